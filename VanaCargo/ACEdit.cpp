@@ -151,14 +151,14 @@ void CACEdit::AddSearchStrings(LPCTSTR Strings[])
 
 /*********************************************************************/
 
-void CACEdit::AddSearchString(LPCTSTR lpszString)
+void CACEdit::AddSearchString(LPCTSTR lpszString, DWORD Score)
 {
 	if (m_iType == -1)
 	{
 		ASSERT(0); return;
 	}
 
-	m_Liste.AddSearchString(lpszString);
+	m_Liste.AddSearchString(lpszString, Score);
 }
 
 /*********************************************************************/
@@ -63,7 +63,7 @@ public:
 	// Attribute
 public:
 	void Init();
-	void AddSearchString(LPCTSTR lpszString);
+	void AddSearchString(LPCTSTR lpszString, DWORD Score = 0);
 	void AddSearchStrings(LPCTSTR Strings[]);
 	void RemoveSearchAll();
 	void SetStartDirectory(LPCTSTR lpszString);
@@ -3,7 +3,9 @@
 
 #include "stdafx.h"
 #include "ACListWnd.h"
+#include "SearchFuzzy.h"
 #include <VersionHelpers.h>
+#include <algorithm>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -19,6 +21,27 @@ static UINT auIDStatusBar[] =
 #define _MAX_ENTRYS_ 8
 #define _MODE_FIND_ALL_ (1L << 5)
 
+// entry of the search list matching the text within a few typos
+typedef struct _FuzzyCandidate
+{
+	int Index;
+	FuzzyScore Score;
+} FuzzyCandidate;
+
+static int CompareFuzzyCandidate(const void* p1, const void* p2)
+{
+	const FuzzyCandidate *pLeft = (const FuzzyCandidate*)p1;
+	const FuzzyCandidate *pRight = (const FuzzyCandidate*)p2;
+
+	if (pLeft->Score.Distance != pRight->Score.Distance)
+		return (int)pLeft->Score.Distance - (int)pRight->Score.Distance;
+
+	if (pLeft->Score.Occurrences != pRight->Score.Occurrences)
+		return (int)pRight->Score.Occurrences - (int)pLeft->Score.Occurrences;
+
+	return pLeft->Index - pRight->Index;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // CACListWnd
 
@@ -45,6 +68,7 @@ CACListWnd::CACListWnd()
 	m_LastSize.SetRectEmpty();
 	m_PrefixChar = 0;
 	m_lMode = 0;
+	m_bCompletionDirty = false;
 
 	m_bSelecting = false;
 	m_pBoldFontDC = m_pFontDC = NULL;
@@ -150,6 +174,13 @@ void CACListWnd::DrawItem(CDC* pDC, long m_lItem, long width)
 		StrLen = EditText.GetLength();
 		StrPos = SearchStr.Find(EditText);
 
+		// entries found with typos have no exact part to highlight
+		if (StrPos < 0)
+		{
+			StrPos = 0;
+			StrLen = 0;
+		}
+
 		Part0 = m_DisplayStr.Left(StrPos);
 		Part1 = m_DisplayStr.Mid(StrPos, StrLen);
 		Part2 = m_DisplayStr.Right(DisplayStrLen - StrPos - StrLen);
@@ -636,7 +667,7 @@ int CACListWnd::FindString(int nStartAfter, LPCTSTR lpszString, bool m_bDisplayO
 
 	if (!m_bDisplayOnly)
 	{
-		CString m_Str1, m_Str2 = lpszString;
+		CString m_Str2 = lpszString;
 		if (!m_pEditParent)
 		{
 			ShowWindow(false);
@@ -656,35 +687,31 @@ int CACListWnd::FindString(int nStartAfter, LPCTSTR lpszString, bool m_bDisplayO
 		}
 
 		m_DisplayList.RemoveAll();
+		UpdateCompletion();
 
-		m_Str2.MakeUpper();
+		std::vector<size_t> Entries;
+		LPCTSTR pText = m_Str2;
+		// the prefix character is displayed before every entry: typed, the rest must start an entry
+		bool Prefixed = (m_PrefixChar != 0 && m_Str2[0] == m_PrefixChar);
 
-		for (int i = nStartAfter + 1; i < m_SearchList.GetSize(); i++)
-		{
-			if (m_PrefixChar)
-				m_Str1 = m_PrefixChar;
-			else
-				m_Str1 = _T("");
-
-			m_Str1 += m_SearchList.GetAt(i);
+		if (Prefixed)
+			pText++;
 
-			m_Str1.MakeUpper();
+		if ((m_lMode & _MODE_FIND_ALL_) && Prefixed == false)
+			m_Completion.FindContains(pText, _MAX_ENTRYS_, Entries);
+		else if (m_PrefixChar == 0 || Prefixed)  // _MODE_FIND_EXACT_
+			m_Completion.FindPrefix(pText, _MAX_ENTRYS_, Entries);
 
-			if (m_lMode & _MODE_FIND_ALL_)
-			{
-				if (m_Str1.Find(m_Str2) >= 0)
-				{
-					m_DisplayList.Add(m_SearchList.GetAt(i));
-				}
-			}
-			else  // _MODE_FIND_EXACT_
-			{
-				if (m_Str1.Find(m_Str2) == 0)
-				{
-					m_DisplayList.Add(m_SearchList.GetAt(i));
-				}
-			}
+		// the entries come sorted on their score, then on their folded text
+		for (size_t i = 0; i < Entries.size(); i++)
+		{
+			if ((int)Entries[i] > nStartAfter)
+				m_DisplayList.Add(m_SearchList.GetAt((INT_PTR)Entries[i]));
 		}
+
+		// nothing contains the text: offer the entries within a few typos of it, closest first
+		if ((m_lMode & _MODE_FIND_ALL_) && m_DisplayList.GetSize() == 0)
+			FindFuzzy(nStartAfter, lpszString);
 	}
 	m_lCount = (long)m_DisplayList.GetSize();
 
@@ -728,8 +755,6 @@ int CACListWnd::FindString(int nStartAfter, LPCTSTR lpszString, bool m_bDisplayO
 
 		if (m_AktCount != m_DisplayList.GetSize())
 			m_lSelItem = -1;
-
-		SortList(m_DisplayList);
 	}
 	else
 	{
@@ -741,6 +766,57 @@ int CACListWnd::FindString(int nStartAfter, LPCTSTR lpszString, bool m_bDisplayO
 
 /*********************************************************************/
 
+void CACListWnd::UpdateCompletion()
+{
+	if (m_bCompletionDirty == false)
+		return;
+
+	m_Completion.Clear();
+
+	for (int i = 0; i < m_SearchList.GetSize(); i++)
+	{
+		const CString &Entry = m_SearchList.GetAt(i);
+
+		m_Completion.Add(Entry.GetString(), Entry.GetLength(), m_SearchScores.GetAt(i));
+	}
+
+	m_Completion.Build();
+	m_bCompletionDirty = false;
+}
+
+/*********************************************************************/
+
+bool CACListWnd::FindFuzzy(int nStartAfter, LPCTSTR lpszString)
+{
+	FuzzyPattern Pattern;
+	int Count = (int)m_SearchList.GetSize() - (nStartAfter + 1);
+
+	if (Count <= 0 || Pattern.Compile(lpszString, -1) == false || Pattern.GetMaxDistance() == 0)
+		return false;
+
+	FuzzyCandidate *pCandidates = new FuzzyCandidate[Count];
+	int Found = 0;
+
+	for (int i = nStartAfter + 1; i < m_SearchList.GetSize(); i++)
+	{
+		const CString &Entry = m_SearchList.GetAt(i);
+
+		if (Pattern.Match(Entry.GetString(), Entry.GetLength(), pCandidates[Found].Score))
+			pCandidates[Found++].Index = i;
+	}
+
+	qsort(pCandidates, Found, sizeof(FuzzyCandidate), CompareFuzzyCandidate);
+
+	for (int i = 0; i < Found && i < _MAX_ENTRYS_; i++)
+		m_DisplayList.Add(m_SearchList.GetAt(pCandidates[i].Index));
+
+	delete[] pCandidates;
+
+	return (Found > 0);
+}
+
+/*********************************************************************/
+
 int CACListWnd::SelectString(LPCTSTR lpszString)
 {
 	int item = FindString(-1, lpszString);
@@ -966,39 +1042,37 @@ void CACListWnd::OnGetMinMaxInfo(MINMAXINFO FAR* lpMMI)
 
 /*********************************************************************/
 
-int CACListWnd::CompareString(const void* p1, const void* p2)
+void CACListWnd::SortSearchList()
 {
-	return _stricmp(*(char**)p1, *(char**)p2);
-}
-
-/*********************************************************************/
-
-void CACListWnd::SortList(CStringArray& m_List)
-{
-	int m_Count = (int)m_List.GetSize();
+	int m_Count = (int)m_SearchList.GetSize();
 
 	if (m_Count > 1)
 	{
 		CStringArray m_Liste1;
-		m_Liste1.Copy(m_List);
-
-		LPCTSTR* ppSortArray = new LPCTSTR[m_Count + 1];
+		CDWordArray m_Scores1;
+		std::vector<int> Order(m_Count);
 
 		for (int i = 0; i < m_Count; i++)
-		{
-			ppSortArray[i] = (LPCTSTR)m_Liste1.GetAt(i);
-		}
+			Order[i] = i;
 
-		m_List.RemoveAll();
+		// the scores follow their entries
+		std::stable_sort(Order.begin(), Order.end(), [this](int Left, int Right)
+		{
+			return _tcsicmp(m_SearchList.GetAt(Left), m_SearchList.GetAt(Right)) < 0;
+		});
 
-		qsort(ppSortArray, m_Count, sizeof(LPCTSTR), CompareString);
+		m_Liste1.SetSize(m_Count);
+		m_Scores1.SetSize(m_Count);
 
 		for (int i = 0; i < m_Count; i++)
 		{
-			m_List.Add((LPCTSTR)ppSortArray[i]);
+			m_Liste1.SetAt(i, m_SearchList.GetAt(Order[i]));
+			m_Scores1.SetAt(i, m_SearchScores.GetAt(Order[i]));
 		}
-		m_Liste1.RemoveAll();
-		delete[] ppSortArray;
+
+		m_SearchList.Copy(m_Liste1);
+		m_SearchScores.Copy(m_Scores1);
+		m_bCompletionDirty = true;
 	}
 }
 
@@ -17,6 +17,7 @@
 *********************************************************************/
 
 #include <afxtempl.h>		// CArray
+#include "SearchCompletion.h"
 #define ENAC_UPDATE        WM_USER + 1200 
 /////////////////////////////////////////////////////////////////////////////
 // Fenster CACListWnd 
@@ -34,24 +35,22 @@ public:
 	int SelectString(LPCTSTR lpszString);
 	bool GetText(int item, CString& m_Text);
 
-	void AddSearchString(LPCTSTR lpszString)
+	// the entries with the highest score are suggested first
+	void AddSearchString(LPCTSTR lpszString, DWORD Score = 0)
 	{
-		m_SearchList.Add(lpszString);
+		m_SearchList.Add(lpszString); m_SearchScores.Add(Score); m_bCompletionDirty = true;
 	}
 
 	void RemoveAll()
 	{
-		m_SearchList.RemoveAll(); m_DisplayList.RemoveAll();
+		m_SearchList.RemoveAll(); m_SearchScores.RemoveAll(); m_DisplayList.RemoveAll(); m_bCompletionDirty = true;
 	}
 
 	CString GetString();
 	CString GetNextString(int m_iChar);
 
 	void CopyList();
-	void SortSearchList()
-	{
-		SortList(m_SearchList);
-	}
+	void SortSearchList();
 
 // Attribute
 public:
@@ -62,6 +61,7 @@ public:
 // Operationen
 public:
 	CStringArray m_SearchList;
+	CDWordArray m_SearchScores;
 // berschreibungen
 	// Vom Klassen-Assistenten generierte virtuelle Funktionsberschreibungen
 	//{{AFX_VIRTUAL(CACListWnd)
@@ -98,6 +98,9 @@ protected:
 	DECLARE_MESSAGE_MAP()
 
 	CStringArray m_DisplayList;
+	// folded and sorted keys of m_SearchList, rebuilt on the first search after it changed
+	SearchCompletion m_Completion;
+	bool m_bCompletionDirty;
 	CScrollBar m_VertBar, m_HoriBar;
 	CRect m_LastSize, m_ParentRect;
 	CFont *m_pFontDC, *m_pBoldFontDC;
@@ -114,8 +117,8 @@ protected:
 	void SetProp();
 	long ScrollBarWidth();
 	void InvalidateAndScroll();
-	void SortList(CStringArray& m_List);
-	static int CompareString(const void* p1, const void* p2);
+	void UpdateCompletion();
+	bool FindFuzzy(int nStartAfter, LPCTSTR lpszString);
 
 	static HFONT GetDefaultFont(LOGFONT &LogFont);
 };
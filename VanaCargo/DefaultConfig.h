@@ -10,6 +10,9 @@
 #define INI_FILE_COLUMNS_SECTION        _T("Columns")
 #define INI_FILE_EXPORT_SECTION         _T("Export")
 #define INI_FILE_CONFIG_SECTION         _T("Config")
+// character ID = FindAll to read its bags from its FindAll dump instead of its DAT files,
+// a name without a USER folder lists the character of that FindAll dump
+#define INI_FILE_SOURCES_SECTION        _T("Sources")
 
 #define INI_FILE_COL_NAME_KEY           _T("Name")
 #define INI_FILE_COL_ATTR_KEY           _T("Attr")
@@ -86,6 +89,7 @@
 #define INI_FILE_FINDALL_ENABLED_VALUE false
 #define INI_FILE_FINDALL_DATA_PATH_VALUE _T("addons\\findAll\\data")
 #define INI_FILE_FINDALL_KEYITEMS_PATH_VALUE _T("res\\key_items.lua")
+#define INI_FILE_SOURCE_FINDALL_VALUE   _T("FindAll")
 
 #define INI_FILE_GAME_REGION_COMMENT    _T(";1 = JP | 2 = US | 3 = EU")
 #define INI_FILE_LANGUAGE_COMMENT       _T(";1 = JP | 2 = US | 3 = FR | 4 = DE")
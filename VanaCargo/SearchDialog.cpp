@@ -191,6 +191,18 @@ void SearchDialog::OnOK()
 	CDialog::OnOK();
 }
 
+// replaces the suggestions of the search term, the highest scores are suggested first
+void SearchDialog::SetCompletions(const CStringArray &Names, const CDWordArray &Scores)
+{
+	if (IsWindow(m_SearchEdit) == FALSE)
+		return;
+
+	m_SearchEdit.RemoveSearchAll();
+
+	for (INT_PTR i = 0; i < Names.GetCount(); ++i)
+		m_SearchEdit.AddSearchString(Names.GetAt(i), Scores.GetAt(i));
+}
+
 void SearchDialog::GetBitMask(const CListCtrl *pList, DWORD &Field)
 {
 	int ListIndex = -1;
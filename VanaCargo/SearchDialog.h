@@ -14,6 +14,7 @@ public:
 		return m_pParams;
 	}
 	void GetBitMask(const CListCtrl *pList, DWORD &Field);
+	void SetCompletions(const CStringArray &Names, const CDWordArray &Scores);
 
 	// Dialog Data
 	enum
@@ -142,6 +142,8 @@ BEGIN_MESSAGE_MAP(FFXiItemList, CListCtrl)
 	ON_NOTIFY_EX_RANGE(TTN_NEEDTEXTW, 0, 0xFFFF, OnToolTipText)
 	ON_NOTIFY_EX_RANGE(TTN_NEEDTEXTA, 0, 0xFFFF, OnToolTipText)
 	ON_NOTIFY(HDN_ITEMCLICK, 0, OnColumnSort)
+	ON_NOTIFY_REFLECT(LVN_GETDISPINFO, OnGetDispInfo)
+	ON_NOTIFY_REFLECT(LVN_ODFINDITEM, OnFindItem)
 END_MESSAGE_MAP()
 
 // CLootBoxDlg dialog
@@ -159,6 +161,8 @@ CLootBoxDlg::CLootBoxDlg(CWnd* pParent)
 	m_pIni->SetSpaces(false);
 	m_CompactList = false;
 	m_pSearchDlg = NULL;
+	m_CatalogLanguage = -1;
+	m_CompletionsValid = false;
 	m_InitDone = false;
 	m_pHelper = NULL;
 	m_PromptForServer = false;
@@ -482,6 +486,7 @@ void CLootBoxDlg::LoadGlobalMap(bool Update)
 				m_pHelper->ParseInventoryFile(InvFile, LocationInfo, pItemMap, m_Language, Update);
 
 				pInvMap->SetAt(FileIndex, pItemMap);
+				m_CompletionsValid = false;
 			}
 
 			m_ProgressDlg.m_Progress.StepIt();
@@ -974,7 +979,7 @@ void CLootBoxDlg::OnDestroy()
 	m_pIni->SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_LAST_TAB_KEY, SelectedTab);
 	m_pIni->SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_LAST_CHARACTER_KEY, SelectedChar);
 
-	pInvList->DeleteAllItems();
+	pInvList->ClearItems();
 	DeleteGlobalMap();
 
 	MapPos = m_SearchTabs.GetStartPosition();
@@ -1096,6 +1101,7 @@ void CLootBoxDlg::DeleteGlobalMap()
 	InventoryItem *pItem;
 	ItemArray *pItemArr;
 
+	m_CompletionsValid = false;
 	GlobalPos = m_GlobalMap.GetStartPosition();
 	pItemArr = NULL;
 	pInvMap = NULL;
@@ -1328,7 +1334,7 @@ void CLootBoxDlg::OnItemDoubleClick(NMHDR *pNMHDR, LRESULT *pResult)
 	if (pList && ItemIndex < 0)
 		ItemIndex = pList->GetNextItem(-1, LVNI_SELECTED);
 
-	pItem = (pList && ItemIndex >= 0) ? (InventoryItem*)pList->GetItemData(ItemIndex) : NULL;
+	pItem = (pList != NULL) ? pList->GetRowItem(ItemIndex) : NULL;
 
 	if (pItem && pItemActivate != NULL && pItemActivate->iSubItem == INVENTORY_LIST_COL_NAME)
 		OpenBgWikiUrl(pItem);
@@ -1393,7 +1399,7 @@ void CLootBoxDlg::OnInventoryListRightClick(NMHDR *pNMHDR, LRESULT *pResult)
 			Cmd = Menu.TrackPopupMenu(TPM_RETURNCMD | TPM_RIGHTBUTTON, MousePos.x, MousePos.y, this);
 			if (Cmd == OpenWikiCmd)
 			{
-				InventoryItem *pItem = (InventoryItem*)pList->GetItemData(ItemIndex);
+				InventoryItem *pItem = pList->GetRowItem(ItemIndex);
 				OpenBgWikiUrl(pItem);
 			}
 		}
@@ -1489,6 +1495,7 @@ void CLootBoxDlg::SetItemMapAt(int SelectedCharIndex, int SelectedTabIndex, Item
 		}
 
 		pInvMap->SetAt(SelectedTabIndex, pItemList);
+		m_CompletionsValid = false;
 	}
 }
 
@@ -1529,7 +1536,7 @@ ItemArray* CLootBoxDlg::GetItemMap(int SelectedCharIndex, int SelectedTabIndex)
 BOOL CLootBoxDlg::RefreshList(const ItemArray *pItemList)
 {
 	FFXiItemList* pList = (FFXiItemList*)GetDlgItem(IDC_INVENTORY_LIST);
-	int ImageIndex = 0, ItemIndex = 0, ImageCount, IconIndex = 0;
+	int ImageIndex = 0, ImageCount, IconIndex = 0;
 	CString ItemCountStr;
 	CBitmap Bitmap;
 	CFile InvFile;
@@ -1537,7 +1544,7 @@ BOOL CLootBoxDlg::RefreshList(const ItemArray *pItemList)
 
 	if (pList)
 	{
-		pList->DeleteAllItems();
+		pList->ClearItems();
 		pList->BlockRedraw();
 
 		ImageCount = m_pItemIconList->GetImageCount();
@@ -1588,23 +1595,13 @@ BOOL CLootBoxDlg::RefreshList(const ItemArray *pItemList)
 					m_ItemsCount++;
 					IconIndex++;
 
+					// the list shows the count after the name of a compact row
 					if (m_CompactList && pItem->RefCount > 1)
-					{
-						CString ItemText;
-
-						pList->AddItem(pItem, ItemIndex);
-						// update the name of the item
-						ItemText.Format(_T("%s (%d)"), pItem->ItemName, pItem->RefCount);
-						pList->UpdateItemText(ItemText, ItemIndex - 1, 0);
 						pItem->ItemToolTip.Format(_T("%d %s"), pItem->RefCount, pItem->LogName2);
-					}
 					else
-					{
 						pItem->ItemToolTip = pItem->LogName;
 
-						for (int i = 0; i < pItem->RefCount; i++)
-							pList->AddItem(pItem, ItemIndex);
-					}
+					pList->AddItem(pItem);
 				}
 
 			}
@@ -1615,6 +1612,7 @@ BOOL CLootBoxDlg::RefreshList(const ItemArray *pItemList)
 
 		ItemCountStr.Format(_T("%d item(s)"), m_ItemsCount);
 		pList->BlockRedraw(false);
+		pList->UpdateItemCount();
 
 		GetDlgItem(IDC_ITEM_COUNT)->SetWindowText(ItemCountStr);
 
@@ -1679,14 +1677,121 @@ afx_msg void CLootBoxDlg::OnSearch()
 	if (m_pSearchDlg == NULL)
 		m_pSearchDlg = new SearchDialog(m_pHelper, this);
 
-	if (m_pSearchDlg->m_hWnd == NULL)
+	bool Created = (m_pSearchDlg->m_hWnd == NULL);
+
+	if (Created)
 		m_pSearchDlg->Create(IDD_SEARCH_DIALOG, this);
 	else
 		m_pSearchDlg->ShowWindow(SW_SHOW);
 
+	UpdateSearchCompletions(Created);
 	m_pSearchDlg->CenterWindow();
 }
 
+// the search box keeps its suggestions while hidden: they are only sent again when they were rebuilt
+void CLootBoxDlg::UpdateSearchCompletions(bool Created)
+{
+	if (m_CompletionsValid && m_CatalogLanguage == m_Language)
+	{
+		if (Created)
+			m_pSearchDlg->SetCompletions(m_CompletionNames, m_CompletionScores);
+
+		return;
+	}
+
+	BuildSearchCompletions();
+	m_pSearchDlg->SetCompletions(m_CompletionNames, m_CompletionScores);
+}
+
+// the scores are computed once per catalog and global map, typing only looks the suggestions up
+void CLootBoxDlg::BuildSearchCompletions()
+{
+	CMap<DWORD, DWORD, int, int> Owners, LastOwner;
+	CMap<CString, LPCTSTR, INT_PTR, INT_PTR> NameIndex;
+	int CharID, FileID, ItemID, Count, Owner;
+	POSITION GlobalPos, InvPos, ItemPos;
+	InventoryMap *pInvMap;
+	InventoryItem *pItem;
+	ItemArray *pItemArr;
+	INT_PTR Index;
+
+	if (m_CatalogLanguage != m_Language)
+	{
+		m_pHelper->ReadItemCatalog(m_Language, m_CatalogIDs, m_CatalogNames);
+		m_CatalogLanguage = m_Language;
+	}
+
+	// count the characters owning each item
+	LoadGlobalMap();
+	GlobalPos = m_GlobalMap.GetStartPosition();
+
+	while (GlobalPos != NULL)
+	{
+		m_GlobalMap.GetNextAssoc(GlobalPos, CharID, pInvMap);
+
+		if (pInvMap == NULL)
+			continue;
+
+		InvPos = pInvMap->GetStartPosition();
+
+		while (InvPos != NULL)
+		{
+			pInvMap->GetNextAssoc(InvPos, FileID, pItemArr);
+
+			if (pItemArr == NULL)
+				continue;
+
+			ItemPos = pItemArr->GetStartPosition();
+
+			while (ItemPos != NULL)
+			{
+				pItemArr->GetNextAssoc(ItemPos, ItemID, pItem);
+
+				if (pItem == NULL)
+					continue;
+
+				// an item in several bags of a character counts once
+				if (LastOwner.Lookup(pItem->ItemHdr.ItemID, Owner) && Owner == CharID)
+					continue;
+
+				LastOwner.SetAt(pItem->ItemHdr.ItemID, CharID);
+				Count = 0;
+				Owners.Lookup(pItem->ItemHdr.ItemID, Count);
+				Owners.SetAt(pItem->ItemHdr.ItemID, Count + 1);
+			}
+		}
+	}
+
+	m_CompletionNames.RemoveAll();
+	m_CompletionScores.RemoveAll();
+
+	// ranked by the number of owners, then by the most recent items (the highest IDs)
+	for (INT_PTR i = 0; i < m_CatalogIDs.GetCount(); ++i)
+	{
+		DWORD ID = m_CatalogIDs.GetAt(i);
+		DWORD Score;
+
+		Count = 0;
+		Owners.Lookup(ID, Count);
+		Score = ((DWORD)Count << 16) | (ID & 0xFFFF);
+
+		// items sharing a name are suggested once, with the best score
+		if (NameIndex.Lookup(m_CatalogNames.GetAt(i), Index))
+		{
+			if (Score > m_CompletionScores.GetAt(Index))
+				m_CompletionScores.SetAt(Index, Score);
+		}
+		else
+		{
+			NameIndex.SetAt(m_CatalogNames.GetAt(i), m_CompletionNames.Add(m_CatalogNames.GetAt(i)));
+			m_CompletionScores.Add(Score);
+		}
+	}
+
+	// LoadGlobalMap above invalidated them if it read anything
+	m_CompletionsValid = true;
+}
+
 afx_msg void CLootBoxDlg::OnExport()
 {
 	ExportDialog Dialog(m_pHelper, m_CharacterNames, m_pIni, this);
@@ -1702,7 +1807,7 @@ afx_msg void CLootBoxDlg::OnExport()
 			CFileDialog SaveDialog(FALSE, _T("*.csv"), _T("export.csv"),
 				OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY | OFN_NOCHANGEDIR
 				| OFN_PATHMUSTEXIST | OFN_ENABLESIZING,
-				_T("(*.csv) Excel 2000/XP||"), this);
+				_T("(*.csv) Excel 2000/XP|*.csv|(*.csv) Excel 5.0/97|*.csv|(*.csv) UTF-8|*.csv||"), this);
 
 			if (SaveDialog.DoModal() == IDOK)
 			{
@@ -1714,7 +1819,7 @@ afx_msg void CLootBoxDlg::OnExport()
 				InventoryMap *pInvMap;
 				InventoryItem *pItem;
 				ItemArray *pItemMap;
-				CString Filename;
+				CString Filename, Url;
 				POSITION ItemPos;
 				int ItemID;
 
@@ -1722,7 +1827,8 @@ afx_msg void CLootBoxDlg::OnExport()
 
 				Filename = SaveDialog.GetPathName();
 
-				Exporter.CreateFile(Filename, ColumnCount);
+				// the filter index matches CsvWriter::CsvFormat
+				Exporter.CreateFile(Filename, ColumnCount, SaveDialog.m_ofn.nFilterIndex);
 
 				Exporter.AddColumn(_T("Character"))
 					.AddColumn(_T("Location"));
@@ -1805,7 +1911,6 @@ afx_msg void CLootBoxDlg::OnExport()
 
 									if ((BitMask & EXPORT_BG_URL) == EXPORT_BG_URL)
 									{
-										CString Url;
 										FFXiItemList::BuildBgWikiUrl(pItem->ItemName, Url);
 										Exporter.AddColumn(Url);
 									}
@@ -1896,44 +2001,59 @@ void CLootBoxDlg::GetSearchResults(SearchData *pData)
 			int CharID, FileID, ItemID, ItemCount, ListIndex = 0;
 			POSITION GlobalPos, InvPos, ItemPos;
 			SearchHandler Searcher(pData);
+			CArray<InventoryItem*, InventoryItem*> Batch;
 			InventoryMap *pInvMap;
 			InventoryItem *pItem;
 			ItemArray *pItemArr;
 
-			GlobalPos = m_GlobalMap.GetStartPosition();
 			pItemArr = NULL;
 			pInvMap = NULL;
 
 			ItemCount = GlobalMapCount();
 			// Init progress bar
 			m_ProgressDlg.Create(IDD_PROGRESS, this);
-			m_ProgressDlg.m_Progress.SetRange(0, ItemCount);
 			m_ProgressDlg.m_Progress.SetStep(1);
 
-			while (GlobalPos != NULL)
+			// the second pass tolerates typos in the term and only runs if the first one found nothing
+			for (int Pass = 0; Pass < 2; ++Pass)
 			{
-				m_GlobalMap.GetNextAssoc(GlobalPos, CharID, pInvMap);
+				if (Pass > 0 && (pData->Items.IsEmpty() == false || Searcher.EnableFuzzy() == false))
+					break;
 
-				if (pInvMap != NULL)
+				GlobalPos = m_GlobalMap.GetStartPosition();
+				m_ProgressDlg.m_Progress.SetRange(0, ItemCount);
+				m_ProgressDlg.m_Progress.SetPos(0);
+
+				while (GlobalPos != NULL)
 				{
-					InvPos = pInvMap->GetStartPosition();
+					m_GlobalMap.GetNextAssoc(GlobalPos, CharID, pInvMap);
 
-					while (InvPos != NULL)
+					if (pInvMap != NULL)
 					{
-						pInvMap->GetNextAssoc(InvPos, FileID, pItemArr);
+						InvPos = pInvMap->GetStartPosition();
 
-						if (pItemArr != NULL)
+						while (InvPos != NULL)
 						{
-							ItemPos = pItemArr->GetStartPosition();
+							pInvMap->GetNextAssoc(InvPos, FileID, pItemArr);
 
-							while (ItemPos != NULL)
+							if (pItemArr != NULL)
 							{
-								pItemArr->GetNextAssoc(ItemPos, ItemID, pItem);
+								ItemPos = pItemArr->GetStartPosition();
+								Batch.SetSize(0, pItemArr->GetCount());
+
+								// each inventory file is filtered as one batch
+								while (ItemPos != NULL)
+								{
+									pItemArr->GetNextAssoc(ItemPos, ItemID, pItem);
+
+									if (pItem != NULL)
+										Batch.Add(pItem);
+								}
 
-								if (pItem != NULL)
-									Searcher.ProcessAll(pItem);
+								if (Batch.GetSize() > 0)
+									Searcher.ProcessBatch(Batch.GetData(), (int)Batch.GetSize());
 
-								m_ProgressDlg.m_Progress.StepIt();
+								m_ProgressDlg.m_Progress.OffsetPos((int)pItemArr->GetCount());
 							}
 						}
 					}
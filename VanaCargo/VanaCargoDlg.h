@@ -57,11 +57,21 @@ protected:
 	CharacterMap m_GlobalMap;
 	CProgress_Dlg m_ProgressDlg;
 	SearchDialog *m_pSearchDlg;
+	// every item of the DAT files in m_CatalogLanguage, suggested by the search box
+	CArray<DWORD, DWORD> m_CatalogIDs;
+	CStringArray m_CatalogNames;
+	int m_CatalogLanguage;
+	// the suggestions ranked by owners, rebuilt when the catalog or the global map change
+	CStringArray m_CompletionNames;
+	CDWordArray m_CompletionScores;
+	bool m_CompletionsValid;
 
 	void RemoveItemIcons();
 	void DeleteGlobalMap();
 	int GlobalMapCount();
 	void GetSearchResults(SearchData *pParams);
+	void UpdateSearchCompletions(bool Created);
+	void BuildSearchCompletions();
 	ItemArray* GetItemMap(int SelectedCharIndex, int SelectedTabIndex);
 	void SetItemMapAt(int SelectedCharIndex, int SelectedTabIndex, ItemArray *pItemList);
 	void SetServerMenu(const CString &serverName, bool Check = true);
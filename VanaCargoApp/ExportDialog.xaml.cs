@@ -55,6 +55,7 @@ namespace VanaCargoApp
 
         public IReadOnlyList<CharacterOption> SelectedCharacters => _characters.Where(c => c.IsSelected).ToList();
         public IReadOnlyList<ColumnOption> SelectedColumns => _columns.Where(c => c.IsSelected).ToList();
+        public bool IsIncremental => IncrementalCheck.IsChecked == true;
 
         private void OnOk(object sender, RoutedEventArgs e)
         {
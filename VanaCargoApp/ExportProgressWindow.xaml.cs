@@ -1,10 +1,14 @@
+using System.Threading;
 using System.Windows;
 
 namespace VanaCargoApp
 {
     public partial class ExportProgressWindow : Window
     {
-        public bool IsCanceled { get; private set; }
+        private readonly CancellationTokenSource _cts = new CancellationTokenSource();
+
+        public bool IsCanceled => _cts.IsCancellationRequested;
+        public CancellationToken Token => _cts.Token;
 
         public ExportProgressWindow()
         {
@@ -20,7 +24,7 @@ namespace VanaCargoApp
 
         private void OnCancel(object sender, RoutedEventArgs e)
         {
-            IsCanceled = true;
+            _cts.Cancel();
             CancelButton.IsEnabled = false;
         }
     }
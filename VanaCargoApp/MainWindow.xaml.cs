@@ -4,6 +4,7 @@ using System.Diagnostics;
 using System.Globalization;
 using System.IO;
 using System.Linq;
+using System.Threading;
 using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
@@ -27,6 +28,7 @@ namespace VanaCargoApp
         private const string DarkModeKey = "DarkMode";
         private LoadResult _loadResult;
         private ManagedTab[] _currentTabs;
+        private CancellationTokenSource _loadCts;
         private string _configPath;
         private bool _darkMode;
 
@@ -59,6 +61,13 @@ namespace VanaCargoApp
                 CharactersList.SelectedIndex = 0;
         }
 
+        protected override void OnClosed(EventArgs e)
+        {
+            // closes the DAT files and frees the inventories kept by the session
+            _bridge.Dispose();
+            base.OnClosed(e);
+        }
+
         private void OnAboutClick(object sender, RoutedEventArgs e)
         {
             var win = new AboutWindow
@@ -68,7 +77,7 @@ namespace VanaCargoApp
             win.ShowDialog();
         }
 
-        private void OnCharacterSelected(object sender, SelectionChangedEventArgs e)
+        private async void OnCharacterSelected(object sender, SelectionChangedEventArgs e)
         {
             if (_loadResult == null)
                 return;
@@ -79,7 +88,31 @@ namespace VanaCargoApp
             if (character == null)
                 return;
 
-            var tabs = _bridge.LoadInventoryForCharacter(_loadResult.Settings, character, _loadResult.Tabs);
+            // the load of the previously selected character stops within its current bag
+            _loadCts?.Cancel();
+            var cts = new CancellationTokenSource();
+            _loadCts = cts;
+
+            StatusText.Text = $"Loading inventory for {character.Name}...";
+
+            ManagedTab[] tabs;
+            try
+            {
+                tabs = await _bridge.LoadInventoryAsync(_loadResult.Settings, character, _loadResult.Tabs,
+                    (completed, total) => Dispatcher.BeginInvoke(new Action(() =>
+                    {
+                        if (_loadCts == cts && completed < total)
+                            StatusText.Text = $"Loading inventory for {character.Name}... {completed}/{total} bags.";
+                    })), cts.Token);
+            }
+            catch (OperationCanceledException)
+            {
+                return;
+            }
+
+            if (_loadCts != cts)
+                return;
+
             if (tabs == null)
             {
                 MessageBox.Show(this, "Failed to load inventory.", "VanaCargo",
@@ -192,7 +225,7 @@ namespace VanaCargoApp
 
             var saveDialog = new SaveFileDialog
             {
-                Filter = "CSV files (*.csv)|*.csv",
+                Filter = "CSV files (*.csv)|*.csv|Columnar files (*.vccol)|*.vccol",
                 FileName = "export.csv",
                 OverwritePrompt = true
             };
@@ -200,91 +233,49 @@ namespace VanaCargoApp
             if (saveDialog.ShowDialog(this) != true)
                 return;
 
-            var includeBg = selectedColumns.Any(c => c.Key == "BgWiki");
-            var includeCount = selectedColumns.Any(c => c.Key == "Count");
-            var includeName = selectedColumns.Any(c => c.Key == "Name");
-            var includeAttr = selectedColumns.Any(c => c.Key == "Attr");
-            var includeDesc = selectedColumns.Any(c => c.Key == "Description");
-            var includeType = selectedColumns.Any(c => c.Key == "Type");
-            var includeRaces = selectedColumns.Any(c => c.Key == "Races");
-            var includeLevel = selectedColumns.Any(c => c.Key == "Level");
-            var includeJobs = selectedColumns.Any(c => c.Key == "Jobs");
-            var includeRemarks = selectedColumns.Any(c => c.Key == "Remarks");
+            var columns = ExportColumns.None;
+            foreach (var column in selectedColumns)
+            {
+                if (Enum.TryParse(column.Key, out ExportColumns flag))
+                    columns |= flag;
+            }
+
+            var characters = selectedChars
+                .Select(option => _loadResult.Characters.FirstOrDefault(c => c.Id == option.Id))
+                .Where(c => c != null)
+                .ToArray();
 
             var progress = new ExportProgressWindow { Owner = this };
             progress.Show();
 
             try
             {
-                var rows = await Task.Run(() => LoadExportRows(selectedChars, progress));
-                if (rows == null)
-                {
-                    StatusText.Text = "Export canceled.";
-                    return;
-                }
+                ProgressHandler onProgress = (completed, total) => progress.Dispatcher.BeginInvoke(new Action(() =>
+                    progress.UpdateStatus($"Exporting inventories... {completed}/{total}", completed, total)));
 
-                var totalRows = rows.Count;
-                progress.UpdateStatus("Writing export file...", 0, totalRows);
+                // the core formats and writes the rows, only the progress comes back;
+                // the columnar file has every column, typed, for the analysis tools
+                var isColumnar = saveDialog.FilterIndex == 2;
+                var rowCount = isColumnar
+                    ? await _bridge.ExportColumnarAsync(_loadResult.Settings, characters, _loadResult.Tabs,
+                        saveDialog.FileName, onProgress, progress.Token)
+                    : await _bridge.ExportCsvAsync(_loadResult.Settings, characters, _loadResult.Tabs,
+                        saveDialog.FileName, columns, exportDialog.IsIncremental, onProgress, progress.Token);
 
-                await Task.Run(() =>
+                if (rowCount < 0)
                 {
-                    using (var writer = new StreamWriter(saveDialog.FileName, false, new System.Text.UTF8Encoding(true)))
-                    {
-                        var header = new List<string> { "Character", "Location" };
-                        if (includeName) header.Add("Name");
-                        if (includeAttr) header.Add("Attributes");
-                        if (includeDesc) header.Add("Description");
-                        if (includeType) header.Add("Type");
-                        if (includeRaces) header.Add("Races");
-                        if (includeLevel) header.Add("Level");
-                        if (includeJobs) header.Add("Jobs");
-                        if (includeRemarks) header.Add("Remarks");
-                        if (includeBg) header.Add("BG Wiki URL");
-                        if (includeCount) header.Add("Count");
-                        
-                        WriteCsvRow(writer, header);
-
-                        for (var i = 0; i < totalRows; i++)
-                        {
-                            if (progress.IsCanceled)
-                                return;
-
-                            var row = rows[i];
-                            var cols = new List<string>
-                            {
-                                row.Character,
-                                row.Location
-                            };
-
-                            if (includeName) cols.Add(row.Item.Name);
-                            if (includeAttr) cols.Add(row.Item.Attr);
-                            if (includeDesc) cols.Add(row.Item.Description);
-                            if (includeType) cols.Add(row.Item.Slot);
-                            if (includeRaces) cols.Add(row.Item.Races);
-                            if (includeLevel) cols.Add(row.Item.Level);
-                            if (includeJobs) cols.Add(row.Item.Jobs);
-                            if (includeRemarks) cols.Add(row.Item.Remarks);
-                            if (includeBg) cols.Add(BuildBgWikiUrl(row.Item.Name));
-                            if (includeCount) cols.Add(row.Item.Count.ToString(CultureInfo.InvariantCulture));
-
-                            WriteCsvRow(writer, cols);
-                            if (i % 50 == 0)
-                            {
-                                progress.Dispatcher.Invoke(() =>
-                                    progress.UpdateStatus($"Writing export file... {i + 1}/{totalRows}", i + 1, totalRows));
-                            }
-                        }
-                    }
-                });
-
-                if (progress.IsCanceled)
-                {
-                    StatusText.Text = "Export canceled.";
+                    MessageBox.Show(this, "The export file could not be written.", "VanaCargo",
+                        MessageBoxButton.OK, MessageBoxImage.Error);
                     return;
                 }
 
-                StatusText.Text = "Export completed.";
-                Process.Start(new ProcessStartInfo(saveDialog.FileName) { UseShellExecute = true });
+                StatusText.Text = $"Export completed ({rowCount} rows).";
+                if (!isColumnar)
+                    Process.Start(new ProcessStartInfo(saveDialog.FileName) { UseShellExecute = true });
+            }
+            catch (OperationCanceledException)
+            {
+                StatusText.Text = "Export canceled.";
             }
             finally
             {
@@ -297,74 +288,6 @@ namespace VanaCargoApp
             Close();
         }
 
-        private sealed class ExportRow
-        {
-            public string Character { get; set; }
-            public string Location { get; set; }
-            public ManagedItem Item { get; set; }
-        }
-
-        private List<ExportRow> LoadExportRows(IReadOnlyList<ExportDialog.CharacterOption> selectedChars, ExportProgressWindow progress)
-        {
-            var rows = new List<ExportRow>();
-            for (var i = 0; i < selectedChars.Count; i++)
-            {
-                if (progress.IsCanceled)
-                    return null;
-
-                var characterOption = selectedChars[i];
-                progress.Dispatcher.Invoke(() => progress.UpdateStatus($"Loading inventories... {i + 1}/{selectedChars.Count}", i + 1, selectedChars.Count));
-
-                var character = _loadResult.Characters.FirstOrDefault(c => c.Id == characterOption.Id);
-                if (character == null)
-                    continue;
-
-                var tabs = _bridge.LoadInventoryForCharacter(_loadResult.Settings, character, _loadResult.Tabs);
-                if (tabs == null)
-                    continue;
-
-                foreach (var tab in tabs)
-                {
-                    if (tab.Items == null)
-                        continue;
-
-                    foreach (var item in tab.Items)
-                    {
-                        rows.Add(new ExportRow
-                        {
-                            Character = character.Name,
-                            Location = tab.Info.DisplayName,
-                            Item = item
-                        });
-                    }
-                }
-            }
-
-            return rows;
-        }
-
-        private static void WriteCsvRow(StreamWriter writer, IReadOnlyList<string> values)
-        {
-            for (var i = 0; i < values.Count; i++)
-            {
-                if (i > 0)
-                    writer.Write(",");
-
-                writer.Write(EscapeCsv(values[i]));
-            }
-            writer.WriteLine();
-        }
-
-        private static string EscapeCsv(string value)
-        {
-            if (string.IsNullOrEmpty(value))
-                return string.Empty;
-
-            var needsQuotes = value.IndexOfAny(new[] { ',', '"', '\n', '\r' }) >= 0;
-            var escaped = value.Replace("\"", "\"\"");
-            return needsQuotes ? $"\"{escaped}\"" : escaped;
-        }
-
         private DataGrid CreateItemsGrid(bool isKeyItems = false)
         {
             var noWrapStyle = new Style(typeof(TextBlock));
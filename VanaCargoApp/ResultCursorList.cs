@@ -0,0 +1,160 @@
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Collections.Specialized;
+using System.Windows.Threading;
+using VanaCargoBridge;
+
+namespace VanaCargoApp
+{
+    internal sealed class SearchResultRow
+    {
+        public string Character { get; set; }
+        public string Location { get; set; }
+        public ManagedItem Item { get; set; }
+    }
+
+    // rows of a native result cursor, a page is only fetched when the grid shows one of its rows
+    internal sealed class ResultCursorList : IList, INotifyCollectionChanged, IDisposable
+    {
+        private const int PageSize = 100;
+        private const int RetryMilliseconds = 100;
+
+        private readonly ResultCursor _cursor;
+        private readonly Dictionary<int, SearchResultRow[]> _pages = new Dictionary<int, SearchResultRow[]>();
+        private static readonly SearchResultRow EmptyRow = new SearchResultRow();
+        // the cursor doesn't wait for a load holding the core: the rows stay empty and are asked again
+        private readonly DispatcherTimer _retryTimer;
+        private ResultSortColumn? _pendingColumn;
+        private bool _pendingDescending;
+
+        public event NotifyCollectionChangedEventHandler CollectionChanged;
+
+        public ResultCursorList(ResultCursor cursor)
+        {
+            _cursor = cursor;
+            _retryTimer = new DispatcherTimer { Interval = TimeSpan.FromMilliseconds(RetryMilliseconds) };
+            _retryTimer.Tick += OnRetryTimerTick;
+        }
+
+        public int Count => _cursor.Count;
+
+        public object this[int index]
+        {
+            get => GetRow(index);
+            set => throw new NotSupportedException();
+        }
+
+        public void Sort(ResultSortColumn column, bool descending)
+        {
+            _pendingColumn = column;
+            _pendingDescending = descending;
+            ApplyPendingSort();
+        }
+
+        public void Dispose()
+        {
+            _retryTimer.Stop();
+            _pages.Clear();
+            _cursor.Dispose();
+        }
+
+        private void ApplyPendingSort()
+        {
+            if (!_cursor.TrySort(_pendingColumn.Value, _pendingDescending))
+            {
+                _retryTimer.Start();
+                return;
+            }
+
+            _pendingColumn = null;
+            _pages.Clear();
+            CollectionChanged?.Invoke(this, new NotifyCollectionChangedEventArgs(NotifyCollectionChangedAction.Reset));
+        }
+
+        private void OnRetryTimerTick(object sender, EventArgs e)
+        {
+            _retryTimer.Stop();
+
+            if (_pendingColumn.HasValue)
+                ApplyPendingSort();
+            else
+                CollectionChanged?.Invoke(this, new NotifyCollectionChangedEventArgs(NotifyCollectionChangedAction.Reset));
+        }
+
+        private SearchResultRow GetRow(int index)
+        {
+            if (index < 0 || index >= Count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            var pageIndex = index / PageSize;
+            if (!_pages.TryGetValue(pageIndex, out var page))
+            {
+                // no page is read in the old order once a sort is waiting for the core
+                ManagedSearchHit[] hits = null;
+                if (_pendingColumn.HasValue || !_cursor.TryGetPage(pageIndex * PageSize, PageSize, ref hits))
+                {
+                    _retryTimer.Start();
+                    return EmptyRow;
+                }
+
+                // null once the inventories were reloaded, the rows stay empty until the next search
+                hits = hits ?? Array.Empty<ManagedSearchHit>();
+                page = new SearchResultRow[hits.Length];
+
+                for (var i = 0; i < hits.Length; ++i)
+                {
+                    page[i] = new SearchResultRow
+                    {
+                        Character = hits[i].Character,
+                        Location = hits[i].Location,
+                        Item = hits[i].Item
+                    };
+                }
+
+                _pages[pageIndex] = page;
+            }
+
+            var offset = index % PageSize;
+            return offset < page.Length ? page[offset] : EmptyRow;
+        }
+
+        public int IndexOf(object value)
+        {
+            // only the rows already fetched can be found
+            foreach (var entry in _pages)
+            {
+                var offset = Array.IndexOf(entry.Value, value);
+                if (offset >= 0)
+                    return entry.Key * PageSize + offset;
+            }
+
+            return -1;
+        }
+
+        public bool Contains(object value) => IndexOf(value) >= 0;
+
+        public IEnumerator GetEnumerator()
+        {
+            for (var i = 0; i < Count; ++i)
+                yield return GetRow(i);
+        }
+
+        public void CopyTo(Array array, int index)
+        {
+            for (var i = 0; i < Count; ++i)
+                array.SetValue(GetRow(i), index + i);
+        }
+
+        public bool IsReadOnly => true;
+        public bool IsFixedSize => true;
+        public bool IsSynchronized => false;
+        public object SyncRoot => this;
+
+        public int Add(object value) => throw new NotSupportedException();
+        public void Clear() => throw new NotSupportedException();
+        public void Insert(int index, object value) => throw new NotSupportedException();
+        public void Remove(object value) => throw new NotSupportedException();
+        public void RemoveAt(int index) => throw new NotSupportedException();
+    }
+}
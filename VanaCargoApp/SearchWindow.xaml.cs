@@ -1,12 +1,14 @@
 using System;
-using System.Collections.ObjectModel;
-using System.Globalization;
+using System.Collections.Generic;
+using System.ComponentModel;
 using System.Linq;
 using System.Threading;
 using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Data;
+using System.Windows.Threading;
+using Microsoft.Win32;
 using VanaCargoBridge;
 
 namespace VanaCargoApp
@@ -15,8 +17,31 @@ namespace VanaCargoApp
     {
         private readonly CoreBridge _bridge;
         private readonly LoadResult _loadResult;
-        private readonly CancellationTokenSource _cts = new CancellationTokenSource();
-        private readonly ObservableCollection<SearchResultRow> _results = new ObservableCollection<SearchResultRow>();
+        private const int SearchDelayMilliseconds = 150;
+        // a term containing one of these is run as a query expression (name:kote ilvl>=119 ...)
+        private static readonly char[] QueryOperators = { ':', '<', '>', '=' };
+
+        // binding path of each sortable column, the rows are sorted by the core
+        private static readonly Dictionary<string, ResultSortColumn> SortColumns = new Dictionary<string, ResultSortColumn>
+        {
+            { "Character", ResultSortColumn.Character },
+            { "Location", ResultSortColumn.Location },
+            { "Item.Count", ResultSortColumn.Count },
+            { "Item.Name", ResultSortColumn.Name },
+            { "Item.Description", ResultSortColumn.Description },
+            { "Item.Attr", ResultSortColumn.Attr },
+            { "Item.Slot", ResultSortColumn.Slot },
+            { "Item.Races", ResultSortColumn.Races },
+            { "Item.Level", ResultSortColumn.Level },
+            { "Item.Jobs", ResultSortColumn.Jobs },
+            { "Item.Remarks", ResultSortColumn.Remarks },
+            { "Item.Id", ResultSortColumn.Id }
+        };
+
+        private ResultCursorList _results;
+        private readonly DispatcherTimer _searchTimer;
+        private CancellationTokenSource _cts;
+        private int _searchId;
 
         public IconConverter IconConverter { get; } = new IconConverter();
 
@@ -25,75 +50,230 @@ namespace VanaCargoApp
             _bridge = bridge;
             _loadResult = loadResult;
             InitializeComponent();
-            ResultsGrid.ItemsSource = _results;
+
+            _searchTimer = new DispatcherTimer { Interval = TimeSpan.FromMilliseconds(SearchDelayMilliseconds) };
+            _searchTimer.Tick += OnSearchTimerTick;
+            Closed += (sender, e) =>
+            {
+                _searchTimer.Stop();
+                _cts?.Cancel();
+                ClearResults();
+            };
+        }
+
+        private void OnSearchClick(object sender, RoutedEventArgs e)
+        {
+            _searchTimer.Stop();
+            StartSearch(true);
+        }
+
+        private void OnSearchTextChanged(object sender, TextChangedEventArgs e)
+        {
+            // restarted on every keystroke, the search runs once typing pauses
+            _searchTimer.Stop();
+            _searchTimer.Start();
         }
 
-        private async void OnSearchClick(object sender, RoutedEventArgs e)
+        private void OnSearchTimerTick(object sender, EventArgs e)
+        {
+            _searchTimer.Stop();
+            StartSearch(false);
+        }
+
+        private async void StartSearch(bool showErrors)
         {
             var term = SearchBox.Text?.Trim() ?? string.Empty;
             if (string.IsNullOrEmpty(term))
+            {
+                if (!showErrors)
+                {
+                    _cts?.Cancel();
+                    ClearResults();
+                    StatusText.Text = string.Empty;
+                }
                 return;
+            }
 
-            var allChars = AllCharactersCheck.IsChecked == true;
+            var isExplain = term.StartsWith("EXPLAIN ", StringComparison.OrdinalIgnoreCase);
+            var isQuery = isExplain || term.IndexOfAny(QueryOperators) >= 0;
+            // char: picks the characters itself
+            var allChars = AllCharactersCheck.IsChecked == true
+                || (isQuery && term.IndexOf("char:", StringComparison.OrdinalIgnoreCase) >= 0);
             var characters = allChars ? _loadResult.Characters : GetSelectedCharacter();
             if (characters == null || characters.Length == 0)
             {
-                StatusText.Text = "Select a character first.";
+                if (showErrors)
+                    StatusText.Text = "Select a character first.";
                 return;
             }
 
-            SearchButton.IsEnabled = false;
+            // the previous search stops at its next batch, the core refines its results
+            // when the new term extends the previous one
+            _cts?.Cancel();
+            var cts = new CancellationTokenSource();
+            var searchId = ++_searchId;
+            _cts = cts;
+
             CancelButton.IsEnabled = true;
             StatusText.Text = "Searching...";
-            _results.Clear();
+            StatusText.ToolTip = null;
+            ClearResults();
 
             try
             {
-                await Task.Run(() => ExecuteSearch(term, characters), _cts.Token);
+                // a canceled search stops inside the bag or the batch it was at, its cursor is disposed by the bridge
+                var result = await _bridge.OpenCursorAsync(_loadResult.Settings, characters, _loadResult.Tabs, term, isQuery,
+                    (hits, completed, total) => OnSearchProgress(searchId, completed, total), cts.Token);
+                var cursor = result.Cursor;
+                var message = result.Message;
+
+                if (searchId != _searchId)
+                {
+                    cursor?.Dispose();
+                    return;
+                }
+
+                if (cursor == null)
+                    throw new FormatException(message);
+
+                // the grid only asks for the rows it displays, they are fetched one page at a time
+                _results = new ResultCursorList(cursor);
+                ResultsGrid.ItemsSource = _results;
+
+                var plan = isQuery ? message : null;
                 StatusText.Text = $"Found {_results.Count} results.";
+                StatusText.ToolTip = plan;
+
+                // not while typing, the plan stays in the tooltip of the status
+                if (isExplain && showErrors && plan != null)
+                    MessageBox.Show(this, plan, "Query plan", MessageBoxButton.OK, MessageBoxImage.Information);
             }
             catch (OperationCanceledException)
             {
-                StatusText.Text = "Search canceled.";
+                if (searchId == _searchId)
+                    StatusText.Text = "Search canceled.";
+            }
+            catch (FormatException ex)
+            {
+                if (searchId == _searchId)
+                    StatusText.Text = $"Query error: {ex.Message}";
             }
             finally
             {
-                SearchButton.IsEnabled = true;
-                CancelButton.IsEnabled = false;
+                if (searchId == _searchId)
+                    CancelButton.IsEnabled = false;
             }
         }
 
-        private void ExecuteSearch(string term, ManagedCharacter[] characters)
+        // who has what: the items matching the term, or every item, totaled across all the characters
+        private async void OnTotalsClick(object sender, RoutedEventArgs e)
         {
-            foreach (var character in characters)
+            var term = SearchBox.Text?.Trim() ?? string.Empty;
+            var isQuery = term.IndexOfAny(QueryOperators) >= 0;
+
+            if (_loadResult.Characters == null || _loadResult.Characters.Length == 0)
             {
-                _cts.Token.ThrowIfCancellationRequested();
-                var tabs = _bridge.LoadInventoryForCharacter(_loadResult.Settings, character, _loadResult.Tabs);
-                if (tabs == null)
-                    continue;
+                StatusText.Text = "No characters to total.";
+                return;
+            }
+
+            var saveDialog = new SaveFileDialog
+            {
+                Filter = "CSV files (*.csv)|*.csv",
+                FileName = "totals.csv",
+                OverwritePrompt = true
+            };
+
+            if (saveDialog.ShowDialog(this) != true)
+                return;
+
+            // the totals share the cancel button with the search
+            _searchTimer.Stop();
+            _cts?.Cancel();
+            var cts = new CancellationTokenSource();
+            var searchId = ++_searchId;
+            _cts = cts;
+
+            CancelButton.IsEnabled = true;
+            TotalsButton.IsEnabled = false;
+            StatusText.Text = "Totaling...";
+            StatusText.ToolTip = null;
 
-                foreach (var tab in tabs)
+            try
+            {
+                using (var pivot = await _bridge.AggregateAsync(_loadResult.Settings, _loadResult.Characters, _loadResult.Tabs,
+                    term, isQuery, (completed, total) => OnSearchProgress(searchId, completed, total), cts.Token))
                 {
-                    if (tab.Items == null)
-                        continue;
+                    if (searchId != _searchId)
+                        return;
 
-                    foreach (var item in tab.Items)
+                    if (pivot == null || !pivot.ExportCsv(saveDialog.FileName))
                     {
-                        if (!Matches(item, term))
-                            continue;
-
-                        Dispatcher.Invoke(() =>
-                        {
-                            _results.Add(new SearchResultRow
-                            {
-                                Character = character.Name,
-                                Location = tab.Info.DisplayName,
-                                Item = item
-                            });
-                        });
+                        StatusText.Text = "Export failed.";
+                        return;
                     }
+
+                    StatusText.Text = $"Exported the totals of {pivot.Count} items.";
                 }
             }
+            catch (OperationCanceledException)
+            {
+                if (searchId == _searchId)
+                    StatusText.Text = "Totals canceled.";
+            }
+            catch (FormatException ex)
+            {
+                if (searchId == _searchId)
+                    StatusText.Text = $"Query error: {ex.Message}";
+            }
+            finally
+            {
+                TotalsButton.IsEnabled = true;
+
+                if (searchId == _searchId)
+                    CancelButton.IsEnabled = false;
+            }
+        }
+
+        private void OnSearchProgress(int searchId, int completed, int total)
+        {
+            Dispatcher.BeginInvoke(new Action(() =>
+            {
+                // updates of a superseded search may still be queued
+                if (searchId != _searchId)
+                    return;
+
+                if (completed < total)
+                    StatusText.Text = $"Searching... {completed}/{total} characters.";
+            }));
+        }
+
+        private void ClearResults()
+        {
+            ResultsGrid.ItemsSource = null;
+            _results?.Dispose();
+            _results = null;
+        }
+
+        private void OnResultsSorting(object sender, DataGridSortingEventArgs e)
+        {
+            // the grid would sort the rows itself and fetch every page to do it
+            e.Handled = true;
+
+            var binding = (e.Column as DataGridBoundColumn)?.Binding as Binding;
+            var path = binding?.Path?.Path;
+            if (_results == null || path == null || !SortColumns.TryGetValue(path, out var column))
+                return;
+
+            var direction = e.Column.SortDirection == ListSortDirection.Ascending
+                ? ListSortDirection.Descending
+                : ListSortDirection.Ascending;
+
+            foreach (var other in ResultsGrid.Columns)
+                other.SortDirection = null;
+
+            _results.Sort(column, direction == ListSortDirection.Descending);
+            e.Column.SortDirection = direction;
         }
 
         private ManagedCharacter[] GetSelectedCharacter()
@@ -106,7 +286,8 @@ namespace VanaCargoApp
 
         private void OnCancelClick(object sender, RoutedEventArgs e)
         {
-            _cts.Cancel();
+            _searchTimer.Stop();
+            _cts?.Cancel();
         }
 
         private void OnResultDoubleClick(object sender, System.Windows.Input.MouseButtonEventArgs e)
@@ -158,36 +339,5 @@ namespace VanaCargoApp
             var escaped = Uri.EscapeDataString(itemName);
             return "https://www.bg-wiki.com/ffxi/" + escaped;
         }
-
-        private static bool Matches(ManagedItem item, string term)
-        {
-            if (item == null)
-                return false;
-
-            return ContainsTerm(item.Name, term) ||
-                   ContainsTerm(item.Attr, term) ||
-                   ContainsTerm(item.Description, term) ||
-                   ContainsTerm(item.Slot, term) ||
-                   ContainsTerm(item.Races, term) ||
-                   ContainsTerm(item.Level, term) ||
-                   ContainsTerm(item.Jobs, term) ||
-                   ContainsTerm(item.Remarks, term) ||
-                   item.Id.ToString(CultureInfo.InvariantCulture).IndexOf(term, StringComparison.OrdinalIgnoreCase) >= 0;
-        }
-
-        private static bool ContainsTerm(string value, string term)
-        {
-            if (string.IsNullOrEmpty(value))
-                return false;
-
-            return value.IndexOf(term, StringComparison.OrdinalIgnoreCase) >= 0;
-        }
-
-        private sealed class SearchResultRow
-        {
-            public string Character { get; set; }
-            public string Location { get; set; }
-            public ManagedItem Item { get; set; }
-        }
     }
 }
@@ -1,7 +1,13 @@
 #include "pch.h"
 #include "VanaCargoBridge.h"
 #include "CoreApi.h"
+#include "CorePivot.h"
+#include "CoreResultCursor.h"
+#include "CoreSession.h"
 #include <vcclr.h>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
 
 using namespace VanaCargoBridge;
 using msclr::interop::marshal_as;
@@ -29,8 +35,493 @@ static std::wstring GetExeDir()
 	return full.substr(0, pos);
 }
 
+static CoreSettings ToNativeSettings(ManagedSettings^ settings)
+{
+	CoreSettings nativeSettings;
+	nativeSettings.Region = settings->Region;
+	nativeSettings.Language = settings->Language;
+	nativeSettings.CompactList = settings->CompactList;
+	nativeSettings.FfxiPath = ToWString(settings->FfxiPath);
+	nativeSettings.FindAllEnabled = settings->FindAllEnabled;
+	nativeSettings.FindAllDataPath = ToWString(settings->FindAllDataPath);
+	nativeSettings.FindAllKeyItemsPath = ToWString(settings->FindAllKeyItemsPath);
+	return nativeSettings;
+}
+
+static void ToNativeTabs(array<ManagedTabInfo^>^ tabs, std::vector<InventoryTabInfo>& nativeTabs)
+{
+	nativeTabs.reserve(tabs->Length);
+	for (int i = 0; i < tabs->Length; ++i)
+	{
+		ManagedTabInfo^ tab = tabs[i];
+		if (tab == nullptr)
+			continue;
+
+		InventoryTabInfo info;
+		info.FileName = ToWString(tab->FileName);
+		info.DisplayName = ToWString(tab->DisplayName);
+		nativeTabs.push_back(info);
+	}
+}
+
+// longer texts are seldom repeated, they aren't interned
+#define BRIDGE_INTERN_MAX_LENGTH 64
+// the intern table stops growing past this number of strings
+#define BRIDGE_INTERN_MAX_ENTRIES 8192
+// object header, length and terminator of a managed string on x64
+#define BRIDGE_STRING_OVERHEAD 22
+
+struct StringInternMap
+{
+	// the keys point into Texts
+	std::unordered_map<std::wstring_view, gcroot<String^>> Strings;
+	std::deque<std::wstring> Texts;
+	long long Hits;
+	long long BytesSaved;
+};
+
+StringInternTable::StringInternTable()
+{
+	m_pMap = new StringInternMap();
+	m_pMap->Hits = 0;
+	m_pMap->BytesSaved = 0;
+}
+
+StringInternTable::~StringInternTable()
+{
+	this->!StringInternTable();
+}
+
+StringInternTable::!StringInternTable()
+{
+	delete m_pMap;
+	m_pMap = NULL;
+}
+
+// the canonical string with the given text, the items are read from several threads
+String^ StringInternTable::Intern(const wchar_t* pText, int length)
+{
+	if (length == 0)
+		return String::Empty;
+
+	if (length > BRIDGE_INTERN_MAX_LENGTH || m_pMap == NULL)
+		return gcnew String(const_cast<wchar_t*>(pText), 0, length);
+
+	msclr::lock lock(this);
+	std::wstring_view key(pText, (size_t)length);
+	std::unordered_map<std::wstring_view, gcroot<String^>>::const_iterator it = m_pMap->Strings.find(key);
+
+	if (it != m_pMap->Strings.end())
+	{
+		++m_pMap->Hits;
+		// allocations are rounded to 8 bytes
+		m_pMap->BytesSaved += (BRIDGE_STRING_OVERHEAD + length * sizeof(wchar_t) + 7) & ~7;
+		return it->second;
+	}
+
+	String^ value = gcnew String(const_cast<wchar_t*>(pText), 0, length);
+
+	if (m_pMap->Strings.size() < BRIDGE_INTERN_MAX_ENTRIES)
+	{
+		m_pMap->Texts.emplace_back(pText, (size_t)length);
+		m_pMap->Strings.emplace(std::wstring_view(m_pMap->Texts.back()), gcroot<String^>(value));
+	}
+
+	return value;
+}
+
+String^ StringInternTable::Intern(array<Char>^ strings, int offset, int length)
+{
+	if (length == 0)
+		return String::Empty;
+
+	pin_ptr<Char> pinned = &strings[offset];
+	return Intern(pinned, length);
+}
+
+void StringInternTable::GetStats(Int64% entries, Int64% hits, Int64% bytesSaved)
+{
+	msclr::lock lock(this);
+	entries = (m_pMap != NULL) ? (Int64)m_pMap->Strings.size() : 0;
+	hits = (m_pMap != NULL) ? m_pMap->Hits : 0;
+	bytesSaved = (m_pMap != NULL) ? m_pMap->BytesSaved : 0;
+}
+
+// Attr, Slot, Races, Level and Jobs take a few hundred values over all the items
+static bool IsInternedField(int field)
+{
+	return field == CORE_ITEM_ATTR || field == CORE_ITEM_SLOT || field == CORE_ITEM_RACES
+		|| field == CORE_ITEM_LEVEL || field == CORE_ITEM_JOBS;
+}
+
+// position of a member in the int array of the records
+#define RECORD_FIELD(member) (int)(offsetof(CoreItemRecord, member) / sizeof(int))
+
+ManagedItem::ManagedItem(InventoryData^ data, int record)
+{
+	int base = record * (int)CORE_ITEM_RECORD_INTS;
+
+	m_data = data;
+	m_record = record;
+	m_id = data->Records[base + RECORD_FIELD(Id)];
+	m_count = data->Records[base + RECORD_FIELD(Count)];
+	m_iconWidth = data->Records[base + RECORD_FIELD(IconWidth)];
+	m_iconHeight = data->Records[base + RECORD_FIELD(IconHeight)];
+	m_iconStride = data->Records[base + RECORD_FIELD(IconStride)];
+}
+
+// the text is created from the string pool the first time it is read, unless it was set
+String^ ManagedItem::GetText(String^% text, int field)
+{
+	if (text == nullptr && m_data != nullptr)
+	{
+		int base = m_record * (int)CORE_ITEM_RECORD_INTS;
+		int offset = m_data->Records[base + RECORD_FIELD(StringOffsets) + field];
+		int length = m_data->Records[base + RECORD_FIELD(StringLengths) + field];
+
+		if (IsInternedField(field) && m_data->Interned != nullptr)
+			text = m_data->Interned->Intern(m_data->Strings, offset, length);
+		else
+			text = gcnew String(m_data->Strings, offset, length);
+	}
+
+	return text;
+}
+
+String^ ManagedItem::Name::get() { return GetText(m_name, CORE_ITEM_NAME); }
+String^ ManagedItem::Attr::get() { return GetText(m_attr, CORE_ITEM_ATTR); }
+String^ ManagedItem::Description::get() { return GetText(m_description, CORE_ITEM_DESCRIPTION); }
+String^ ManagedItem::Slot::get() { return GetText(m_slot, CORE_ITEM_SLOT); }
+String^ ManagedItem::Races::get() { return GetText(m_races, CORE_ITEM_RACES); }
+String^ ManagedItem::Level::get() { return GetText(m_level, CORE_ITEM_LEVEL); }
+String^ ManagedItem::Jobs::get() { return GetText(m_jobs, CORE_ITEM_JOBS); }
+String^ ManagedItem::Remarks::get() { return GetText(m_remarks, CORE_ITEM_REMARKS); }
+
+// the pixels are copied out of the icon atlas when the item is first drawn
+array<Byte>^ ManagedItem::IconPixels::get()
+{
+	if (m_iconPixels == nullptr && m_data != nullptr)
+	{
+		int base = m_record * (int)CORE_ITEM_RECORD_INTS;
+		int offset = m_data->Records[base + RECORD_FIELD(IconOffset)];
+		int size = m_data->Records[base + RECORD_FIELD(IconSize)];
+
+		if (offset >= 0 && size > 0)
+		{
+			m_iconPixels = gcnew array<Byte>(size);
+			Buffer::BlockCopy(m_data->Icons, offset, m_iconPixels, 0, size);
+		}
+	}
+
+	return m_iconPixels;
+}
+
+// copies a native buffer into a new managed array in a single block
+template <typename T>
+static array<T>^ ToManagedArray(const T* pData, size_t count)
+{
+	array<T>^ result = gcnew array<T>((int)count);
+	if (count > 0)
+	{
+		pin_ptr<T> pinned = &result[0];
+		memcpy(pinned, pData, count * sizeof(T));
+	}
+
+	return result;
+}
+
+static ManagedItem^ ToManagedItem(const CoreItem& src, const CoreIcon* pIcon, StringInternTable^ interned)
+{
+	ManagedItem^ item = gcnew ManagedItem();
+	item->Id = src.Id;
+	item->Count = src.Count;
+	item->Name = gcnew String(src.Name.c_str());
+	item->Attr = interned->Intern(src.Attr.c_str(), (int)src.Attr.size());
+	item->Description = gcnew String(src.Description.c_str());
+	item->Slot = interned->Intern(src.Slot.c_str(), (int)src.Slot.size());
+	item->Races = interned->Intern(src.Races.c_str(), (int)src.Races.size());
+	item->Level = interned->Intern(src.Level.c_str(), (int)src.Level.size());
+	item->Jobs = interned->Intern(src.Jobs.c_str(), (int)src.Jobs.size());
+	item->Remarks = gcnew String(src.Remarks.c_str());
+	item->IconWidth = src.IconWidth;
+	item->IconHeight = src.IconHeight;
+	item->IconStride = src.IconStride;
+
+	// cached items keep their pixels in the shared icon map
+	const std::vector<unsigned char>& iconPixels = pIcon != NULL ? pIcon->Pixels : src.IconPixels;
+	if (!iconPixels.empty())
+	{
+		array<Byte>^ pixels = gcnew array<Byte>((int)iconPixels.size());
+		if (pixels->Length > 0)
+		{
+			pin_ptr<Byte> pinned = &pixels[0];
+			memcpy(pinned, iconPixels.data(), iconPixels.size());
+		}
+		item->IconPixels = pixels;
+	}
+
+	return item;
+}
+
+static array<ManagedSearchHit^>^ ToManagedHits(const CoreApi* pApi,
+	const std::vector<CoreSearchHit>& hits,
+	array<ManagedCharacter^>^ characters,
+	array<String^>^ locations,
+	StringInternTable^ interned)
+{
+	array<ManagedSearchHit^>^ batch = gcnew array<ManagedSearchHit^>((int)hits.size());
+	for (int i = 0; i < batch->Length; ++i)
+	{
+		const CoreSearchHit& hit = hits[i];
+		const CoreIcon* pIcon = hit.pItem->IconStride != 0 ? pApi->GetItemIcon(hit.pItem->Id) : NULL;
+
+		ManagedSearchHit^ managedHit = gcnew ManagedSearchHit();
+		managedHit->Character = characters[hit.Character]->Name;
+		managedHit->Location = locations[hit.Tab];
+		managedHit->Item = ToManagedItem(*hit.pItem, pIcon, interned);
+		batch[i] = managedHit;
+	}
+
+	return batch;
+}
+
+ref class SearchContext
+{
+public:
+	array<ManagedCharacter^>^ Characters;
+	array<String^>^ Locations;
+	SearchHitsHandler^ OnHits;
+	StringInternTable^ Interned;
+	int Completed;
+	int Total;
+};
+
+class ManagedSearchObserver : public CoreSearchObserver
+{
+public:
+	ManagedSearchObserver(const CoreApi* pApi, SearchContext^ context)
+		: m_pApi(pApi), m_context(context)
+	{
+	}
+
+	virtual void OnProgress(int completed, int total) override
+	{
+		SearchContext^ context = m_context;
+		context->Completed = completed;
+		context->Total = total;
+
+		if (context->OnHits != nullptr)
+			context->OnHits(gcnew array<ManagedSearchHit^>(0), completed, total);
+	}
+
+	virtual void OnHits(const std::vector<CoreSearchHit>& hits) override
+	{
+		SearchContext^ context = m_context;
+		if (context->OnHits == nullptr)
+			return;
+
+		context->OnHits(ToManagedHits(m_pApi, hits, context->Characters, context->Locations, context->Interned),
+			context->Completed, context->Total);
+	}
+
+private:
+	const CoreApi* m_pApi;
+	gcroot<SearchContext^> m_context;
+};
+
+// native copy of a CancellationToken, the core polls it inside its loops without calling into managed code
+ref class NativeCancellation
+{
+public:
+	NativeCancellation(System::Threading::CancellationToken token)
+	{
+		m_pToken = new CoreCancelToken();
+		m_registration = token.Register(gcnew Action(this, &NativeCancellation::OnCancel));
+	}
+
+	~NativeCancellation()
+	{
+		// waits for a callback already running
+		m_registration.Dispose();
+		this->!NativeCancellation();
+	}
+
+	!NativeCancellation()
+	{
+		delete m_pToken;
+		m_pToken = NULL;
+	}
+
+	const CoreCancelToken* GetToken() { return m_pToken; }
+
+private:
+	void OnCancel() { m_pToken->Cancel(); }
+
+	CoreCancelToken* m_pToken;
+	System::Threading::CancellationTokenRegistration m_registration;
+};
+
+// milliseconds between two progress updates sent to the frontend
+#define BRIDGE_PROGRESS_INTERVAL 50
+
+// the updates are coalesced, the last one is always sent
+class ManagedProgressObserver : public CoreProgressObserver
+{
+public:
+	ManagedProgressObserver(ProgressHandler^ onProgress)
+		: m_onProgress(onProgress), m_lastTick(0)
+	{
+	}
+
+	virtual void OnProgress(int completed, int total) override
+	{
+		ProgressHandler^ onProgress = m_onProgress;
+		if (onProgress == nullptr)
+			return;
+
+		ULONGLONG tick = GetTickCount64();
+		if (completed < total && tick - m_lastTick < BRIDGE_PROGRESS_INTERVAL)
+			return;
+
+		m_lastTick = tick;
+		onProgress(completed, total);
+	}
+
+private:
+	gcroot<ProgressHandler^> m_onProgress;
+	ULONGLONG m_lastTick;
+};
+
+ref class LoadInventoryOperation
+{
+public:
+	CoreBridge^ Bridge;
+	ManagedSettings^ Settings;
+	ManagedCharacter^ Character;
+	array<ManagedTabInfo^>^ Tabs;
+	ProgressHandler^ OnProgress;
+	System::Threading::CancellationToken Token;
+
+	array<ManagedTab^>^ Run()
+	{
+		array<ManagedTab^>^ result = Bridge->LoadInventory(Settings, Character, Tabs, OnProgress, Token);
+		Token.ThrowIfCancellationRequested();
+		return result;
+	}
+};
+
+ref class OpenCursorOperation
+{
+public:
+	CoreBridge^ Bridge;
+	ManagedSettings^ Settings;
+	array<ManagedCharacter^>^ Characters;
+	array<ManagedTabInfo^>^ Tabs;
+	String^ Term;
+	bool IsQuery;
+	SearchHitsHandler^ OnProgress;
+	System::Threading::CancellationToken Token;
+
+	OpenCursorResult^ Run()
+	{
+		String^ message = nullptr;
+		ResultCursor^ cursor = Bridge->OpenCursor(Settings, Characters, Tabs, Term, IsQuery, OnProgress, Token, message);
+
+		if (Token.IsCancellationRequested)
+		{
+			if (cursor != nullptr)
+				delete cursor;
+
+			Token.ThrowIfCancellationRequested();
+		}
+
+		OpenCursorResult^ result = gcnew OpenCursorResult();
+		result->Cursor = cursor;
+		result->Message = message;
+		return result;
+	}
+};
+
+ref class ExportOperation
+{
+public:
+	CoreBridge^ Bridge;
+	ManagedSettings^ Settings;
+	array<ManagedCharacter^>^ Characters;
+	array<ManagedTabInfo^>^ Tabs;
+	String^ Path;
+	// the columns of a CSV export, ignored by the columnar export
+	ExportColumns Columns;
+	bool IsIncremental;
+	bool IsColumnar;
+	ProgressHandler^ OnProgress;
+	System::Threading::CancellationToken Token;
+
+	int Run()
+	{
+		int result = IsColumnar
+			? Bridge->ExportColumnar(Settings, Characters, Tabs, Path, OnProgress, Token)
+			: Bridge->ExportCsv(Settings, Characters, Tabs, Path, Columns, IsIncremental, OnProgress, Token);
+		Token.ThrowIfCancellationRequested();
+		return result;
+	}
+};
+
+ref class AggregateOperation
+{
+public:
+	CoreBridge^ Bridge;
+	ManagedSettings^ Settings;
+	array<ManagedCharacter^>^ Characters;
+	array<ManagedTabInfo^>^ Tabs;
+	String^ Filter;
+	bool IsQuery;
+	ProgressHandler^ OnProgress;
+	System::Threading::CancellationToken Token;
+
+	PivotTable^ Run()
+	{
+		String^ message = nullptr;
+		PivotTable^ pivot = Bridge->Aggregate(Settings, Characters, Tabs, Filter, IsQuery, OnProgress, Token, message);
+
+		Token.ThrowIfCancellationRequested();
+
+		if (pivot == nullptr && !String::IsNullOrEmpty(message))
+			throw gcnew FormatException(message);
+
+		return pivot;
+	}
+};
+
+// the pivot and the lists its cells index, kept for the export
+struct NativePivot
+{
+	CorePivot Pivot;
+	std::vector<CharacterInfo> Characters;
+	std::vector<InventoryTabInfo> Tabs;
+};
+
 CoreBridge::CoreBridge()
 {
+	m_pSession = new CoreSession();
+	m_pApi = &m_pSession->GetApi();
+	m_pSearchSession = new CoreSearchSession();
+	m_interned = gcnew StringInternTable();
+	m_syncRoot = gcnew Object();
+}
+
+CoreBridge::~CoreBridge()
+{
+	this->!CoreBridge();
+}
+
+CoreBridge::!CoreBridge()
+{
+	delete m_pSearchSession;
+	m_pSearchSession = NULL;
+	m_pApi = NULL;
+	delete m_pSession;
+	m_pSession = NULL;
 }
 
 String^ CoreBridge::Ping()
@@ -40,14 +531,20 @@ String^ CoreBridge::Ping()
 
 LoadResult^ CoreBridge::LoadConfigAndCharacters(String^ configPath)
 {
-	CoreApi api;
 	CoreSettings settings;
 	std::vector<InventoryTabInfo> tabs;
 	std::vector<CharacterInfo> characters;
 
-	bool ok = api.LoadConfig(ToWString(configPath), settings, tabs, characters);
-	if (!ok)
-		return nullptr;
+	{
+		// the session only parses the config again once it changed
+		msclr::lock lock(m_syncRoot);
+		if (!m_pSession->LoadConfig(ToWString(configPath)))
+			return nullptr;
+
+		settings = m_pSession->GetSettings();
+		tabs = m_pSession->GetTabs();
+		characters = m_pSession->GetCharacters();
+	}
 
 	LoadResult^ result = gcnew LoadResult();
 	ManagedSettings^ managedSettings = gcnew ManagedSettings();
@@ -76,6 +573,7 @@ LoadResult^ CoreBridge::LoadConfigAndCharacters(String^ configPath)
 		ManagedCharacter^ ch = gcnew ManagedCharacter();
 		ch->Id = gcnew String(characters[i].Id.c_str());
 		ch->Name = gcnew String(characters[i].Name.c_str());
+		ch->Source = (InventorySource)characters[i].Source;
 		charArray[i] = ch;
 	}
 	result->Characters = charArray;
@@ -88,17 +586,10 @@ bool CoreBridge::SaveSettings(String^ configPath, ManagedSettings^ settings)
 	if (settings == nullptr)
 		return false;
 
-	CoreSettings nativeSettings;
-	nativeSettings.Region = settings->Region;
-	nativeSettings.Language = settings->Language;
-	nativeSettings.CompactList = settings->CompactList;
-	nativeSettings.FfxiPath = ToWString(settings->FfxiPath);
-	nativeSettings.FindAllEnabled = settings->FindAllEnabled;
-	nativeSettings.FindAllDataPath = ToWString(settings->FindAllDataPath);
-	nativeSettings.FindAllKeyItemsPath = ToWString(settings->FindAllKeyItemsPath);
+	CoreSettings nativeSettings = ToNativeSettings(settings);
 
-	CoreApi api;
-	return api.SaveSettings(ToWString(configPath), nativeSettings);
+	msclr::lock lock(m_syncRoot);
+	return m_pSession->SaveSettings(ToWString(configPath), nativeSettings);
 }
 
 bool CoreBridge::SaveCharacterDisplayNames(String^ configPath, array<ManagedCharacter^>^ characters)
@@ -117,91 +608,91 @@ bool CoreBridge::SaveCharacterDisplayNames(String^ configPath, array<ManagedChar
 		}
 	}
 
-	CoreApi api;
-	return api.SaveCharacterDisplayNames(ToWString(configPath), entries);
+	msclr::lock lock(m_syncRoot);
+	return m_pSession->SaveCharacterDisplayNames(ToWString(configPath), entries);
 }
 
 array<ManagedTab^>^ CoreBridge::LoadInventoryForCharacter(
 	ManagedSettings^ settings,
 	ManagedCharacter^ character,
 	array<ManagedTabInfo^>^ tabs)
+{
+	return LoadInventory(settings, character, tabs, nullptr, System::Threading::CancellationToken::None);
+}
+
+System::Threading::Tasks::Task<array<ManagedTab^>^>^ CoreBridge::LoadInventoryAsync(
+	ManagedSettings^ settings,
+	ManagedCharacter^ character,
+	array<ManagedTabInfo^>^ tabs,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	LoadInventoryOperation^ operation = gcnew LoadInventoryOperation();
+	operation->Bridge = this;
+	operation->Settings = settings;
+	operation->Character = character;
+	operation->Tabs = tabs;
+	operation->OnProgress = onProgress;
+	operation->Token = cancellationToken;
+
+	return System::Threading::Tasks::Task::Run<array<ManagedTab^>^>(
+		gcnew Func<array<ManagedTab^>^>(operation, &LoadInventoryOperation::Run), cancellationToken);
+}
+
+// null if the load failed or was canceled
+array<ManagedTab^>^ CoreBridge::LoadInventory(
+	ManagedSettings^ settings,
+	ManagedCharacter^ character,
+	array<ManagedTabInfo^>^ tabs,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
 {
 	if (settings == nullptr || character == nullptr || tabs == nullptr)
 		return nullptr;
 
-	CoreSettings nativeSettings;
-	nativeSettings.Region = settings->Region;
-	nativeSettings.Language = settings->Language;
-	nativeSettings.CompactList = settings->CompactList;
-	nativeSettings.FfxiPath = ToWString(settings->FfxiPath);
-	nativeSettings.FindAllEnabled = settings->FindAllEnabled;
-	nativeSettings.FindAllDataPath = ToWString(settings->FindAllDataPath);
-	nativeSettings.FindAllKeyItemsPath = ToWString(settings->FindAllKeyItemsPath);
+	CoreSettings nativeSettings = ToNativeSettings(settings);
 
 	CharacterInfo nativeChar;
 	nativeChar.Id = ToWString(character->Id);
 	nativeChar.Name = ToWString(character->Name);
+	nativeChar.Source = (int)character->Source;
 
 	std::vector<InventoryTabInfo> nativeTabs;
-	nativeTabs.reserve(tabs->Length);
-	for (int i = 0; i < tabs->Length; ++i)
-	{
-		ManagedTabInfo^ tab = tabs[i];
-		if (tab == nullptr)
-			continue;
+	ToNativeTabs(tabs, nativeTabs);
 
-		InventoryTabInfo info;
-		info.FileName = ToWString(tab->FileName);
-		info.DisplayName = ToWString(tab->DisplayName);
-		nativeTabs.push_back(info);
+	CoreInventoryBuffer buffer;
+	NativeCancellation cancellation(cancellationToken);
+	ManagedProgressObserver observer(onProgress);
+	observer.SetCancelToken(cancellation.GetToken());
+
+	{
+		// the decoded inventory stays in the cache shared with the searches
+		msclr::lock lock(m_syncRoot);
+		if (!m_pApi->LoadInventoryBuffer(nativeSettings, nativeChar, nativeTabs, buffer, &observer))
+			return nullptr;
 	}
 
-	std::vector<InventoryTab> nativeOut;
-	CoreApi api;
-	if (!api.LoadInventoryForCharacter(nativeSettings, nativeChar, nativeTabs, nativeOut))
-		return nullptr;
+	// one copy per buffer instead of a string per field and an array per icon, the items are views of them
+	InventoryData^ data = gcnew InventoryData();
+	data->Strings = ToManagedArray<Char>(buffer.Strings.data(), buffer.Strings.size());
+	data->Records = ToManagedArray<int>(reinterpret_cast<const int*>(buffer.Records.data()),
+		buffer.Records.size() * CORE_ITEM_RECORD_INTS);
+	data->Icons = ToManagedArray<Byte>(buffer.Icons.data(), buffer.Icons.size());
+	data->Interned = m_interned;
 
-	array<ManagedTab^>^ managedTabs = gcnew array<ManagedTab^>((int)nativeOut.size());
-	for (int i = 0; i < (int)nativeOut.size(); ++i)
+	array<ManagedTab^>^ managedTabs = gcnew array<ManagedTab^>((int)buffer.Tabs.size());
+	for (int i = 0; i < (int)buffer.Tabs.size(); ++i)
 	{
 		ManagedTab^ managedTab = gcnew ManagedTab();
 		ManagedTabInfo^ tabInfo = gcnew ManagedTabInfo();
-		tabInfo->FileName = gcnew String(nativeOut[i].Info.FileName.c_str());
-		tabInfo->DisplayName = gcnew String(nativeOut[i].Info.DisplayName.c_str());
+		tabInfo->FileName = gcnew String(buffer.Tabs[i].FileName.c_str());
+		tabInfo->DisplayName = gcnew String(buffer.Tabs[i].DisplayName.c_str());
 		managedTab->Info = tabInfo;
 
-		array<ManagedItem^>^ items = gcnew array<ManagedItem^>((int)nativeOut[i].Items.size());
-		for (int j = 0; j < (int)nativeOut[i].Items.size(); ++j)
-		{
-			const CoreItem& src = nativeOut[i].Items[j];
-			ManagedItem^ item = gcnew ManagedItem();
-			item->Id = src.Id;
-			item->Count = src.Count;
-			item->Name = gcnew String(src.Name.c_str());
-			item->Attr = gcnew String(src.Attr.c_str());
-			item->Description = gcnew String(src.Description.c_str());
-			item->Slot = gcnew String(src.Slot.c_str());
-			item->Races = gcnew String(src.Races.c_str());
-			item->Level = gcnew String(src.Level.c_str());
-			item->Jobs = gcnew String(src.Jobs.c_str());
-			item->Remarks = gcnew String(src.Remarks.c_str());
-			item->IconWidth = src.IconWidth;
-			item->IconHeight = src.IconHeight;
-			item->IconStride = src.IconStride;
-
-			if (!src.IconPixels.empty())
-			{
-				array<Byte>^ pixels = gcnew array<Byte>((int)src.IconPixels.size());
-				if (pixels->Length > 0)
-				{
-					pin_ptr<Byte> pinned = &pixels[0];
-					memcpy(pinned, src.IconPixels.data(), src.IconPixels.size());
-				}
-				item->IconPixels = pixels;
-			}
-
-			items[j] = item;
-		}
+		int first = buffer.TabOffsets[i];
+		array<ManagedItem^>^ items = gcnew array<ManagedItem^>(buffer.TabOffsets[i + 1] - first);
+		for (int j = 0; j < items->Length; ++j)
+			items[j] = gcnew ManagedItem(data, first + j);
 
 		managedTab->Items = items;
 		managedTabs[i] = managedTab;
@@ -209,3 +700,584 @@ array<ManagedTab^>^ CoreBridge::LoadInventoryForCharacter(
 
 	return managedTabs;
 }
+
+System::Threading::Tasks::Task<int>^ CoreBridge::ExportCsvAsync(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ path,
+	ExportColumns columns,
+	bool incremental,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	ExportOperation^ operation = gcnew ExportOperation();
+	operation->Bridge = this;
+	operation->Settings = settings;
+	operation->Characters = characters;
+	operation->Tabs = tabs;
+	operation->Path = path;
+	operation->Columns = columns;
+	operation->IsIncremental = incremental;
+	operation->IsColumnar = false;
+	operation->OnProgress = onProgress;
+	operation->Token = cancellationToken;
+
+	return System::Threading::Tasks::Task::Run<int>(
+		gcnew Func<int>(operation, &ExportOperation::Run), cancellationToken);
+}
+
+System::Threading::Tasks::Task<int>^ CoreBridge::ExportColumnarAsync(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ path,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	ExportOperation^ operation = gcnew ExportOperation();
+	operation->Bridge = this;
+	operation->Settings = settings;
+	operation->Characters = characters;
+	operation->Tabs = tabs;
+	operation->Path = path;
+	operation->IsIncremental = false;
+	operation->IsColumnar = true;
+	operation->OnProgress = onProgress;
+	operation->Token = cancellationToken;
+
+	return System::Threading::Tasks::Task::Run<int>(
+		gcnew Func<int>(operation, &ExportOperation::Run), cancellationToken);
+}
+
+static void ToNativeCharacters(array<ManagedCharacter^>^ characters, std::vector<CharacterInfo>& nativeChars)
+{
+	nativeChars.clear();
+
+	for (int i = 0; i < characters->Length; ++i)
+	{
+		if (characters[i] == nullptr)
+			continue;
+
+		CharacterInfo info;
+		info.Id = ToWString(characters[i]->Id);
+		info.Name = ToWString(characters[i]->Name);
+		info.Source = (int)characters[i]->Source;
+		nativeChars.push_back(info);
+	}
+}
+
+// the rows never cross into managed code, only the progress does
+int CoreBridge::ExportCsv(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ path,
+	ExportColumns columns,
+	bool incremental,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (settings == nullptr || characters == nullptr || tabs == nullptr || String::IsNullOrEmpty(path))
+		return -1;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+
+	std::vector<InventoryTabInfo> nativeTabs;
+	ToNativeTabs(tabs, nativeTabs);
+
+	std::vector<CharacterInfo> nativeChars;
+	ToNativeCharacters(characters, nativeChars);
+
+	NativeCancellation cancellation(cancellationToken);
+	ManagedProgressObserver observer(onProgress);
+	observer.SetCancelToken(cancellation.GetToken());
+	CoreExportStats stats;
+
+	msclr::lock lock(m_syncRoot);
+	if (!m_pApi->ExportCsv(nativeSettings, nativeChars, nativeTabs, (unsigned int)columns, ToWString(path),
+		incremental, observer, &stats))
+		return -1;
+
+	return (int)stats.Rows;
+}
+
+int CoreBridge::ExportColumnar(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ path,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (settings == nullptr || characters == nullptr || tabs == nullptr || String::IsNullOrEmpty(path))
+		return -1;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+
+	std::vector<InventoryTabInfo> nativeTabs;
+	ToNativeTabs(tabs, nativeTabs);
+
+	std::vector<CharacterInfo> nativeChars;
+	ToNativeCharacters(characters, nativeChars);
+
+	NativeCancellation cancellation(cancellationToken);
+	ManagedProgressObserver observer(onProgress);
+	observer.SetCancelToken(cancellation.GetToken());
+	size_t rowCount = 0;
+
+	msclr::lock lock(m_syncRoot);
+	if (!m_pApi->ExportColumnar(nativeSettings, nativeChars, nativeTabs, ToWString(path), observer, &rowCount))
+		return -1;
+
+	return (int)rowCount;
+}
+
+// the counts are summed natively, the pivot only crosses once as flat arrays
+PivotTable^ CoreBridge::Aggregate(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ filter,
+	bool isQuery,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken,
+	String^% message)
+{
+	message = nullptr;
+
+	if (settings == nullptr || characters == nullptr || tabs == nullptr)
+		return nullptr;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+	NativePivot* pPivot = new NativePivot();
+
+	ToNativeTabs(tabs, pPivot->Tabs);
+	ToNativeCharacters(characters, pPivot->Characters);
+
+	// the cells index the characters passed to the core, without the nulls
+	array<ManagedCharacter^>^ managedChars = gcnew array<ManagedCharacter^>((int)pPivot->Characters.size());
+
+	for (int i = 0, c = 0; i < characters->Length; ++i)
+	{
+		if (characters[i] != nullptr)
+			managedChars[c++] = characters[i];
+	}
+
+	NativeCancellation cancellation(cancellationToken);
+	ManagedProgressObserver observer(onProgress);
+	observer.SetCancelToken(cancellation.GetToken());
+	std::wstring error;
+	bool result;
+
+	{
+		msclr::lock lock(m_syncRoot);
+		result = m_pApi->Aggregate(nativeSettings, pPivot->Characters, pPivot->Tabs,
+			filter == nullptr ? std::wstring() : ToWString(filter), isQuery, pPivot->Pivot, observer, error);
+	}
+
+	if (!error.empty())
+		message = gcnew String(error.c_str());
+
+	if (!result)
+	{
+		delete pPivot;
+		return nullptr;
+	}
+
+	return gcnew PivotTable(pPivot, managedChars, m_interned);
+}
+
+System::Threading::Tasks::Task<PivotTable^>^ CoreBridge::AggregateAsync(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ filter,
+	bool isQuery,
+	ProgressHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	AggregateOperation^ operation = gcnew AggregateOperation();
+	operation->Bridge = this;
+	operation->Settings = settings;
+	operation->Characters = characters;
+	operation->Tabs = tabs;
+	operation->Filter = filter;
+	operation->IsQuery = isQuery;
+	operation->OnProgress = onProgress;
+	operation->Token = cancellationToken;
+
+	return System::Threading::Tasks::Task::Run<PivotTable^>(
+		gcnew Func<PivotTable^>(operation, &AggregateOperation::Run), cancellationToken);
+}
+
+PivotTable::PivotTable(NativePivot* pPivot, array<ManagedCharacter^>^ characters, StringInternTable^ interned)
+{
+	const CorePivot& pivot = pPivot->Pivot;
+	int rowCount = (int)pivot.GetRowCount();
+	int cellCount = (int)pivot.GetCellCount();
+
+	m_pPivot = pPivot;
+	m_characters = characters;
+	m_itemIds = gcnew array<int>(rowCount);
+	m_keyItems = gcnew array<bool>(rowCount);
+	m_names = gcnew array<String^>(rowCount);
+	m_totals = gcnew array<Int64>(rowCount);
+	m_owners = gcnew array<int>(rowCount);
+	m_rowFirstCell = gcnew array<int>(rowCount + 1);
+	m_cellCharacters = gcnew array<int>(cellCount);
+	m_cellLocations = gcnew array<int>(cellCount);
+	m_cellCounts = gcnew array<Int64>(cellCount);
+	m_locations = gcnew array<String^>((int)pPivot->Tabs.size());
+
+	for (int i = 0; i < m_locations->Length; ++i)
+	{
+		const std::wstring& name = pPivot->Tabs[i].DisplayName;
+		m_locations[i] = interned->Intern(name.c_str(), (int)name.size());
+	}
+
+	// the rows are sorted by total, their cells are copied in that order to stay contiguous
+	int cell = 0;
+
+	for (int i = 0; i < rowCount; ++i)
+	{
+		const CorePivotRow& row = pivot.GetRow(i);
+
+		m_itemIds[i] = row.ItemId;
+		m_keyItems[i] = row.KeyItem;
+		// every item has its own name: interning them would fill the table shared with the item attributes
+		m_names[i] = gcnew String(const_cast<wchar_t*>(row.Name.c_str()), 0, (int)row.Name.size());
+		m_totals[i] = row.Total;
+		m_owners[i] = row.Characters;
+		m_rowFirstCell[i] = cell;
+
+		for (size_t c = 0; c < row.CellCount; ++c, ++cell)
+		{
+			const CorePivotCell& src = pivot.GetCell(row.FirstCell + c);
+
+			m_cellCharacters[cell] = src.Character;
+			m_cellLocations[cell] = src.Tab;
+			m_cellCounts[cell] = src.Count;
+		}
+	}
+
+	m_rowFirstCell[rowCount] = cell;
+}
+
+PivotTable::~PivotTable()
+{
+	this->!PivotTable();
+}
+
+PivotTable::!PivotTable()
+{
+	delete m_pPivot;
+	m_pPivot = NULL;
+}
+
+bool PivotTable::ExportCsv(String^ path)
+{
+	if (m_pPivot == NULL || String::IsNullOrEmpty(path))
+		return false;
+
+	return CoreApi::ExportPivotCsv(m_pPivot->Pivot, m_pPivot->Characters, m_pPivot->Tabs, ToWString(path));
+}
+
+ManagedMemoryStats^ CoreBridge::GetMemoryStats()
+{
+	CoreMemoryStats stats;
+
+	{
+		msclr::lock lock(m_syncRoot);
+		m_pSession->GetMemoryStats(stats);
+	}
+
+	ManagedMemoryStats^ result = gcnew ManagedMemoryStats();
+	result->Inventories = (Int64)stats.Inventories;
+	result->Items = (Int64)stats.Items;
+	result->ItemTextBytes = (Int64)stats.ItemTextBytes;
+	result->SearchTextBytes = (Int64)stats.SearchTextBytes;
+	result->Icons = (Int64)stats.Icons;
+	result->IconBytes = (Int64)stats.IconBytes;
+	result->CachedResults = (Int64)stats.CachedResults;
+	result->CatalogEntries = (Int64)stats.CatalogEntries;
+	result->OpenDatFiles = (Int64)stats.OpenDatFiles;
+
+	Int64 internedStrings, internHits, internBytesSaved;
+	m_interned->GetStats(internedStrings, internHits, internBytesSaved);
+	result->InternedStrings = internedStrings;
+	result->InternHits = internHits;
+	result->InternBytesSaved = internBytesSaved;
+	return result;
+}
+
+void CoreBridge::EvictInventory(String^ characterId)
+{
+	if (characterId == nullptr)
+		return;
+
+	msclr::lock lock(m_syncRoot);
+	m_pSession->EvictInventory(ToWString(characterId));
+}
+
+void CoreBridge::ClearCache()
+{
+	msclr::lock lock(m_syncRoot);
+	m_pSession->ClearCache();
+	*m_pSearchSession = CoreSearchSession();
+}
+
+static SearchContext^ CreateSearchContext(
+	array<ManagedCharacter^>^ characters,
+	const std::vector<InventoryTabInfo>& nativeTabs,
+	SearchHitsHandler^ onHits,
+	StringInternTable^ interned,
+	std::vector<CharacterInfo>& nativeChars)
+{
+	SearchContext^ context = gcnew SearchContext();
+	context->Characters = gcnew array<ManagedCharacter^>(characters->Length);
+	context->Locations = gcnew array<String^>((int)nativeTabs.size());
+	context->OnHits = onHits;
+	context->Interned = interned;
+
+	nativeChars.reserve(characters->Length);
+	for (int i = 0; i < characters->Length; ++i)
+	{
+		ManagedCharacter^ character = characters[i];
+		if (character == nullptr)
+			continue;
+
+		CharacterInfo info;
+		info.Id = ToWString(character->Id);
+		info.Name = ToWString(character->Name);
+		info.Source = (int)character->Source;
+		context->Characters[(int)nativeChars.size()] = character;
+		nativeChars.push_back(info);
+	}
+
+	for (int i = 0; i < context->Locations->Length; ++i)
+		context->Locations[i] = gcnew String(nativeTabs[i].DisplayName.c_str());
+
+	return context;
+}
+
+bool CoreBridge::Search(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ term,
+	SearchHitsHandler^ onHits,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (settings == nullptr || characters == nullptr || tabs == nullptr)
+		return false;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+
+	std::vector<InventoryTabInfo> nativeTabs;
+	ToNativeTabs(tabs, nativeTabs);
+
+	std::vector<CharacterInfo> nativeChars;
+	SearchContext^ context = CreateSearchContext(characters, nativeTabs, onHits, m_interned, nativeChars);
+	NativeCancellation cancellation(cancellationToken);
+
+	CoreSearchQuery query;
+	query.Term = ToWString(term);
+	memset(&query.Criteria, 0, sizeof(query.Criteria));
+	query.Fuzzy = true;
+
+	// the inventory cache and the session are shared between searches
+	msclr::lock lock(m_syncRoot);
+	ManagedSearchObserver observer(m_pApi, context);
+	observer.SetCancelToken(cancellation.GetToken());
+	return m_pApi->Search(nativeSettings, nativeChars, nativeTabs, query, observer, m_pSearchSession);
+}
+
+bool CoreBridge::Query(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ expression,
+	SearchHitsHandler^ onHits,
+	System::Threading::CancellationToken cancellationToken,
+	String^% message)
+{
+	message = nullptr;
+
+	if (settings == nullptr || characters == nullptr || tabs == nullptr)
+		return false;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+
+	std::vector<InventoryTabInfo> nativeTabs;
+	ToNativeTabs(tabs, nativeTabs);
+
+	std::vector<CharacterInfo> nativeChars;
+	SearchContext^ context = CreateSearchContext(characters, nativeTabs, onHits, m_interned, nativeChars);
+	NativeCancellation cancellation(cancellationToken);
+
+	std::wstring explain;
+	std::wstring error;
+	bool result;
+
+	{
+		msclr::lock lock(m_syncRoot);
+		ManagedSearchObserver observer(m_pApi, context);
+		observer.SetCancelToken(cancellation.GetToken());
+		result = m_pApi->RunQuery(nativeSettings, nativeChars, nativeTabs, ToWString(expression), observer, explain, error);
+	}
+
+	message = gcnew String(error.empty() ? explain.c_str() : error.c_str());
+	return result;
+}
+
+ResultCursor^ CoreBridge::OpenCursor(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ term,
+	bool isQuery,
+	SearchHitsHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken,
+	String^% message)
+{
+	message = nullptr;
+
+	if (settings == nullptr || characters == nullptr || tabs == nullptr)
+		return nullptr;
+
+	CoreSettings nativeSettings = ToNativeSettings(settings);
+
+	std::vector<InventoryTabInfo> nativeTabs;
+	ToNativeTabs(tabs, nativeTabs);
+
+	std::vector<CharacterInfo> nativeChars;
+	SearchContext^ context = CreateSearchContext(characters, nativeTabs, onProgress, m_interned, nativeChars);
+	NativeCancellation cancellation(cancellationToken);
+
+	CoreResultCursor* pCursor = new CoreResultCursor();
+	pCursor->Reset(nativeChars, nativeTabs);
+
+	std::wstring explain;
+	std::wstring error;
+	bool result;
+
+	{
+		msclr::lock lock(m_syncRoot);
+		ManagedSearchObserver observer(m_pApi, context);
+		observer.SetCancelToken(cancellation.GetToken());
+		CoreCursorObserver cursorObserver(*pCursor, observer);
+
+		if (isQuery)
+		{
+			result = m_pApi->RunQuery(nativeSettings, nativeChars, nativeTabs, ToWString(term), cursorObserver, explain, error);
+		}
+		else
+		{
+			CoreSearchQuery query;
+			query.Term = ToWString(term);
+			memset(&query.Criteria, 0, sizeof(query.Criteria));
+			query.Fuzzy = true;
+
+			result = m_pApi->Search(nativeSettings, nativeChars, nativeTabs, query, cursorObserver, m_pSearchSession);
+		}
+
+		pCursor->Seal(*m_pApi);
+	}
+
+	if (!error.empty() || !explain.empty())
+		message = gcnew String(error.empty() ? explain.c_str() : error.c_str());
+
+	if (!result)
+	{
+		delete pCursor;
+		return nullptr;
+	}
+
+	return gcnew ResultCursor(m_pApi, m_syncRoot, pCursor, context->Characters, context->Locations, m_interned);
+}
+
+System::Threading::Tasks::Task<OpenCursorResult^>^ CoreBridge::OpenCursorAsync(
+	ManagedSettings^ settings,
+	array<ManagedCharacter^>^ characters,
+	array<ManagedTabInfo^>^ tabs,
+	String^ term,
+	bool isQuery,
+	SearchHitsHandler^ onProgress,
+	System::Threading::CancellationToken cancellationToken)
+{
+	OpenCursorOperation^ operation = gcnew OpenCursorOperation();
+	operation->Bridge = this;
+	operation->Settings = settings;
+	operation->Characters = characters;
+	operation->Tabs = tabs;
+	operation->Term = term;
+	operation->IsQuery = isQuery;
+	operation->OnProgress = onProgress;
+	operation->Token = cancellationToken;
+
+	return System::Threading::Tasks::Task::Run<OpenCursorResult^>(
+		gcnew Func<OpenCursorResult^>(operation, &OpenCursorOperation::Run), cancellationToken);
+}
+
+ResultCursor::ResultCursor(CoreApi* pApi, Object^ syncRoot, CoreResultCursor* pCursor,
+	array<ManagedCharacter^>^ characters, array<String^>^ locations, StringInternTable^ interned)
+{
+	m_pApi = pApi;
+	m_syncRoot = syncRoot;
+	m_pCursor = pCursor;
+	m_characters = characters;
+	m_locations = locations;
+	m_interned = interned;
+	m_count = (int)pCursor->GetCount();
+}
+
+ResultCursor::~ResultCursor()
+{
+	this->!ResultCursor();
+}
+
+ResultCursor::!ResultCursor()
+{
+	delete m_pCursor;
+	m_pCursor = NULL;
+}
+
+// milliseconds the UI thread waits for the core before a page is reported busy,
+// a load or a search holds the core for seconds
+#define BRIDGE_CURSOR_WAIT 20
+
+bool ResultCursor::TrySort(ResultSortColumn column, bool descending)
+{
+	if (m_pCursor == NULL)
+		return true;
+
+	// the sort keys are read from the items of the inventory cache shared with the loads
+	msclr::lock lock(m_syncRoot, msclr::lock_later);
+	if (!lock.try_acquire(BRIDGE_CURSOR_WAIT))
+		return false;
+
+	// a cursor whose inventories were reloaded is left as is, its pages are then null
+	m_pCursor->Sort(*m_pApi, (int)column, descending);
+	return true;
+}
+
+bool ResultCursor::TryGetPage(int offset, int count, array<ManagedSearchHit^>^% hits)
+{
+	hits = nullptr;
+
+	if (m_pCursor == NULL || offset < 0 || count <= 0)
+		return true;
+
+	// the items belong to the inventory cache shared with the searches
+	msclr::lock lock(m_syncRoot, msclr::lock_later);
+	if (!lock.try_acquire(BRIDGE_CURSOR_WAIT))
+		return false;
+
+	std::vector<CoreSearchHit> page;
+	if (!m_pCursor->GetPage(*m_pApi, (size_t)offset, (size_t)count, page))
+		return true;
+
+	hits = ToManagedHits(m_pApi, page, m_characters, m_locations, m_interned);
+	return true;
+}
@@ -1,5 +1,12 @@
 #pragma once
 
+class CoreApi;
+class CoreResultCursor;
+class CoreSession;
+struct StringInternMap;
+struct NativePivot;
+struct CoreSearchSession;
+
 using namespace System;
 
 namespace VanaCargoBridge
@@ -79,6 +86,13 @@ namespace VanaCargoBridge
 		String^ m_displayName = nullptr;
 	};
 
+	// where the bags of a character are read from, the values of CORE_INVENTORY_SOURCE
+	public enum class InventorySource
+	{
+		Dat = 0,
+		FindAll
+	};
+
 	public ref class ManagedCharacter
 	{
 	public:
@@ -94,14 +108,50 @@ namespace VanaCargoBridge
 			void set(String ^ value) { m_name = value; }
 		}
 
+			property InventorySource Source
+		{
+			InventorySource get() { return m_source; }
+			void set(InventorySource value) { m_source = value; }
+		}
+
 	private:
 		String^ m_id = nullptr;
 		String^ m_name = nullptr;
+		InventorySource m_source = InventorySource::Dat;
+	};
+
+	// one managed string per distinct value of the fields repeated across items (Attr, Slot, Races,
+	// Level, Jobs), shared by all the inventories and searches of a bridge
+	ref class StringInternTable
+	{
+	internal:
+		StringInternTable();
+		~StringInternTable();
+		!StringInternTable();
+
+		String^ Intern(const wchar_t* pText, int length);
+		String^ Intern(array<Char>^ strings, int offset, int length);
+		void GetStats(Int64% entries, Int64% hits, Int64% bytesSaved);
+
+	private:
+		StringInternMap* m_pMap;
+	};
+
+	// inventory copied in bulk from a CoreInventoryBuffer, one managed array per native buffer
+	ref class InventoryData
+	{
+	internal:
+		array<Char>^ Strings;
+		array<int>^ Records;
+		array<Byte>^ Icons;
+		StringInternTable^ Interned;
 	};
 
 	public ref class ManagedItem
 	{
 	public:
+		ManagedItem() {}
+
 		property int Id
 		{
 			int get() { return m_id; }
@@ -116,49 +166,49 @@ namespace VanaCargoBridge
 
 			property String^ Name
 		{
-			String ^ get() { return m_name; }
+			String ^ get();
 			void set(String ^ value) { m_name = value; }
 		}
 
 			property String^ Attr
 		{
-			String ^ get() { return m_attr; }
+			String ^ get();
 			void set(String ^ value) { m_attr = value; }
 		}
 
 			property String^ Description
 		{
-			String ^ get() { return m_description; }
+			String ^ get();
 			void set(String ^ value) { m_description = value; }
 		}
 
 			property String^ Slot
 		{
-			String ^ get() { return m_slot; }
+			String ^ get();
 			void set(String ^ value) { m_slot = value; }
 		}
 
 			property String^ Races
 		{
-			String ^ get() { return m_races; }
+			String ^ get();
 			void set(String ^ value) { m_races = value; }
 		}
 
 			property String^ Level
 		{
-			String ^ get() { return m_level; }
+			String ^ get();
 			void set(String ^ value) { m_level = value; }
 		}
 
 			property String^ Jobs
 		{
-			String ^ get() { return m_jobs; }
+			String ^ get();
 			void set(String ^ value) { m_jobs = value; }
 		}
 
 		property String^ Remarks
 		{
-			String ^ get() { return m_remarks; }
+			String ^ get();
 			void set(String ^ value) { m_remarks = value; }
 		}
 
@@ -182,11 +232,19 @@ namespace VanaCargoBridge
 
 			property array<Byte>^ IconPixels
 		{
-			array<Byte> ^ get() { return m_iconPixels; }
+			array<Byte> ^ get();
 			void set(array<Byte> ^ value) { m_iconPixels = value; }
 		}
 
+	internal:
+		ManagedItem(InventoryData^ data, int record);
+
 	private:
+		String^ GetText(String^% text, int field);
+
+		// the buffers the item is a view of, its texts and pixels are only copied out when read
+		InventoryData^ m_data = nullptr;
+		int m_record = 0;
 		int m_id = 0;
 		int m_count = 0;
 		String^ m_name = nullptr;
@@ -250,10 +308,274 @@ namespace VanaCargoBridge
 		array<ManagedCharacter^>^ m_characters = nullptr;
 	};
 
+	public ref class ManagedSearchHit
+	{
+	public:
+		property String^ Character
+		{
+			String ^ get() { return m_character; }
+			void set(String ^ value) { m_character = value; }
+		}
+
+			property String^ Location
+		{
+			String ^ get() { return m_location; }
+			void set(String ^ value) { m_location = value; }
+		}
+
+			property ManagedItem^ Item
+		{
+			ManagedItem ^ get() { return m_item; }
+			void set(ManagedItem ^ value) { m_item = value; }
+		}
+
+	private:
+		String^ m_character = nullptr;
+		String^ m_location = nullptr;
+		ManagedItem^ m_item = nullptr;
+	};
+
+	// sizes of the caches kept by the session of a CoreBridge
+	public ref class ManagedMemoryStats
+	{
+	public:
+		property Int64 Inventories
+		{
+			Int64 get() { return m_inventories; }
+			void set(Int64 value) { m_inventories = value; }
+		}
+
+			property Int64 Items
+		{
+			Int64 get() { return m_items; }
+			void set(Int64 value) { m_items = value; }
+		}
+
+			property Int64 ItemTextBytes
+		{
+			Int64 get() { return m_itemTextBytes; }
+			void set(Int64 value) { m_itemTextBytes = value; }
+		}
+
+			property Int64 SearchTextBytes
+		{
+			Int64 get() { return m_searchTextBytes; }
+			void set(Int64 value) { m_searchTextBytes = value; }
+		}
+
+			property Int64 Icons
+		{
+			Int64 get() { return m_icons; }
+			void set(Int64 value) { m_icons = value; }
+		}
+
+			property Int64 IconBytes
+		{
+			Int64 get() { return m_iconBytes; }
+			void set(Int64 value) { m_iconBytes = value; }
+		}
+
+			property Int64 CachedResults
+		{
+			Int64 get() { return m_cachedResults; }
+			void set(Int64 value) { m_cachedResults = value; }
+		}
+
+			property Int64 CatalogEntries
+		{
+			Int64 get() { return m_catalogEntries; }
+			void set(Int64 value) { m_catalogEntries = value; }
+		}
+
+			property Int64 OpenDatFiles
+		{
+			Int64 get() { return m_openDatFiles; }
+			void set(Int64 value) { m_openDatFiles = value; }
+		}
+
+			property Int64 InternedStrings
+		{
+			Int64 get() { return m_internedStrings; }
+			void set(Int64 value) { m_internedStrings = value; }
+		}
+
+			property Int64 InternHits
+		{
+			Int64 get() { return m_internHits; }
+			void set(Int64 value) { m_internHits = value; }
+		}
+
+			// managed allocations the intern table avoided, in bytes
+			property Int64 InternBytesSaved
+		{
+			Int64 get() { return m_internBytesSaved; }
+			void set(Int64 value) { m_internBytesSaved = value; }
+		}
+
+	private:
+		Int64 m_inventories = 0;
+		Int64 m_items = 0;
+		Int64 m_itemTextBytes = 0;
+		Int64 m_searchTextBytes = 0;
+		Int64 m_icons = 0;
+		Int64 m_iconBytes = 0;
+		Int64 m_cachedResults = 0;
+		Int64 m_catalogEntries = 0;
+		Int64 m_openDatFiles = 0;
+		Int64 m_internedStrings = 0;
+		Int64 m_internHits = 0;
+		Int64 m_internBytesSaved = 0;
+	};
+
+	// invoked from the searching thread with each batch of hits, hits is empty for progress-only updates
+	public delegate void SearchHitsHandler(array<ManagedSearchHit^>^ hits, int completed, int total);
+
+	// invoked from the loading thread, at most every 50 milliseconds and always once done
+	public delegate void ProgressHandler(int completed, int total);
+
+	// same values as CORE_SORT_COLUMN
+	public enum class ResultSortColumn
+	{
+		None = 0,
+		Character,
+		Location,
+		Count,
+		Name,
+		Description,
+		Attr,
+		Slot,
+		Races,
+		Level,
+		Jobs,
+		Remarks,
+		Id
+	};
+
+	// same values as CORE_EXPORT_COLUMN, Character and Location are always exported
+	[System::Flags]
+	public enum class ExportColumns
+	{
+		None = 0,
+		Name = 0x0001,
+		Attr = 0x0002,
+		Description = 0x0004,
+		Type = 0x0008,
+		Races = 0x0010,
+		Level = 0x0020,
+		Jobs = 0x0040,
+		Remarks = 0x0080,
+		BgWiki = 0x0100,
+		Count = 0x0200
+	};
+
+	// results of a search kept by the core, sorted natively and read one page at a time
+	public ref class ResultCursor
+	{
+	public:
+		~ResultCursor();
+		!ResultCursor();
+
+		property int Count
+		{
+			int get() { return m_count; }
+		}
+
+		// false while a load or a search holds the core, the order is then unchanged
+		bool TrySort(ResultSortColumn column, bool descending);
+		// false while a load or a search holds the core,
+		// hits is null once the inventory of one of the characters was reloaded
+		bool TryGetPage(int offset, int count, array<ManagedSearchHit^>^% hits);
+
+	internal:
+		ResultCursor(CoreApi* pApi, Object^ syncRoot, CoreResultCursor* pCursor,
+			array<ManagedCharacter^>^ characters, array<String^>^ locations, StringInternTable^ interned);
+
+	private:
+		CoreApi* m_pApi;
+		Object^ m_syncRoot;
+		CoreResultCursor* m_pCursor;
+		array<ManagedCharacter^>^ m_characters;
+		array<String^>^ m_locations;
+		StringInternTable^ m_interned;
+		int m_count;
+	};
+
+	// totals of the items across the characters, in flat arrays instead of an object per item:
+	// row i is the item ItemIds[i], its bags are the cells [RowFirstCell[i], RowFirstCell[i + 1])
+	// and a cell points into Characters and Locations
+	public ref class PivotTable
+	{
+	public:
+		~PivotTable();
+		!PivotTable();
+
+		property int Count
+		{
+			int get() { return m_itemIds->Length; }
+		}
+
+		property array<int>^ ItemIds { array<int>^ get() { return m_itemIds; } }
+		property array<bool>^ KeyItems { array<bool>^ get() { return m_keyItems; } }
+		property array<String^>^ Names { array<String^>^ get() { return m_names; } }
+		property array<Int64>^ Totals { array<Int64>^ get() { return m_totals; } }
+		// number of characters owning each item
+		property array<int>^ Owners { array<int>^ get() { return m_owners; } }
+		property array<int>^ RowFirstCell { array<int>^ get() { return m_rowFirstCell; } }
+		property array<int>^ CellCharacters { array<int>^ get() { return m_cellCharacters; } }
+		property array<int>^ CellLocations { array<int>^ get() { return m_cellLocations; } }
+		property array<Int64>^ CellCounts { array<Int64>^ get() { return m_cellCounts; } }
+		property array<ManagedCharacter^>^ Characters { array<ManagedCharacter^>^ get() { return m_characters; } }
+		property array<String^>^ Locations { array<String^>^ get() { return m_locations; } }
+
+		// one line per item and bag with the total of the item, UTF-8
+		bool ExportCsv(String^ path);
+
+	internal:
+		PivotTable(NativePivot* pPivot, array<ManagedCharacter^>^ characters, StringInternTable^ interned);
+
+	private:
+		NativePivot* m_pPivot;
+		array<int>^ m_itemIds;
+		array<bool>^ m_keyItems;
+		array<String^>^ m_names;
+		array<Int64>^ m_totals;
+		array<int>^ m_owners;
+		array<int>^ m_rowFirstCell;
+		array<int>^ m_cellCharacters;
+		array<int>^ m_cellLocations;
+		array<Int64>^ m_cellCounts;
+		array<ManagedCharacter^>^ m_characters;
+		array<String^>^ m_locations;
+	};
+
+	public ref class OpenCursorResult
+	{
+	public:
+		property ResultCursor^ Cursor
+		{
+			ResultCursor ^ get() { return m_cursor; }
+			void set(ResultCursor ^ value) { m_cursor = value; }
+		}
+
+			property String^ Message
+		{
+			String ^ get() { return m_message; }
+			void set(String ^ value) { m_message = value; }
+		}
+
+	private:
+		ResultCursor^ m_cursor = nullptr;
+		String^ m_message = nullptr;
+	};
+
+	// long-lived session of a frontend, the config, the open DAT files and the decoded inventories
+	// are kept until it is disposed
 	public ref class CoreBridge
 	{
 	public:
 		CoreBridge();
+		~CoreBridge();
+		!CoreBridge();
 		String^ Ping();
 		LoadResult^ LoadConfigAndCharacters(String^ configPath);
 		bool SaveSettings(String^ configPath, ManagedSettings^ settings);
@@ -262,5 +584,130 @@ namespace VanaCargoBridge
 			ManagedSettings^ settings,
 			ManagedCharacter^ character,
 			array<ManagedTabInfo^>^ tabs);
+		// decodes the inventory on the thread pool, onProgress receives the number of bags decoded;
+		// the task is canceled within an item of the token being canceled
+		System::Threading::Tasks::Task<array<ManagedTab^>^>^ LoadInventoryAsync(
+			ManagedSettings^ settings,
+			ManagedCharacter^ character,
+			array<ManagedTabInfo^>^ tabs,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+		bool Search(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ term,
+			SearchHitsHandler^ onHits,
+			System::Threading::CancellationToken cancellationToken);
+		// runs a query expression, message receives the plan and timings or the syntax error
+		bool Query(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ expression,
+			SearchHitsHandler^ onHits,
+			System::Threading::CancellationToken cancellationToken,
+			String^% message);
+		// runs a search (or a query expression) and keeps its results natively, onProgress only
+		// receives progress updates; message receives the query plan or the syntax error
+		ResultCursor^ OpenCursor(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ term,
+			bool isQuery,
+			SearchHitsHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken,
+			String^% message);
+		// OpenCursor on the thread pool, the cursor of a canceled search is disposed and the task canceled
+		System::Threading::Tasks::Task<OpenCursorResult^>^ OpenCursorAsync(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ term,
+			bool isQuery,
+			SearchHitsHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+
+		// writes the items of the characters to a UTF-8 CSV file on the thread pool, onProgress receives
+		// the number of characters written; the task returns the number of rows, -1 if the file couldn't
+		// be written, and a canceled export leaves no file. An incremental export only formats the
+		// characters that changed since the previous one to the same file
+		System::Threading::Tasks::Task<int>^ ExportCsvAsync(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ path,
+			ExportColumns columns,
+			bool incremental,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+		// ExportCsvAsync to the columnar binary format of CoreColumnar.h, every column is written
+		System::Threading::Tasks::Task<int>^ ExportColumnarAsync(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ path,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+
+		// totals of the items across the characters on the thread pool, filter is a search term or a query
+		// expression (isQuery) and every item is counted when it's empty; the task throws a FormatException
+		// with the reason of a syntax error
+		System::Threading::Tasks::Task<PivotTable^>^ AggregateAsync(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ filter,
+			bool isQuery,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+
+		ManagedMemoryStats^ GetMemoryStats();
+		// drops the decoded inventory of a character, the cursors on it return null pages
+		void EvictInventory(String^ characterId);
+		void ClearCache();
+
+	internal:
+		array<ManagedTab^>^ LoadInventory(
+			ManagedSettings^ settings,
+			ManagedCharacter^ character,
+			array<ManagedTabInfo^>^ tabs,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+		int ExportCsv(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ path,
+			ExportColumns columns,
+			bool incremental,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+		PivotTable^ Aggregate(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ filter,
+			bool isQuery,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken,
+			String^% message);
+		int ExportColumnar(
+			ManagedSettings^ settings,
+			array<ManagedCharacter^>^ characters,
+			array<ManagedTabInfo^>^ tabs,
+			String^ path,
+			ProgressHandler^ onProgress,
+			System::Threading::CancellationToken cancellationToken);
+
+	private:
+		CoreSession* m_pSession;
+		// the CoreApi of the session
+		CoreApi* m_pApi;
+		// lets a search that narrows the previous one refine its results
+		CoreSearchSession* m_pSearchSession;
+		StringInternTable^ m_interned;
+		Object^ m_syncRoot;
 	};
 }
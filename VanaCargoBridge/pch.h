@@ -1,3 +1,4 @@
 #pragma once
 
 #include <msclr/marshal_cppstd.h>
+#include <msclr/lock.h>
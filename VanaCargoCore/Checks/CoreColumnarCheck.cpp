@@ -0,0 +1,271 @@
+// Round trip of the columnar export format: files written in memory with the writers of
+// CoreColumnar.h, the way CoreApi::ExportColumnar writes them, are read back with
+// CoreColumnarReader. Covers the header, the row groups, the dictionary offsets and texts,
+// the footer and the trailer, then truncated and damaged files. Portable, built outside of
+// the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. CoreColumnarCheck.cpp ../CoreColumnar.cpp ../CoreUtf.cpp -o CoreColumnarCheck
+//   ./CoreColumnarCheck items.vccolumn && python3 vccolumn.py items.vccolumn
+//
+// prints each failed check and returns their number; with a path, also writes a file of 1000 rows
+// there for vccolumn.py
+
+#include "CoreColumnar.h"
+#include "CoreUtf.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char *pWhat)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", pWhat);
+		++s_failures;
+	}
+}
+
+// same interface as the buffered file of the export
+class MemoryFile
+{
+public:
+	bool Write(const char *pData, size_t size)
+	{
+		m_data.append(pData, size);
+
+		return true;
+	}
+
+	template <typename V> bool WriteValue(V value)
+	{
+		return Write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template <typename V> bool WriteValues(const std::vector<V> &values)
+	{
+		return Write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(V));
+	}
+
+	unsigned long long GetPosition() const { return m_data.size(); }
+
+	const std::string& GetData() const { return m_data; }
+
+private:
+	std::string m_data;
+};
+
+// every column of the rows as written, texts in UTF-8
+struct ExpectedFile
+{
+	std::vector<unsigned int> Values[CORE_COLUMNAR_COLUMN_COUNT];
+	std::vector<std::string> Texts[CORE_COLUMNAR_COLUMN_COUNT];
+	std::vector<size_t> GroupRows;
+	std::string Data;
+};
+
+static std::wstring BuildText(int column, size_t row)
+{
+	static const wchar_t *texts[] = { L"", L"Dragon Mask", L"Épée de Feu", L"光のクリスタル",
+		L"DEF:44 HP+20 \"Store TP\"+5\nAll Races", L"Lu Shang's Fishing Rod" };
+	std::wstring text = texts[(row * (column + 1)) % 6];
+
+	// a few distinct texts per column, shared by many rows
+	if (row % 7 == 3)
+		text += (wchar_t)(L'A' + column);
+
+	return text;
+}
+
+static void BuildFile(size_t rowCount, size_t groupRows, ExpectedFile &expected)
+{
+	std::vector<unsigned int> values[CORE_COLUMNAR_COLUMN_COUNT];
+	CoreColumnarDictionary dictionaries[CORE_COLUMNAR_COLUMN_COUNT];
+	std::vector<unsigned long long> groupOffsets;
+	MemoryFile file;
+	bool success = CoreColumnarWriteHeader(file);
+
+	for (size_t row = 0; row < rowCount && success; ++row)
+	{
+		for (int i = 0; i < CORE_COLUMNAR_COLUMN_COUNT; ++i)
+		{
+			unsigned int value = (unsigned int)(row * 2654435761U + i);
+
+			if (CoreColumnarColumns[i].Type == CORE_COLUMNAR_DICTIONARY)
+			{
+				std::wstring text = BuildText(i, row);
+				std::string utf8;
+
+				value = dictionaries[i].Add(text);
+				CoreAppendUtf8(utf8, text.c_str(), text.size());
+
+				if (value == expected.Texts[i].size())
+					expected.Texts[i].push_back(utf8);
+			}
+			else if (CoreColumnarColumns[i].Type == CORE_COLUMNAR_INT32 && row % 3 == 0)
+			{
+				value = (unsigned int)-(int)(row + 1);
+			}
+
+			values[i].push_back(value);
+			expected.Values[i].push_back(value);
+		}
+
+		if (values[0].size() == groupRows)
+		{
+			expected.GroupRows.push_back(values[0].size());
+			success = CoreColumnarWriteGroup(file, values, groupOffsets);
+		}
+	}
+
+	if (success && !values[0].empty())
+	{
+		expected.GroupRows.push_back(values[0].size());
+		success = CoreColumnarWriteGroup(file, values, groupOffsets);
+	}
+
+	success = success && CoreColumnarWriteFooter(file, dictionaries, groupOffsets, rowCount);
+
+	Check(success, "writing the file");
+	expected.Data = file.GetData();
+}
+
+static void CheckRoundTrip(size_t rowCount, size_t groupRows)
+{
+	ExpectedFile expected;
+	CoreColumnarReader reader;
+	char what[96];
+
+	BuildFile(rowCount, groupRows, expected);
+	snprintf(what, sizeof(what), "%u rows in groups of %u", (unsigned int)rowCount, (unsigned int)groupRows);
+
+	if (!reader.Open(expected.Data.data(), expected.Data.size()))
+	{
+		Check(false, what);
+		return;
+	}
+
+	Check(reader.GetColumnCount() == CORE_COLUMNAR_COLUMN_COUNT, "column count");
+	Check(reader.GetRowCount() == rowCount, "row count in the footer");
+	Check(reader.GetGroupCount() == expected.GroupRows.size(), "row group count");
+
+	for (size_t i = 0; i < reader.GetColumnCount() && i < CORE_COLUMNAR_COLUMN_COUNT; ++i)
+	{
+		Check(reader.GetColumnName(i) == CoreColumnarColumns[i].pName, "column name");
+		Check(reader.GetColumnType(i) == CoreColumnarColumns[i].Type, "column type");
+		Check(reader.GetDictionarySize(i) == expected.Texts[i].size(), "dictionary size");
+
+		for (size_t e = 0; e < expected.Texts[i].size(); ++e)
+			Check(reader.GetDictionaryText(i, (unsigned int)e) == expected.Texts[i][e], "dictionary text");
+
+		Check(reader.GetDictionaryText(i, (unsigned int)expected.Texts[i].size()).empty(), "dictionary index out of range");
+	}
+
+	size_t firstRow = 0;
+	std::vector<unsigned int> values;
+
+	for (size_t g = 0; g < reader.GetGroupCount() && g < expected.GroupRows.size(); ++g)
+	{
+		Check(reader.GetGroupRowCount(g) == expected.GroupRows[g], "rows of a group");
+
+		for (size_t i = 0; i < CORE_COLUMNAR_COLUMN_COUNT; ++i)
+		{
+			reader.ReadColumn(g, i, values);
+
+			Check(values.size() == expected.GroupRows[g]
+				&& std::equal(values.begin(), values.end(), expected.Values[i].begin() + firstRow), what);
+		}
+
+		firstRow += expected.GroupRows[g];
+	}
+}
+
+// a file of a few groups, cut or damaged in the places a reader relies on
+static void CheckDamagedFiles()
+{
+	ExpectedFile expected;
+	CoreColumnarReader reader;
+
+	BuildFile(50, 16, expected);
+
+	const std::string &data = expected.Data;
+	size_t trailer = data.size() - sizeof(unsigned long long) - CORE_COLUMNAR_MAGIC_SIZE;
+	size_t rowCount = trailer - sizeof(unsigned long long);
+	size_t groupOffsets = rowCount - expected.GroupRows.size() * sizeof(unsigned long long);
+	unsigned long long footer = 0;
+	unsigned long long firstGroup = 0;
+	bool rejected = true;
+
+	memcpy(&footer, data.data() + trailer, sizeof(footer));
+	memcpy(&firstGroup, data.data() + groupOffsets, sizeof(firstGroup));
+
+	for (size_t size = 0; size < data.size(); ++size)
+		rejected = rejected && !reader.Open(data.data(), size);
+
+	Check(rejected, "truncated file");
+
+	struct Damage
+	{
+		const char *pWhat;
+		size_t Offset;
+		int Delta;
+	} damages[] = {
+		{ "magic", 0, 1 },
+		{ "version", CORE_COLUMNAR_MAGIC_SIZE, 1 },
+		{ "column count", CORE_COLUMNAR_MAGIC_SIZE + 4, 1 },
+		{ "column type", CORE_COLUMNAR_MAGIC_SIZE + 8, 3 },
+		{ "length of a column name", CORE_COLUMNAR_MAGIC_SIZE + 12, 100 },
+		{ "footer offset after the footer", trailer, 1 },
+		{ "footer offset before the footer", trailer, -4 },
+		{ "trailer magic", data.size() - 1, 1 },
+		{ "row count", rowCount, 1 },
+		{ "offset of the second group", groupOffsets + sizeof(unsigned long long), 4 },
+		{ "offset of the last group", rowCount - sizeof(unsigned long long), -4 },
+		{ "rows of the first group", (size_t)firstGroup, 1 },
+		// the first dictionary starts the footer: entry count, then offsets[0] which must be 0
+		{ "dictionary entry count", (size_t)footer, 1 },
+		{ "first dictionary offset", (size_t)footer + 4, 1 },
+	};
+
+	for (size_t d = 0; d < sizeof(damages) / sizeof(damages[0]); ++d)
+	{
+		std::string damaged = data;
+
+		damaged[damages[d].Offset] = (char)(damaged[damages[d].Offset] + damages[d].Delta);
+		Check(!reader.Open(damaged.data(), damaged.size()), damages[d].pWhat);
+	}
+
+	Check(reader.Open(data.data(), data.size()), "the undamaged file");
+}
+
+int main(int argc, char *argv[])
+{
+	CheckRoundTrip(0, 16);
+	CheckRoundTrip(1, 16);
+	CheckRoundTrip(16, 16);
+	CheckRoundTrip(17, 16);
+	CheckRoundTrip(1000, 300);
+	CheckDamagedFiles();
+
+	if (argc > 1)
+	{
+		ExpectedFile expected;
+		FILE *pFile = fopen(argv[1], "wb");
+
+		BuildFile(1000, 300, expected);
+		Check(pFile != NULL && fwrite(expected.Data.data(), 1, expected.Data.size(), pFile) == expected.Data.size(),
+			"writing the file for vccolumn.py");
+
+		if (pFile != NULL)
+			fclose(pFile);
+	}
+
+	if (s_failures == 0)
+		printf("all checks passed\n");
+
+	return s_failures;
+}
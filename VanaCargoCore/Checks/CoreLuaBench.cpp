@@ -0,0 +1,112 @@
+// Throughput of the tokenizer on a synthetic FindAll dump of a few MB: bags of [id] = count
+// entries, key items, and resource-like records with escaped strings and comments. Portable,
+// built outside of the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. CoreLuaBench.cpp ../CoreLua.cpp -o CoreLuaBench
+//
+// prints the time of a pass and fails if a pass misses a token or stops on an error
+
+#include "CoreLua.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+#define BENCH_PASSES 10
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the dump and the number of tokens it holds
+static size_t BuildDump(std::string &text)
+{
+	static const char *bags[] = { "inventory", "safe", "safe2", "storage", "locker", "satchel", "sack", "case",
+		"wardrobe", "wardrobe2", "wardrobe3", "wardrobe4" };
+	size_t tokens = 1;
+	char line[160];
+
+	text = "-- FindAll dump\nreturn {\n";
+
+	for (int copy = 0; copy < 64; ++copy)
+	{
+		for (size_t bag = 0; bag < sizeof(bags) / sizeof(bags[0]); ++bag)
+		{
+			snprintf(line, sizeof(line), "\t[\"%s%d\"] = {\n", bags[bag], copy);
+			text += line;
+			tokens += 2;
+
+			for (int slot = 0; slot < 300; ++slot)
+			{
+				snprintf(line, sizeof(line), "\t\t[%d] = %d,\n", 10000 + (copy * 7919 + slot * 31) % 20000, 1 + slot % 99);
+				text += line;
+				++tokens;
+			}
+
+			text += "\t},\n";
+		}
+
+		text += "\t[\"key items\"] = { ";
+		tokens += 2;
+
+		for (int item = 0; item < 200; ++item)
+		{
+			snprintf(line, sizeof(line), "%d, ", 2000 + item);
+			text += line;
+			++tokens;
+		}
+
+		text += "},\n";
+
+		for (int record = 0; record < 400; ++record)
+		{
+			snprintf(line, sizeof(line),
+				"\t{id=%d, en=\"Dragon's \\\"Hide\\\" %d\", ja='\\227\\131\\137', category=[[Temporary]]}, --[[ %d ]]\n",
+				record, record, record);
+			text += line;
+			tokens += 6;
+		}
+	}
+
+	text += "\tgil = 123456789,\n}\n";
+	tokens += 2;
+
+	return tokens;
+}
+
+int main()
+{
+	std::string text;
+	size_t expected = BuildDump(text);
+	size_t tokens = 0;
+	bool failed = false;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int pass = 0; pass < BENCH_PASSES; ++pass)
+	{
+		CoreLuaTokenizer tokenizer(text.data(), text.size());
+		CoreLuaToken token;
+
+		tokens = 0;
+
+		while (tokenizer.Next(token))
+			++tokens;
+
+		failed = failed || tokenizer.HasError() || tokens != expected;
+	}
+
+	double passMs = ElapsedMs(start) / BENCH_PASSES;
+
+	printf("%u bytes, %u tokens: %.2f ms per pass, %.0f MB/s\n", (unsigned int)text.size(), (unsigned int)tokens,
+		passMs, text.size() / (passMs * 1000.0));
+
+	if (failed)
+	{
+		printf("tokenizing FAILED: %u tokens of %u\n", (unsigned int)tokens, (unsigned int)expected);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,230 @@
+// Checks of the tokenizer of the FindAll dumps and of key_items.lua. Portable, built outside of
+// the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. CoreLuaCheck.cpp ../CoreLua.cpp -o CoreLuaCheck
+//
+// prints each failed check and returns the number of failures
+
+#include "CoreLua.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char *pWhat)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", pWhat);
+		++s_failures;
+	}
+}
+
+// the tokens of a text, one line each: depth, type, key and value; "error" last on a syntax error
+static std::string Describe(const char *pText)
+{
+	static const char *types[] = { "end", "{", "}", "string", "number", "name" };
+	static const char *keys[] = { "", "name:", "string:", "number:" };
+
+	CoreLuaTokenizer tokenizer(pText, strlen(pText));
+	CoreLuaToken token;
+	std::string out;
+
+	while (tokenizer.Next(token))
+	{
+		std::string key(token.Key.pText != NULL ? token.Key.pText : "", token.Key.Length);
+		std::string value(token.Value.pText != NULL ? token.Value.pText : "", token.Value.Length);
+
+		if (token.KeyEscaped)
+			CoreLuaUnescape(token.Key, key);
+
+		if (token.ValueEscaped)
+			CoreLuaUnescape(token.Value, value);
+
+		out += std::to_string(token.Depth) + " " + types[token.Type];
+
+		if (token.KeyType != CORE_LUA_KEY_NONE)
+			out += std::string(" ") + keys[token.KeyType] + key;
+
+		if (!value.empty())
+			out += " " + value;
+
+		out += "\n";
+	}
+
+	if (tokenizer.HasError())
+		out += "error\n";
+
+	return out;
+}
+
+static void CheckDescribe(const char *pText, const char *pExpected, const char *pWhat)
+{
+	std::string result = Describe(pText);
+
+	if (result != pExpected)
+		printf("%s", result.c_str());
+
+	Check(result == pExpected, pWhat);
+}
+
+static void CheckTables()
+{
+	CheckDescribe("return { inventory = { [12] = 3, [-4] = 0x10 }, gil = 100 }",
+		"0 {\n"
+		"1 { name:inventory\n"
+		"2 number number:12 3\n"
+		"2 number number:-4 0x10\n"
+		"2 }\n"
+		"1 number name:gil 100\n"
+		"1 }\n",
+		"nested tables, name and number keys");
+
+	CheckDescribe("{ [\"key items\"] = { 1; 2, }, ['safe'] = {}, true, nil }",
+		"0 {\n"
+		"1 { string:key items\n"
+		"2 number 1\n"
+		"2 number 2\n"
+		"2 }\n"
+		"1 { string:safe\n"
+		"2 }\n"
+		"1 name true\n"
+		"1 name nil\n"
+		"1 }\n",
+		"string keys, separators and positional values");
+
+	CheckDescribe("{ a = { b = { c = { d = 1 } } } }",
+		"0 {\n"
+		"1 { name:a\n"
+		"2 { name:b\n"
+		"3 { name:c\n"
+		"4 number name:d 1\n"
+		"4 }\n"
+		"3 }\n"
+		"2 }\n"
+		"1 }\n",
+		"depth of deeply nested tables");
+}
+
+static void CheckStrings()
+{
+	CheckDescribe("{ en = \"Dragon's \\\"Hide\\\"\", ja = 'A\\tB\\065', [\"x\\ny\"] = [[raw \\n]] }",
+		"0 {\n"
+		"1 string name:en Dragon's \"Hide\"\n"
+		"1 string name:ja A\tBA\n"
+		"1 string string:x\ny raw \\n\n"
+		"1 }\n",
+		"escapes decoded, long strings kept as is");
+
+	CheckDescribe("{ [==[a]]b]==], [[\nline]] }",
+		"0 {\n"
+		"1 string a]]b\n"
+		"1 string line\n"
+		"1 }\n",
+		"long strings with levels and a leading newline");
+
+	CoreLuaTokenizer tokenizer("\"a\\\\\"", 5);
+	CoreLuaToken token;
+	std::string text;
+
+	Check(tokenizer.Next(token) && token.ValueEscaped, "escaped backslash before the quote");
+	CoreLuaUnescape(token.Value, text);
+	Check(text == "a\\", "escaped backslash decoded");
+}
+
+static void CheckComments()
+{
+	CheckDescribe("-- header\n{ --[[ block\n } ]] a = 1, -- line }\n --[==[ ]] ]==] b = 2 }",
+		"0 {\n"
+		"1 number name:a 1\n"
+		"1 number name:b 2\n"
+		"1 }\n",
+		"line and block comments");
+
+	CheckDescribe("{ a = 1 } -- no newline at the end",
+		"0 {\n"
+		"1 number name:a 1\n"
+		"1 }\n",
+		"comment at the end of the text");
+
+	CheckDescribe("{ a = 1 } --[[ not closed",
+		"0 {\n"
+		"1 number name:a 1\n"
+		"1 }\n",
+		"unclosed block comment read as a line comment");
+}
+
+static void CheckTruncated()
+{
+	CheckDescribe("{ a = { [1] = 2", "0 {\n1 { name:a\n2 number number:1 2\nerror\n", "truncated inside a table");
+	CheckDescribe("{ a = \"unfinished", "0 {\nerror\n", "truncated inside a string");
+	CheckDescribe("{ [\"key\"", "0 {\nerror\n", "truncated inside a key");
+	CheckDescribe("{ a = ", "0 {\nerror\n", "truncated after a key");
+	CheckDescribe("{ [[long", "0 {\nerror\n", "truncated inside a long string");
+	CheckDescribe("}", "error\n", "end of a table never opened");
+	CheckDescribe("{ a = = 1 }", "0 {\nerror\n", "value missing");
+
+	// every prefix of a dump ends on an error or on a complete value, without reading past it
+	const char *pDump = "return { [\"inventory\"] = { [4096] = 12, [\"x\\\"y\"] = 'z' }, gil = -5 } --[[ end ]]";
+	size_t length = strlen(pDump);
+	bool stopped = true;
+
+	for (size_t i = 0; i < length; ++i)
+	{
+		std::vector<char> prefix(pDump, pDump + i);
+		const char *pText = prefix.empty() ? "" : &prefix[0];
+		CoreLuaTokenizer tokenizer(pText, i);
+		CoreLuaToken token;
+		int tokens = 0;
+
+		while (tokenizer.Next(token))
+		{
+			stopped = stopped && token.Value.pText + token.Value.Length <= pText + i
+				&& token.Key.pText + token.Key.Length <= pText + i;
+
+			if (++tokens > 100)
+				stopped = false;
+		}
+	}
+
+	Check(stopped, "every prefix of a dump stays in bounds");
+}
+
+static void CheckNumbers()
+{
+	long long value = 0;
+	CoreLuaSpan span;
+
+	span.pText = "-1234.5";
+	span.Length = 7;
+	Check(CoreLuaToInt64(span, value) && value == -1234, "integral part of a decimal");
+
+	span.pText = "12";
+	span.Length = 1;
+	Check(CoreLuaToInt64(span, value) && value == 1, "span not terminated");
+
+	span.pText = "x1";
+	span.Length = 2;
+	Check(!CoreLuaToInt64(span, value) && value == 0, "not a number");
+
+	CheckDescribe("{ 1e5, 2.5E-3, .5, 0xFF }",
+		"0 {\n1 number 1e5\n1 number 2.5E-3\n1 number .5\n1 number 0xFF\n1 }\n",
+		"exponents, fractions and hexadecimal");
+}
+
+int main()
+{
+	CheckTables();
+	CheckStrings();
+	CheckComments();
+	CheckTruncated();
+	CheckNumbers();
+
+	if (s_failures == 0)
+		printf("all checks passed\n");
+
+	return s_failures;
+}
@@ -0,0 +1,91 @@
+// Checks of the row index and of the cell text of the virtual lists. Portable, built outside of
+// the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. CoreRowsCheck.cpp ../CoreRows.cpp -o CoreRowsCheck
+//
+// prints each failed check and returns the number of failures
+
+#include "CoreRows.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char *pWhat)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", pWhat);
+		++s_failures;
+	}
+}
+
+static bool IsRow(const CoreRowIndex &rows, int row, int record, int count)
+{
+	return row < rows.GetCount() && rows.GetRow(row).Record == record && rows.GetRow(row).Count == count;
+}
+
+static void CheckRowIndex()
+{
+	CoreRowIndex rows;
+
+	rows.Add(0, 3, false);
+	rows.Add(1, 2, true);
+	rows.Add(2, 1, true);
+	rows.Add(3, 0, false);
+
+	Check(rows.GetCount() == 5, "Add: a row per item when expanded, one when compact");
+	Check(IsRow(rows, 0, 0, 1) && IsRow(rows, 2, 0, 1), "Add: the expanded rows count one");
+	Check(IsRow(rows, 3, 1, 2), "Add: the compact row keeps the count");
+	Check(IsRow(rows, 4, 2, 1), "Add: a single item is a single row");
+
+	Check(rows.Find(0) == 0 && rows.Find(1) == 3 && rows.Find(2) == 4, "Find: first row of a record");
+	Check(rows.Find(3) == -1, "Find: a record without rows");
+
+	// descending records: the three rows of record 0 compare equal and stay last, in order
+	rows.Sort([](int left, int right) { return right - left; });
+
+	Check(IsRow(rows, 0, 2, 1) && IsRow(rows, 1, 1, 2), "Sort: records in order");
+	Check(IsRow(rows, 2, 0, 1) && IsRow(rows, 4, 0, 1), "Sort: equal rows kept together");
+	Check(rows.Find(0) == 2 && rows.Find(2) == 0, "Find: after a sort");
+
+	rows.Clear();
+
+	Check(rows.GetCount() == 0 && rows.Find(0) == -1, "Clear: no rows left");
+}
+
+static void CheckCellText()
+{
+	wchar_t buffer[8];
+
+	CoreCopyCellText(L"Longer than the cell", buffer, 8);
+	Check(wcscmp(buffer, L"Longer ") == 0, "CopyCellText: truncated and terminated");
+
+	CoreCopyCellText(NULL, buffer, 8);
+	Check(buffer[0] == 0, "CopyCellText: no text is an empty cell");
+
+	CoreFormatCellCount(L"Ab", 3, buffer, 8);
+	Check(wcscmp(buffer, L"Ab (3)") == 0, "FormatCellCount: name and count");
+
+	CoreFormatCellCount(L"Longname", 12, buffer, 8);
+	Check(wcscmp(buffer, L"Lo (12)") == 0, "FormatCellCount: the name is truncated, not the count");
+
+	CoreFormatCellCount(L"Ab", 1234567, buffer, 8);
+	Check(wcscmp(buffer, L"Ab") == 0, "FormatCellCount: a count wider than the cell is left out");
+
+	buffer[0] = L'x';
+	CoreFormatCellCount(L"Ab", 3, buffer, 1);
+	Check(buffer[0] == 0, "FormatCellCount: a cell of one character stays empty");
+}
+
+int main()
+{
+	CheckRowIndex();
+	CheckCellText();
+
+	if (s_failures == 0)
+		printf("all checks passed\n");
+
+	return s_failures;
+}
@@ -0,0 +1,161 @@
+// Checks that the AVX2 and scalar paths of the search kernels set the same bits, on lengths that
+// end inside a lane of 8 values and inside a word of 32, then times both paths on an inventory
+// the size of a large account. Portable, built outside of the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. SearchKernelCheck.cpp ../SearchKernel.cpp -o SearchKernelCheck
+//
+// prints each failed check and the time of a call, returns the number of failures
+
+#include "SearchKernel.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#define BENCH_ITEMS 40000
+#define BENCH_CALLS 2000
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char *pWhat, size_t count)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s, %u values\n", pWhat, (unsigned int)count);
+		++s_failures;
+	}
+}
+
+// values spread over the whole range, the sign bit included, with runs of equal values
+static std::vector<unsigned int> BuildValues(size_t count, unsigned int seed)
+{
+	std::vector<unsigned int> values(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		values[i] = (i % 5 == 0) ? 0x80000010 : (i % 3 == 0) ? 12 : seed;
+	}
+
+	return values;
+}
+
+// every bit up to the count as expected, none past it
+static bool Matches(const SearchBitset &result, const std::vector<bool> &expected)
+{
+	if (result.GetCount() != expected.size())
+		return false;
+
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		if (result.Test(i) != expected[i])
+			return false;
+	}
+
+	size_t bits = result.GetWordCount() * SEARCH_BITSET_WORD_BITS;
+
+	for (size_t i = expected.size(); i < bits; ++i)
+	{
+		if ((result.GetWords()[i / SEARCH_BITSET_WORD_BITS] >> (i % SEARCH_BITSET_WORD_BITS)) & 1)
+			return false;
+	}
+
+	return true;
+}
+
+static void CheckMaskCompare(const std::vector<unsigned int> &values, unsigned int andMask, unsigned int expected, bool equal)
+{
+	const unsigned int *pValues = values.empty() ? NULL : &values[0];
+	std::vector<bool> reference(values.size());
+	SearchBitset result;
+
+	for (size_t i = 0; i < values.size(); ++i)
+		reference[i] = ((values[i] & andMask) == expected) == equal;
+
+	for (int avx2 = 0; avx2 < 2; ++avx2)
+	{
+		SearchKernelEnableAVX2(avx2 != 0);
+		SearchKernelMaskCompare(pValues, values.size(), andMask, expected, equal, result);
+		Check(Matches(result, reference), avx2 ? "MaskCompare with AVX2" : "MaskCompare without AVX2", values.size());
+	}
+}
+
+static void CheckRange(const std::vector<unsigned int> &values, unsigned int min, unsigned int max)
+{
+	const unsigned int *pValues = values.empty() ? NULL : &values[0];
+	std::vector<bool> reference(values.size());
+	SearchBitset result;
+
+	for (size_t i = 0; i < values.size(); ++i)
+		reference[i] = min <= values[i] && values[i] <= max;
+
+	for (int avx2 = 0; avx2 < 2; ++avx2)
+	{
+		SearchKernelEnableAVX2(avx2 != 0);
+		SearchKernelRange(pValues, values.size(), min, max, result);
+		Check(Matches(result, reference), avx2 ? "Range with AVX2" : "Range without AVX2", values.size());
+	}
+}
+
+static double TimeCallUs(const std::vector<unsigned int> &values, bool avx2, bool range)
+{
+	SearchBitset result;
+	size_t found = 0;
+
+	SearchKernelEnableAVX2(avx2);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int call = 0; call < BENCH_CALLS; ++call)
+	{
+		if (range)
+			SearchKernelRange(&values[0], values.size(), 10, 0x80000000 + (unsigned int)call, result);
+		else
+			SearchKernelMaskCompare(&values[0], values.size(), 0xFF, (unsigned int)call & 0xFF, true, result);
+
+		found += result.CountSet();
+	}
+
+	double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	// keeps the calls from being optimized away
+	if (found == (size_t)-1)
+		printf("\n");
+
+	return us / BENCH_CALLS;
+}
+
+int main()
+{
+	for (size_t count = 0; count <= 100; ++count)
+	{
+		std::vector<unsigned int> values = BuildValues(count, (unsigned int)count);
+
+		CheckMaskCompare(values, 0xFFFFFFFF, 12, true);
+		CheckMaskCompare(values, 0x80000000, 0x80000000, false);
+		CheckMaskCompare(values, 0, 0, true);
+		CheckRange(values, 10, 0x80000010);
+		CheckRange(values, 0, 0xFFFFFFFF);
+		CheckRange(values, 12, 12);
+		CheckRange(values, 0x90000000, 0x10);
+	}
+
+	std::vector<unsigned int> values = BuildValues(BENCH_ITEMS, 7);
+
+	CheckMaskCompare(values, 0x0000FF00, 0x00001200, true);
+	CheckRange(values, 0x7FFFFFFF, 0x80000010);
+
+	double maskScalar = TimeCallUs(values, false, false);
+	double maskAVX2 = TimeCallUs(values, true, false);
+	double rangeScalar = TimeCallUs(values, false, true);
+	double rangeAVX2 = TimeCallUs(values, true, true);
+
+	// the timings with AVX2 are those of the scalar path when the CPU doesn't support it
+	printf("%d values, AVX2 %s: MaskCompare %.2f us without AVX2, %.2f us with; Range %.2f us without, %.2f us with\n",
+		BENCH_ITEMS, SearchKernelHasAVX2() ? "available" : "unavailable", maskScalar, maskAVX2, rangeScalar, rangeAVX2);
+
+	if (s_failures == 0)
+		printf("all checks passed\n");
+
+	return s_failures;
+}
@@ -0,0 +1,192 @@
+// Per-item cost of typical gear searches through a compiled SearchProgram, over the columns of an
+// inventory the size of a large account. Each search is checked against a plain per-item test of
+// the same criteria. Portable, built outside of the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. SearchProgramBench.cpp ../SearchProgram.cpp ../SearchKernel.cpp -o SearchProgramBench
+//
+// prints the time of each search per item, fails if a search selects other items than the test
+
+#include "SearchProgram.h"
+#include "SearchKernel.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define BENCH_ITEMS 40000
+#define BENCH_PASSES 200
+
+// the criteria the way the search dialog enters them, tested item by item
+static bool MatchCriteria(const SearchCriteria &criteria, const SearchFields &fields)
+{
+	unsigned int classes = SEARCH_CLASS_ALL;
+	int ranges[4][2] = { { criteria.MinLevel, criteria.MaxLevel }, { criteria.MinDmg, criteria.MaxDmg },
+		{ criteria.MinDelay, criteria.MaxDelay }, { criteria.MinDef, criteria.MaxDef } };
+	const unsigned int rangeClasses[4] = { SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR, SEARCH_CLASS_WEAPON,
+		SEARCH_CLASS_ALL, SEARCH_CLASS_ARMOR };
+	const unsigned int values[4] = { fields.Level, fields.Damage, fields.Delay, fields.Defense };
+	unsigned int rareEx = (criteria.Rare ? SEARCH_ITEM_FLAG_RARE : 0) | (criteria.Exclusive ? SEARCH_ITEM_FLAG_EXCLUSIVE : 0);
+
+	if (criteria.Skill != 0)
+		classes &= SEARCH_CLASS_WEAPON;
+	if (criteria.JobsBitMask != 0 || criteria.RacesBitMask != 0)
+		classes &= SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+	if (criteria.SlotBitMask == SEARCH_SLOT_FLAG_MAIN)
+		classes &= SEARCH_CLASS_WEAPON;
+	else if (criteria.SlotBitMask == SEARCH_SLOT_FLAG_SUB)
+		classes &= SEARCH_CLASS_ARMOR;
+	else if (criteria.SlotBitMask != 0)
+		classes &= SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		if (SearchProgram::NormalizeRange(ranges[i][0], ranges[i][1]) == false)
+			continue;
+
+		classes &= rangeClasses[i];
+
+		if ((int)values[i] < ranges[i][0] || (int)values[i] > ranges[i][1])
+			return false;
+	}
+
+	return (fields.Class & classes) != 0
+		&& (criteria.Skill == 0 || fields.Skill == criteria.Skill)
+		&& (criteria.JobsBitMask == 0 || (fields.Jobs & criteria.JobsBitMask) != 0)
+		&& (criteria.RacesBitMask == 0 || (fields.Races & ~criteria.RacesBitMask) == 0)
+		&& (criteria.SlotBitMask == 0 || (fields.Slot & ~criteria.SlotBitMask) == 0)
+		&& (fields.Flags & rareEx) == rareEx;
+}
+
+// one item in six is a weapon, one in six armor, the rest have no gear attributes
+static void BuildItems(std::vector<SearchFields> &items)
+{
+	unsigned int seed = 12345;
+
+	items.resize(BENCH_ITEMS);
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		SearchFields &fields = items[i];
+
+		memset(&fields, 0, sizeof(fields));
+		seed = seed * 1664525 + 1013904223;
+
+		fields.Flags = (unsigned short)(((seed >> 8) % 4 == 0) ? SEARCH_ITEM_FLAG_RARE : 0)
+			| (unsigned short)(((seed >> 10) % 3 == 0) ? SEARCH_ITEM_FLAG_EXCLUSIVE : 0);
+
+		switch (i % 6)
+		{
+			case 0:
+				fields.Class = SEARCH_CLASS_WEAPON;
+				fields.Skill = (unsigned short)(1 + (seed >> 12) % 12);
+				fields.Slot = (unsigned short)(((seed >> 16) % 4 == 0) ? SEARCH_SLOT_FLAG_MAIN | SEARCH_SLOT_FLAG_SUB : SEARCH_SLOT_FLAG_MAIN);
+				fields.Damage = (unsigned short)(10 + (seed >> 4) % 300);
+				fields.Delay = (unsigned short)(180 + (seed >> 6) % 360);
+				break;
+			case 1:
+				fields.Class = SEARCH_CLASS_ARMOR;
+				fields.Slot = (unsigned short)(1 << (1 + (seed >> 12) % 14));
+				fields.Defense = (unsigned short)((seed >> 4) % 160);
+				break;
+			default:
+				fields.Class = SEARCH_CLASS_OTHER;
+				continue;
+		}
+
+		fields.Jobs = 1U << (1 + (seed >> 20) % 22);
+		fields.Jobs |= ((seed >> 5) % 3 == 0) ? 0x7FFFFE : 0;
+		fields.Races = (unsigned short)(((seed >> 24) % 4 == 0) ? 0x1FE : 0x002 << ((seed >> 26) % 8));
+		fields.Level = (unsigned short)(1 + (seed >> 14) % 99);
+		fields.ItemLevel = (unsigned short)((fields.Level == 99) ? 100 + (seed >> 3) % 20 : 0);
+	}
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	struct BenchSearch
+	{
+		const char *pName;
+		SearchCriteria Criteria;
+	} searches[7];
+	std::vector<SearchFields> items;
+	SearchColumns columns;
+	int failures = 0;
+
+	memset(searches, 0, sizeof(searches));
+
+	searches[0].pName = "no filter";
+	searches[1].pName = "WAR, level 99";
+	searches[1].Criteria.JobsBitMask = 0x000002;
+	searches[1].Criteria.MinLevel = 99;
+	searches[2].pName = "head, DEF 40-80";
+	searches[2].Criteria.SlotBitMask = 0x0010;
+	searches[2].Criteria.MinDef = 40;
+	searches[2].Criteria.MaxDef = 80;
+	searches[3].pName = "sword, DMG 100+, delay 200-260";
+	searches[3].Criteria.Skill = 3;
+	searches[3].Criteria.MinDmg = 100;
+	searches[3].Criteria.MaxDmg = 0xFFFF;
+	searches[3].Criteria.MinDelay = 200;
+	searches[3].Criteria.MaxDelay = 260;
+	searches[4].pName = "WHM/BLM/RDM, Hume male, level 1-75";
+	searches[4].Criteria.JobsBitMask = 0x000038;
+	searches[4].Criteria.RacesBitMask = 0x0002;
+	searches[4].Criteria.MinLevel = 1;
+	searches[4].Criteria.MaxLevel = 75;
+	searches[5].pName = "rare and exclusive";
+	searches[5].Criteria.Rare = true;
+	searches[5].Criteria.Exclusive = true;
+	searches[6].pName = "main hand, DEF set (never matches)";
+	searches[6].Criteria.SlotBitMask = SEARCH_SLOT_FLAG_MAIN;
+	searches[6].Criteria.MinDef = 10;
+
+	BuildItems(items);
+	columns.Reserve(items.size());
+
+	for (size_t i = 0; i < items.size(); ++i)
+		columns.Add(items[i]);
+
+	printf("%u items, AVX2 %s\n", (unsigned int)items.size(), SearchKernelHasAVX2() ? "used" : "not used");
+
+	for (size_t s = 0; s < sizeof(searches) / sizeof(searches[0]); ++s)
+	{
+		SearchProgram program;
+		SearchBitset selection;
+		size_t found = 0;
+
+		program.Compile(searches[s].Criteria);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int pass = 0; pass < BENCH_PASSES; ++pass)
+			found = program.Filter(columns, selection);
+
+		double searchMs = ElapsedMs(start) / BENCH_PASSES;
+		size_t expected = 0;
+		bool same = true;
+
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			bool match = MatchCriteria(searches[s].Criteria, items[i]);
+
+			expected += match ? 1 : 0;
+			same = same && (selection.GetCount() == 0 ? !match : selection.Test(i) == match);
+		}
+
+		same = same && (found == expected);
+
+		printf("%s: %u items, %u predicates, %.1f us, %.2f ns per item%s\n", searches[s].pName, (unsigned int)found,
+			(unsigned int)program.GetOpCount(), searchMs * 1000.0, searchMs * 1000000.0 / items.size(),
+			same ? "" : " - MISMATCH");
+
+		failures += same ? 0 : 1;
+	}
+
+	return failures;
+}
@@ -0,0 +1,151 @@
+// SearchTextArena::Refine against the scan it replaced, the former SearchHandler::ProcessSearchTerm: a lowered
+// copy of the name, log name and description of every item searched one after the other. Both
+// run on the same synthetic inventory and must select the same items. Portable, built outside of
+// the Visual Studio solution:
+//
+//   g++ -O2 -std=c++14 -I.. SearchTextBench.cpp ../SearchText.cpp ../SearchKernel.cpp -o SearchTextBench
+//
+// prints the time of a search for each term, fails if the two scans select different items
+
+#include "SearchText.h"
+
+#include <chrono>
+#include <locale.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <wctype.h>
+
+#define BENCH_ITEMS 16000
+#define BENCH_PASSES 10
+
+struct BenchItem
+{
+	std::wstring Name;
+	std::wstring LogName;
+	std::wstring Description;
+};
+
+// ProcessSearchTerm without CString: the term is already lowered, every field is copied and lowered
+static bool MatchLoweredCopies(const BenchItem &item, const wchar_t *pTerm)
+{
+	const std::wstring *fields[] = { &item.Name, &item.LogName, &item.Description };
+
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+	{
+		std::wstring lowered = *fields[i];
+
+		for (size_t j = 0; j < lowered.size(); ++j)
+			lowered[j] = (wchar_t)towlower((wint_t)lowered[j]);
+
+		if (lowered.find(pTerm) != std::wstring::npos)
+			return true;
+	}
+
+	return false;
+}
+
+// names, log names and descriptions of about 170 characters, as in the item DAT files
+static void BuildItems(std::vector<BenchItem> &items)
+{
+	static const wchar_t *names[] = { L"Dragon Mask", L"Haste Belt", L"Ochain", L"Kaja Ring", L"Moonbeam Cape",
+		L"Épée de Feu", L"Hi-Potion", L"Lu Shang's Fishing Rod", L"Adoulin Cuirass", L"光のクリスタル" };
+	static const wchar_t *stats[] = { L"DEF:44 HP+20 STR+9 DEX+9 VIT+9 AGI+9 Attack+15",
+		L"DEF:10 Accuracy+10 \"Store TP\"+5 Haste+8%", L"Magic Atk. Bonus+30 INT+25 Enmity-6",
+		L"Pet: Accuracy+20 Ranged Accuracy+20 Attack+20", L"Latent effect: Regain+50",
+		L"Enchantment: Teleport (Port Jeuno) \"Refresh\"+2" };
+	wchar_t buffer[64];
+
+	items.resize(BENCH_ITEMS);
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		BenchItem &item = items[i];
+
+		swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), L" %u", (unsigned int)(i % 97));
+		item.Name = names[i % 10];
+		item.Name += buffer;
+		item.LogName = L"a pair of ";
+		item.LogName += item.Name;
+		item.Description = stats[i % 6];
+		item.Description += L" All Races Lv.99 WAR PLD DRK BST SAM DRG RUN Unity ranking: ";
+		item.Description += stats[(i / 6) % 6];
+		item.Description += buffer;
+	}
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	// the labels are printed, %ls stops on the first character the C locale can't convert
+	static const struct { const wchar_t *pTerm; const char *pLabel; } terms[] = {
+		{ L"haste", "haste" }, { L"accuracy+20", "accuracy+20" }, { L"ring 4", "ring 4" }, { L"épée", "épée" },
+		{ L"クリ", "クリ" }, { L"\"refresh\"+2", "\"refresh\"+2" }, { L"no such item", "no such item" }, { L"e", "e" } };
+	std::vector<BenchItem> items;
+	SearchTextArena arena;
+	SearchBitset selection;
+	int failures = 0;
+
+	// towlower only folds ASCII in the C locale, "Épée" would never match "épée"
+	if (setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+		setlocale(LC_CTYPE, "");
+
+	BuildItems(items);
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		arena.AddItem();
+		arena.AddField(items[i].Name.c_str(), items[i].Name.size(), SEARCH_TEXT_FIELD_NAME);
+		arena.AddField(items[i].LogName.c_str(), items[i].LogName.size(), SEARCH_TEXT_FIELD_LOG_NAME);
+		arena.AddField(items[i].Description.c_str(), items[i].Description.size(), SEARCH_TEXT_FIELD_DESCRIPTION);
+	}
+
+	printf("%u items, %u characters\n", (unsigned int)items.size(), (unsigned int)arena.GetLength());
+
+	for (size_t t = 0; t < sizeof(terms) / sizeof(terms[0]); ++t)
+	{
+		std::vector<bool> copies(items.size());
+		size_t copiesFound = 0;
+		size_t arenaFound = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int pass = 0; pass < BENCH_PASSES; ++pass)
+		{
+			copiesFound = 0;
+
+			for (size_t i = 0; i < items.size(); ++i)
+			{
+				copies[i] = MatchLoweredCopies(items[i], terms[t].pTerm);
+				copiesFound += copies[i] ? 1 : 0;
+			}
+		}
+
+		double copiesMs = ElapsedMs(start) / BENCH_PASSES;
+
+		start = std::chrono::steady_clock::now();
+
+		for (int pass = 0; pass < BENCH_PASSES; ++pass)
+		{
+			selection.Resize(items.size(), true);
+			arenaFound = arena.Refine(terms[t].pTerm, selection);
+		}
+
+		double arenaMs = ElapsedMs(start) / BENCH_PASSES;
+		bool same = (copiesFound == arenaFound);
+
+		for (size_t i = 0; i < items.size() && same; ++i)
+			same = (copies[i] == selection.Test(i));
+
+		printf("%s: %u items, lowered copies %.2f ms, arena %.3f ms%s\n", terms[t].pLabel, (unsigned int)arenaFound,
+			copiesMs, arenaMs, same ? "" : " - MISMATCH");
+
+		failures += same ? 0 : 1;
+	}
+
+	return failures;
+}
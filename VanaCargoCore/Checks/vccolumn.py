@@ -0,0 +1,92 @@
+"""Minimal loader of the columnar export (CoreApi::ExportColumnar, layout in CoreColumnar.h).
+
+    python3 vccolumn.py items.vccolumn
+
+prints the columns and the first rows. From other code:
+
+    columns = load("items.vccolumn")
+    columns["name"]   # numpy array of str, one entry per row
+    columns["level"]  # numpy array of uint32
+
+Integer columns become uint32 or int32 arrays, dictionary columns are expanded to arrays of str.
+Needs numpy, the file is read in one piece.
+"""
+
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b"VCCOLUMN"
+VERSION = 1
+INT32, UINT32, DICTIONARY = 1, 2, 3
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:8] != MAGIC or data[-8:] != MAGIC:
+        raise ValueError("not a VCCOLUMN file")
+
+    version, column_count = struct.unpack_from("<II", data, 8)
+
+    if version != VERSION:
+        raise ValueError("unsupported version %d" % version)
+
+    # header: type, name length, name of each column
+    columns = []
+    position = 16
+
+    for _ in range(column_count):
+        column_type, length = struct.unpack_from("<II", data, position)
+        columns.append((data[position + 8:position + 8 + length].decode("utf-8"), column_type))
+        position += 8 + length
+
+    # footer: the dictionaries in column order, then the offsets of the row groups
+    (position,) = struct.unpack_from("<Q", data, len(data) - 16)
+    dictionaries = {}
+
+    for name, column_type in columns:
+        if column_type != DICTIONARY:
+            continue
+
+        (count,) = struct.unpack_from("<I", data, position)
+        offsets = np.frombuffer(data, "<u4", count + 1, position + 4)
+        start = position + 4 + 4 * (count + 1)
+        dictionaries[name] = np.array([data[start + offsets[i]:start + offsets[i + 1]].decode("utf-8")
+                                       for i in range(count)], dtype=object)
+        position = start + int(offsets[-1])
+
+    (group_count,) = struct.unpack_from("<I", data, position)
+    group_offsets = np.frombuffer(data, "<u8", group_count, position + 4)
+    (row_count,) = struct.unpack_from("<Q", data, position + 4 + 8 * group_count)
+
+    # row groups: row count, then the values of each column one after the other
+    parts = {name: [] for name, _ in columns}
+
+    for offset in group_offsets:
+        (rows,) = struct.unpack_from("<I", data, int(offset))
+        position = int(offset) + 4
+
+        for name, column_type in columns:
+            parts[name].append(np.frombuffer(data, "<i4" if column_type == INT32 else "<u4", rows, position))
+            position += 4 * rows
+
+    result = {}
+
+    for name, column_type in columns:
+        values = np.concatenate(parts[name]) if parts[name] else np.zeros(0, "<i4" if column_type == INT32 else "<u4")
+        result[name] = dictionaries[name][values] if column_type == DICTIONARY else values
+
+    if any(len(values) != row_count for values in result.values()):
+        raise ValueError("the row groups don't hold the %d rows of the footer" % row_count)
+
+    return result
+
+
+if __name__ == "__main__":
+    columns = load(sys.argv[1])
+
+    for name, values in columns.items():
+        print("%s (%d): %s" % (name, len(values), values[:5].tolist()))
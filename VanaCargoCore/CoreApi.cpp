@@ -1,9 +1,13 @@
 #include "stdafx.h"
 #include "CoreApi.h"
 
+#include "CoreLua.h"
+#include "CoreUtf.h"
 #include "DefaultConfig.h"
 #include "FFXIHelper.h"
+#include "SearchHandler.h"
 #include "SimpleIni.h"
+#include <algorithm>
 #include <unordered_map>
 
 #ifdef GDIPLUS_IMAGE_RESIZING
@@ -276,6 +280,7 @@ struct KeyItemInfo
 	std::wstring Category;
 };
 
+// the whole file in one read, the FindAll addon rewrites its dumps in place and a mapping of them would make it fail
 static bool ReadFileText(const std::wstring& path, std::string& out)
 {
 	out.clear();
@@ -288,25 +293,29 @@ static bool ReadFileText(const std::wstring& path, std::string& out)
 		return false;
 
 	out.resize((size_t)length);
-	file.Read(&out[0], (UINT)length);
-	return true;
+	out.resize(file.Read(&out[0], (UINT)length));
+	return !out.empty();
 }
 
-static std::wstring ToWide(const std::string& value)
+static std::wstring ToWide(const char* pText, size_t length)
 {
-	if (value.empty())
-		return std::wstring();
-
-	int size = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0);
-	if (size <= 0)
-		return std::wstring();
-
 	std::wstring result;
-	result.resize(size);
-	MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), &result[0], size);
+
+	CoreAppendUtf16(result, pText, length);
 	return result;
 }
 
+// the text of a string token, decoded only when it holds escapes
+static std::wstring ToWide(const CoreLuaSpan& span, bool escaped)
+{
+	if (!escaped)
+		return ToWide(span.pText, span.Length);
+
+	std::string text;
+	CoreLuaUnescape(span, text);
+	return ToWide(text.data(), text.size());
+}
+
 static std::wstring CapitalizeFirstLetter(const std::wstring& value)
 {
 	if (value.empty())
@@ -325,191 +334,195 @@ static std::wstring CapitalizeFirstLetter(const std::wstring& value)
 	return result;
 }
 
-static bool ParseQuotedString(const std::string& data, size_t start, std::string& out, size_t& endPos)
+// the records of the resources of Windower: a table of {id=1, en="name", category="..."}, an ID may appear twice
+static void ParseKeyItems(const char* pText, size_t length, std::vector<std::pair<int, KeyItemInfo>>& items)
 {
-	out.clear();
-	endPos = std::string::npos;
-
-	bool escape = false;
-	for (size_t i = start; i < data.size(); ++i)
+	CoreLuaTokenizer tokenizer(pText, length);
+	CoreLuaToken token;
+	// depth of the values of the record being read, -1 between the records
+	int recordDepth = -1;
+	long long id = 0;
+	bool hasId = false;
+	bool hasName = false;
+	KeyItemInfo info;
+
+	while (tokenizer.Next(token))
 	{
-		char ch = data[i];
-		if (escape)
+		if (token.Type == CORE_LUA_TABLE_BEGIN)
 		{
-			switch (ch)
-			{
-			case 'n':
-				out.push_back('\n');
-				break;
-			case 'r':
-				out.push_back('\r');
-				break;
-			case 't':
-				out.push_back('\t');
-				break;
-			default:
-				out.push_back(ch);
-				break;
-			}
-			escape = false;
+			recordDepth = token.Depth + 1;
+			hasId = false;
+			hasName = false;
+			info.Name.clear();
+			info.Category.clear();
 			continue;
 		}
 
-		if (ch == '\\')
+		if (token.Depth != recordDepth)
+			continue;
+
+		if (token.Type == CORE_LUA_TABLE_END)
 		{
-			escape = true;
+			if (hasId && hasName)
+				items.push_back(std::make_pair((int)id, info));
+
+			recordDepth = -1;
 			continue;
 		}
 
-		if (ch == '"')
+		if (token.KeyType != CORE_LUA_KEY_NAME)
+			continue;
+
+		if (token.Type == CORE_LUA_NUMBER && CoreLuaEquals(token.Key, "id"))
+			hasId = CoreLuaToInt64(token.Value, id);
+		else if (token.Type == CORE_LUA_STRING && CoreLuaEquals(token.Key, "en"))
 		{
-			endPos = i;
-			return true;
+			info.Name = ToWide(token.Value, token.ValueEscaped);
+			hasName = true;
 		}
-
-		out.push_back(ch);
+		else if (token.Type == CORE_LUA_STRING && CoreLuaEquals(token.Key, "category"))
+			info.Category = ToWide(token.Value, token.ValueEscaped);
 	}
-
-	return false;
 }
 
-static void ParseKeyItems(const std::string& data, std::unordered_map<int, KeyItemInfo>& items)
+// ["gil"] = 123 and the keys of the ["key items"] table, wherever they are nested;
+// false if the key items table is missing or cut short
+static bool ParseFindAllData(const char* pText, size_t length, long long& gil, std::vector<int>& keyItemIds)
 {
-	size_t pos = 0;
-	while ((pos = data.find("id=", pos)) != std::string::npos)
-	{
-		size_t idStart = pos + 3;
-		size_t idEnd = idStart;
-		while (idEnd < data.size() && isdigit((unsigned char)data[idEnd]))
-			++idEnd;
-
-		if (idEnd == idStart)
-		{
-			pos = idEnd;
-			continue;
-		}
+	CoreLuaTokenizer tokenizer(pText, length);
+	CoreLuaToken token;
+	bool hasGil = false;
+	bool hasKeyItems = false;
+	// depth of the values of the key items table while it is read
+	int keyItemsDepth = -1;
 
-		int id = atoi(data.substr(idStart, idEnd - idStart).c_str());
-		size_t enPos = data.find("en=\"", idEnd);
-		if (enPos == std::string::npos)
-		{
-			pos = idEnd;
-			continue;
-		}
+	gil = 0;
+	keyItemIds.clear();
 
-		enPos += 4;
-		std::string name;
-		size_t enEnd = std::string::npos;
-		if (!ParseQuotedString(data, enPos, name, enEnd))
+	while (tokenizer.Next(token))
+	{
+		if (keyItemsDepth >= 0)
 		{
-			pos = enPos;
-			continue;
-		}
-		std::string category;
+			if (token.Depth != keyItemsDepth)
+				continue;
 
-		size_t objEnd = data.find('}', enEnd);
-		if (objEnd != std::string::npos)
-		{
-			size_t catPos = data.find("category=\"", enEnd);
-			if (catPos != std::string::npos && catPos < objEnd)
+			if (token.Type == CORE_LUA_TABLE_END)
 			{
-				catPos += 10;
-				size_t catEnd = std::string::npos;
-				if (!ParseQuotedString(data, catPos, category, catEnd) || catEnd >= objEnd)
-					category.clear();
+				keyItemsDepth = -1;
+				hasKeyItems = true;
+				continue;
 			}
+
+			long long id = 0;
+			if (token.KeyType != CORE_LUA_KEY_NONE && CoreLuaToInt64(token.Key, id) && id > 0 && id <= INT_MAX)
+				keyItemIds.push_back((int)id);
+
+			continue;
 		}
 
-		KeyItemInfo info;
-		info.Name = ToWide(name);
-		info.Category = ToWide(category);
-		items[id] = info;
-		pos = enEnd;
+		if (token.KeyType != CORE_LUA_KEY_STRING)
+			continue;
+
+		if (!hasGil && token.Type == CORE_LUA_NUMBER && CoreLuaEquals(token.Key, "gil"))
+			hasGil = CoreLuaToInt64(token.Value, gil);
+		else if (!hasKeyItems && token.Type == CORE_LUA_TABLE_BEGIN && CoreLuaEquals(token.Key, "key items"))
+			keyItemsDepth = token.Depth + 1;
 	}
+
+	if (gil < 0)
+		gil = 0;
+
+	return hasKeyItems;
 }
 
-static bool ParseFindAllData(const std::string& data, long long& gil, std::vector<int>& keyItemIds)
+void KeyItemCatalog::Clear()
 {
-	gil = 0;
-	keyItemIds.clear();
+	m_Path.clear();
+	m_Stamp.WriteTime = 0ULL;
+	m_Stamp.Size = 0ULL;
+	m_Ids.clear();
+	m_Entries.clear();
+	m_Text.clear();
+}
 
-	size_t gilPos = data.find("[\"gil\"]");
-	if (gilPos != std::string::npos)
-	{
-		size_t eqPos = data.find('=', gilPos);
-		if (eqPos != std::string::npos)
-		{
-			size_t numStart = eqPos + 1;
-			while (numStart < data.size() && isspace((unsigned char)data[numStart]))
-				++numStart;
-			size_t numEnd = numStart;
-			while (numEnd < data.size() && isdigit((unsigned char)data[numEnd]))
-				++numEnd;
-			if (numEnd > numStart)
-				gil = _atoi64(data.substr(numStart, numEnd - numStart).c_str());
-		}
-	}
+bool KeyItemCatalog::Load(const std::wstring& path)
+{
+	CoreFileStamp stamp = GetFileStamp(path);
 
-	size_t tablePos = data.find("[\"key items\"]");
-	if (tablePos == std::string::npos)
-		return false;
+	if (stamp.Size != 0ULL && path == m_Path
+		&& stamp.WriteTime == m_Stamp.WriteTime && stamp.Size == m_Stamp.Size)
+		return true;
+
+	Clear();
 
-	size_t braceStart = data.find('{', tablePos);
-	if (braceStart == std::string::npos)
+	std::string file;
+	if (!ReadFileText(path, file))
 		return false;
 
-	size_t idx = braceStart + 1;
-	int depth = 1;
-	size_t braceEnd = std::string::npos;
-	for (; idx < data.size(); ++idx)
-	{
-		if (data[idx] == '{')
-			++depth;
-		else if (data[idx] == '}')
-		{
-			--depth;
-			if (depth == 0)
-			{
-				braceEnd = idx;
-				break;
-			}
-		}
-	}
+	std::vector<std::pair<int, KeyItemInfo>> items;
+	ParseKeyItems(file.data(), file.size(), items);
 
-	if (braceEnd == std::string::npos || braceEnd <= braceStart)
-		return false;
+	// stable: the last definition of an ID comes last in its run and wins
+	std::stable_sort(items.begin(), items.end(),
+		[](const std::pair<int, KeyItemInfo>& lhs, const std::pair<int, KeyItemInfo>& rhs) { return lhs.first < rhs.first; });
+
+	m_Ids.reserve(items.size());
+	m_Entries.reserve(items.size());
 
-	size_t pos = braceStart;
-	while ((pos = data.find("[\"", pos)) != std::string::npos && pos < braceEnd)
+	for (size_t i = 0; i < items.size(); ++i)
 	{
-		size_t idStart = pos + 2;
-		size_t idEnd = data.find("\"]", idStart);
-		if (idEnd == std::string::npos || idEnd > braceEnd)
-			break;
+		if (i + 1 < items.size() && items[i + 1].first == items[i].first)
+			continue;
 
-		int id = atoi(data.substr(idStart, idEnd - idStart).c_str());
-		if (id > 0)
-			keyItemIds.push_back(id);
+		const KeyItemInfo& info = items[i].second;
+		Entry entry;
 
-		pos = idEnd + 2;
+		entry.NameOffset = (unsigned int)m_Text.size();
+		entry.NameLength = (unsigned int)info.Name.size();
+		m_Text += info.Name;
+		entry.CategoryOffset = (unsigned int)m_Text.size();
+		entry.CategoryLength = (unsigned int)info.Category.size();
+		m_Text += info.Category;
+
+		m_Ids.push_back(items[i].first);
+		m_Entries.push_back(entry);
 	}
 
+	m_Path = path;
+	m_Stamp = stamp;
+
+	return true;
+}
+
+bool KeyItemCatalog::Find(int id, std::wstring& name, std::wstring& category) const
+{
+	std::vector<int>::const_iterator it = std::lower_bound(m_Ids.begin(), m_Ids.end(), id);
+
+	if (it == m_Ids.end() || *it != id)
+		return false;
+
+	const Entry& entry = m_Entries[it - m_Ids.begin()];
+	name.assign(m_Text, entry.NameOffset, entry.NameLength);
+	category.assign(m_Text, entry.CategoryOffset, entry.CategoryLength);
+
 	return true;
 }
 
-static void AddKeyItem(const KeyItemInfo* info, int id, std::vector<CoreItem>& items)
+static void AddKeyItem(const KeyItemCatalog& keyItems, int id, std::vector<CoreItem>& items)
 {
 	CoreItem item;
+	std::wstring name;
+	bool found = keyItems.Find(id, name, item.Remarks);
+
 	item.Id = id;
 	item.Count = 1;
-	item.Name = info ? CapitalizeFirstLetter(info->Name) : std::wstring();
+	item.Name = found ? CapitalizeFirstLetter(name) : std::wstring();
 	item.Attr.clear();
 	item.Description.clear();
 	item.Slot = L"Key Item";
 	item.Races.clear();
 	item.Level.clear();
 	item.Jobs.clear();
-	item.Remarks = info ? info->Category : std::wstring();
 	item.IconWidth = 0;
 	item.IconHeight = 0;
 	item.IconStride = 0;
@@ -558,6 +571,118 @@ static std::wstring BuildFindAllDataFile(const std::wstring& dataDir, const std:
 	return dataFile;
 }
 
+// bag of a FindAll dump holding the items of each DAT file
+static const struct
+{
+	const wchar_t* pFileName;
+	const char* pBag;
+} FindAllBags[] =
+{
+	{ L"is.dat", "inventory" },
+	{ L"bs.dat", "safe" },
+	{ L"b2.dat", "safe2" },
+	{ L"cl.dat", "storage" },
+	{ L"mb.dat", "locker" },
+	{ L"sb.dat", "satchel" },
+	{ L"sk.dat", "sack" },
+	{ L"ca.dat", "case" },
+	{ L"wr.dat", "wardrobe" },
+	{ L"wr_2.dat", "wardrobe2" },
+	{ L"wr_3.dat", "wardrobe3" },
+	{ L"wr_4.dat", "wardrobe4" },
+	{ L"wr_5.dat", "wardrobe5" },
+	{ L"wr_6.dat", "wardrobe6" },
+	{ L"wr_7.dat", "wardrobe7" },
+	{ L"wr_8.dat", "wardrobe8" }
+};
+
+// (item ID, count) of each bag of a FindAll dump, in the order of the tabs
+struct FindAllInventory
+{
+	std::vector<std::vector<std::pair<int, int>>> Tabs;
+};
+
+static const char* GetFindAllBag(const InventoryTabInfo& tabInfo)
+{
+	for (size_t i = 0; i < sizeof(FindAllBags) / sizeof(FindAllBags[0]); ++i)
+	{
+		if (_wcsicmp(tabInfo.FileName.c_str(), FindAllBags[i].pFileName) == 0)
+			return FindAllBags[i].pBag;
+	}
+
+	return NULL;
+}
+
+// the tables of the bags are the values of the table of the dump: ["inventory"] = { ["4096"] = 12, ... }
+static bool ParseFindAllBags(const char* pText, size_t length,
+	const std::vector<InventoryTabInfo>& tabs,
+	FindAllInventory& inventory)
+{
+	CoreLuaTokenizer tokenizer(pText, length);
+	CoreLuaToken token;
+	std::vector<const char*> bags(tabs.size());
+	// tab of the bag being read, -1 outside of the bags
+	int tab = -1;
+
+	inventory.Tabs.clear();
+	inventory.Tabs.resize(tabs.size());
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+		bags[i] = GetFindAllBag(tabs[i]);
+
+	while (tokenizer.Next(token))
+	{
+		if (tab >= 0)
+		{
+			if (token.Depth != 2)
+				continue;
+
+			long long id = 0;
+			long long count = 0;
+
+			if (token.Type == CORE_LUA_TABLE_END)
+				tab = -1;
+			else if (token.Type == CORE_LUA_NUMBER && token.KeyType != CORE_LUA_KEY_NONE
+				&& CoreLuaToInt64(token.Key, id) && id > 0 && id <= 0xFFFF
+				&& CoreLuaToInt64(token.Value, count) && count > 0)
+			{
+				inventory.Tabs[tab].push_back(std::make_pair((int)id, count > INT_MAX ? INT_MAX : (int)count));
+			}
+
+			continue;
+		}
+
+		if (token.Type != CORE_LUA_TABLE_BEGIN || token.Depth != 1 || token.KeyType != CORE_LUA_KEY_STRING)
+			continue;
+
+		for (size_t i = 0; i < bags.size() && tab < 0; ++i)
+		{
+			if (bags[i] != NULL && CoreLuaEquals(token.Key, bags[i]))
+				tab = (int)i;
+		}
+	}
+
+	return !tokenizer.HasError();
+}
+
+// false if the character isn't read from FindAll or its dump can't be read, its DAT files are then used
+static bool LoadFindAllInventory(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	FindAllInventory& inventory)
+{
+	inventory.Tabs.clear();
+
+	if (character.Source != CORE_SOURCE_FINDALL || settings.FindAllDataPath.empty())
+		return false;
+
+	std::string data;
+	if (!ReadFileText(BuildFindAllDataFile(settings.FindAllDataPath, TrimWhitespace(character.Name)), data))
+		return false;
+
+	return ParseFindAllBags(data.data(), data.size(), tabs, inventory);
+}
+
 static void AddFindAllErrorItem(const std::wstring& dataFile, const std::wstring& keyItemsPath,
 	const std::wstring& error,
 	std::vector<CoreItem>& items)
@@ -602,9 +727,11 @@ static void AddFindAllErrorItem(const std::wstring& dataFile, const std::wstring
 	}
 }
 
+// only the data file of the character is parsed, the key item names come from the catalog
 static bool LoadFindAllKeyItems(const std::wstring& dataDir,
 	const std::wstring& keyItemsPath,
 	const std::wstring& characterName,
+	KeyItemCatalog& keyItems,
 	std::vector<CoreItem>& items,
 	std::wstring& error)
 {
@@ -631,26 +758,22 @@ static bool LoadFindAllKeyItems(const std::wstring& dataDir,
 
 	std::wstring dataFile = BuildFindAllDataFile(dataDir, trimmedName);
 
-	std::string keyItemsText;
-	if (!ReadFileText(keyItemsPath, keyItemsText))
+	if (!keyItems.Load(keyItemsPath))
 	{
 		error = L"Missing key items file: " + keyItemsPath;
 		return false;
 	}
 
-	std::string dataText;
-	if (!ReadFileText(dataFile, dataText))
+	std::string data;
+	if (!ReadFileText(dataFile, data))
 	{
 		error = L"Missing FindAll data file: " + dataFile;
 		return false;
 	}
 
-	std::unordered_map<int, KeyItemInfo> keyItems;
-	ParseKeyItems(keyItemsText, keyItems);
-
 	long long gil = 0;
 	std::vector<int> keyItemIds;
-	if (!ParseFindAllData(dataText, gil, keyItemIds))
+	if (!ParseFindAllData(data.data(), data.size(), gil, keyItemIds))
 	{
 		error = L"Unable to parse key items table in: " + dataFile;
 		return false;
@@ -658,13 +781,10 @@ static bool LoadFindAllKeyItems(const std::wstring& dataDir,
 
 	AddGilItem(gil, items);
 
+	items.reserve(items.size() + keyItemIds.size());
+
 	for (size_t i = 0; i < keyItemIds.size(); ++i)
-	{
-		int id = keyItemIds[i];
-		std::unordered_map<int, KeyItemInfo>::const_iterator it = keyItems.find(id);
-		const KeyItemInfo* info = it != keyItems.end() ? &it->second : NULL;
-		AddKeyItem(info, id, items);
-	}
+		AddKeyItem(keyItems, keyItemIds[i], items);
 
 	return true;
 }
@@ -734,6 +854,41 @@ static void FillIconPixels(const FFXiIconInfo& iconInfo, CoreItem& item)
 	}
 }
 
+// the characters [Sources] reads from FindAll that have no USER folder, named and identified by their dump;
+// the other dumps aren't listed, they may belong to a USER folder shown by its ID
+static void AddFindAllCharacters(CSimpleIni& ini, const std::wstring& dataDir, std::vector<CharacterInfo>& characters)
+{
+	CSimpleIni::TNamesDepend keys;
+	if (!ini.GetAllKeys(INI_FILE_SOURCES_SECTION, keys))
+		return;
+
+	size_t userCount = characters.size();
+	keys.sort(CSimpleIni::Entry::LoadOrder());
+
+	for (CSimpleIni::TNamesDepend::const_iterator it = keys.begin(); it != keys.end(); ++it)
+	{
+		const TCHAR* source = ini.GetValue(INI_FILE_SOURCES_SECTION, it->pItem);
+		if (source == NULL || _tcsicmp(source, INI_FILE_SOURCE_FINDALL_VALUE) != 0)
+			continue;
+
+		std::wstring name = TrimWhitespace(std::wstring(it->pItem));
+		bool known = name.empty();
+
+		for (size_t i = 0; i < userCount && !known; ++i)
+			known = _wcsicmp(characters[i].Id.c_str(), name.c_str()) == 0
+				|| _wcsicmp(TrimWhitespace(characters[i].Name).c_str(), name.c_str()) == 0;
+
+		if (known || GetFileAttributesW(BuildFindAllDataFile(dataDir, name).c_str()) == INVALID_FILE_ATTRIBUTES)
+			continue;
+
+		CharacterInfo character;
+		character.Id = name;
+		character.Name = name;
+		character.Source = CORE_SOURCE_FINDALL;
+		characters.push_back(character);
+	}
+}
+
 bool CoreApi::LoadConfig(const std::wstring& configPath,
 	CoreSettings& settings,
 	std::vector<InventoryTabInfo>& tabs,
@@ -834,152 +989,1333 @@ bool CoreApi::LoadConfig(const std::wstring& configPath,
 		else
 			character.Name = std::wstring(display);
 
+		const TCHAR* source = ini.GetValue(INI_FILE_SOURCES_SECTION, id);
+		if (settings.FindAllEnabled && source != NULL && _tcsicmp(source, INI_FILE_SOURCE_FINDALL_VALUE) == 0)
+			character.Source = CORE_SOURCE_FINDALL;
+
 		characters.push_back(character);
 	}
 
 	finder.Close();
+
+	if (settings.FindAllEnabled && !settings.FindAllDataPath.empty())
+		AddFindAllCharacters(ini, settings.FindAllDataPath, characters);
+
 	return true;
 }
 
-bool CoreApi::LoadInventoryForCharacter(const CoreSettings& settings,
+static std::wstring BuildInventoryFilePath(const CoreSettings& settings,
 	const CharacterInfo& character,
-	const std::vector<InventoryTabInfo>& tabs,
-	std::vector<InventoryTab>& outTabs)
+	const InventoryTabInfo& tabInfo)
 {
-	outTabs.clear();
+	CString basePath = ToCString(settings.FfxiPath);
+	basePath.TrimRight('\\');
 
-	if (settings.FfxiPath.empty())
-		return false;
+	CString invFile;
+	invFile.Format(_T("%s\\%s\\%s\\%s"),
+		basePath.GetString(),
+		FFXI_PATH_USER_DATA,
+		ToCString(character.Id).GetString(),
+		ToCString(tabInfo.FileName).GetString());
 
-	FFXiHelper helper(settings.Region);
-	helper.SetInstallPath(ToCString(settings.FfxiPath));
+	return ToWString(invFile);
+}
 
-	CString basePath = ToCString(settings.FfxiPath);
-	basePath.TrimRight('\\');
+CoreFileStamp GetFileStamp(const std::wstring& path)
+{
+	CoreFileStamp stamp = { 0ULL, 0ULL };
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if (path.empty() || !GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data))
+		return stamp;
+
+	stamp.WriteTime = ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	stamp.Size = ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	return stamp;
+}
+
+// where the bags of a character are read from
+enum INVENTORY_FILES
+{
+	INVENTORY_FILES_DAT = 0,
+	INVENTORY_FILES_FINDALL,
+	// the DAT files, the dump being unreadable: it is collected last to notice when it is rewritten
+	INVENTORY_FILES_DAT_FALLBACK
+};
+
+// the dump of a FindAll character is used when it exists, LoadFindAllInventory may still fall back
+static int GetInventoryFiles(const CoreSettings& settings, const CharacterInfo& character)
+{
+	if (character.Source != CORE_SOURCE_FINDALL || settings.FindAllDataPath.empty())
+		return INVENTORY_FILES_DAT;
+
+	CoreFileStamp stamp = GetFileStamp(BuildFindAllDataFile(settings.FindAllDataPath, TrimWhitespace(character.Name)));
+
+	return (stamp.Size > 0) ? INVENTORY_FILES_FINDALL : INVENTORY_FILES_DAT;
+}
+
+// the files the inventory of a character is decoded from, in the order of the tabs
+static void CollectInventoryFiles(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	int source,
+	std::vector<std::wstring>& files)
+{
+	std::wstring dataFile = BuildFindAllDataFile(settings.FindAllDataPath, TrimWhitespace(character.Name));
+
+	files.clear();
+	files.reserve(tabs.size() + 2);
 
 	for (size_t i = 0; i < tabs.size(); ++i)
 	{
-		const InventoryTabInfo& tabInfo = tabs[i];
-		InventoryTab tab;
-		tab.Info = tabInfo;
-
-		if (tabInfo.FileName == L"__FINDALL_KEYITEMS__")
+		if (tabs[i].FileName == L"__FINDALL_KEYITEMS__")
 		{
-			std::vector<CoreItem> keyItems;
-			std::wstring error;
-			bool loaded = LoadFindAllKeyItems(settings.FindAllDataPath, settings.FindAllKeyItemsPath,
-				character.Name, keyItems, error);
+			files.push_back(dataFile);
+			files.push_back(settings.FindAllKeyItemsPath);
+		}
+		else if (source == INVENTORY_FILES_FINDALL)
+			files.push_back(dataFile);
+		else
+			files.push_back(BuildInventoryFilePath(settings, character, tabs[i]));
+	}
 
-			if (!loaded)
-			{
-				std::wstring dataFile = BuildFindAllDataFile(settings.FindAllDataPath,
-					TrimWhitespace(character.Name));
-				AddFindAllErrorItem(dataFile, settings.FindAllKeyItemsPath, error, keyItems);
-			}
+	if (source == INVENTORY_FILES_DAT_FALLBACK)
+		files.push_back(dataFile);
+}
 
-			tab.Items = keyItems;
-			outTabs.push_back(tab);
-			continue;
-		}
+static void CollectFileStamps(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	int source,
+	std::vector<CoreFileStamp>& stamps)
+{
+	std::vector<std::wstring> files;
+	CollectInventoryFiles(settings, character, tabs, source, files);
 
-		CString invFile;
-		invFile.Format(_T("%s\\%s\\%s\\%s"),
-			basePath.GetString(),
-			FFXI_PATH_USER_DATA,
-			ToCString(character.Id).GetString(),
-			ToCString(tabInfo.FileName).GetString());
+	stamps.clear();
+	stamps.reserve(files.size());
 
-		ItemArray itemMap;
-		ItemLocationInfo location;
-		location.InvTab = (int)i;
-		location.Character = 0;
-		location.ListIndex = 0;
-		location.ImageIndex = 0;
-		location.Location.Empty();
+	for (size_t i = 0; i < files.size(); ++i)
+		stamps.push_back(GetFileStamp(files[i]));
+}
 
-		if (helper.ParseInventoryFile(invFile, location, &itemMap, settings.Language, false))
-		{
-			POSITION pos = itemMap.GetStartPosition();
-			InventoryItem* item = NULL;
-			int itemId = 0;
+unsigned long long HashBytes(unsigned long long hash, const void* pData, size_t size)
+{
+	const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
 
-			while (pos != NULL)
-			{
-				itemMap.GetNextAssoc(pos, itemId, item);
-				if (item == NULL)
-					continue;
-
-				CoreItem coreItem;
-				coreItem.Id = item->ItemHdr.ItemID;
-				coreItem.Count = item->RefCount;
-				coreItem.Name = ToWString(item->ItemName);
-				coreItem.Attr = ToWString(item->Attr);
-				coreItem.Description = ToWString(item->ItemDescription);
-				coreItem.Slot = ToWString(item->Slot);
-				coreItem.Races = ToWString(item->Races);
-				coreItem.Level = ToWString(item->Level);
-				coreItem.Jobs = ToWString(item->Jobs);
-				coreItem.Remarks = ToWString(item->Remarks);
-				coreItem.IconWidth = 0;
-				coreItem.IconHeight = 0;
-				coreItem.IconStride = 0;
-				coreItem.IconPixels.clear();
-				FillIconPixels(item->IconInfo, coreItem);
-				tab.Items.push_back(coreItem);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+unsigned long long HashInventoryStamps(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs)
+{
+	std::vector<CoreFileStamp> stamps;
+	CollectFileStamps(settings, character, tabs, GetInventoryFiles(settings, character), stamps);
+
+	return HashBytes(CORE_HASH_SEED, stamps.data(), stamps.size() * sizeof(CoreFileStamp));
+}
+
+unsigned long long HashInventoryContents(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs)
+{
+	std::vector<std::wstring> files;
+	std::vector<unsigned char> block(64 * 1024);
+	unsigned long long hash = CORE_HASH_SEED;
+
+	CollectInventoryFiles(settings, character, tabs, GetInventoryFiles(settings, character), files);
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		HANDLE hFile = files[i].empty() ? INVALID_HANDLE_VALUE : ::CreateFileW(files[i].c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		unsigned long long size = 0;
+		DWORD read = 0;
 
-				helper.ClearItemData(item);
-				delete item;
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			while (::ReadFile(hFile, block.data(), (DWORD)block.size(), &read, NULL) && read > 0)
+			{
+				hash = HashBytes(hash, block.data(), read);
+				size += read;
 			}
+
+			::CloseHandle(hFile);
 		}
 
-		itemMap.RemoveAll();
-		outTabs.push_back(tab);
+		// the sizes separate the files, a missing file counts as empty
+		hash = HashBytes(hash, &size, sizeof(size));
 	}
 
-	return true;
+	return hash;
 }
 
-bool CoreApi::SaveSettings(const std::wstring& configPath, const CoreSettings& settings)
+static bool IsSameStamps(const std::vector<CoreFileStamp>& lhs, const std::vector<CoreFileStamp>& rhs)
 {
-	CSimpleIni ini(true, false, false);
-	CStringW iniPath = ToCString(configPath);
-	if (ini.LoadFile(iniPath) < 0)
+	if (lhs.size() != rhs.size())
 		return false;
 
-	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_GAME_REGION_KEY, settings.Region);
-	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_LANGUAGE_KEY, settings.Language);
-	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_COMPACT_LIST_KEY, settings.CompactList ? 1L : 0L);
-	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_GAME_DIRECTORY, ToCString(settings.FfxiPath));
-	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_ENABLED_KEY, settings.FindAllEnabled ? 1L : 0L);
-	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_DATA_PATH_KEY, ToCString(settings.FindAllDataPath));
-	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_KEYITEMS_PATH_KEY, ToCString(settings.FindAllKeyItemsPath));
+	for (size_t i = 0; i < lhs.size(); ++i)
+	{
+		if (lhs[i].WriteTime != rhs[i].WriteTime || lhs[i].Size != rhs[i].Size)
+			return false;
+	}
 
-	return ini.SaveFile(iniPath) >= 0;
+	return true;
 }
 
-bool CoreApi::SaveCharacterDisplayNames(const std::wstring& configPath,
-	const std::vector<std::pair<std::wstring, std::wstring>>& entries)
+static void ToCoreItem(const InventoryItem& item, CoreItem& coreItem)
 {
-	CSimpleIni ini(true, false, false);
-	CStringW iniPath = ToCString(configPath);
-	if (ini.LoadFile(iniPath) < 0)
-		return false;
+	coreItem.Id = item.ItemHdr.ItemID;
+	coreItem.Count = item.RefCount;
+	coreItem.Name = ToWString(item.ItemName);
+	coreItem.Attr = ToWString(item.Attr);
+	coreItem.Description = ToWString(item.ItemDescription);
+	coreItem.Slot = ToWString(item.Slot);
+	coreItem.Races = ToWString(item.Races);
+	coreItem.Level = ToWString(item.Level);
+	coreItem.Jobs = ToWString(item.Jobs);
+	coreItem.Remarks = ToWString(item.Remarks);
+	coreItem.IconWidth = 0;
+	coreItem.IconHeight = 0;
+	coreItem.IconStride = 0;
+	coreItem.IconPixels.clear();
+}
 
-	for (size_t i = 0; i < entries.size(); ++i)
+void CoreItemCatalog::Clear()
+{
+	m_Items.clear();
+	m_FfxiPath.clear();
+	m_Region = -1;
+	m_Language = -1;
+}
+
+const CoreItemCatalog::Entry* CoreItemCatalog::Find(FFXiHelper& helper, int id, const CoreSettings& settings)
+{
+	int language = settings.Language;
+
+	// another install or region reads another set of DAT files
+	if (language != m_Language || settings.Region != m_Region || settings.FfxiPath != m_FfxiPath)
 	{
-		const std::wstring& id = entries[i].first;
-		const std::wstring& name = entries[i].second;
-		if (id.empty())
-			continue;
+		m_Items.clear();
+		m_FfxiPath = settings.FfxiPath;
+		m_Region = settings.Region;
+		m_Language = language;
+	}
 
-		CString key(id.c_str());
-		if (name.empty() || name == id)
-			ini.Delete(INI_FILE_CHARACTERS_SECTION, key);
-		else
-			ini.SetValue(INI_FILE_CHARACTERS_SECTION, key, CString(name.c_str()));
+	std::unordered_map<int, std::unique_ptr<Entry>>::const_iterator it = m_Items.find(id);
+	if (it != m_Items.end())
+		return it->second.get();
+
+	std::unique_ptr<Entry> entry;
+	InventoryItem item;
+
+	if (helper.ReadItemFromID((DWORD)id, &item, language))
+	{
+		CoreItem iconItem;
+
+		entry.reset(new Entry());
+		ToCoreItem(item, entry->Item);
+		entry->Item.Count = 0;
+		SearchHandler::GetSearchFields(&item, entry->Fields);
+
+		iconItem.IconWidth = 0;
+		iconItem.IconHeight = 0;
+		iconItem.IconStride = 0;
+		FillIconPixels(item.IconInfo, iconItem);
+		entry->Icon.Width = iconItem.IconWidth;
+		entry->Icon.Height = iconItem.IconHeight;
+		entry->Icon.Stride = iconItem.IconStride;
+		entry->Icon.Pixels.swap(iconItem.IconPixels);
+
+		helper.ClearItemData(&item);
 	}
 
-	return ini.SaveFile(iniPath) >= 0;
+	const Entry* pEntry = entry.get();
+	m_Items[id] = std::move(entry);
+
+	return pEntry;
+}
+
+// the items of a bag of a FindAll dump, decoded through the shared catalog
+static void LoadFindAllTab(FFXiHelper& helper,
+	const CoreSettings& settings,
+	const std::vector<std::pair<int, int>>& bag,
+	CoreItemCatalog& catalog,
+	InventoryTab& tab,
+	std::unordered_map<int, CoreIcon>* pIcons,
+	SearchColumns* pColumns)
+{
+	tab.Items.reserve(bag.size());
+	if (pColumns != NULL)
+		pColumns->Reserve(pColumns->GetCount() + bag.size());
+
+	for (size_t i = 0; i < bag.size(); ++i)
+	{
+		const CoreItemCatalog::Entry* pEntry = catalog.Find(helper, bag[i].first, settings);
+		if (pEntry == NULL)
+			continue;
+
+		tab.Items.push_back(pEntry->Item);
+
+		CoreItem& coreItem = tab.Items.back();
+		coreItem.Count = bag[i].second;
+
+		// with the shared map the pixels stay in it, the dimensions mark the item as having an icon
+		if (pIcons == NULL)
+			coreItem.IconPixels = pEntry->Icon.Pixels;
+		else if (pIcons->find(coreItem.Id) == pIcons->end())
+			(*pIcons)[coreItem.Id] = pEntry->Icon;
+
+		coreItem.IconWidth = pEntry->Icon.Width;
+		coreItem.IconHeight = pEntry->Icon.Height;
+		coreItem.IconStride = pEntry->Icon.Stride;
+
+		if (pColumns != NULL)
+			pColumns->Add(pEntry->Fields);
+	}
+}
+
+// decodes a single inventory tab; when pIcons is set, icons are stored once per item ID
+// in the shared map instead of being expanded into every item
+static void LoadInventoryTab(FFXiHelper& helper,
+	const CoreSettings& settings,
+	const CharacterInfo& character,
+	int tabIndex,
+	const InventoryTabInfo& tabInfo,
+	InventoryTab& tab,
+	KeyItemCatalog& keyItems,
+	const FindAllInventory* pFindAll,
+	CoreItemCatalog& catalog,
+	std::unordered_map<int, CoreIcon>* pIcons,
+	SearchColumns* pColumns)
+{
+	tab.Info = tabInfo;
+	tab.Items.clear();
+
+	if (tabInfo.FileName == L"__FINDALL_KEYITEMS__")
+	{
+		std::wstring error;
+		bool loaded = LoadFindAllKeyItems(settings.FindAllDataPath, settings.FindAllKeyItemsPath,
+			character.Name, keyItems, tab.Items, error);
+
+		if (!loaded)
+		{
+			std::wstring dataFile = BuildFindAllDataFile(settings.FindAllDataPath,
+				TrimWhitespace(character.Name));
+			AddFindAllErrorItem(dataFile, settings.FindAllKeyItemsPath, error, tab.Items);
+		}
+
+		if (pColumns != NULL)
+		{
+			SearchFields fields;
+			SearchHandler::GetSearchFields(NULL, fields);
+			fields.Class = SEARCH_CLASS_OTHER;
+
+			for (size_t i = 0; i < tab.Items.size(); ++i)
+				pColumns->Add(fields);
+		}
+
+		return;
+	}
+
+	// a character read from FindAll doesn't touch its USER folder
+	if (pFindAll != NULL)
+	{
+		if (tabIndex >= 0 && (size_t)tabIndex < pFindAll->Tabs.size())
+			LoadFindAllTab(helper, settings, pFindAll->Tabs[tabIndex], catalog, tab, pIcons, pColumns);
+
+		return;
+	}
+
+	CString invFile = ToCString(BuildInventoryFilePath(settings, character, tabInfo));
+	ItemArray itemMap;
+	ItemLocationInfo location;
+	location.InvTab = tabIndex;
+	location.Character = 0;
+	location.ListIndex = 0;
+	location.ImageIndex = 0;
+	location.Location.Empty();
+
+	if (helper.ParseInventoryFile(invFile, location, &itemMap, settings.Language, false))
+	{
+		POSITION pos = itemMap.GetStartPosition();
+		InventoryItem* item = NULL;
+		int itemId = 0;
+
+		tab.Items.reserve(itemMap.GetCount());
+		if (pColumns != NULL)
+			pColumns->Reserve(pColumns->GetCount() + itemMap.GetCount());
+
+		while (pos != NULL)
+		{
+			itemMap.GetNextAssoc(pos, itemId, item);
+			if (item == NULL)
+				continue;
+
+			CoreItem coreItem;
+			ToCoreItem(*item, coreItem);
+
+			if (pIcons == NULL)
+				FillIconPixels(item->IconInfo, coreItem);
+			else
+			{
+				std::unordered_map<int, CoreIcon>::const_iterator it = pIcons->find(coreItem.Id);
+				if (it == pIcons->end())
+				{
+					CoreItem iconItem;
+					iconItem.IconWidth = 0;
+					iconItem.IconHeight = 0;
+					iconItem.IconStride = 0;
+					FillIconPixels(item->IconInfo, iconItem);
+
+					CoreIcon& icon = (*pIcons)[coreItem.Id];
+					icon.Width = iconItem.IconWidth;
+					icon.Height = iconItem.IconHeight;
+					icon.Stride = iconItem.IconStride;
+					icon.Pixels.swap(iconItem.IconPixels);
+					it = pIcons->find(coreItem.Id);
+				}
+
+				// the pixels stay in the shared map, the dimensions mark the item as having an icon
+				coreItem.IconWidth = it->second.Width;
+				coreItem.IconHeight = it->second.Height;
+				coreItem.IconStride = it->second.Stride;
+			}
+
+			tab.Items.push_back(coreItem);
+
+			if (pColumns != NULL)
+			{
+				SearchFields fields;
+				SearchHandler::GetSearchFields(item, fields);
+				pColumns->Add(fields);
+			}
+
+			helper.ClearItemData(item);
+			delete item;
+		}
+	}
+
+	itemMap.RemoveAll();
+}
+
+// case-insensitive substring test, term must already be lowercase
+static void AddSearchText(const CoreItem& item, SearchTextArena& text)
+{
+	wchar_t idText[16];
+
+	text.AddItem();
+	text.AddField(item.Name.c_str(), item.Name.size(), SEARCH_TEXT_FIELD_NAME);
+	text.AddField(item.Attr.c_str(), item.Attr.size(), SEARCH_TEXT_FIELD_ATTR);
+	text.AddField(item.Description.c_str(), item.Description.size(), SEARCH_TEXT_FIELD_DESCRIPTION);
+	text.AddField(item.Slot.c_str(), item.Slot.size(), SEARCH_TEXT_FIELD_SLOT);
+	text.AddField(item.Races.c_str(), item.Races.size(), SEARCH_TEXT_FIELD_RACES);
+	text.AddField(item.Level.c_str(), item.Level.size(), SEARCH_TEXT_FIELD_LEVEL);
+	text.AddField(item.Jobs.c_str(), item.Jobs.size(), SEARCH_TEXT_FIELD_JOBS);
+	text.AddField(item.Remarks.c_str(), item.Remarks.size(), SEARCH_TEXT_FIELD_REMARKS);
+
+	if (_itow_s(item.Id, idText, 16, 10) == 0)
+		text.AddField(idText, SEARCH_TEXT_FIELD_ID);
+}
+
+bool CoreApi::LoadInventoryForCharacter(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	std::vector<InventoryTab>& outTabs)
+{
+	outTabs.clear();
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	FFXiHelper helper(settings.Region);
+	helper.SetInstallPath(ToCString(settings.FfxiPath));
+
+	FindAllInventory findAll;
+	bool fromFindAll = LoadFindAllInventory(settings, character, tabs, findAll);
+
+	outTabs.resize(tabs.size());
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+	{
+		LoadInventoryTab(helper, settings, character, (int)i, tabs[i], outTabs[i], m_KeyItems,
+			fromFindAll ? &findAll : NULL, m_ItemCatalog, NULL, NULL);
+	}
+
+	return true;
+}
+
+void CoreInventoryBuffer::Clear()
+{
+	Tabs.clear();
+	TabOffsets.clear();
+	Records.clear();
+	Strings.clear();
+	Icons.clear();
+}
+
+static void AddBufferString(const std::wstring& text, int field, CoreItemRecord& record, std::vector<wchar_t>& strings)
+{
+	record.StringOffsets[field] = (int)strings.size();
+	record.StringLengths[field] = (int)text.size();
+	strings.insert(strings.end(), text.begin(), text.end());
+}
+
+bool CoreApi::LoadInventoryBuffer(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	CoreInventoryBuffer& buffer,
+	CoreProgressObserver* pObserver)
+{
+	buffer.Clear();
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	const CachedInventory* pInventory = GetCachedInventory(settings, character, tabs,
+		(pObserver != NULL) ? pObserver->GetCancelToken() : NULL, pObserver);
+	if (pInventory == NULL)
+		return false;
+
+	// position of the icon of each item ID in the atlas
+	std::unordered_map<int, int> iconOffsets;
+
+	buffer.Tabs = tabs;
+	buffer.TabOffsets.resize(tabs.size() + 1);
+	buffer.Records.reserve(pInventory->Columns.GetCount());
+	buffer.Strings.reserve(pInventory->Text.GetLength());
+
+	for (size_t i = 0; i < pInventory->Tabs.size(); ++i)
+	{
+		const std::vector<CoreItem>& items = pInventory->Tabs[i].Items;
+
+		buffer.TabOffsets[i] = (int)buffer.Records.size();
+
+		for (size_t j = 0; j < items.size(); ++j)
+		{
+			const CoreItem& item = items[j];
+			CoreItemRecord record;
+
+			record.Id = item.Id;
+			record.Count = item.Count;
+			record.IconWidth = item.IconWidth;
+			record.IconHeight = item.IconHeight;
+			record.IconStride = item.IconStride;
+			record.IconOffset = -1;
+			record.IconSize = 0;
+
+			AddBufferString(item.Name, CORE_ITEM_NAME, record, buffer.Strings);
+			AddBufferString(item.Attr, CORE_ITEM_ATTR, record, buffer.Strings);
+			AddBufferString(item.Description, CORE_ITEM_DESCRIPTION, record, buffer.Strings);
+			AddBufferString(item.Slot, CORE_ITEM_SLOT, record, buffer.Strings);
+			AddBufferString(item.Races, CORE_ITEM_RACES, record, buffer.Strings);
+			AddBufferString(item.Level, CORE_ITEM_LEVEL, record, buffer.Strings);
+			AddBufferString(item.Jobs, CORE_ITEM_JOBS, record, buffer.Strings);
+			AddBufferString(item.Remarks, CORE_ITEM_REMARKS, record, buffer.Strings);
+
+			// the cached items keep their pixels in the shared icon map
+			const CoreIcon* pIcon = (item.IconStride != 0) ? GetItemIcon(item.Id) : NULL;
+
+			if (pIcon != NULL)
+			{
+				std::pair<std::unordered_map<int, int>::iterator, bool> inserted =
+					iconOffsets.insert(std::make_pair(item.Id, (int)buffer.Icons.size()));
+
+				if (inserted.second)
+					buffer.Icons.insert(buffer.Icons.end(), pIcon->Pixels.begin(), pIcon->Pixels.end());
+
+				record.IconOffset = inserted.first->second;
+				record.IconSize = (int)pIcon->Pixels.size();
+			}
+
+			buffer.Records.push_back(record);
+		}
+	}
+
+	buffer.TabOffsets[tabs.size()] = (int)buffer.Records.size();
+
+	return true;
+}
+
+bool CoreApi::SaveSettings(const std::wstring& configPath, const CoreSettings& settings)
+{
+	CSimpleIni ini(true, false, false);
+	CStringW iniPath = ToCString(configPath);
+	if (ini.LoadFile(iniPath) < 0)
+		return false;
+
+	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_GAME_REGION_KEY, settings.Region);
+	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_LANGUAGE_KEY, settings.Language);
+	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_COMPACT_LIST_KEY, settings.CompactList ? 1L : 0L);
+	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_GAME_DIRECTORY, ToCString(settings.FfxiPath));
+	ini.SetLongValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_ENABLED_KEY, settings.FindAllEnabled ? 1L : 0L);
+	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_DATA_PATH_KEY, ToCString(settings.FindAllDataPath));
+	ini.SetValue(INI_FILE_CONFIG_SECTION, INI_FILE_FINDALL_KEYITEMS_PATH_KEY, ToCString(settings.FindAllKeyItemsPath));
+
+	return ini.SaveFile(iniPath) >= 0;
+}
+
+bool CoreApi::SaveCharacterDisplayNames(const std::wstring& configPath,
+	const std::vector<std::pair<std::wstring, std::wstring>>& entries)
+{
+	CSimpleIni ini(true, false, false);
+	CStringW iniPath = ToCString(configPath);
+	if (ini.LoadFile(iniPath) < 0)
+		return false;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const std::wstring& id = entries[i].first;
+		const std::wstring& name = entries[i].second;
+		if (id.empty())
+			continue;
+
+		CString key(id.c_str());
+		if (name.empty() || name == id)
+			ini.Delete(INI_FILE_CHARACTERS_SECTION, key);
+		else
+			ini.SetValue(INI_FILE_CHARACTERS_SECTION, key, CString(name.c_str()));
+	}
+
+	return ini.SaveFile(iniPath) >= 0;
+}
+
+static bool IsNarrowerMask(unsigned int previous, unsigned int next)
+{
+	return previous == 0 || (next != 0 && (next & ~previous) == 0);
+}
+
+static bool IsNarrowerRange(int previousMin, int previousMax, int nextMin, int nextMax)
+{
+	if (SearchProgram::NormalizeRange(previousMin, previousMax) == false)
+		return true;
+
+	if (SearchProgram::NormalizeRange(nextMin, nextMax) == false)
+		return false;
+
+	return nextMin >= previousMin && nextMax <= previousMax;
+}
+
+// true when every item matching next also matched previous
+static bool IsNarrowerQuery(const std::wstring& previousTerm, const SearchCriteria& previous,
+	const std::wstring& nextTerm, const SearchCriteria& next)
+{
+	return nextTerm.find(previousTerm) != std::wstring::npos
+		&& IsNarrowerMask(previous.JobsBitMask, next.JobsBitMask)
+		&& IsNarrowerMask(previous.SlotBitMask, next.SlotBitMask)
+		&& IsNarrowerMask(previous.RacesBitMask, next.RacesBitMask)
+		&& (previous.Skill == 0 || previous.Skill == next.Skill)
+		&& (!previous.Rare || next.Rare)
+		&& (!previous.Exclusive || next.Exclusive)
+		&& IsNarrowerRange(previous.MinLevel, previous.MaxLevel, next.MinLevel, next.MaxLevel)
+		&& IsNarrowerRange(previous.MinDelay, previous.MaxDelay, next.MinDelay, next.MaxDelay)
+		&& IsNarrowerRange(previous.MinDmg, previous.MaxDmg, next.MinDmg, next.MaxDmg)
+		&& IsNarrowerRange(previous.MinDef, previous.MaxDef, next.MinDef, next.MaxDef);
+}
+
+static const SearchBitset* FindSessionSelection(const CoreSearchSession& session,
+	const std::wstring& characterId, unsigned int generation)
+{
+	for (size_t i = 0; i < session.CharacterIds.size(); ++i)
+	{
+		if (session.CharacterIds[i] == characterId)
+			return session.Generations[i] == generation ? &session.Selections[i] : NULL;
+	}
+
+	return NULL;
+}
+
+// a search and its filters as one string, the same for equivalent searches
+static std::wstring BuildSearchKey(const std::wstring& term, const SearchCriteria& criteria)
+{
+	const int values[] =
+	{
+		(int)criteria.JobsBitMask, (int)criteria.SlotBitMask, (int)criteria.RacesBitMask, (int)criteria.Skill,
+		criteria.MinLevel, criteria.MaxLevel, criteria.MinDelay, criteria.MaxDelay,
+		criteria.MinDmg, criteria.MaxDmg, criteria.MinDef, criteria.MaxDef,
+		criteria.Rare ? 1 : 0, criteria.Exclusive ? 1 : 0
+	};
+	std::wstring key = L"search\n" + term;
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+	{
+		key += L'\n';
+		key += std::to_wstring(values[i]);
+	}
+
+	return key;
+}
+
+// a query expression with the spaces outside of quotes collapsed
+static std::wstring BuildQueryKey(const std::wstring& expression)
+{
+	std::wstring trimmed = TrimWhitespace(expression);
+	std::wstring key = L"query\n";
+	bool quoted = false;
+	bool space = false;
+
+	for (size_t i = 0; i < trimmed.size(); ++i)
+	{
+		if (trimmed[i] == L'"')
+			quoted = !quoted;
+
+		if (!quoted && iswspace(trimmed[i]))
+		{
+			space = true;
+			continue;
+		}
+
+		if (space)
+		{
+			key += L' ';
+			space = false;
+		}
+
+		key += trimmed[i];
+	}
+
+	return key;
+}
+
+const SearchBitset* CoreApi::FindCachedResult(const std::wstring& key,
+	const std::wstring& characterId,
+	unsigned int generation)
+{
+	std::unordered_map<std::wstring, std::list<CachedResult>::iterator>::iterator it = m_ResultIndex.find(key);
+	if (it == m_ResultIndex.end())
+		return NULL;
+
+	m_Results.splice(m_Results.begin(), m_Results, it->second);
+
+	std::map<std::wstring, CachedSelection>::const_iterator character = it->second->Characters.find(characterId);
+	if (character == it->second->Characters.end() || character->second.Generation != generation)
+		return NULL;
+
+	return &character->second.Selection;
+}
+
+void CoreApi::StoreCachedResult(const std::wstring& key,
+	const std::wstring& characterId,
+	unsigned int generation,
+	const SearchBitset& selection)
+{
+	std::unordered_map<std::wstring, std::list<CachedResult>::iterator>::iterator it = m_ResultIndex.find(key);
+
+	if (it == m_ResultIndex.end())
+	{
+		m_Results.push_front(CachedResult());
+		m_Results.front().Key = key;
+		it = m_ResultIndex.insert(std::make_pair(key, m_Results.begin())).first;
+
+		if (m_Results.size() > CORE_RESULT_CACHE_SIZE)
+		{
+			m_ResultIndex.erase(m_Results.back().Key);
+			m_Results.pop_back();
+		}
+	}
+	else
+		m_Results.splice(m_Results.begin(), m_Results, it->second);
+
+	CachedSelection& cached = it->second->Characters[characterId];
+	cached.Generation = generation;
+	cached.Selection = selection;
+}
+
+// drops the selections computed on the previous inventory of a character
+void CoreApi::InvalidateCachedResults(const std::wstring& characterId)
+{
+	for (std::list<CachedResult>::iterator it = m_Results.begin(); it != m_Results.end(); ++it)
+		it->Characters.erase(characterId);
+}
+
+const CoreApi::CachedInventory* CoreApi::GetCachedInventory(const CoreSettings& settings,
+	const CharacterInfo& character,
+	const std::vector<InventoryTabInfo>& tabs,
+	const CoreCancelToken* pCancel,
+	CoreProgressObserver* pProgress)
+{
+	CachedInventory& cached = m_Inventories[character.Id];
+	// the source is decided once: the stamps are those of the files actually read
+	int source = GetInventoryFiles(settings, character);
+
+	// a dump that couldn't be read keeps the DAT files until it is rewritten
+	if (source == INVENTORY_FILES_FINDALL && cached.DumpUnreadable)
+		source = INVENTORY_FILES_DAT_FALLBACK;
+
+	std::vector<CoreFileStamp> stamps;
+	CollectFileStamps(settings, character, tabs, source, stamps);
+
+	bool sameLayout = cached.Tabs.size() == tabs.size()
+		&& cached.FfxiPath == settings.FfxiPath
+		&& cached.Name == character.Name
+		&& cached.Region == settings.Region
+		&& cached.Language == settings.Language;
+
+	for (size_t i = 0; sameLayout && i < tabs.size(); ++i)
+		sameLayout = cached.TabFiles[i] == tabs[i].FileName;
+
+	if (sameLayout && IsSameStamps(cached.Stamps, stamps))
+		return &cached;
+
+	// only this character's bags changed, the results of the others stay valid
+	InvalidateCachedResults(character.Id);
+
+	FFXiHelper& helper = GetHelper(settings);
+
+	cached.FfxiPath = settings.FfxiPath;
+	cached.Name = character.Name;
+	cached.Region = settings.Region;
+	cached.Language = settings.Language;
+	cached.TabFiles.resize(tabs.size());
+	cached.Tabs.resize(tabs.size());
+	cached.TabOffsets.resize(tabs.size());
+	cached.Columns.Clear();
+	cached.Text.Clear();
+	cached.Stamps.swap(stamps);
+	cached.Generation = ++m_Generation;
+
+	FindAllInventory findAll;
+	bool fromFindAll = source != INVENTORY_FILES_DAT && LoadFindAllInventory(settings, character, tabs, findAll);
+
+	int read = fromFindAll ? INVENTORY_FILES_FINDALL
+		: (source == INVENTORY_FILES_DAT ? INVENTORY_FILES_DAT : INVENTORY_FILES_DAT_FALLBACK);
+
+	cached.DumpUnreadable = (read == INVENTORY_FILES_DAT_FALLBACK);
+
+	if (read != source)
+		CollectFileStamps(settings, character, tabs, read, cached.Stamps);
+
+	helper.SetCancelFlag(pCancel != NULL ? pCancel->GetFlag() : NULL);
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+	{
+		if (pProgress != NULL)
+			pProgress->OnProgress((int)i, (int)tabs.size());
+
+		cached.TabFiles[i] = tabs[i].FileName;
+		cached.TabOffsets[i] = cached.Columns.GetCount();
+		LoadInventoryTab(helper, settings, character, (int)i, tabs[i], cached.Tabs[i], m_KeyItems,
+			fromFindAll ? &findAll : NULL, m_ItemCatalog, &m_Icons, &cached.Columns);
+
+		// a bag cut short can't be cached, the inventory is decoded again by the next call
+		if (pCancel != NULL && pCancel->IsCanceled())
+		{
+			helper.SetCancelFlag(NULL);
+			m_Inventories.erase(character.Id);
+
+			return NULL;
+		}
+	}
+
+	helper.SetCancelFlag(NULL);
+
+	if (pProgress != NULL)
+		pProgress->OnProgress((int)tabs.size(), (int)tabs.size());
+
+	for (size_t i = 0; i < cached.Tabs.size(); ++i)
+	{
+		for (size_t j = 0; j < cached.Tabs[i].Items.size(); ++j)
+			AddSearchText(cached.Tabs[i].Items[j], cached.Text);
+	}
+
+	cached.Stats.Build(cached.Columns);
+
+	AddFuzzyEntries(cached, settings.Language);
+
+	return &cached;
+}
+
+void CoreApi::AddFuzzyEntries(const CachedInventory& inventory, int language)
+{
+	if (m_FuzzyLanguage != language)
+	{
+		m_FuzzyIndex.Clear();
+		m_FuzzyEntries.clear();
+		m_FuzzyItems.clear();
+		m_FuzzyLanguage = language;
+	}
+
+	for (size_t i = 0; i < inventory.Tabs.size(); ++i)
+	{
+		// key item IDs overlap with the item IDs
+		if (inventory.TabFiles[i] == L"__FINDALL_KEYITEMS__")
+			continue;
+
+		const std::vector<CoreItem>& items = inventory.Tabs[i].Items;
+
+		for (size_t j = 0; j < items.size(); ++j)
+		{
+			if (m_FuzzyEntries.find(items[j].Id) != m_FuzzyEntries.end())
+				continue;
+
+			// the log name isn't kept by CoreItem
+			const wchar_t* fields[FUZZY_FIELD_COUNT] = { items[j].Name.c_str(), NULL, items[j].Description.c_str() };
+			size_t lengths[FUZZY_FIELD_COUNT] = { items[j].Name.size(), 0, items[j].Description.size() };
+
+			m_FuzzyEntries[items[j].Id] = (unsigned int)m_FuzzyIndex.AddEntry(fields, lengths);
+			m_FuzzyItems.push_back(items[j].Id);
+		}
+	}
+}
+
+bool CoreApi::Search(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const CoreSearchQuery& query,
+	CoreSearchObserver& observer,
+	CoreSearchSession* pSession)
+{
+	if (settings.FfxiPath.empty())
+		return false;
+
+	std::wstring term = TrimWhitespace(query.Term);
+	for (size_t i = 0; i < term.size(); ++i)
+		term[i] = (wchar_t)towlower(term[i]);
+
+	SearchProgram program;
+	program.Compile(query.Criteria);
+
+	if (term.empty() && program.IsEmpty())
+		return false;
+
+	std::vector<std::wstring> tabFiles(tabs.size());
+	for (size_t i = 0; i < tabs.size(); ++i)
+		tabFiles[i] = tabs[i].FileName;
+
+	bool refine = pSession != NULL && pSession->Valid && pSession->TabFiles == tabFiles
+		&& IsNarrowerQuery(pSession->Term, pSession->Criteria, term, query.Criteria);
+
+	std::wstring resultKey = BuildSearchKey(term, query.Criteria);
+	std::vector<CoreSearchHit> hits;
+	SearchBitset selection;
+	hits.reserve(CORE_SEARCH_BATCH_SIZE);
+
+	int total = (int)characters.size();
+	bool canceled = false;
+	size_t batchSize = CORE_SEARCH_FIRST_BATCH_SIZE;
+	size_t hitCount = 0;
+	std::vector<unsigned int> generations(characters.size(), 0);
+	std::vector<SearchBitset> selections(pSession != NULL ? characters.size() : 0);
+
+	observer.OnProgress(0, total);
+
+	for (int c = 0; c < total && !canceled; ++c)
+	{
+		if (observer.IsCanceled())
+		{
+			canceled = true;
+			break;
+		}
+
+		if (program.NeverMatches())
+		{
+			observer.OnProgress(c + 1, total);
+			continue;
+		}
+
+		const CachedInventory* pInventory = GetCachedInventory(settings, characters[c], tabs, observer.GetCancelToken(), NULL);
+		if (pInventory == NULL)
+		{
+			canceled = true;
+			break;
+		}
+
+		const SearchBitset* pCached = FindCachedResult(resultKey, characters[c].Id, pInventory->Generation);
+
+		if (pCached != NULL)
+			selection = *pCached;
+		else
+		{
+			const SearchBitset* pPrevious = refine
+				? FindSessionSelection(*pSession, characters[c].Id, pInventory->Generation) : NULL;
+
+			// the numeric filters run over the columns of all tabs at once, the text only on what is left
+			program.Filter(pInventory->Columns, selection);
+
+			// a narrower query can only keep what the previous one selected
+			if (pPrevious != NULL)
+				selection.And(*pPrevious);
+
+			if (!term.empty() && !selection.IsEmpty())
+				pInventory->Text.Refine(term.c_str(), selection);
+
+			StoreCachedResult(resultKey, characters[c].Id, pInventory->Generation, selection);
+		}
+
+		if (pSession != NULL)
+		{
+			selections[c] = selection;
+			generations[c] = pInventory->Generation;
+		}
+
+		hitCount += selection.CountSet();
+		canceled = !SendHits(*pInventory, c, selection, hits, batchSize, observer);
+
+		if (!canceled)
+			observer.OnProgress(c + 1, total);
+	}
+
+	// the characters that were not reached keep generation 0 and are scanned again next time
+	if (pSession != NULL)
+	{
+		pSession->Valid = true;
+		pSession->Term = term;
+		pSession->Criteria = query.Criteria;
+		pSession->TabFiles.swap(tabFiles);
+		pSession->CharacterIds.resize(characters.size());
+		for (size_t i = 0; i < characters.size(); ++i)
+			pSession->CharacterIds[i] = characters[i].Id;
+		pSession->Generations.swap(generations);
+		pSession->Selections.swap(selections);
+	}
+
+	if (!canceled && hitCount == 0 && query.Fuzzy && !term.empty())
+		canceled = !SearchFuzzy(settings, characters, tabs, term, program, observer);
+
+	return !canceled;
+}
+
+// sends the selected rows of an inventory as hits, returns false if the search was canceled
+bool CoreApi::SendHits(const CachedInventory& inventory,
+	int character,
+	const SearchBitset& selection,
+	std::vector<CoreSearchHit>& hits,
+	size_t& batchSize,
+	CoreSearchObserver& observer)
+{
+	size_t rows = selection.GetCount();
+	size_t tab = 0;
+
+	for (size_t row = selection.FindNext(0); row < rows; row = selection.FindNext(row + 1))
+	{
+		while (tab + 1 < inventory.TabOffsets.size() && row >= inventory.TabOffsets[tab + 1])
+			++tab;
+
+		const CoreItem& item = inventory.Tabs[tab].Items[row - inventory.TabOffsets[tab]];
+
+		CoreSearchHit hit;
+		hit.Character = character;
+		hit.Tab = (int)tab;
+		hit.pItem = &item;
+		hits.push_back(hit);
+
+		if (hits.size() >= batchSize)
+		{
+			observer.OnHits(hits);
+			hits.clear();
+			batchSize = CORE_SEARCH_BATCH_SIZE;
+
+			if (observer.IsCanceled())
+				return false;
+		}
+	}
+
+	// hits point into this character's cache entry, flush them before moving on
+	if (!hits.empty())
+	{
+		observer.OnHits(hits);
+		hits.clear();
+		batchSize = CORE_SEARCH_BATCH_SIZE;
+	}
+
+	return true;
+}
+
+bool CoreApi::RunQuery(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const std::wstring& expression,
+	CoreSearchObserver& observer,
+	std::wstring& explain,
+	std::wstring& error)
+{
+	explain.clear();
+	error.clear();
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	SearchQuery query;
+	if (!query.Parse(expression.c_str(), error))
+		return false;
+
+	// every inventory is loaded before planning so that the estimates cover all of them
+	std::vector<int> selected;
+	std::vector<const CachedInventory*> inventories;
+	std::vector<SearchQueryData> data;
+
+	for (int c = 0; c < (int)characters.size(); ++c)
+	{
+		if (!query.MatchCharacter(characters[c].Name, characters[c].Id))
+			continue;
+
+		if (observer.IsCanceled())
+			return false;
+
+		const CachedInventory* pInventory = GetCachedInventory(settings, characters[c], tabs, observer.GetCancelToken(), NULL);
+		if (pInventory == NULL)
+			return false;
+
+		SearchQueryData inventoryData;
+		inventoryData.pColumns = &pInventory->Columns;
+		inventoryData.pText = &pInventory->Text;
+		inventoryData.pStats = &pInventory->Stats;
+
+		selected.push_back(c);
+		inventories.push_back(pInventory);
+		data.push_back(inventoryData);
+	}
+
+	// EXPLAIN always runs the query to time it
+	std::wstring resultKey = query.IsExplain() ? std::wstring() : BuildQueryKey(expression);
+	std::vector<CoreSearchHit> hits;
+	SearchBitset selection;
+	hits.reserve(CORE_SEARCH_BATCH_SIZE);
+
+	int total = (int)selected.size();
+	int fromCache = 0;
+	bool planned = false;
+	size_t batchSize = CORE_SEARCH_FIRST_BATCH_SIZE;
+	size_t hitCount = 0;
+
+	observer.OnProgress(0, total);
+
+	for (int i = 0; i < total; ++i)
+	{
+		if (observer.IsCanceled())
+			return false;
+
+		const CharacterInfo& character = characters[selected[i]];
+		const SearchBitset* pCached = resultKey.empty()
+			? NULL : FindCachedResult(resultKey, character.Id, inventories[i]->Generation);
+
+		if (pCached != NULL)
+		{
+			selection = *pCached;
+			hitCount += selection.CountSet();
+			++fromCache;
+		}
+		else
+		{
+			// planned on the first inventory missing from the cache
+			if (!planned)
+			{
+				query.Plan(data);
+				planned = true;
+			}
+
+			hitCount += query.Execute(data[i], selection);
+
+			if (!resultKey.empty())
+				StoreCachedResult(resultKey, character.Id, inventories[i]->Generation, selection);
+		}
+
+		if (!SendHits(*inventories[i], selected[i], selection, hits, batchSize, observer))
+			return false;
+
+		observer.OnProgress(i + 1, total);
+	}
+
+	CStringW header;
+	header.Format(L"%d of %d characters, %u hits, %d from the result cache\n",
+		total, (int)characters.size(), (unsigned int)hitCount, fromCache);
+
+	query.Explain(explain);
+	explain.insert(0, ToWString(header));
+
+	return true;
+}
+
+static bool CompareRankedHits(const std::pair<size_t, CoreSearchHit>& left, const std::pair<size_t, CoreSearchHit>& right)
+{
+	return left.first < right.first;
+}
+
+// the items within a few typos of the term, ranked over all the characters and sent best first
+bool CoreApi::SearchFuzzy(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const std::wstring& term,
+	const SearchProgram& program,
+	CoreSearchObserver& observer)
+{
+	std::vector<FuzzyMatch> matches;
+	if (m_FuzzyIndex.Search(term.c_str(), -1, matches, CORE_SEARCH_FUZZY_MAX_ITEMS) == 0)
+		return true;
+
+	std::unordered_map<int, size_t> ranks;
+	for (size_t i = 0; i < matches.size(); ++i)
+		ranks[m_FuzzyItems[matches[i].Entry]] = i;
+
+	std::vector<std::pair<size_t, CoreSearchHit>> ranked;
+	SearchBitset selection;
+
+	for (int c = 0; c < (int)characters.size(); ++c)
+	{
+		if (observer.IsCanceled())
+			return false;
+
+		const CachedInventory* pInventory = GetCachedInventory(settings, characters[c], tabs, observer.GetCancelToken(), NULL);
+		if (pInventory == NULL)
+			return false;
+
+		size_t rows = pInventory->Columns.GetCount();
+		size_t tab = 0;
+
+		if (program.Filter(pInventory->Columns, selection) == 0)
+			continue;
+
+		for (size_t row = selection.FindNext(0); row < rows; row = selection.FindNext(row + 1))
+		{
+			while (tab + 1 < pInventory->TabOffsets.size() && row >= pInventory->TabOffsets[tab + 1])
+				++tab;
+
+			const CoreItem& item = pInventory->Tabs[tab].Items[row - pInventory->TabOffsets[tab]];
+			std::unordered_map<int, size_t>::const_iterator it = ranks.find(item.Id);
+
+			if (it == ranks.end() || pInventory->TabFiles[tab] == L"__FINDALL_KEYITEMS__")
+				continue;
+
+			CoreSearchHit hit;
+			hit.Character = c;
+			hit.Tab = (int)tab;
+			hit.pItem = &item;
+			ranked.push_back(std::make_pair(it->second, hit));
+		}
+	}
+
+	// the pointers stay valid, each cache entry was loaded once above
+	std::stable_sort(ranked.begin(), ranked.end(), CompareRankedHits);
+
+	std::vector<CoreSearchHit> hits;
+	hits.reserve(CORE_SEARCH_BATCH_SIZE);
+
+	for (size_t i = 0; i < ranked.size(); ++i)
+	{
+		hits.push_back(ranked[i].second);
+
+		if (hits.size() >= CORE_SEARCH_BATCH_SIZE || i + 1 == ranked.size())
+		{
+			observer.OnHits(hits);
+			hits.clear();
+
+			if (observer.IsCanceled())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+const CoreIcon* CoreApi::GetItemIcon(int itemId) const
+{
+	std::unordered_map<int, CoreIcon>::const_iterator it = m_Icons.find(itemId);
+	if (it == m_Icons.end() || it->second.Pixels.empty())
+		return NULL;
+
+	return &it->second;
+}
+
+unsigned int CoreApi::GetGeneration(const std::wstring& characterId) const
+{
+	std::map<std::wstring, CachedInventory>::const_iterator it = m_Inventories.find(characterId);
+	if (it == m_Inventories.end())
+		return 0;
+
+	return it->second.Generation;
+}
+
+// out of line: the helper is only declared in the header, its deleter needs the whole type
+CoreApi::CoreApi() : m_Generation(0), m_FuzzyLanguage(-1), m_HelperRegion(-1)
+{
+}
+
+CoreApi::~CoreApi()
+{
+}
+
+// DAT files stay open between the inventories loaded with the same install and region
+FFXiHelper& CoreApi::GetHelper(const CoreSettings& settings)
+{
+	if (!m_pHelper || m_HelperPath != settings.FfxiPath || m_HelperRegion != settings.Region)
+	{
+		m_pHelper.reset(new FFXiHelper(settings.Region));
+		m_pHelper->SetInstallPath(ToCString(settings.FfxiPath));
+		m_pHelper->KeepDatFilesOpen(true);
+		m_HelperPath = settings.FfxiPath;
+		m_HelperRegion = settings.Region;
+	}
+	else
+	{
+		// a game update may have replaced a DAT file since the last load
+		m_pHelper->CloseChangedDatFiles();
+	}
+
+	return *m_pHelper;
+}
+
+static size_t GetItemTextLength(const CoreItem& item)
+{
+	return item.Name.size() + item.Attr.size() + item.Description.size() + item.Slot.size()
+		+ item.Races.size() + item.Level.size() + item.Jobs.size() + item.Remarks.size();
+}
+
+void CoreApi::GetMemoryStats(CoreMemoryStats& stats) const
+{
+	memset(&stats, 0, sizeof(stats));
+
+	for (std::map<std::wstring, CachedInventory>::const_iterator it = m_Inventories.begin(); it != m_Inventories.end(); ++it)
+	{
+		const CachedInventory& inventory = it->second;
+
+		for (size_t i = 0; i < inventory.Tabs.size(); ++i)
+		{
+			for (size_t j = 0; j < inventory.Tabs[i].Items.size(); ++j)
+				stats.ItemTextBytes += GetItemTextLength(inventory.Tabs[i].Items[j]) * sizeof(wchar_t);
+
+			stats.Items += inventory.Tabs[i].Items.size();
+		}
+
+		stats.SearchTextBytes += inventory.Text.GetLength() * sizeof(SearchTextChar);
+		++stats.Inventories;
+	}
+
+	for (std::unordered_map<int, CoreIcon>::const_iterator it = m_Icons.begin(); it != m_Icons.end(); ++it)
+		stats.IconBytes += it->second.Pixels.size();
+
+	stats.Icons = m_Icons.size();
+	stats.CachedResults = m_Results.size();
+	stats.CatalogEntries = m_FuzzyItems.size();
+	stats.OpenDatFiles = m_pHelper ? (size_t)m_pHelper->GetOpenDatFileCount() : 0;
+}
+
+// drops the inventory of a character, it is decoded again the next time it is used
+void CoreApi::EvictInventory(const std::wstring& characterId)
+{
+	m_Inventories.erase(characterId);
+	InvalidateCachedResults(characterId);
+}
+
+void CoreApi::ClearCache()
+{
+	m_pHelper.reset();
+	m_Inventories.clear();
+	m_Icons.clear();
+	m_FuzzyIndex.Clear();
+	m_FuzzyEntries.clear();
+	m_FuzzyItems.clear();
+	m_Results.clear();
+	m_ResultIndex.clear();
+	m_KeyItems.Clear();
+	m_ItemCatalog.Clear();
 }
 
 
@@ -1,8 +1,21 @@
 #pragma once
 
+#include <list>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "SearchProgram.h"
+#include "SearchKernel.h"
+#include "SearchText.h"
+#include "SearchFuzzy.h"
+#include "SearchQuery.h"
+
+class FFXiHelper;
+class CorePivot;
+
 struct CoreSettings
 {
 	int Region;
@@ -20,10 +33,21 @@ struct InventoryTabInfo
 	std::wstring DisplayName;
 };
 
+// where the bags of a character are read from
+enum CORE_INVENTORY_SOURCE
+{
+	CORE_SOURCE_DAT = 0,
+	// the FindAll dump of the character, the items are decoded by ID from the DAT files of the game
+	CORE_SOURCE_FINDALL
+};
+
 struct CharacterInfo
 {
+	CharacterInfo() : Source(CORE_SOURCE_DAT) {}
+
 	std::wstring Id;
 	std::wstring Name;
+	int Source;
 };
 
 struct CoreItem
@@ -50,9 +74,265 @@ struct InventoryTab
 	std::vector<CoreItem> Items;
 };
 
+struct CoreIcon
+{
+	int Width;
+	int Height;
+	int Stride;
+	std::vector<unsigned char> Pixels;
+};
+
+// text fields of an item in the string pool of a CoreInventoryBuffer
+enum CORE_ITEM_STRING
+{
+	CORE_ITEM_NAME = 0,
+	CORE_ITEM_ATTR,
+	CORE_ITEM_DESCRIPTION,
+	CORE_ITEM_SLOT,
+	CORE_ITEM_RACES,
+	CORE_ITEM_LEVEL,
+	CORE_ITEM_JOBS,
+	CORE_ITEM_REMARKS,
+	CORE_ITEM_STRING_COUNT
+};
+
+// fixed-stride record of an item, only 32-bit integers so that the records can be copied as one int array
+struct CoreItemRecord
+{
+	int Id;
+	int Count;
+	int IconWidth;
+	int IconHeight;
+	int IconStride;
+	// pixels in the icon atlas, IconOffset is -1 without icon
+	int IconOffset;
+	int IconSize;
+	// text i spans [StringOffsets[i], StringOffsets[i] + StringLengths[i]) of the string pool
+	int StringOffsets[CORE_ITEM_STRING_COUNT];
+	int StringLengths[CORE_ITEM_STRING_COUNT];
+};
+
+#define CORE_ITEM_RECORD_INTS (sizeof(CoreItemRecord) / sizeof(int))
+
+// inventory of a character in three flat buffers, for the frontends that copy it in bulk
+struct CoreInventoryBuffer
+{
+	void Clear();
+
+	std::vector<InventoryTabInfo> Tabs;
+	// the items of tab i are the records [TabOffsets[i], TabOffsets[i + 1])
+	std::vector<int> TabOffsets;
+	std::vector<CoreItemRecord> Records;
+	std::vector<wchar_t> Strings;
+	// pixels of every distinct icon, the items sharing an ID share their icon
+	std::vector<unsigned char> Icons;
+};
+
+struct CoreFileStamp
+{
+	unsigned long long WriteTime;
+	unsigned long long Size;
+};
+
+// last write time and size of a file or directory, zero if it doesn't exist
+CoreFileStamp GetFileStamp(const std::wstring &path);
+
+// FNV-1a of a block of bytes, chained from CORE_HASH_SEED
+#define CORE_HASH_SEED 14695981039346656037ULL
+unsigned long long HashBytes(unsigned long long hash, const void *pData, size_t size);
+// hashes of the stamps and of the contents of the files the inventory of a character is decoded from
+unsigned long long HashInventoryStamps(const CoreSettings &settings,
+	const CharacterInfo &character,
+	const std::vector<InventoryTabInfo> &tabs);
+unsigned long long HashInventoryContents(const CoreSettings &settings,
+	const CharacterInfo &character,
+	const std::vector<InventoryTabInfo> &tabs);
+
+// memory held by the caches of a CoreApi, the byte counts only include the payload of the containers
+struct CoreMemoryStats
+{
+	size_t Inventories;
+	size_t Items;
+	size_t ItemTextBytes;
+	size_t SearchTextBytes;
+	size_t Icons;
+	size_t IconBytes;
+	size_t CachedResults;
+	size_t CatalogEntries;
+	size_t OpenDatFiles;
+};
+
+// optional columns of a CSV export, Character and Location are always the first two
+enum CORE_EXPORT_COLUMN
+{
+	CORE_EXPORT_NAME        = 0x0001,
+	CORE_EXPORT_ATTR        = 0x0002,
+	CORE_EXPORT_DESCRIPTION = 0x0004,
+	CORE_EXPORT_TYPE        = 0x0008,
+	CORE_EXPORT_RACES       = 0x0010,
+	CORE_EXPORT_LEVEL       = 0x0020,
+	CORE_EXPORT_JOBS        = 0x0040,
+	CORE_EXPORT_REMARKS     = 0x0080,
+	CORE_EXPORT_BGWIKI      = 0x0100,
+	CORE_EXPORT_COUNT       = 0x0200
+};
+
+// size of the buffer the rows of an export are written through
+#define CORE_EXPORT_BUFFER_SIZE (1 << 20)
+
+// what an export wrote, the reused characters were copied from the previous file of an incremental export
+struct CoreExportStats
+{
+	size_t Rows;
+	size_t Characters;
+	size_t ReusedCharacters;
+};
+
+struct CoreSearchQuery
+{
+	std::wstring Term;
+	SearchCriteria Criteria;
+	// when the term matches nothing, fall back to the items within a few typos of it, best first
+	bool Fuzzy;
+};
+
+// compact search result: indices into the character and tab lists passed to CoreApi::Search
+// pItem points into the inventory cache and is only valid during CoreSearchObserver::OnHits
+struct CoreSearchHit
+{
+	int Character;
+	int Tab;
+	const CoreItem *pItem;
+};
+
+// cancellation flag set from any thread, the long operations check it between bags and between items
+class CoreCancelToken
+{
+public:
+	CoreCancelToken() : m_Canceled(0) {}
+
+	void Cancel() { m_Canceled = 1; }
+	bool IsCanceled() const { return m_Canceled != 0; }
+	const volatile long* GetFlag() const { return &m_Canceled; }
+
+private:
+	volatile long m_Canceled;
+};
+
+// progress of a long operation, IsCanceled is polled between characters
+// and the cancel token, if any, inside the loops decoding the bags
+class CoreProgressObserver
+{
+public:
+	CoreProgressObserver() : m_pCancel(NULL) {}
+	virtual ~CoreProgressObserver() {}
+
+	virtual bool IsCanceled() { return m_pCancel != NULL && m_pCancel->IsCanceled(); }
+	virtual void OnProgress(int completed, int total) {}
+
+	void SetCancelToken(const CoreCancelToken *pCancel) { m_pCancel = pCancel; }
+	const CoreCancelToken* GetCancelToken() const { return m_pCancel; }
+
+private:
+	const CoreCancelToken *m_pCancel;
+};
+
+class CoreSearchObserver : public CoreProgressObserver
+{
+public:
+	virtual void OnHits(const std::vector<CoreSearchHit> &hits) = 0;
+};
+
+#define CORE_SEARCH_BATCH_SIZE 256
+// the first batch is flushed early so that something shows up while typing
+#define CORE_SEARCH_FIRST_BATCH_SIZE 32
+// number of distinct items the typo-tolerant fallback returns at most
+#define CORE_SEARCH_FUZZY_MAX_ITEMS 500
+// number of searches and queries whose selections are kept, least recently used first out
+#define CORE_RESULT_CACHE_SIZE 32
+
+// state kept between the searches of a search-as-you-type session: a query that
+// only narrows the previous one starts from its selections instead of the whole inventory
+struct CoreSearchSession
+{
+	CoreSearchSession() : Valid(false) {}
+
+	bool Valid;
+	std::wstring Term;
+	SearchCriteria Criteria;
+	std::vector<std::wstring> TabFiles;
+	std::vector<std::wstring> CharacterIds;
+	// generation of the cached inventory each selection was computed on, 0 if the search stopped before it
+	std::vector<unsigned int> Generations;
+	std::vector<SearchBitset> Selections;
+};
+
+// key_items.lua of FindAll parsed once per session: the IDs sorted, the names and categories
+// in one buffer. Load parses the file again only when its size or write time changed
+class KeyItemCatalog
+{
+public:
+	KeyItemCatalog() { Clear(); }
+
+	// false if the file can't be read, the catalog is then empty
+	bool Load(const std::wstring &path);
+	// false if the ID isn't in the catalog
+	bool Find(int id, std::wstring &name, std::wstring &category) const;
+	size_t GetCount() const { return m_Ids.size(); }
+	void Clear();
+
+private:
+	struct Entry
+	{
+		unsigned int NameOffset;
+		unsigned int NameLength;
+		unsigned int CategoryOffset;
+		unsigned int CategoryLength;
+	};
+
+	std::wstring m_Path;
+	CoreFileStamp m_Stamp;
+	// m_Entries[i] is the key item m_Ids[i]
+	std::vector<int> m_Ids;
+	std::vector<Entry> m_Entries;
+	std::wstring m_Text;
+};
+
+// items decoded by ID from the DAT files for the inventories read from the FindAll dumps,
+// shared by every character: an ID is only decoded once per language
+class CoreItemCatalog
+{
+public:
+	struct Entry
+	{
+		// without count nor icon pixels
+		CoreItem Item;
+		SearchFields Fields;
+		CoreIcon Icon;
+	};
+
+	CoreItemCatalog() : m_Region(-1), m_Language(-1) {}
+
+	// NULL if the ID isn't an item of the DAT files; the catalog is emptied when the install,
+	// the region or the language of the settings differ from those of its items
+	const Entry* Find(FFXiHelper &helper, int id, const CoreSettings &settings);
+	size_t GetCount() const { return m_Items.size(); }
+	void Clear();
+
+private:
+	// the IDs missing from the DAT files are kept as NULL
+	std::unordered_map<int, std::unique_ptr<Entry>> m_Items;
+	std::wstring m_FfxiPath;
+	int m_Region;
+	int m_Language;
+};
+
 class CoreApi
 {
 public:
+	CoreApi();
+	~CoreApi();
+
 	bool LoadConfig(const std::wstring &configPath,
 		CoreSettings &settings,
 		std::vector<InventoryTabInfo> &tabs,
@@ -62,8 +342,162 @@ public:
 		const CharacterInfo &character,
 		const std::vector<InventoryTabInfo> &tabs,
 		std::vector<InventoryTab> &outTabs);
+	// the items come from the inventory cache shared with the searches, the observer
+	// receives the bags decoded and returns false when it is canceled
+	bool LoadInventoryBuffer(const CoreSettings &settings,
+		const CharacterInfo &character,
+		const std::vector<InventoryTabInfo> &tabs,
+		CoreInventoryBuffer &buffer,
+		CoreProgressObserver *pObserver = NULL);
 
 	bool SaveSettings(const std::wstring &configPath, const CoreSettings &settings);
 	bool SaveCharacterDisplayNames(const std::wstring &configPath,
 		const std::vector<std::pair<std::wstring, std::wstring>> &entries);
+
+	bool Search(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const CoreSearchQuery &query,
+		CoreSearchObserver &observer,
+		CoreSearchSession *pSession = NULL);
+
+	// runs a query expression such as name:"kote" job:SAM ilvl>=119 char:Mule* (see SearchQuery)
+	// explain receives the plan with the timings of each predicate, error the reason of a syntax error
+	bool RunQuery(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const std::wstring &expression,
+		CoreSearchObserver &observer,
+		std::wstring &explain,
+		std::wstring &error);
+
+	// writes the items of the characters to a UTF-8 CSV file, the rows of several characters are
+	// formatted in parallel and written in order; the observer receives the characters done.
+	// An incremental export keeps a manifest next to the file and only formats the characters whose
+	// bags or name changed since the previous export to the same path, the others are copied from it
+	bool ExportCsv(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		unsigned int columns,
+		const std::wstring &path,
+		bool incremental,
+		CoreProgressObserver &observer,
+		CoreExportStats *pStats = NULL);
+	// writes the items of the characters to a columnar binary file (see CoreColumnar.h):
+	// typed columns for the numbers and masks, dictionary-encoded texts
+	bool ExportColumnar(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const std::wstring &path,
+		CoreProgressObserver &observer,
+		size_t *pRowCount = NULL);
+
+	// groups the items of the characters by item, then by character and bag (see CorePivot);
+	// filter is a search term or a query expression (isQuery), every item is counted when it's empty
+	bool Aggregate(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const std::wstring &filter,
+		bool isQuery,
+		CorePivot &pivot,
+		CoreProgressObserver &observer,
+		std::wstring &error);
+	// writes a pivot to a UTF-8 CSV file, one line per item and bag with the total of the item
+	static bool ExportPivotCsv(const CorePivot &pivot,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const std::wstring &path);
+
+	const CoreIcon* GetItemIcon(int itemId) const;
+	// generation of the cached inventory of a character, 0 if it isn't loaded
+	unsigned int GetGeneration(const std::wstring &characterId) const;
+	void GetMemoryStats(CoreMemoryStats &stats) const;
+	void EvictInventory(const std::wstring &characterId);
+	void ClearCache();
+
+private:
+	// decoded inventory of a character without icons, revalidated against the bag files
+	struct CachedInventory
+	{
+		std::wstring FfxiPath;
+		std::wstring Name;
+		int Region;
+		int Language;
+		std::vector<std::wstring> TabFiles;
+		std::vector<CoreFileStamp> Stamps;
+		// the FindAll dump of the character couldn't be read, its DAT files were used instead
+		bool DumpUnreadable;
+		unsigned int Generation;
+		std::vector<InventoryTab> Tabs;
+		// search fields of every item of every tab, TabOffsets[i] is the first row of tab i
+		SearchColumns Columns;
+		std::vector<size_t> TabOffsets;
+		// searchable strings of the same rows, case-folded
+		SearchTextArena Text;
+		// value distribution of the columns, used to plan queries
+		SearchColumnStats Stats;
+	};
+
+	// rows a search selected in the inventory of a character, valid as long as its generation
+	struct CachedSelection
+	{
+		unsigned int Generation;
+		SearchBitset Selection;
+	};
+
+	struct CachedResult
+	{
+		std::wstring Key;
+		std::map<std::wstring, CachedSelection> Characters;
+	};
+
+	const SearchBitset* FindCachedResult(const std::wstring &key,
+		const std::wstring &characterId,
+		unsigned int generation);
+	void StoreCachedResult(const std::wstring &key,
+		const std::wstring &characterId,
+		unsigned int generation,
+		const SearchBitset &selection);
+	void InvalidateCachedResults(const std::wstring &characterId);
+
+	FFXiHelper& GetHelper(const CoreSettings &settings);
+	// NULL if it was canceled while decoding the bags
+	const CachedInventory* GetCachedInventory(const CoreSettings &settings,
+		const CharacterInfo &character,
+		const std::vector<InventoryTabInfo> &tabs,
+		const CoreCancelToken *pCancel,
+		CoreProgressObserver *pProgress);
+	static bool SendHits(const CachedInventory &inventory,
+		int character,
+		const SearchBitset &selection,
+		std::vector<CoreSearchHit> &hits,
+		size_t &batchSize,
+		CoreSearchObserver &observer);
+	void AddFuzzyEntries(const CachedInventory &inventory, int language);
+	bool SearchFuzzy(const CoreSettings &settings,
+		const std::vector<CharacterInfo> &characters,
+		const std::vector<InventoryTabInfo> &tabs,
+		const std::wstring &term,
+		const SearchProgram &program,
+		CoreSearchObserver &observer);
+
+	std::map<std::wstring, CachedInventory> m_Inventories;
+	std::unordered_map<int, CoreIcon> m_Icons;
+	unsigned int m_Generation;
+	// normalized search or query -> selections per character, most recently used first
+	std::list<CachedResult> m_Results;
+	std::unordered_map<std::wstring, std::list<CachedResult>::iterator> m_ResultIndex;
+	// item texts of every inventory loaded so far, one entry per item ID
+	FuzzyIndex m_FuzzyIndex;
+	std::unordered_map<int, unsigned int> m_FuzzyEntries;
+	std::vector<int> m_FuzzyItems;
+	int m_FuzzyLanguage;
+	// reads the bags of every character, its DAT files stay open as long as the install and region don't change
+	std::unique_ptr<FFXiHelper> m_pHelper;
+	std::wstring m_HelperPath;
+	int m_HelperRegion;
+	// shared by the FindAll key items of every character
+	KeyItemCatalog m_KeyItems;
+	// items of the characters read from their FindAll dump
+	CoreItemCatalog m_ItemCatalog;
 };
@@ -0,0 +1,253 @@
+#include "CoreColumnar.h"
+#include "CoreUtf.h"
+
+const CoreColumnarColumn CoreColumnarColumns[CORE_COLUMNAR_COLUMN_COUNT] =
+{
+	{ "character", CORE_COLUMNAR_DICTIONARY },
+	{ "location", CORE_COLUMNAR_DICTIONARY },
+	{ "id", CORE_COLUMNAR_INT32 },
+	{ "count", CORE_COLUMNAR_INT32 },
+	{ "name", CORE_COLUMNAR_DICTIONARY },
+	{ "attributes", CORE_COLUMNAR_DICTIONARY },
+	{ "description", CORE_COLUMNAR_DICTIONARY },
+	{ "type", CORE_COLUMNAR_DICTIONARY },
+	{ "races_text", CORE_COLUMNAR_DICTIONARY },
+	{ "level_text", CORE_COLUMNAR_DICTIONARY },
+	{ "jobs_text", CORE_COLUMNAR_DICTIONARY },
+	{ "remarks", CORE_COLUMNAR_DICTIONARY },
+	{ "class", CORE_COLUMNAR_UINT32 },
+	{ "jobs", CORE_COLUMNAR_UINT32 },
+	{ "slot", CORE_COLUMNAR_UINT32 },
+	{ "races", CORE_COLUMNAR_UINT32 },
+	{ "flags", CORE_COLUMNAR_UINT32 },
+	{ "skill", CORE_COLUMNAR_UINT32 },
+	{ "level", CORE_COLUMNAR_UINT32 },
+	{ "item_level", CORE_COLUMNAR_UINT32 },
+	{ "damage", CORE_COLUMNAR_UINT32 },
+	{ "delay", CORE_COLUMNAR_UINT32 },
+	{ "defense", CORE_COLUMNAR_UINT32 }
+};
+
+unsigned int CoreColumnarDictionary::Add(const std::wstring &text)
+{
+	std::unordered_map<std::wstring, unsigned int>::const_iterator it = m_indices.find(text);
+
+	if (it != m_indices.end())
+		return it->second;
+
+	unsigned int index = (unsigned int)m_indices.size();
+
+	m_indices.insert(std::make_pair(text, index));
+	CoreAppendUtf8(m_data, text.c_str(), text.size());
+	m_offsets.push_back((unsigned int)m_data.size());
+
+	return index;
+}
+
+// the values are unaligned in the file: they follow texts of any length
+template <typename V> static V LoadValue(const char *pData)
+{
+	V value;
+
+	memcpy(&value, pData, sizeof(value));
+
+	return value;
+}
+
+// reads a value at position and moves past it, false when it ends past the limit
+template <typename V> static bool ReadValue(const char *pData, size_t limit, size_t &position, V &value)
+{
+	if (position > limit || limit - position < sizeof(V))
+		return false;
+
+	value = LoadValue<V>(pData + position);
+	position += sizeof(V);
+
+	return true;
+}
+
+// moves past count items of the given size, false when they end past the limit
+static bool Skip(size_t limit, size_t &position, unsigned long long count, size_t itemSize)
+{
+	if (position > limit || (limit - position) / itemSize < count)
+		return false;
+
+	position += (size_t)count * itemSize;
+
+	return true;
+}
+
+CoreColumnarReader::CoreColumnarReader() : m_pData(NULL), m_size(0), m_rowCount(0) {}
+
+bool CoreColumnarReader::Open(const char *pData, size_t size)
+{
+	size_t position = CORE_COLUMNAR_MAGIC_SIZE;
+	size_t trailer = size - sizeof(unsigned long long) - CORE_COLUMNAR_MAGIC_SIZE;
+	unsigned int version = 0;
+	unsigned int columnCount = 0;
+	unsigned long long footer = 0;
+
+	m_pData = pData;
+	m_size = size;
+	m_columns.clear();
+	m_groups.clear();
+	m_rowCount = 0;
+
+	if (size < 2 * CORE_COLUMNAR_MAGIC_SIZE + sizeof(unsigned long long)
+		|| memcmp(pData, CORE_COLUMNAR_MAGIC, CORE_COLUMNAR_MAGIC_SIZE) != 0
+		|| memcmp(pData + size - CORE_COLUMNAR_MAGIC_SIZE, CORE_COLUMNAR_MAGIC, CORE_COLUMNAR_MAGIC_SIZE) != 0
+		|| !ReadValue(pData, trailer, position, version) || version != CORE_COLUMNAR_VERSION
+		|| !ReadValue(pData, trailer, position, columnCount) || columnCount == 0)
+	{
+		return false;
+	}
+
+	// each column takes at least its type and the length of its name
+	if ((trailer - position) / (2 * sizeof(unsigned int)) < columnCount)
+		return false;
+
+	m_columns.resize(columnCount);
+
+	for (size_t i = 0; i < m_columns.size(); ++i)
+	{
+		Column &column = m_columns[i];
+		unsigned int length = 0;
+		size_t name = 0;
+
+		if (!ReadValue(pData, trailer, position, column.Type) || !ReadValue(pData, trailer, position, length))
+			return false;
+
+		name = position;
+
+		if (column.Type < CORE_COLUMNAR_INT32 || column.Type > CORE_COLUMNAR_DICTIONARY || !Skip(trailer, position, length, 1))
+			return false;
+
+		column.Name.assign(pData + name, length);
+		column.pOffsets = NULL;
+		column.EntryCount = 0;
+		column.pEntries = NULL;
+	}
+
+	footer = LoadValue<unsigned long long>(pData + trailer);
+
+	if (footer < position || footer > trailer || !ReadFooter((size_t)footer, trailer))
+		return false;
+
+	// the row groups follow each other from the end of the header to the footer
+	unsigned long long rowCount = 0;
+
+	for (size_t g = 0; g < m_groups.size(); ++g)
+	{
+		size_t end = (g + 1 < m_groups.size()) ? (size_t)(m_groups[g + 1].pValues - pData) : (size_t)footer;
+		size_t start = (size_t)(m_groups[g].pValues - pData);
+		unsigned int rows = 0;
+
+		if (start != position || !ReadValue(pData, end, position, rows)
+			|| !Skip(end, position, rows, sizeof(unsigned int) * m_columns.size()) || position != end)
+		{
+			return false;
+		}
+
+		m_groups[g].pValues = pData + start + sizeof(unsigned int);
+		m_groups[g].Rows = rows;
+		rowCount += rows;
+	}
+
+	return position == footer && rowCount == m_rowCount;
+}
+
+// dictionaries, then the index of the row groups; the groups are kept as their offsets
+bool CoreColumnarReader::ReadFooter(size_t footer, size_t end)
+{
+	size_t position = footer;
+	unsigned int groupCount = 0;
+
+	for (size_t i = 0; i < m_columns.size(); ++i)
+	{
+		Column &column = m_columns[i];
+
+		if (column.Type != CORE_COLUMNAR_DICTIONARY)
+			continue;
+
+		if (!ReadValue(m_pData, end, position, column.EntryCount))
+			return false;
+
+		column.pOffsets = m_pData + position;
+
+		if (!Skip(end, position, (unsigned long long)column.EntryCount + 1, sizeof(unsigned int)))
+			return false;
+
+		column.pEntries = m_pData + position;
+
+		// the offsets go up from 0 and the last one is the size of the entries
+		unsigned int previous = 0;
+
+		for (unsigned int e = 0; e <= column.EntryCount; ++e)
+		{
+			unsigned int offset = LoadValue<unsigned int>(column.pOffsets + e * sizeof(unsigned int));
+
+			if ((e == 0 && offset != 0) || offset < previous)
+				return false;
+
+			previous = offset;
+		}
+
+		if (!Skip(end, position, previous, 1))
+			return false;
+	}
+
+	if (!ReadValue(m_pData, end, position, groupCount))
+		return false;
+
+	size_t offsets = position;
+
+	if (!Skip(end, position, groupCount, sizeof(unsigned long long))
+		|| !ReadValue(m_pData, end, position, m_rowCount) || position != end)
+	{
+		return false;
+	}
+
+	m_groups.resize(groupCount);
+
+	for (size_t g = 0; g < m_groups.size(); ++g)
+	{
+		unsigned long long offset = LoadValue<unsigned long long>(m_pData + offsets + g * sizeof(unsigned long long));
+
+		// checked against the header and the other groups by Open
+		if (offset >= footer)
+			return false;
+
+		m_groups[g].pValues = m_pData + (size_t)offset;
+		m_groups[g].Rows = 0;
+	}
+
+	return true;
+}
+
+void CoreColumnarReader::ReadColumn(size_t group, size_t column, std::vector<unsigned int> &values) const
+{
+	const Group &rows = m_groups[group];
+
+	values.resize(rows.Rows);
+
+	if (rows.Rows != 0)
+		memcpy(&values[0], rows.pValues + column * rows.Rows * sizeof(unsigned int), rows.Rows * sizeof(unsigned int));
+}
+
+size_t CoreColumnarReader::GetDictionarySize(size_t column) const
+{
+	return m_columns[column].EntryCount;
+}
+
+std::string CoreColumnarReader::GetDictionaryText(size_t column, unsigned int index) const
+{
+	const Column &dictionary = m_columns[column];
+
+	if (index >= dictionary.EntryCount)
+		return std::string();
+
+	unsigned int first = LoadValue<unsigned int>(dictionary.pOffsets + index * sizeof(unsigned int));
+	unsigned int last = LoadValue<unsigned int>(dictionary.pOffsets + (index + 1) * sizeof(unsigned int));
+
+	return std::string(dictionary.pEntries + first, last - first);
+}
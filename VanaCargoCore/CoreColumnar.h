@@ -0,0 +1,209 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Columnar export of the inventories (CoreApi::ExportColumnar), written in one pass.
+// Every integer is little-endian, the texts are UTF-8 without terminator.
+//
+//   header      magic "VCCOLUMN", uint32 version, uint32 column count,
+//               then for each column: uint32 type (CORE_COLUMNAR_TYPE), uint32 name length, name
+//   row groups  uint32 row count, then the values of each column in order: row count uint32
+//               (int32 for CORE_COLUMNAR_INT32), a dictionary column holds indices into its dictionary
+//   footer      for each dictionary column in order: uint32 entry count, uint32 offsets[count + 1]
+//               relative to the first entry, the entries;
+//               then uint32 row group count, uint64 offset of each row group, uint64 row count
+//   trailer     uint64 offset of the footer, magic "VCCOLUMN"
+//
+// A reader seeks to the trailer, loads the dictionaries and maps the row groups it needs:
+// the values of a column are one contiguous array per group. CoreColumnarReader does so in C++,
+// Checks/vccolumn.py with numpy. Nothing here depends on Windows, Checks/CoreColumnarCheck
+// writes files with the functions below and reads them back.
+
+#define CORE_COLUMNAR_MAGIC "VCCOLUMN"
+#define CORE_COLUMNAR_MAGIC_SIZE 8
+#define CORE_COLUMNAR_VERSION 1
+// rows held in memory before they are written as a group
+#define CORE_COLUMNAR_GROUP_ROWS 65536
+
+enum CORE_COLUMNAR_TYPE
+{
+	CORE_COLUMNAR_INT32 = 1,
+	CORE_COLUMNAR_UINT32,
+	CORE_COLUMNAR_DICTIONARY
+};
+
+// columns of the file, in order
+enum CORE_COLUMNAR_COLUMN
+{
+	CORE_COLUMNAR_CHARACTER = 0,
+	CORE_COLUMNAR_LOCATION,
+	CORE_COLUMNAR_ID,
+	CORE_COLUMNAR_COUNT,
+	CORE_COLUMNAR_NAME,
+	CORE_COLUMNAR_ATTR,
+	CORE_COLUMNAR_DESCRIPTION,
+	CORE_COLUMNAR_TYPE_TEXT,
+	CORE_COLUMNAR_RACES_TEXT,
+	CORE_COLUMNAR_LEVEL_TEXT,
+	CORE_COLUMNAR_JOBS_TEXT,
+	CORE_COLUMNAR_REMARKS,
+	CORE_COLUMNAR_CLASS,
+	CORE_COLUMNAR_JOBS,
+	CORE_COLUMNAR_SLOT,
+	CORE_COLUMNAR_RACES,
+	CORE_COLUMNAR_FLAGS,
+	CORE_COLUMNAR_SKILL,
+	CORE_COLUMNAR_LEVEL,
+	CORE_COLUMNAR_ITEM_LEVEL,
+	CORE_COLUMNAR_DAMAGE,
+	CORE_COLUMNAR_DELAY,
+	CORE_COLUMNAR_DEFENSE,
+	CORE_COLUMNAR_COLUMN_COUNT
+};
+
+struct CoreColumnarColumn
+{
+	const char *pName;
+	unsigned int Type;
+};
+
+// same order as CORE_COLUMNAR_COLUMN
+extern const CoreColumnarColumn CoreColumnarColumns[CORE_COLUMNAR_COLUMN_COUNT];
+
+// distinct texts of a dictionary column in UTF-8, numbered in order of appearance
+class CoreColumnarDictionary
+{
+public:
+	CoreColumnarDictionary() : m_offsets(1, 0) {}
+
+	unsigned int Add(const std::wstring &text);
+
+	template <typename F> bool Write(F &file) const
+	{
+		return file.WriteValue((unsigned int)m_indices.size())
+			&& file.WriteValues(m_offsets)
+			&& file.Write(m_data.data(), m_data.size());
+	}
+
+private:
+	std::unordered_map<std::wstring, unsigned int> m_indices;
+	std::vector<unsigned int> m_offsets;
+	std::string m_data;
+};
+
+// The writers take any file with Write(pData, size), WriteValue(value), WriteValues(vector)
+// and GetPosition(): the buffered Win32 file of the export or the memory file of the checks.
+
+template <typename F> bool CoreColumnarWriteHeader(F &file)
+{
+	bool success = file.Write(CORE_COLUMNAR_MAGIC, CORE_COLUMNAR_MAGIC_SIZE)
+		&& file.WriteValue((unsigned int)CORE_COLUMNAR_VERSION)
+		&& file.WriteValue((unsigned int)CORE_COLUMNAR_COLUMN_COUNT);
+
+	for (int i = 0; i < CORE_COLUMNAR_COLUMN_COUNT && success; ++i)
+	{
+		unsigned int length = (unsigned int)strlen(CoreColumnarColumns[i].pName);
+
+		success = file.WriteValue(CoreColumnarColumns[i].Type)
+			&& file.WriteValue(length)
+			&& file.Write(CoreColumnarColumns[i].pName, length);
+	}
+
+	return success;
+}
+
+// writes pValues[CORE_COLUMNAR_COLUMN_COUNT] as a row group and empties them
+template <typename F> bool CoreColumnarWriteGroup(F &file, std::vector<unsigned int> *pValues,
+												  std::vector<unsigned long long> &groupOffsets)
+{
+	bool success = true;
+
+	groupOffsets.push_back(file.GetPosition());
+	success = file.WriteValue((unsigned int)pValues[0].size());
+
+	for (int i = 0; i < CORE_COLUMNAR_COLUMN_COUNT && success; ++i)
+	{
+		success = file.WriteValues(pValues[i]);
+		pValues[i].clear();
+	}
+
+	return success;
+}
+
+// footer and trailer, pDictionaries[CORE_COLUMNAR_COLUMN_COUNT] is indexed by column
+template <typename F> bool CoreColumnarWriteFooter(F &file, const CoreColumnarDictionary *pDictionaries,
+												   const std::vector<unsigned long long> &groupOffsets,
+												   unsigned long long rowCount)
+{
+	unsigned long long footer = file.GetPosition();
+	bool success = true;
+
+	for (int i = 0; i < CORE_COLUMNAR_COLUMN_COUNT && success; ++i)
+	{
+		if (CoreColumnarColumns[i].Type == CORE_COLUMNAR_DICTIONARY)
+			success = pDictionaries[i].Write(file);
+	}
+
+	return success
+		&& file.WriteValue((unsigned int)groupOffsets.size())
+		&& file.WriteValues(groupOffsets)
+		&& file.WriteValue(rowCount)
+		&& file.WriteValue(footer)
+		&& file.Write(CORE_COLUMNAR_MAGIC, CORE_COLUMNAR_MAGIC_SIZE);
+}
+
+// Reads a file loaded in memory. Open checks the header, the trailer, the footer and the bounds
+// of every row group, so the values and the texts can be read without further checks.
+// The data must outlive the reader.
+class CoreColumnarReader
+{
+public:
+	CoreColumnarReader();
+
+	bool Open(const char *pData, size_t size);
+
+	size_t GetColumnCount() const { return m_columns.size(); }
+	const std::string& GetColumnName(size_t column) const { return m_columns[column].Name; }
+	unsigned int GetColumnType(size_t column) const { return m_columns[column].Type; }
+
+	size_t GetGroupCount() const { return m_groups.size(); }
+	size_t GetGroupRowCount(size_t group) const { return m_groups[group].Rows; }
+	unsigned long long GetRowCount() const { return m_rowCount; }
+	// values of a column in a row group, signed for CORE_COLUMNAR_INT32
+	void ReadColumn(size_t group, size_t column, std::vector<unsigned int> &values) const;
+
+	// entries of a dictionary column, 0 for the other columns
+	size_t GetDictionarySize(size_t column) const;
+	// UTF-8 text of an entry, empty when the index is out of range
+	std::string GetDictionaryText(size_t column, unsigned int index) const;
+
+private:
+	struct Column
+	{
+		std::string Name;
+		unsigned int Type;
+		// offsets of the entries, relative to pEntries
+		const char *pOffsets;
+		unsigned int EntryCount;
+		const char *pEntries;
+	};
+
+	struct Group
+	{
+		// first value of the first column
+		const char *pValues;
+		size_t Rows;
+	};
+
+	bool ReadFooter(size_t footer, size_t end);
+
+	const char *m_pData;
+	size_t m_size;
+	std::vector<Column> m_columns;
+	std::vector<Group> m_groups;
+	unsigned long long m_rowCount;
+};
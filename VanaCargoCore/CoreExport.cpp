@@ -0,0 +1,815 @@
+#include "stdafx.h"
+#include "CoreApi.h"
+#include "CoreColumnar.h"
+#include "CorePivot.h"
+#include "CoreUtf.h"
+#include "FFXIHelper.h"
+
+#include <algorithm>
+#include <thread>
+
+#define CORE_EXPORT_BGWIKI_URL "https://www.bg-wiki.com/ffxi/"
+// number of rows formatted between two checks of the cancel token
+#define CORE_EXPORT_CANCEL_INTERVAL 256
+// changes whenever the text of the rows changes, the segments of the previous exports are then rewritten
+#define CORE_EXPORT_FORMAT_VERSION 1
+// files next to the output of an incremental export
+#define CORE_EXPORT_MANIFEST_EXT L".manifest"
+#define CORE_EXPORT_TEMP_EXT L".tmp"
+#define CORE_EXPORT_MANIFEST_MAGIC "VCEXPMAN"
+#define CORE_EXPORT_MANIFEST_MAGIC_SIZE 8
+
+// segment of a character in the file of an incremental export
+struct ExportManifestEntry
+{
+	std::wstring Id;
+	// options of the export and name of the character
+	unsigned long long Key;
+	unsigned long long StampHash;
+	unsigned long long ContentHash;
+	unsigned long long Offset;
+	unsigned long long Length;
+	unsigned long long Rows;
+};
+
+// rows of one character in UTF-8, formatted by a worker thread or copied from the previous file
+struct ExportChunk
+{
+	const std::wstring *pCharacter;
+	// NULL when the rows were copied
+	const std::vector<InventoryTab> *pTabs;
+	std::string Text;
+	size_t Rows;
+	ExportManifestEntry Entry;
+};
+
+// file written through a large buffer, the chunks bigger than the buffer go straight to the file
+class ExportFile
+{
+public:
+	ExportFile() : m_hFile(INVALID_HANDLE_VALUE), m_position(0) {}
+	~ExportFile() { Close(); }
+
+	bool Create(const std::wstring &path)
+	{
+		m_hFile = ::CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		m_buffer.reserve(CORE_EXPORT_BUFFER_SIZE);
+
+		return (m_hFile != INVALID_HANDLE_VALUE);
+	}
+
+	bool Write(const char *pData, size_t size)
+	{
+		m_position += size;
+
+		if (m_buffer.size() + size > CORE_EXPORT_BUFFER_SIZE && !Flush())
+			return false;
+
+		if (size >= CORE_EXPORT_BUFFER_SIZE)
+			return WriteFile(pData, size);
+
+		m_buffer.append(pData, size);
+
+		return true;
+	}
+
+	template <typename V> bool WriteValue(V value)
+	{
+		return Write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template <typename V> bool WriteValues(const std::vector<V> &values)
+	{
+		return Write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(V));
+	}
+
+	// offset of the next byte written
+	unsigned long long GetPosition() const { return m_position; }
+
+	bool Close()
+	{
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		bool success = Flush();
+
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+
+		return success;
+	}
+
+private:
+	bool Flush()
+	{
+		bool success = WriteFile(m_buffer.data(), m_buffer.size());
+
+		m_buffer.clear();
+
+		return success;
+	}
+
+	bool WriteFile(const char *pData, size_t size)
+	{
+		while (size > 0)
+		{
+			DWORD written = 0;
+			DWORD toWrite = (DWORD)std::min<size_t>(size, 0x40000000);
+
+			if (!::WriteFile(m_hFile, pData, toWrite, &written, NULL) || written == 0)
+				return false;
+
+			pData += written;
+			size -= written;
+		}
+
+		return true;
+	}
+
+	HANDLE m_hFile;
+	std::string m_buffer;
+	unsigned long long m_position;
+};
+
+// a field quoted only when it contains a separator, a quote or a line break, the quotes are doubled
+static void AppendField(std::string &out, const std::wstring &value)
+{
+	out += ',';
+
+	if (value.find_first_of(L",\"\r\n") == std::wstring::npos)
+	{
+		CoreAppendUtf8(out, value.c_str(), value.size());
+		return;
+	}
+
+	size_t start = 0;
+
+	out += '"';
+
+	for (size_t quote = value.find(L'"'); quote != std::wstring::npos; quote = value.find(L'"', start))
+	{
+		CoreAppendUtf8(out, value.c_str() + start, quote - start);
+		out += "\"\"";
+		start = quote + 1;
+	}
+
+	CoreAppendUtf8(out, value.c_str() + start, value.size() - start);
+	out += '"';
+}
+
+// BG Wiki page of an item, the name percent-encoded like Uri.EscapeDataString
+static void AppendBgWikiUrl(std::string &out, const std::wstring &name, std::string &scratch)
+{
+	static const char Hex[] = "0123456789ABCDEF";
+
+	scratch.clear();
+	CoreAppendUtf8(scratch, name.c_str(), name.size());
+
+	out += "," CORE_EXPORT_BGWIKI_URL;
+
+	for (size_t i = 0; i < scratch.size(); ++i)
+	{
+		unsigned char c = (unsigned char)scratch[i];
+
+		if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+		 || c == '-' || c == '.' || c == '_' || c == '~')
+		{
+			out += (char)c;
+		}
+		else
+		{
+			out += '%';
+			out += Hex[c >> 4];
+			out += Hex[c & 0x0F];
+		}
+	}
+}
+
+static void FormatChunk(ExportChunk &chunk, const std::vector<InventoryTabInfo> &tabs,
+						unsigned int columns, const CoreCancelToken *pCancel)
+{
+	std::string character, scratch;
+	std::vector<std::string> locations(tabs.size());
+	char count[16];
+
+	// the first two fields are the same for every row of a tab
+	AppendField(character, *chunk.pCharacter);
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+		AppendField(locations[i], tabs[i].DisplayName);
+
+	for (size_t i = 0; i < chunk.pTabs->size() && i < tabs.size(); ++i)
+	{
+		const std::vector<CoreItem> &items = (*chunk.pTabs)[i].Items;
+
+		for (size_t j = 0; j < items.size(); ++j)
+		{
+			const CoreItem &item = items[j];
+
+			if (pCancel != NULL && (chunk.Rows % CORE_EXPORT_CANCEL_INTERVAL) == 0 && pCancel->IsCanceled())
+				return;
+
+			// without the leading separator of the first field
+			chunk.Text.append(character, 1, std::string::npos);
+			chunk.Text += locations[i];
+
+			if (columns & CORE_EXPORT_NAME)
+				AppendField(chunk.Text, item.Name);
+			if (columns & CORE_EXPORT_ATTR)
+				AppendField(chunk.Text, item.Attr);
+			if (columns & CORE_EXPORT_DESCRIPTION)
+				AppendField(chunk.Text, item.Description);
+			if (columns & CORE_EXPORT_TYPE)
+				AppendField(chunk.Text, item.Slot);
+			if (columns & CORE_EXPORT_RACES)
+				AppendField(chunk.Text, item.Races);
+			if (columns & CORE_EXPORT_LEVEL)
+				AppendField(chunk.Text, item.Level);
+			if (columns & CORE_EXPORT_JOBS)
+				AppendField(chunk.Text, item.Jobs);
+			if (columns & CORE_EXPORT_REMARKS)
+				AppendField(chunk.Text, item.Remarks);
+			if (columns & CORE_EXPORT_BGWIKI)
+				AppendBgWikiUrl(chunk.Text, item.Name, scratch);
+
+			if (columns & CORE_EXPORT_COUNT)
+			{
+				_itoa_s(item.Count, count, 10);
+				chunk.Text += ',';
+				chunk.Text += count;
+			}
+
+			chunk.Text += "\r\n";
+			++chunk.Rows;
+		}
+	}
+}
+
+static std::string FormatHeader(unsigned int columns)
+{
+	// UTF-8 BOM so that Excel picks the encoding
+	std::string header("\xEF\xBB\xBF" "Character,Location");
+
+	if (columns & CORE_EXPORT_NAME)
+		header += ",Name";
+	if (columns & CORE_EXPORT_ATTR)
+		header += ",Attributes";
+	if (columns & CORE_EXPORT_DESCRIPTION)
+		header += ",Description";
+	if (columns & CORE_EXPORT_TYPE)
+		header += ",Type";
+	if (columns & CORE_EXPORT_RACES)
+		header += ",Races";
+	if (columns & CORE_EXPORT_LEVEL)
+		header += ",Level";
+	if (columns & CORE_EXPORT_JOBS)
+		header += ",Jobs";
+	if (columns & CORE_EXPORT_REMARKS)
+		header += ",Remarks";
+	if (columns & CORE_EXPORT_BGWIKI)
+		header += ",BG Wiki URL";
+	if (columns & CORE_EXPORT_COUNT)
+		header += ",Count";
+
+	header += "\r\n";
+
+	return header;
+}
+
+template <typename V> static bool ReadValue(const std::string &data, size_t &position, V &value)
+{
+	if (data.size() - position < sizeof(V))
+		return false;
+
+	memcpy(&value, data.data() + position, sizeof(V));
+	position += sizeof(V);
+
+	return true;
+}
+
+// the segments of the file written by an incremental export, valid as long as the file keeps its stamp
+class ExportManifest
+{
+public:
+	ExportManifest() { m_output.WriteTime = m_output.Size = 0; }
+
+	bool Load(const std::wstring &path)
+	{
+		std::string data;
+		HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+		LARGE_INTEGER size;
+		size_t position = CORE_EXPORT_MANIFEST_MAGIC_SIZE;
+		unsigned int count = 0;
+		bool success = false;
+
+		if (hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		if (::GetFileSizeEx(hFile, &size) && size.QuadPart >= CORE_EXPORT_MANIFEST_MAGIC_SIZE)
+			success = ReadRange(hFile, 0, (size_t)size.QuadPart, data);
+
+		::CloseHandle(hFile);
+
+		success = success && memcmp(data.data(), CORE_EXPORT_MANIFEST_MAGIC, CORE_EXPORT_MANIFEST_MAGIC_SIZE) == 0
+			&& ReadValue(data, position, m_output.WriteTime)
+			&& ReadValue(data, position, m_output.Size)
+			&& ReadValue(data, position, count);
+
+		m_entries.clear();
+
+		for (unsigned int i = 0; i < count && success; ++i)
+		{
+			ExportManifestEntry entry;
+			unsigned int length = 0;
+
+			success = ReadValue(data, position, length)
+				&& (data.size() - position) / sizeof(wchar_t) >= length;
+
+			if (!success)
+				break;
+
+			entry.Id.assign(reinterpret_cast<const wchar_t*>(data.data() + position), length);
+			position += length * sizeof(wchar_t);
+
+			success = ReadValue(data, position, entry.Key)
+				&& ReadValue(data, position, entry.StampHash)
+				&& ReadValue(data, position, entry.ContentHash)
+				&& ReadValue(data, position, entry.Offset)
+				&& ReadValue(data, position, entry.Length)
+				&& ReadValue(data, position, entry.Rows);
+
+			if (success)
+				m_entries.push_back(entry);
+		}
+
+		if (!success)
+			m_entries.clear();
+
+		return success;
+	}
+
+	bool Save(const std::wstring &path, const CoreFileStamp &output)
+	{
+		ExportFile file;
+		bool success = file.Create(path)
+			&& file.Write(CORE_EXPORT_MANIFEST_MAGIC, CORE_EXPORT_MANIFEST_MAGIC_SIZE)
+			&& file.WriteValue(output.WriteTime)
+			&& file.WriteValue(output.Size)
+			&& file.WriteValue((unsigned int)m_entries.size());
+
+		for (size_t i = 0; i < m_entries.size() && success; ++i)
+		{
+			const ExportManifestEntry &entry = m_entries[i];
+
+			success = file.WriteValue((unsigned int)entry.Id.size())
+				&& file.Write(reinterpret_cast<const char*>(entry.Id.c_str()), entry.Id.size() * sizeof(wchar_t))
+				&& file.WriteValue(entry.Key)
+				&& file.WriteValue(entry.StampHash)
+				&& file.WriteValue(entry.ContentHash)
+				&& file.WriteValue(entry.Offset)
+				&& file.WriteValue(entry.Length)
+				&& file.WriteValue(entry.Rows);
+		}
+
+		success = file.Close() && success;
+
+		if (!success)
+			::DeleteFileW(path.c_str());
+
+		return success;
+	}
+
+	// false once the file was modified or replaced outside of an incremental export
+	bool Matches(const CoreFileStamp &output) const
+	{
+		return output.Size != 0 && output.Size == m_output.Size && output.WriteTime == m_output.WriteTime;
+	}
+
+	const ExportManifestEntry* Find(const std::wstring &id) const
+	{
+		for (size_t i = 0; i < m_entries.size(); ++i)
+		{
+			if (m_entries[i].Id == id)
+				return &m_entries[i];
+		}
+
+		return NULL;
+	}
+
+	void Add(const ExportManifestEntry &entry) { m_entries.push_back(entry); }
+
+	static bool ReadRange(HANDLE hFile, unsigned long long offset, size_t length, std::string &data)
+	{
+		LARGE_INTEGER position;
+
+		position.QuadPart = (LONGLONG)offset;
+		data.resize(length);
+
+		if (!::SetFilePointerEx(hFile, position, NULL, FILE_BEGIN))
+			return false;
+
+		for (size_t done = 0; done < length; )
+		{
+			DWORD read = 0;
+			DWORD toRead = (DWORD)std::min<size_t>(length - done, 0x40000000);
+
+			if (!::ReadFile(hFile, &data[done], toRead, &read, NULL) || read == 0)
+				return false;
+
+			done += read;
+		}
+
+		return true;
+	}
+
+private:
+	CoreFileStamp m_output;
+	std::vector<ExportManifestEntry> m_entries;
+};
+
+// everything but the inventories that changes the text of a segment, the item DAT files
+// included: the names and descriptions change with the updates of the game
+static unsigned long long HashExportOptions(const CoreSettings &settings,
+											const std::vector<InventoryTabInfo> &tabs,
+											unsigned int columns,
+											FFXiHelper &helper)
+{
+	unsigned int values[] = { CORE_EXPORT_FORMAT_VERSION, columns, (unsigned int)settings.Region, (unsigned int)settings.Language };
+	unsigned long long hash = HashBytes(CORE_HASH_SEED, values, sizeof(values));
+
+	hash = HashBytes(hash, settings.FfxiPath.c_str(), (settings.FfxiPath.size() + 1) * sizeof(wchar_t));
+	hash = HashBytes(hash, settings.FindAllDataPath.c_str(), (settings.FindAllDataPath.size() + 1) * sizeof(wchar_t));
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+	{
+		hash = HashBytes(hash, tabs[i].FileName.c_str(), (tabs[i].FileName.size() + 1) * sizeof(wchar_t));
+		hash = HashBytes(hash, tabs[i].DisplayName.c_str(), (tabs[i].DisplayName.size() + 1) * sizeof(wchar_t));
+	}
+
+	for (int type = ITEM_TYPE_GENERAL_ITEMS_1; type < ITEM_TYPE_COUNT; ++type)
+	{
+		CString datFile;
+
+		helper.GetFileFromType(type, datFile, settings.Language);
+
+		CoreFileStamp stamp = GetFileStamp(std::wstring((LPCTSTR)datFile));
+
+		hash = HashBytes(hash, &stamp, sizeof(stamp));
+	}
+
+	return hash;
+}
+
+bool CoreApi::ExportCsv(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	unsigned int columns,
+	const std::wstring& path,
+	bool incremental,
+	CoreProgressObserver& observer,
+	CoreExportStats* pStats)
+{
+	CoreExportStats stats = { 0, 0, 0 };
+
+	if (pStats != NULL)
+		*pStats = stats;
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	// an incremental export copies the segments of the unchanged characters from the previous
+	// file: the new one is written next to it and replaces it once complete
+	std::wstring manifestPath = path + CORE_EXPORT_MANIFEST_EXT;
+	std::wstring outputPath = incremental ? path + CORE_EXPORT_TEMP_EXT : path;
+	HANDLE hPrevious = INVALID_HANDLE_VALUE;
+	ExportManifest previous, manifest;
+
+	if (incremental && previous.Load(manifestPath) && previous.Matches(GetFileStamp(path)))
+	{
+		hPrevious = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	}
+
+	ExportFile file;
+	if (!file.Create(outputPath))
+	{
+		if (hPrevious != INVALID_HANDLE_VALUE)
+			::CloseHandle(hPrevious);
+
+		return false;
+	}
+
+	std::string header = FormatHeader(columns);
+	bool success = file.Write(header.data(), header.size());
+	bool canceled = false;
+	unsigned long long options = HashExportOptions(settings, tabs, columns, GetHelper(settings));
+
+	// a window of characters is formatted at once, one thread per character:
+	// only the text of the window is held in memory before it is written
+	int window = (int)std::max(1u, std::thread::hardware_concurrency());
+	int total = (int)characters.size();
+	std::vector<ExportChunk> chunks;
+	std::vector<size_t> pending;
+	std::vector<std::thread> workers;
+
+	observer.OnProgress(0, total);
+
+	for (int first = 0; first < total && success && !canceled; first += window)
+	{
+		int last = std::min(total, first + window);
+
+		chunks.resize(last - first);
+		pending.clear();
+
+		// the inventory cache isn't shared between threads, the characters are decoded in turn
+		for (int c = first; c < last; ++c)
+		{
+			const CharacterInfo& character = characters[c];
+			ExportChunk& chunk = chunks[c - first];
+			ExportManifestEntry& entry = chunk.Entry;
+
+			chunk.pCharacter = &character.Name;
+			chunk.pTabs = NULL;
+			chunk.Text.clear();
+			chunk.Rows = 0;
+			entry.Id = character.Id;
+			entry.Key = entry.StampHash = entry.ContentHash = 0;
+
+			if (observer.IsCanceled())
+			{
+				canceled = true;
+				break;
+			}
+
+			if (incremental)
+			{
+				const ExportManifestEntry* pPrevious = (hPrevious != INVALID_HANDLE_VALUE) ? previous.Find(character.Id) : NULL;
+
+				entry.Key = HashBytes(options, character.Name.c_str(), character.Name.size() * sizeof(wchar_t));
+				entry.StampHash = HashInventoryStamps(settings, character, tabs);
+
+				// the game rewrites the bags at logout even when nothing moved, the contents decide
+				if (pPrevious != NULL && pPrevious->Key == entry.Key && pPrevious->StampHash == entry.StampHash)
+					entry.ContentHash = pPrevious->ContentHash;
+				else
+					entry.ContentHash = HashInventoryContents(settings, character, tabs);
+
+				if (pPrevious != NULL && pPrevious->Key == entry.Key && pPrevious->ContentHash == entry.ContentHash
+				 && ExportManifest::ReadRange(hPrevious, pPrevious->Offset, (size_t)pPrevious->Length, chunk.Text))
+				{
+					chunk.Rows = (size_t)pPrevious->Rows;
+					++stats.ReusedCharacters;
+					continue;
+				}
+
+				chunk.Text.clear();
+			}
+
+			const CachedInventory* pInventory = GetCachedInventory(settings, character, tabs, observer.GetCancelToken(), NULL);
+
+			if (pInventory == NULL)
+			{
+				canceled = true;
+				break;
+			}
+
+			chunk.pTabs = &pInventory->Tabs;
+			pending.push_back(c - first);
+		}
+
+		if (canceled)
+			break;
+
+		for (size_t i = 1; i < pending.size(); ++i)
+			workers.push_back(std::thread(FormatChunk, std::ref(chunks[pending[i]]), std::cref(tabs), columns, observer.GetCancelToken()));
+
+		if (!pending.empty())
+			FormatChunk(chunks[pending[0]], tabs, columns, observer.GetCancelToken());
+
+		for (size_t i = 0; i < workers.size(); ++i)
+			workers[i].join();
+
+		workers.clear();
+
+		if (observer.IsCanceled())
+		{
+			canceled = true;
+			break;
+		}
+
+		for (size_t i = 0; i < chunks.size() && success; ++i)
+		{
+			ExportManifestEntry& entry = chunks[i].Entry;
+
+			entry.Offset = file.GetPosition();
+			entry.Length = chunks[i].Text.size();
+			entry.Rows = chunks[i].Rows;
+			manifest.Add(entry);
+
+			success = file.Write(chunks[i].Text.data(), chunks[i].Text.size());
+			stats.Rows += chunks[i].Rows;
+			++stats.Characters;
+		}
+
+		observer.OnProgress(last, total);
+	}
+
+	if (hPrevious != INVALID_HANDLE_VALUE)
+		::CloseHandle(hPrevious);
+
+	success = file.Close() && success && !canceled;
+
+	if (success && incremental)
+	{
+		success = ::MoveFileExW(outputPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+
+		// without a manifest the next export starts over
+		if (success && !manifest.Save(manifestPath, GetFileStamp(path)))
+			::DeleteFileW(manifestPath.c_str());
+	}
+
+	// nothing is left of an export that didn't complete
+	if (!success)
+		::DeleteFileW(outputPath.c_str());
+
+	if (pStats != NULL)
+		*pStats = stats;
+
+	return success;
+}
+
+bool CoreApi::ExportPivotCsv(const CorePivot& pivot,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const std::wstring& path)
+{
+	ExportFile file;
+	if (!file.Create(path))
+		return false;
+
+	static const char Header[] = "\xEF\xBB\xBF" "Item,ID,Total,Character,Location,Count\r\n";
+	bool success = file.Write(Header, sizeof(Header) - 1);
+	std::string item, text;
+	char number[32];
+
+	for (size_t r = 0; r < pivot.GetRowCount() && success; ++r)
+	{
+		const CorePivotRow& row = pivot.GetRow(r);
+
+		// the first three fields are the same for every bag of the item
+		item.clear();
+		AppendField(item, row.Name);
+		_itoa_s(row.ItemId, number, 10);
+		item += ',';
+		item += number;
+		_i64toa_s(row.Total, number, sizeof(number), 10);
+		item += ',';
+		item += number;
+
+		text.clear();
+
+		for (size_t c = row.FirstCell; c < row.FirstCell + row.CellCount; ++c)
+		{
+			const CorePivotCell& cell = pivot.GetCell(c);
+
+			text.append(item, 1, std::string::npos);
+			AppendField(text, ((size_t)cell.Character < characters.size()) ? characters[cell.Character].Name : std::wstring());
+			AppendField(text, ((size_t)cell.Tab < tabs.size()) ? tabs[cell.Tab].DisplayName : std::wstring());
+			_i64toa_s(cell.Count, number, sizeof(number), 10);
+			text += ',';
+			text += number;
+			text += "\r\n";
+		}
+
+		success = file.Write(text.data(), text.size());
+	}
+
+	success = file.Close() && success;
+
+	if (!success)
+		::DeleteFileW(path.c_str());
+
+	return success;
+}
+
+static void AddColumnarRow(std::vector<unsigned int> *pValues, CoreColumnarDictionary *pDictionaries,
+						   unsigned int character, unsigned int location,
+						   const CoreItem &item, const SearchColumns &columns, size_t row)
+{
+	bool hasFields = row < columns.GetCount();
+
+	pValues[CORE_COLUMNAR_CHARACTER].push_back(character);
+	pValues[CORE_COLUMNAR_LOCATION].push_back(location);
+	pValues[CORE_COLUMNAR_ID].push_back((unsigned int)item.Id);
+	pValues[CORE_COLUMNAR_COUNT].push_back((unsigned int)item.Count);
+	pValues[CORE_COLUMNAR_NAME].push_back(pDictionaries[CORE_COLUMNAR_NAME].Add(item.Name));
+	pValues[CORE_COLUMNAR_ATTR].push_back(pDictionaries[CORE_COLUMNAR_ATTR].Add(item.Attr));
+	pValues[CORE_COLUMNAR_DESCRIPTION].push_back(pDictionaries[CORE_COLUMNAR_DESCRIPTION].Add(item.Description));
+	pValues[CORE_COLUMNAR_TYPE_TEXT].push_back(pDictionaries[CORE_COLUMNAR_TYPE_TEXT].Add(item.Slot));
+	pValues[CORE_COLUMNAR_RACES_TEXT].push_back(pDictionaries[CORE_COLUMNAR_RACES_TEXT].Add(item.Races));
+	pValues[CORE_COLUMNAR_LEVEL_TEXT].push_back(pDictionaries[CORE_COLUMNAR_LEVEL_TEXT].Add(item.Level));
+	pValues[CORE_COLUMNAR_JOBS_TEXT].push_back(pDictionaries[CORE_COLUMNAR_JOBS_TEXT].Add(item.Jobs));
+	pValues[CORE_COLUMNAR_REMARKS].push_back(pDictionaries[CORE_COLUMNAR_REMARKS].Add(item.Remarks));
+	pValues[CORE_COLUMNAR_CLASS].push_back(hasFields ? columns.Class[row] : 0);
+	pValues[CORE_COLUMNAR_JOBS].push_back(hasFields ? columns.Jobs[row] : 0);
+	pValues[CORE_COLUMNAR_SLOT].push_back(hasFields ? columns.Slot[row] : 0);
+	pValues[CORE_COLUMNAR_RACES].push_back(hasFields ? columns.Races[row] : 0);
+	pValues[CORE_COLUMNAR_FLAGS].push_back(hasFields ? columns.Flags[row] : 0);
+	pValues[CORE_COLUMNAR_SKILL].push_back(hasFields ? columns.Skill[row] : 0);
+	pValues[CORE_COLUMNAR_LEVEL].push_back(hasFields ? columns.Level[row] : 0);
+	pValues[CORE_COLUMNAR_ITEM_LEVEL].push_back(hasFields ? columns.ItemLevel[row] : 0);
+	pValues[CORE_COLUMNAR_DAMAGE].push_back(hasFields ? columns.Damage[row] : 0);
+	pValues[CORE_COLUMNAR_DELAY].push_back(hasFields ? columns.Delay[row] : 0);
+	pValues[CORE_COLUMNAR_DEFENSE].push_back(hasFields ? columns.Defense[row] : 0);
+}
+
+bool CoreApi::ExportColumnar(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const std::wstring& path,
+	CoreProgressObserver& observer,
+	size_t* pRowCount)
+{
+	if (pRowCount != NULL)
+		*pRowCount = 0;
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	ExportFile file;
+	if (!file.Create(path))
+		return false;
+
+	// only one group of rows and the dictionaries are held in memory
+	std::vector<unsigned int> values[CORE_COLUMNAR_COLUMN_COUNT];
+	CoreColumnarDictionary dictionaries[CORE_COLUMNAR_COLUMN_COUNT];
+	std::vector<unsigned long long> groupOffsets;
+	unsigned long long rowCount = 0;
+	const CoreCancelToken* pCancel = observer.GetCancelToken();
+	int total = (int)characters.size();
+	bool success = CoreColumnarWriteHeader(file);
+	bool canceled = false;
+
+	for (int i = 0; i < CORE_COLUMNAR_COLUMN_COUNT; ++i)
+		values[i].reserve(CORE_COLUMNAR_GROUP_ROWS);
+
+	observer.OnProgress(0, total);
+
+	for (int c = 0; c < total && success && !canceled; ++c)
+	{
+		const CachedInventory* pInventory = NULL;
+
+		if (!observer.IsCanceled())
+			pInventory = GetCachedInventory(settings, characters[c], tabs, pCancel, NULL);
+
+		if (pInventory == NULL)
+		{
+			canceled = true;
+			break;
+		}
+
+		unsigned int character = dictionaries[CORE_COLUMNAR_CHARACTER].Add(characters[c].Name);
+
+		for (size_t t = 0; t < pInventory->Tabs.size() && t < tabs.size() && success && !canceled; ++t)
+		{
+			const std::vector<CoreItem>& items = pInventory->Tabs[t].Items;
+			unsigned int location = dictionaries[CORE_COLUMNAR_LOCATION].Add(tabs[t].DisplayName);
+			size_t firstRow = (t < pInventory->TabOffsets.size()) ? pInventory->TabOffsets[t] : pInventory->Columns.GetCount();
+
+			for (size_t j = 0; j < items.size() && success; ++j)
+			{
+				if (pCancel != NULL && (j % CORE_EXPORT_CANCEL_INTERVAL) == 0 && pCancel->IsCanceled())
+				{
+					canceled = true;
+					break;
+				}
+
+				AddColumnarRow(values, dictionaries, character, location, items[j], pInventory->Columns, firstRow + j);
+				++rowCount;
+
+				if (values[0].size() == CORE_COLUMNAR_GROUP_ROWS)
+					success = CoreColumnarWriteGroup(file, values, groupOffsets);
+			}
+		}
+
+		observer.OnProgress(c + 1, total);
+	}
+
+	if (success && !canceled && !values[0].empty())
+		success = CoreColumnarWriteGroup(file, values, groupOffsets);
+
+	if (success && !canceled)
+		success = CoreColumnarWriteFooter(file, dictionaries, groupOffsets, rowCount);
+
+	success = file.Close() && success && !canceled;
+
+	// nothing is left of an export that didn't complete
+	if (!success)
+		::DeleteFileW(path.c_str());
+
+	if (pRowCount != NULL)
+		*pRowCount = (size_t)rowCount;
+
+	return success;
+}
@@ -0,0 +1,440 @@
+#include "CoreLua.h"
+
+#include <string.h>
+
+static bool IsDigit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+static bool IsNameStart(char ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+static bool IsNameChar(char ch)
+{
+	return IsNameStart(ch) || IsDigit(ch);
+}
+
+CoreLuaTokenizer::CoreLuaTokenizer(const char* pText, size_t length)
+	: m_pPos(pText), m_pEnd(pText + length), m_depth(0), m_error(false)
+{
+}
+
+bool CoreLuaTokenizer::Fail()
+{
+	m_error = true;
+	m_pPos = m_pEnd;
+
+	return false;
+}
+
+// whitespace, line comments and --[[ block comments ]]
+void CoreLuaTokenizer::SkipSpace()
+{
+	while (m_pPos < m_pEnd)
+	{
+		char ch = *m_pPos;
+
+		if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\f' || ch == '\v')
+		{
+			++m_pPos;
+			continue;
+		}
+
+		if (ch != '-' || m_pPos + 1 >= m_pEnd || m_pPos[1] != '-')
+			break;
+
+		m_pPos += 2;
+
+		if (m_pPos < m_pEnd && *m_pPos == '[')
+		{
+			CoreLuaSpan comment;
+			bool escaped;
+
+			if (ReadString(comment, escaped))
+				continue;
+		}
+
+		while (m_pPos < m_pEnd && *m_pPos != '\n')
+			++m_pPos;
+	}
+}
+
+// "text", 'text' or [[text]] with any level of =, m_pPos only moves past a complete string
+bool CoreLuaTokenizer::ReadString(CoreLuaSpan& span, bool& escaped)
+{
+	const char* pPos = m_pPos;
+	char quote = *pPos++;
+
+	escaped = false;
+
+	if (quote == '[')
+	{
+		int level = 0;
+
+		while (pPos < m_pEnd && *pPos == '=')
+		{
+			++level;
+			++pPos;
+		}
+
+		if (pPos >= m_pEnd || *pPos != '[')
+			return false;
+
+		++pPos;
+
+		// a newline right after the opening bracket isn't part of the string
+		if (pPos < m_pEnd && *pPos == '\r')
+			++pPos;
+		if (pPos < m_pEnd && *pPos == '\n')
+			++pPos;
+
+		for (const char* pClose = pPos; pClose < m_pEnd; ++pClose)
+		{
+			if (*pClose != ']')
+				continue;
+
+			const char* pLevel = pClose + 1;
+			int closeLevel = 0;
+
+			while (pLevel < m_pEnd && *pLevel == '=')
+			{
+				++closeLevel;
+				++pLevel;
+			}
+
+			if (closeLevel == level && pLevel < m_pEnd && *pLevel == ']')
+			{
+				span.pText = pPos;
+				span.Length = (size_t)(pClose - pPos);
+				m_pPos = pLevel + 1;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	for (const char* pClose = pPos; pClose < m_pEnd; ++pClose)
+	{
+		if (*pClose == '\\')
+		{
+			escaped = true;
+
+			if (++pClose >= m_pEnd)
+				break;
+
+			continue;
+		}
+
+		if (*pClose == quote)
+		{
+			span.pText = pPos;
+			span.Length = (size_t)(pClose - pPos);
+			m_pPos = pClose + 1;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// decimal, hexadecimal and exponents; the text is kept, CoreLuaToInt64 converts it when needed
+bool CoreLuaTokenizer::ReadNumber(CoreLuaSpan& span)
+{
+	const char* pPos = m_pPos;
+
+	if (pPos < m_pEnd && *pPos == '-')
+		++pPos;
+
+	const char* pDigits = pPos;
+
+	while (pPos < m_pEnd)
+	{
+		char ch = *pPos;
+
+		if (IsNameChar(ch) || ch == '.')
+			++pPos;
+		else if ((ch == '+' || ch == '-') && pPos > pDigits
+			&& (pPos[-1] == 'e' || pPos[-1] == 'E' || pPos[-1] == 'p' || pPos[-1] == 'P'))
+			++pPos;
+		else
+			break;
+	}
+
+	if (pPos == pDigits || !(IsDigit(*pDigits) || (*pDigits == '.' && pPos - pDigits > 1)))
+		return false;
+
+	span.pText = m_pPos;
+	span.Length = (size_t)(pPos - m_pPos);
+	m_pPos = pPos;
+
+	return true;
+}
+
+bool CoreLuaTokenizer::ReadName(CoreLuaSpan& span)
+{
+	const char* pPos = m_pPos;
+
+	if (pPos >= m_pEnd || !IsNameStart(*pPos))
+		return false;
+
+	while (pPos < m_pEnd && IsNameChar(*pPos))
+		++pPos;
+
+	span.pText = m_pPos;
+	span.Length = (size_t)(pPos - m_pPos);
+	m_pPos = pPos;
+
+	return true;
+}
+
+// name = or [key] =, the key stays empty in front of a positional value
+bool CoreLuaTokenizer::ReadKey(CoreLuaToken& token)
+{
+	char ch = *m_pPos;
+
+	if (ch == '[' && m_pPos + 1 < m_pEnd && m_pPos[1] != '[' && m_pPos[1] != '=')
+	{
+		++m_pPos;
+		SkipSpace();
+
+		if (m_pPos >= m_pEnd)
+			return false;
+
+		if (*m_pPos == '"' || *m_pPos == '\'')
+		{
+			if (!ReadString(token.Key, token.KeyEscaped))
+				return false;
+
+			token.KeyType = CORE_LUA_KEY_STRING;
+		}
+		else
+		{
+			if (!ReadNumber(token.Key))
+				return false;
+
+			token.KeyType = CORE_LUA_KEY_NUMBER;
+		}
+
+		SkipSpace();
+		if (m_pPos >= m_pEnd || *m_pPos != ']')
+			return false;
+
+		++m_pPos;
+		SkipSpace();
+		if (m_pPos >= m_pEnd || *m_pPos != '=')
+			return false;
+
+		++m_pPos;
+		return true;
+	}
+
+	if (IsNameStart(ch))
+	{
+		const char* pName = m_pPos;
+		CoreLuaSpan name;
+
+		ReadName(name);
+		SkipSpace();
+
+		if (m_pPos < m_pEnd && *m_pPos == '=' && (m_pPos + 1 >= m_pEnd || m_pPos[1] != '='))
+		{
+			++m_pPos;
+			token.KeyType = CORE_LUA_KEY_NAME;
+			token.Key = name;
+
+			return true;
+		}
+
+		// a name used as a value
+		m_pPos = pName;
+	}
+
+	return true;
+}
+
+bool CoreLuaTokenizer::Next(CoreLuaToken& token)
+{
+	for (;;)
+	{
+		token.Type = CORE_LUA_END;
+		token.KeyType = CORE_LUA_KEY_NONE;
+		token.Key.pText = NULL;
+		token.Key.Length = 0;
+		token.KeyEscaped = false;
+		token.Value.pText = NULL;
+		token.Value.Length = 0;
+		token.ValueEscaped = false;
+		token.Depth = m_depth;
+
+		if (m_error)
+			return false;
+
+		SkipSpace();
+
+		// the separators are optional, like the trailing one of a table
+		while (m_pPos < m_pEnd && (*m_pPos == ',' || *m_pPos == ';'))
+		{
+			++m_pPos;
+			SkipSpace();
+		}
+
+		if (m_pPos >= m_pEnd)
+			return (m_depth == 0) ? false : Fail();
+
+		if (*m_pPos == '}')
+		{
+			if (m_depth == 0)
+				return Fail();
+
+			++m_pPos;
+			token.Type = CORE_LUA_TABLE_END;
+			--m_depth;
+
+			return true;
+		}
+
+		if (!ReadKey(token))
+			return Fail();
+
+		SkipSpace();
+
+		if (m_pPos >= m_pEnd)
+			return Fail();
+
+		char ch = *m_pPos;
+
+		if (ch == '{')
+		{
+			++m_pPos;
+			++m_depth;
+			token.Type = CORE_LUA_TABLE_BEGIN;
+
+			return true;
+		}
+
+		if (ch == '"' || ch == '\'' || ch == '[')
+		{
+			if (!ReadString(token.Value, token.ValueEscaped))
+				return Fail();
+
+			token.Type = CORE_LUA_STRING;
+
+			return true;
+		}
+
+		if (ch == '-' || ch == '.' || IsDigit(ch))
+		{
+			if (!ReadNumber(token.Value))
+				return Fail();
+
+			token.Type = CORE_LUA_NUMBER;
+
+			return true;
+		}
+
+		if (!ReadName(token.Value))
+			return Fail();
+
+		// return in front of the values of the file
+		if (m_depth == 0 && token.KeyType == CORE_LUA_KEY_NONE && CoreLuaEquals(token.Value, "return"))
+			continue;
+
+		token.Type = CORE_LUA_NAME;
+
+		return true;
+	}
+}
+
+bool CoreLuaEquals(const CoreLuaSpan& span, const char* pText)
+{
+	size_t length = strlen(pText);
+
+	return span.Length == length && memcmp(span.pText, pText, length) == 0;
+}
+
+bool CoreLuaToInt64(const CoreLuaSpan& span, long long& value)
+{
+	const char* pPos = span.pText;
+	const char* pEnd = span.pText + span.Length;
+	bool negative = false;
+	unsigned long long result = 0;
+
+	value = 0;
+
+	if (pPos < pEnd && *pPos == '-')
+	{
+		negative = true;
+		++pPos;
+	}
+
+	if (pPos >= pEnd || !IsDigit(*pPos))
+		return false;
+
+	while (pPos < pEnd && IsDigit(*pPos))
+		result = result * 10 + (unsigned long long)(*pPos++ - '0');
+
+	value = negative ? -(long long)result : (long long)result;
+
+	return true;
+}
+
+void CoreLuaUnescape(const CoreLuaSpan& span, std::string& out)
+{
+	const char* pPos = span.pText;
+	const char* pEnd = span.pText + span.Length;
+
+	out.clear();
+	out.reserve(span.Length);
+
+	while (pPos < pEnd)
+	{
+		const char* pEscape = (const char*)memchr(pPos, '\\', (size_t)(pEnd - pPos));
+
+		if (pEscape == NULL)
+		{
+			out.append(pPos, pEnd);
+			break;
+		}
+
+		out.append(pPos, pEscape);
+		pPos = pEscape + 1;
+
+		if (pPos >= pEnd)
+			break;
+
+		char ch = *pPos++;
+
+		switch (ch)
+		{
+		case 'n':
+			out.push_back('\n');
+			break;
+		case 'r':
+			out.push_back('\r');
+			break;
+		case 't':
+			out.push_back('\t');
+			break;
+		default:
+			if (IsDigit(ch))
+			{
+				// \ddd, the byte in decimal
+				int code = ch - '0';
+
+				for (int i = 0; i < 2 && pPos < pEnd && IsDigit(*pPos); ++i)
+					code = code * 10 + (*pPos++ - '0');
+
+				out.push_back((char)code);
+			}
+			else
+				out.push_back(ch);
+			break;
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+
+// a piece of the text being tokenized, not terminated
+struct CoreLuaSpan
+{
+	const char *pText;
+	size_t Length;
+};
+
+enum CORE_LUA_TOKEN
+{
+	CORE_LUA_END = 0,
+	CORE_LUA_TABLE_BEGIN,
+	CORE_LUA_TABLE_END,
+	CORE_LUA_STRING,
+	CORE_LUA_NUMBER,
+	// true, false, nil or any other identifier used as a value
+	CORE_LUA_NAME
+};
+
+enum CORE_LUA_KEY
+{
+	// positional value, or the end of a table
+	CORE_LUA_KEY_NONE = 0,
+	// name = value
+	CORE_LUA_KEY_NAME,
+	// ["text"] = value
+	CORE_LUA_KEY_STRING,
+	// [12] = value
+	CORE_LUA_KEY_NUMBER
+};
+
+// a value of a table with its key; the spans point into the text, the strings without their quotes
+// and still escaped when Escaped is set
+struct CoreLuaToken
+{
+	CORE_LUA_TOKEN Type;
+	CORE_LUA_KEY KeyType;
+	CoreLuaSpan Key;
+	bool KeyEscaped;
+	CoreLuaSpan Value;
+	bool ValueEscaped;
+	// depth of the table holding the value, 0 outside of any table;
+	// the end of a table has the depth of its values
+	int Depth;
+};
+
+// Single pass over the data files of the Lua addons (FindAll, the resources of Windower):
+// a sequence of values optionally preceded by return, the values being numbers, strings,
+// names and tables nested to any depth. Nothing is copied, the tokens point into the text.
+class CoreLuaTokenizer
+{
+public:
+	CoreLuaTokenizer(const char *pText, size_t length);
+
+	// false at the end of the text or on a syntax error
+	bool Next(CoreLuaToken &token);
+	bool HasError() const { return m_error; }
+	int GetDepth() const { return m_depth; }
+
+private:
+	void SkipSpace();
+	bool ReadString(CoreLuaSpan &span, bool &escaped);
+	bool ReadNumber(CoreLuaSpan &span);
+	bool ReadName(CoreLuaSpan &span);
+	bool ReadKey(CoreLuaToken &token);
+	bool Fail();
+
+	const char *m_pPos;
+	const char *m_pEnd;
+	int m_depth;
+	bool m_error;
+};
+
+bool CoreLuaEquals(const CoreLuaSpan &span, const char *pText);
+// integral part of a decimal number, false if the span doesn't start with one
+bool CoreLuaToInt64(const CoreLuaSpan &span, long long &value);
+// the text of a string token, escapes decoded
+void CoreLuaUnescape(const CoreLuaSpan &span, std::string &out);
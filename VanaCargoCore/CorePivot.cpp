@@ -0,0 +1,197 @@
+#include "stdafx.h"
+#include "CorePivot.h"
+
+#include <algorithm>
+#include <string.h>
+
+// set in the item key of the key items
+#define CORE_PIVOT_KEY_ITEM 0x80000000u
+
+// item key in the high 32 bits, then 16 bits of character and 16 bits of bag:
+// sorting the keys groups the cells of an item in character and bag order
+static unsigned long long PackCell(unsigned int key, int character, int tab)
+{
+	return ((unsigned long long)key << 32)
+		| ((unsigned long long)(character & 0xFFFF) << 16)
+		| (unsigned long long)(tab & 0xFFFF);
+}
+
+// the largest totals first, then by name and ID
+static bool IsBeforeRow(const CorePivotRow& left, const CorePivotRow& right)
+{
+	if (left.Total != right.Total)
+		return left.Total > right.Total;
+
+	int result = _wcsicmp(left.Name.c_str(), right.Name.c_str());
+
+	if (result != 0)
+		return result < 0;
+
+	if (left.KeyItem != right.KeyItem)
+		return right.KeyItem;
+
+	return left.ItemId < right.ItemId;
+}
+
+void CorePivot::Reset(const std::vector<InventoryTabInfo>& tabs)
+{
+	m_counts.clear();
+	m_names.clear();
+	m_rows.clear();
+	m_cells.clear();
+	m_keyItemTabs.resize(tabs.size());
+
+	for (size_t i = 0; i < tabs.size(); ++i)
+		m_keyItemTabs[i] = (tabs[i].FileName == L"__FINDALL_KEYITEMS__");
+}
+
+void CorePivot::Add(int character, int tab, const CoreItem& item)
+{
+	unsigned int key = (unsigned int)item.Id & ~CORE_PIVOT_KEY_ITEM;
+
+	if (tab >= 0 && (size_t)tab < m_keyItemTabs.size() && m_keyItemTabs[tab])
+		key |= CORE_PIVOT_KEY_ITEM;
+
+	// the key items and the items that don't stack have no count
+	m_counts[PackCell(key, character, tab)] += (item.Count > 0) ? item.Count : 1;
+
+	if (m_names.find(key) == m_names.end())
+		m_names.insert(std::make_pair(key, item.Name));
+}
+
+void CorePivot::Add(const std::vector<CoreSearchHit>& hits)
+{
+	for (size_t i = 0; i < hits.size(); ++i)
+		Add(hits[i].Character, hits[i].Tab, *hits[i].pItem);
+}
+
+void CorePivot::Build()
+{
+	std::vector<std::pair<unsigned long long, long long>> cells(m_counts.begin(), m_counts.end());
+	unsigned int rowKey = 0;
+
+	std::sort(cells.begin(), cells.end());
+
+	m_rows.clear();
+	m_cells.clear();
+	m_cells.reserve(cells.size());
+
+	for (size_t i = 0; i < cells.size(); ++i)
+	{
+		unsigned int key = (unsigned int)(cells[i].first >> 32);
+		CorePivotCell cell;
+
+		cell.Character = (int)((cells[i].first >> 16) & 0xFFFF);
+		cell.Tab = (int)(cells[i].first & 0xFFFF);
+		cell.Count = cells[i].second;
+
+		if (m_rows.empty() || key != rowKey)
+		{
+			CorePivotRow row;
+
+			row.ItemId = (int)(key & ~CORE_PIVOT_KEY_ITEM);
+			row.KeyItem = (key & CORE_PIVOT_KEY_ITEM) != 0;
+			row.Name = m_names[key];
+			row.Total = 0;
+			row.Characters = 0;
+			row.FirstCell = m_cells.size();
+			row.CellCount = 0;
+
+			m_rows.push_back(row);
+			rowKey = key;
+		}
+
+		CorePivotRow& row = m_rows.back();
+
+		if (row.CellCount == 0 || m_cells.back().Character != cell.Character)
+			++row.Characters;
+
+		row.Total += cell.Count;
+		++row.CellCount;
+		m_cells.push_back(cell);
+	}
+
+	// the rows keep the range of their cells
+	std::sort(m_rows.begin(), m_rows.end(), IsBeforeRow);
+
+	m_counts.clear();
+	m_names.clear();
+}
+
+bool CoreApi::Aggregate(const CoreSettings& settings,
+	const std::vector<CharacterInfo>& characters,
+	const std::vector<InventoryTabInfo>& tabs,
+	const std::wstring& filter,
+	bool isQuery,
+	CorePivot& pivot,
+	CoreProgressObserver& observer,
+	std::wstring& error)
+{
+	bool success = true;
+
+	pivot.Reset(tabs);
+	error.clear();
+
+	if (settings.FfxiPath.empty())
+		return false;
+
+	if (!filter.empty())
+	{
+		// the search selects the rows, only its hits are counted
+		CorePivotObserver pivotObserver(pivot, observer);
+
+		if (isQuery)
+		{
+			std::wstring explain;
+
+			success = RunQuery(settings, characters, tabs, filter, pivotObserver, explain, error);
+		}
+		else
+		{
+			CoreSearchQuery query;
+
+			query.Term = filter;
+			memset(&query.Criteria, 0, sizeof(query.Criteria));
+			query.Fuzzy = false;
+
+			success = Search(settings, characters, tabs, query, pivotObserver);
+		}
+	}
+	else
+	{
+		int total = (int)characters.size();
+
+		observer.OnProgress(0, total);
+
+		for (int c = 0; c < total && success; ++c)
+		{
+			const CachedInventory* pInventory = NULL;
+
+			if (!observer.IsCanceled())
+				pInventory = GetCachedInventory(settings, characters[c], tabs, observer.GetCancelToken(), NULL);
+
+			if (pInventory == NULL)
+			{
+				success = false;
+				break;
+			}
+
+			for (size_t t = 0; t < pInventory->Tabs.size() && t < tabs.size(); ++t)
+			{
+				const std::vector<CoreItem>& items = pInventory->Tabs[t].Items;
+
+				for (size_t i = 0; i < items.size(); ++i)
+					pivot.Add(c, (int)t, items[i]);
+			}
+
+			observer.OnProgress(c + 1, total);
+		}
+	}
+
+	if (!success || observer.IsCanceled())
+		return false;
+
+	pivot.Build();
+
+	return true;
+}
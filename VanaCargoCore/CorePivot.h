@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CoreApi.h"
+
+// count of an item in one bag of one character, indices into the lists passed to CoreApi::Aggregate
+struct CorePivotCell
+{
+	int Character;
+	int Tab;
+	long long Count;
+};
+
+// an item of the pivot, its cells are [FirstCell, FirstCell + CellCount) ordered by character then bag
+struct CorePivotRow
+{
+	int ItemId;
+	bool KeyItem;
+	std::wstring Name;
+	long long Total;
+	// number of characters owning the item
+	int Characters;
+	size_t FirstCell;
+	size_t CellCount;
+};
+
+// "who has what": the items of the inventories grouped by item, then by character and bag.
+// The counts are summed in a hash table keyed by (item, character, bag) packed in 64 bits,
+// Build turns it into rows sorted by total
+class CorePivot
+{
+public:
+	void Reset(const std::vector<InventoryTabInfo> &tabs);
+	void Add(int character, int tab, const CoreItem &item);
+	void Add(const std::vector<CoreSearchHit> &hits);
+	void Build();
+
+	size_t GetRowCount() const { return m_rows.size(); }
+	const CorePivotRow& GetRow(size_t row) const { return m_rows[row]; }
+	const CorePivotCell& GetCell(size_t cell) const { return m_cells[cell]; }
+	size_t GetCellCount() const { return m_cells.size(); }
+
+private:
+	std::unordered_map<unsigned long long, long long> m_counts;
+	// name of each item key, the first one seen
+	std::unordered_map<unsigned int, std::wstring> m_names;
+	// the key items have their own IDs, they are kept apart from the items with the same ID
+	std::vector<bool> m_keyItemTabs;
+	std::vector<CorePivotRow> m_rows;
+	std::vector<CorePivotCell> m_cells;
+};
+
+// forwards the progress of the search filtering a pivot and adds its hits to it
+class CorePivotObserver : public CoreSearchObserver
+{
+public:
+	CorePivotObserver(CorePivot &pivot, CoreProgressObserver &observer)
+		: m_pivot(pivot), m_observer(observer)
+	{
+		SetCancelToken(observer.GetCancelToken());
+	}
+
+	virtual bool IsCanceled() { return m_observer.IsCanceled(); }
+	virtual void OnProgress(int completed, int total) { m_observer.OnProgress(completed, total); }
+	virtual void OnHits(const std::vector<CoreSearchHit> &hits) { m_pivot.Add(hits); }
+
+private:
+	CorePivot &m_pivot;
+	CoreProgressObserver &m_observer;
+};
@@ -0,0 +1,285 @@
+#include "CoreResultCursor.h"
+
+#include <algorithm>
+#include <wctype.h>
+
+// number of characters of a text packed into its sort key
+#define CORE_SORT_KEY_CHARS 4
+
+static const std::wstring* GetSortText(const CoreItem& item, int column)
+{
+	switch (column)
+	{
+		case CORE_SORT_NAME: return &item.Name;
+		case CORE_SORT_DESCRIPTION: return &item.Description;
+		case CORE_SORT_ATTR: return &item.Attr;
+		case CORE_SORT_SLOT: return &item.Slot;
+		case CORE_SORT_RACES: return &item.Races;
+		case CORE_SORT_LEVEL: return &item.Level;
+		case CORE_SORT_JOBS: return &item.Jobs;
+		case CORE_SORT_REMARKS: return &item.Remarks;
+		default: return NULL;
+	}
+}
+
+static unsigned short FoldSortChar(wchar_t value)
+{
+	return (unsigned short)towlower(value);
+}
+
+// case-insensitive comparison of two texts from the given position
+static int CompareSortText(const std::wstring& left, const std::wstring& right, size_t start)
+{
+	for (size_t i = start; i < left.size() && i < right.size(); ++i)
+	{
+		unsigned short l = FoldSortChar(left[i]);
+		unsigned short r = FoldSortChar(right[i]);
+
+		if (l != r)
+			return (l < r) ? -1 : 1;
+	}
+
+	if (left.size() == right.size())
+		return 0;
+
+	return (left.size() < right.size()) ? -1 : 1;
+}
+
+// names sorted case-insensitively, ranks[i] is the position of names[i]
+static void RankNames(const std::vector<std::wstring>& names, std::vector<unsigned int>& ranks)
+{
+	std::vector<std::pair<std::wstring, unsigned int>> sorted(names.size());
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		sorted[i].first = names[i];
+		std::transform(sorted[i].first.begin(), sorted[i].first.end(), sorted[i].first.begin(), towlower);
+		sorted[i].second = (unsigned int)i;
+	}
+
+	std::sort(sorted.begin(), sorted.end());
+	ranks.resize(names.size());
+
+	for (size_t i = 0; i < sorted.size(); ++i)
+		ranks[sorted[i].second] = (unsigned int)i;
+}
+
+// orders two rows by their keys, the texts only when their first characters are the same
+struct CoreResultCursor::RowLess
+{
+	RowLess(const CoreResultCursor& cursor) : m_cursor(cursor) {}
+
+	bool operator()(unsigned int left, unsigned int right) const
+	{
+		unsigned long long leftKey = m_cursor.m_keys[left];
+		unsigned long long rightKey = m_cursor.m_keys[right];
+
+		if (leftKey != rightKey)
+			return leftKey < rightKey;
+
+		const std::wstring* pLeft = GetSortText(*m_cursor.m_hits[left].pItem, m_cursor.m_column);
+		const std::wstring* pRight = GetSortText(*m_cursor.m_hits[right].pItem, m_cursor.m_column);
+
+		if (pLeft != NULL && pRight != NULL && m_cursor.m_column != CORE_SORT_LEVEL)
+		{
+			int result = CompareSortText(*pLeft, *pRight, CORE_SORT_KEY_CHARS);
+
+			if (result != 0)
+				return m_cursor.m_descending ? result > 0 : result < 0;
+		}
+
+		// equal rows keep the search order
+		return left < right;
+	}
+
+	const CoreResultCursor& m_cursor;
+};
+
+void CoreResultCursor::Reset(const std::vector<CharacterInfo>& characters, const std::vector<InventoryTabInfo>& tabs)
+{
+	std::vector<std::wstring> names(characters.size());
+
+	m_hits.clear();
+	m_order.clear();
+	m_keys.clear();
+	m_column = CORE_SORT_NONE;
+	m_descending = false;
+	m_sorted = 0;
+	m_stale = false;
+	m_characterIds.resize(characters.size());
+	m_generations.assign(characters.size(), 0);
+
+	for (size_t i = 0; i < characters.size(); ++i)
+	{
+		m_characterIds[i] = characters[i].Id;
+		names[i] = characters[i].Name;
+	}
+
+	RankNames(names, m_characterRanks);
+
+	names.resize(tabs.size());
+	for (size_t i = 0; i < tabs.size(); ++i)
+		names[i] = tabs[i].DisplayName;
+
+	RankNames(names, m_tabRanks);
+}
+
+void CoreResultCursor::Add(const std::vector<CoreSearchHit>& hits)
+{
+	m_hits.insert(m_hits.end(), hits.begin(), hits.end());
+}
+
+// records the inventories the hits point into, called once the search is over
+void CoreResultCursor::Seal(const CoreApi& api)
+{
+	std::fill(m_generations.begin(), m_generations.end(), 0);
+
+	for (size_t i = 0; i < m_hits.size(); ++i)
+	{
+		unsigned int& generation = m_generations[m_hits[i].Character];
+
+		if (generation == 0)
+			generation = api.GetGeneration(m_characterIds[m_hits[i].Character]);
+	}
+
+	m_order.resize(m_hits.size());
+	for (size_t i = 0; i < m_order.size(); ++i)
+		m_order[i] = (unsigned int)i;
+
+	m_sorted = m_order.size();
+}
+
+// false once the inventory of one of the characters was reloaded, the items of the hits are gone
+bool CoreResultCursor::IsValid(const CoreApi& api) const
+{
+	if (m_stale)
+		return false;
+
+	for (size_t i = 0; i < m_generations.size(); ++i)
+	{
+		if (m_generations[i] != 0 && api.GetGeneration(m_characterIds[i]) != m_generations[i])
+			return false;
+	}
+
+	return true;
+}
+
+// drops the hits once they are no longer valid, no sort key is read from a freed item
+bool CoreResultCursor::Revalidate(const CoreApi& api)
+{
+	if (IsValid(api))
+		return true;
+
+	m_hits.clear();
+	m_order.clear();
+	m_keys.clear();
+	m_sorted = 0;
+	m_stale = true;
+
+	return false;
+}
+
+unsigned long long CoreResultCursor::GetSortKey(const CoreSearchHit& hit) const
+{
+	switch (m_column)
+	{
+		case CORE_SORT_CHARACTER:
+			return m_characterRanks[hit.Character];
+		case CORE_SORT_LOCATION:
+			return m_tabRanks[hit.Tab];
+		case CORE_SORT_COUNT:
+			return (unsigned long long)((long long)hit.pItem->Count + 0x80000000LL);
+		case CORE_SORT_ID:
+			return (unsigned long long)((long long)hit.pItem->Id + 0x80000000LL);
+		case CORE_SORT_LEVEL:
+		{
+			// the first number of the text, "Lv.9" comes before "Lv.10"
+			const std::wstring& level = hit.pItem->Level;
+			size_t start = level.find_first_of(L"0123456789");
+			unsigned long long value = 0;
+
+			for (size_t i = start; i < level.size() && iswdigit(level[i]) && value < 0xFFFFFFFF; ++i)
+				value = value * 10 + (level[i] - L'0');
+
+			return (start == std::wstring::npos) ? 0 : value + 1;
+		}
+		default:
+		{
+			// the first characters packed in order, the rest is only compared on a tie
+			const std::wstring* pText = GetSortText(*hit.pItem, m_column);
+			unsigned long long key = 0;
+
+			for (size_t i = 0; i < CORE_SORT_KEY_CHARS; ++i)
+				key = (key << 16) | ((pText != NULL && i < pText->size()) ? FoldSortChar((*pText)[i]) : 0);
+
+			return key;
+		}
+	}
+}
+
+// orders the rows on one of CORE_SORT_COLUMN, they are only sorted when a page asks for them
+bool CoreResultCursor::Sort(const CoreApi& api, int column, bool descending)
+{
+	if (!Revalidate(api))
+		return false;
+
+	m_column = column;
+	m_descending = descending;
+	m_order.resize(m_hits.size());
+
+	for (size_t i = 0; i < m_order.size(); ++i)
+		m_order[i] = (unsigned int)i;
+
+	if (column == CORE_SORT_NONE)
+	{
+		if (descending)
+			std::reverse(m_order.begin(), m_order.end());
+
+		m_keys.clear();
+		m_sorted = m_order.size();
+
+		return true;
+	}
+
+	m_keys.resize(m_hits.size());
+
+	for (size_t i = 0; i < m_hits.size(); ++i)
+	{
+		m_keys[i] = GetSortKey(m_hits[i]);
+
+		if (descending)
+			m_keys[i] = ~m_keys[i];
+	}
+
+	m_sorted = 0;
+
+	return true;
+}
+
+// copies the hits shown at rows [offset, offset + count), fewer past the end
+bool CoreResultCursor::GetPage(const CoreApi& api, size_t offset, size_t count, std::vector<CoreSearchHit>& page)
+{
+	page.clear();
+
+	if (!Revalidate(api))
+		return false;
+
+	size_t end = (offset < m_order.size()) ? std::min(m_order.size(), offset + count) : offset;
+
+	if (offset >= end)
+		return true;
+
+	// the rows up to m_sorted are final, sort just enough of the others to reach the end of the page
+	if (end > m_sorted)
+	{
+		std::partial_sort(m_order.begin() + m_sorted, m_order.begin() + end, m_order.end(), RowLess(*this));
+		m_sorted = end;
+	}
+
+	page.reserve(end - offset);
+
+	for (size_t i = offset; i < end; ++i)
+		page.push_back(m_hits[m_order[i]]);
+
+	return true;
+}
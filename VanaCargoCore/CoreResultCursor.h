@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CoreApi.h"
+
+// columns a cursor can be sorted on, CORE_SORT_NONE keeps the search order
+enum CORE_SORT_COLUMN
+{
+	CORE_SORT_NONE = 0,
+	CORE_SORT_CHARACTER,
+	CORE_SORT_LOCATION,
+	CORE_SORT_COUNT,
+	CORE_SORT_NAME,
+	CORE_SORT_DESCRIPTION,
+	CORE_SORT_ATTR,
+	CORE_SORT_SLOT,
+	CORE_SORT_RACES,
+	CORE_SORT_LEVEL,
+	CORE_SORT_JOBS,
+	CORE_SORT_REMARKS,
+	CORE_SORT_ID
+};
+
+// the results of a search kept natively: the frontends only fetch the page they display,
+// sorting orders the rows up to the last page requested and leaves the rest unsorted
+class CoreResultCursor
+{
+public:
+	CoreResultCursor() : m_column(CORE_SORT_NONE), m_descending(false), m_sorted(0), m_stale(false) {}
+
+	void Reset(const std::vector<CharacterInfo> &characters, const std::vector<InventoryTabInfo> &tabs);
+	void Add(const std::vector<CoreSearchHit> &hits);
+	void Seal(const CoreApi &api);
+	bool IsValid(const CoreApi &api) const;
+
+	size_t GetCount() const { return m_hits.size(); }
+	int GetSortColumn() const { return m_column; }
+	bool IsDescending() const { return m_descending; }
+
+	// both read the items of the hits: false once IsValid fails, the hits are then dropped
+	bool Sort(const CoreApi &api, int column, bool descending);
+	bool GetPage(const CoreApi &api, size_t offset, size_t count, std::vector<CoreSearchHit> &page);
+
+private:
+	struct RowLess;
+
+	unsigned long long GetSortKey(const CoreSearchHit &hit) const;
+	bool Revalidate(const CoreApi &api);
+
+	std::vector<CoreSearchHit> m_hits;
+	// m_order[i] is the hit shown at row i, only the first m_sorted rows are in order
+	std::vector<unsigned int> m_order;
+	std::vector<unsigned long long> m_keys;
+	int m_column;
+	bool m_descending;
+	size_t m_sorted;
+	// position of each character and tab once sorted by name
+	std::vector<unsigned int> m_characterRanks;
+	std::vector<unsigned int> m_tabRanks;
+	std::vector<std::wstring> m_characterIds;
+	// inventory generation of each character when the hits were collected, 0 without hits
+	std::vector<unsigned int> m_generations;
+	// the hits were dropped after a reload of one of the inventories
+	bool m_stale;
+};
+
+// forwards the progress of a search and collects its hits into a cursor
+class CoreCursorObserver : public CoreSearchObserver
+{
+public:
+	CoreCursorObserver(CoreResultCursor &cursor, CoreSearchObserver &observer)
+		: m_cursor(cursor), m_observer(observer)
+	{
+		SetCancelToken(observer.GetCancelToken());
+	}
+
+	virtual bool IsCanceled() { return m_observer.IsCanceled(); }
+	virtual void OnProgress(int completed, int total) { m_observer.OnProgress(completed, total); }
+	virtual void OnHits(const std::vector<CoreSearchHit> &hits) { m_cursor.Add(hits); }
+
+private:
+	CoreResultCursor &m_cursor;
+	CoreSearchObserver &m_observer;
+};
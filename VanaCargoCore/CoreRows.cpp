@@ -0,0 +1,71 @@
+#include "CoreRows.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+void CoreRowIndex::Add(int record, int count, bool compact)
+{
+	CoreRow row;
+
+	row.Record = record;
+	row.Count = 1;
+
+	if (compact && count > 1)
+	{
+		row.Count = count;
+		m_rows.push_back(row);
+		return;
+	}
+
+	for (int i = 0; i < count; ++i)
+		m_rows.push_back(row);
+}
+
+int CoreRowIndex::Find(int record) const
+{
+	for (size_t i = 0; i < m_rows.size(); ++i)
+	{
+		if (m_rows[i].Record == record)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+void CoreCopyCellText(const wchar_t *pText, wchar_t *pBuffer, size_t size)
+{
+	if (pBuffer == NULL || size == 0)
+		return;
+
+	size_t length = (pText != NULL) ? wcslen(pText) : 0;
+
+	if (length >= size)
+		length = size - 1;
+
+	if (length > 0)
+		wmemcpy(pBuffer, pText, length);
+
+	pBuffer[length] = 0;
+}
+
+void CoreFormatCellCount(const wchar_t *pText, int count, wchar_t *pBuffer, size_t size)
+{
+	wchar_t suffix[16];
+
+	if (pBuffer == NULL || size == 0)
+		return;
+
+	CoreCopyCellText(pText, pBuffer, size);
+
+	int suffixLength = swprintf(suffix, sizeof(suffix) / sizeof(suffix[0]), L" (%d)", count);
+	size_t length = wcslen(pBuffer);
+
+	// the count is kept whole: a truncated name reads better than a truncated count
+	if (suffixLength <= 0 || (size_t)suffixLength >= size)
+		return;
+
+	if (length + (size_t)suffixLength >= size)
+		length = size - 1 - (size_t)suffixLength;
+
+	wmemcpy(pBuffer + length, suffix, (size_t)suffixLength + 1);
+}
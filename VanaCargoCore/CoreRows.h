@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+// what a virtual list shows: the control keeps no text and asks for the cells it paints
+class CoreRowProvider
+{
+public:
+	virtual ~CoreRowProvider() {}
+
+	virtual int GetRowCount() const = 0;
+	// copies the text of a cell, truncated to the size of the buffer and always terminated
+	virtual void GetCellText(int row, int column, wchar_t *pBuffer, size_t size) const = 0;
+	// index of the icon of the row in the image list of the control, -1 without one
+	virtual int GetRowIcon(int row) const = 0;
+};
+
+// a record shown by a list, Count > 1 on the single row of a record listed with its count
+struct CoreRow
+{
+	int Record;
+	int Count;
+};
+
+// rows of the records of a provider: adding a record only appends to a vector,
+// sorting moves the rows and leaves the records in place
+class CoreRowIndex
+{
+public:
+	void Clear() { m_rows.clear(); }
+	void Reserve(size_t count) { m_rows.reserve(count); }
+	// a single row with the count when compact, count identical rows otherwise
+	void Add(int record, int count, bool compact);
+
+	int GetCount() const { return (int)m_rows.size(); }
+	const CoreRow& GetRow(int row) const { return m_rows[(size_t)row]; }
+	// first row of a record, -1 if it isn't listed
+	int Find(int record) const;
+
+	// compare(left, right) orders two records like strcmp, the rows comparing equal keep their order
+	template <typename Compare> void Sort(Compare compare)
+	{
+		std::stable_sort(m_rows.begin(), m_rows.end(), [&compare](const CoreRow &left, const CoreRow &right)
+		{
+			return compare(left.Record, right.Record) < 0;
+		});
+	}
+
+private:
+	std::vector<CoreRow> m_rows;
+};
+
+// copies a text into the buffer of a cell, truncated and always terminated
+void CoreCopyCellText(const wchar_t *pText, wchar_t *pBuffer, size_t size);
+// the text followed by the count: "Name (3)"
+void CoreFormatCellCount(const wchar_t *pText, int count, wchar_t *pBuffer, size_t size);
@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "CoreSession.h"
+
+#include "FFXIHelper.h"
+
+void CoreSession::CollectConfigStamps(const std::wstring& configPath, const CoreSettings& settings,
+	std::vector<CoreFileStamp>& stamps)
+{
+	stamps.clear();
+	stamps.push_back(GetFileStamp(configPath));
+
+	// a new character adds a folder, which changes the write time of USER
+	if (!settings.FfxiPath.empty())
+		stamps.push_back(GetFileStamp(settings.FfxiPath + L"\\" + FFXI_PATH_USER_DATA));
+
+	// and a new FindAll dump adds a character
+	if (settings.FindAllEnabled && !settings.FindAllDataPath.empty())
+		stamps.push_back(GetFileStamp(settings.FindAllDataPath));
+}
+
+static bool IsSameConfigStamps(const std::vector<CoreFileStamp>& lhs, const std::vector<CoreFileStamp>& rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (size_t i = 0; i < lhs.size(); ++i)
+	{
+		if (lhs[i].WriteTime != rhs[i].WriteTime || lhs[i].Size != rhs[i].Size)
+			return false;
+	}
+
+	return true;
+}
+
+bool CoreSession::LoadConfig(const std::wstring& configPath)
+{
+	if (m_loaded && configPath == m_configPath)
+	{
+		std::vector<CoreFileStamp> stamps;
+		CollectConfigStamps(configPath, m_settings, stamps);
+
+		if (IsSameConfigStamps(stamps, m_stamps))
+			return true;
+	}
+
+	m_configPath = configPath;
+	m_loaded = m_api.LoadConfig(configPath, m_settings, m_tabs, m_characters);
+
+	if (m_loaded)
+		CollectConfigStamps(configPath, m_settings, m_stamps);
+
+	return m_loaded;
+}
+
+// the next load parses the config again, a write within the resolution of the write time keeps its stamp
+bool CoreSession::SaveSettings(const std::wstring& configPath, const CoreSettings& settings)
+{
+	m_loaded = false;
+
+	return m_api.SaveSettings(configPath, settings);
+}
+
+bool CoreSession::SaveCharacterDisplayNames(const std::wstring& configPath,
+	const std::vector<std::pair<std::wstring, std::wstring>>& entries)
+{
+	m_loaded = false;
+
+	return m_api.SaveCharacterDisplayNames(configPath, entries);
+}
+
+// the config stays parsed, only the decoded data is dropped
+void CoreSession::ClearCache()
+{
+	m_api.ClearCache();
+}
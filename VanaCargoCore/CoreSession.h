@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CoreApi.h"
+
+// state kept by a frontend for as long as it runs: the parsed config and a CoreApi whose caches
+// (open DAT files, decoded inventories, icons, item catalog, search results) are shared by all its windows
+class CoreSession
+{
+public:
+	CoreSession() : m_loaded(false) {}
+
+	// parses the config and lists the characters, unless neither the file nor the character folders changed
+	bool LoadConfig(const std::wstring &configPath);
+	bool SaveSettings(const std::wstring &configPath, const CoreSettings &settings);
+	bool SaveCharacterDisplayNames(const std::wstring &configPath,
+		const std::vector<std::pair<std::wstring, std::wstring>> &entries);
+
+	const CoreSettings& GetSettings() const { return m_settings; }
+	const std::vector<InventoryTabInfo>& GetTabs() const { return m_tabs; }
+	const std::vector<CharacterInfo>& GetCharacters() const { return m_characters; }
+
+	CoreApi& GetApi() { return m_api; }
+	const CoreApi& GetApi() const { return m_api; }
+
+	void GetMemoryStats(CoreMemoryStats &stats) const { m_api.GetMemoryStats(stats); }
+	void EvictInventory(const std::wstring &characterId) { m_api.EvictInventory(characterId); }
+	void ClearCache();
+
+private:
+	static void CollectConfigStamps(const std::wstring &configPath, const CoreSettings &settings,
+		std::vector<CoreFileStamp> &stamps);
+
+	std::wstring m_configPath;
+	bool m_loaded;
+	// config file and folder of the characters when the config was parsed
+	std::vector<CoreFileStamp> m_stamps;
+	CoreSettings m_settings;
+	std::vector<InventoryTabInfo> m_tabs;
+	std::vector<CharacterInfo> m_characters;
+	CoreApi m_api;
+};
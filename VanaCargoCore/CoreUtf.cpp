@@ -0,0 +1,290 @@
+#include "CoreUtf.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define CORE_UTF_SSE2
+#include <emmintrin.h>
+#endif
+
+#define CORE_UTF_REPLACEMENT 0xFFFD
+
+static bool IsContinuation(unsigned char byte)
+{
+	return (byte & 0xC0) == 0x80;
+}
+
+// copies the ASCII prefix of the text, returns its length
+static size_t WidenAscii(const unsigned char *pText, size_t length, wchar_t *pOut)
+{
+	size_t i = 0;
+
+#ifdef CORE_UTF_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(pText + i));
+
+		if (_mm_movemask_epi8(bytes) != 0)
+			break;
+
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+		if (sizeof(wchar_t) == 2)
+		{
+			_mm_storeu_si128((__m128i*)(pOut + i), low);
+			_mm_storeu_si128((__m128i*)(pOut + i + 8), high);
+		}
+		else
+		{
+			_mm_storeu_si128((__m128i*)(pOut + i), _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128((__m128i*)(pOut + i + 4), _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128((__m128i*)(pOut + i + 8), _mm_unpacklo_epi16(high, zero));
+			_mm_storeu_si128((__m128i*)(pOut + i + 12), _mm_unpackhi_epi16(high, zero));
+		}
+	}
+#else
+	for (; i + 8 <= length; i += 8)
+	{
+		unsigned long long word;
+
+		memcpy(&word, pText + i, sizeof(word));
+
+		if ((word & 0x8080808080808080ULL) != 0)
+			break;
+
+		for (size_t j = 0; j < 8; ++j)
+			pOut[i + j] = (wchar_t)pText[i + j];
+	}
+#endif
+
+	while (i < length && pText[i] < 0x80)
+	{
+		pOut[i] = (wchar_t)pText[i];
+		++i;
+	}
+
+	return i;
+}
+
+// copies the ASCII prefix of the text, returns its length
+static size_t NarrowAscii(const wchar_t *pText, size_t length, char *pOut)
+{
+	size_t i = 0;
+
+#ifdef CORE_UTF_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	if (sizeof(wchar_t) == 2)
+	{
+		const __m128i mask = _mm_set1_epi16((short)0xFF80);
+
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i low = _mm_loadu_si128((const __m128i*)(pText + i));
+			__m128i high = _mm_loadu_si128((const __m128i*)(pText + i + 8));
+			__m128i wide = _mm_and_si128(_mm_or_si128(low, high), mask);
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(wide, zero)) != 0xFFFF)
+				break;
+
+			_mm_storeu_si128((__m128i*)(pOut + i), _mm_packus_epi16(low, high));
+		}
+	}
+	else
+	{
+		const __m128i mask = _mm_set1_epi32((int)0xFFFFFF80);
+
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i part0 = _mm_loadu_si128((const __m128i*)(pText + i));
+			__m128i part1 = _mm_loadu_si128((const __m128i*)(pText + i + 4));
+			__m128i part2 = _mm_loadu_si128((const __m128i*)(pText + i + 8));
+			__m128i part3 = _mm_loadu_si128((const __m128i*)(pText + i + 12));
+			__m128i wide = _mm_and_si128(_mm_or_si128(_mm_or_si128(part0, part1), _mm_or_si128(part2, part3)), mask);
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(wide, zero)) != 0xFFFF)
+				break;
+
+			__m128i low = _mm_packs_epi32(part0, part1);
+			__m128i high = _mm_packs_epi32(part2, part3);
+
+			_mm_storeu_si128((__m128i*)(pOut + i), _mm_packus_epi16(low, high));
+		}
+	}
+#endif
+
+	while (i < length && (unsigned int)pText[i] < 0x80)
+	{
+		pOut[i] = (char)pText[i];
+		++i;
+	}
+
+	return i;
+}
+
+// one code point, a pair of surrogates above U+FFFF when wchar_t has 16 bits
+static wchar_t* PutCodePoint(unsigned int code, wchar_t *pOut)
+{
+	if (code >= 0x10000 && sizeof(wchar_t) == 2)
+	{
+		code -= 0x10000;
+		*pOut++ = (wchar_t)(0xD800 + (code >> 10));
+		*pOut++ = (wchar_t)(0xDC00 + (code & 0x3FF));
+	}
+	else
+		*pOut++ = (wchar_t)code;
+
+	return pOut;
+}
+
+size_t CoreUtf8ToUtf16(const char *pText, size_t length, wchar_t *pOut)
+{
+	const unsigned char *pBytes = (const unsigned char*)pText;
+	wchar_t *pStart = pOut;
+	size_t i = 0;
+
+	while (i < length)
+	{
+		size_t ascii = WidenAscii(pBytes + i, length - i, pOut);
+
+		i += ascii;
+		pOut += ascii;
+
+		if (i >= length)
+			break;
+
+		unsigned char lead = pBytes[i];
+		unsigned int code = CORE_UTF_REPLACEMENT;
+		// continuation bytes and range of the first one
+		size_t count = 0;
+		unsigned char min = 0x80;
+		unsigned char max = 0xBF;
+
+		if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			count = 1;
+			code = lead & 0x1F;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			count = 2;
+			code = lead & 0x0F;
+			// no overlong forms nor surrogates
+			if (lead == 0xE0)
+				min = 0xA0;
+			else if (lead == 0xED)
+				max = 0x9F;
+		}
+		else if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			count = 3;
+			code = lead & 0x07;
+			// no overlong forms nor code points above U+10FFFF
+			if (lead == 0xF0)
+				min = 0x90;
+			else if (lead == 0xF4)
+				max = 0x8F;
+		}
+
+		++i;
+
+		if (count == 0)
+		{
+			*pOut++ = (wchar_t)CORE_UTF_REPLACEMENT;
+			continue;
+		}
+
+		// the longest valid prefix of a broken sequence becomes a single U+FFFD,
+		// the byte that broke it starts the next one
+		size_t read = 0;
+
+		for (; read < count && i < length; ++read, ++i)
+		{
+			unsigned char byte = pBytes[i];
+
+			if (read == 0 ? (byte < min || byte > max) : !IsContinuation(byte))
+				break;
+
+			code = (code << 6) | (byte & 0x3F);
+		}
+
+		if (read < count)
+			code = CORE_UTF_REPLACEMENT;
+
+		pOut = PutCodePoint(code, pOut);
+	}
+
+	return (size_t)(pOut - pStart);
+}
+
+size_t CoreUtf16ToUtf8(const wchar_t *pText, size_t length, char *pOut)
+{
+	char *pStart = pOut;
+	size_t i = 0;
+
+	while (i < length)
+	{
+		size_t ascii = NarrowAscii(pText + i, length - i, pOut);
+
+		i += ascii;
+		pOut += ascii;
+
+		if (i >= length)
+			break;
+
+		unsigned int code = (unsigned int)pText[i++];
+
+		if (code < 0x800)
+		{
+			*pOut++ = (char)(0xC0 | (code >> 6));
+			*pOut++ = (char)(0x80 | (code & 0x3F));
+			continue;
+		}
+
+		if (code >= 0xD800 && code <= 0xDBFF && i < length
+			&& (unsigned int)pText[i] >= 0xDC00 && (unsigned int)pText[i] <= 0xDFFF)
+		{
+			code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned int)pText[i++] - 0xDC00);
+		}
+		else if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+			code = CORE_UTF_REPLACEMENT;
+
+		if (code >= 0x10000)
+		{
+			*pOut++ = (char)(0xF0 | (code >> 18));
+			*pOut++ = (char)(0x80 | ((code >> 12) & 0x3F));
+		}
+		else
+			*pOut++ = (char)(0xE0 | (code >> 12));
+
+		*pOut++ = (char)(0x80 | ((code >> 6) & 0x3F));
+		*pOut++ = (char)(0x80 | (code & 0x3F));
+	}
+
+	return (size_t)(pOut - pStart);
+}
+
+void CoreAppendUtf16(std::wstring &out, const char *pText, size_t length)
+{
+	size_t start = out.size();
+
+	if (length == 0)
+		return;
+
+	out.resize(start + CORE_UTF16_MAX_LENGTH(length));
+	out.resize(start + CoreUtf8ToUtf16(pText, length, &out[start]));
+}
+
+void CoreAppendUtf8(std::string &out, const wchar_t *pText, size_t length)
+{
+	size_t start = out.size();
+
+	if (length == 0)
+		return;
+
+	out.resize(start + CORE_UTF8_MAX_LENGTH(length));
+	out.resize(start + CoreUtf16ToUtf8(pText, length, &out[start]));
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// UTF-8 <-> UTF-16 for the Lua files read and the UTF-8 files written.
+// The runs of ASCII are converted 16 characters at a time (SSE2, or a 64-bit word without it),
+// the rest one code point at a time with validation: an invalid sequence or an unpaired
+// surrogate becomes U+FFFD, like with MultiByteToWideChar and WideCharToMultiByte.
+// Nothing depends on Windows, the conversions build with any compiler for benchmarking.
+
+// most characters a conversion writes
+#define CORE_UTF16_MAX_LENGTH(utf8Length) (utf8Length)
+#define CORE_UTF8_MAX_LENGTH(utf16Length) ((utf16Length) * (sizeof(wchar_t) == 2 ? 3 : 4))
+
+// pOut holds CORE_UTF16_MAX_LENGTH(length) characters, returns the number written
+size_t CoreUtf8ToUtf16(const char *pText, size_t length, wchar_t *pOut);
+// pOut holds CORE_UTF8_MAX_LENGTH(length) bytes, returns the number written
+size_t CoreUtf16ToUtf8(const wchar_t *pText, size_t length, char *pOut);
+
+void CoreAppendUtf16(std::wstring &out, const char *pText, size_t length);
+void CoreAppendUtf8(std::string &out, const wchar_t *pText, size_t length);
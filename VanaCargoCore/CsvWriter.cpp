@@ -1,11 +1,16 @@
 #include "stdafx.h"
 #include "CsvWriter.h"
+#include "CoreUtf.h"
+
+//! the most bytes a character takes once encoded and escaped (a doubled surrogate pair)
+#define CSV_WRITER_MAX_CHAR_BYTES 8
 
 /*! \brief CsvWriter constructor */
 template <typename T>CsvWriter<T>::CsvWriter()
-	: m_bFileOpened(false), m_LineCount(0),
+	: m_bFileOpened(false), m_pFile(new T),
+	m_pBuffer(NULL), m_BufferLength(0),
 	m_ColumnCount(0), m_ColumnIndex(0),
-	m_pFile(new T) {}
+	m_LineCount(0) {}
 
 /*! \brief CsvWriter destructor */
 template <typename T>CsvWriter<T>::~CsvWriter()
@@ -16,6 +21,12 @@ template <typename T>CsvWriter<T>::~CsvWriter()
 /*! \brief Performs cleanup operations */
 template <typename T> void CsvWriter<T>::Cleanup()
 {
+	if (m_bFileOpened)
+	{
+		WriteLine();
+		CloseFile();
+	}
+
 	// delete the file object owned by this object, if any
 	if (m_pFile != NULL)
 	{
@@ -23,11 +34,9 @@ template <typename T> void CsvWriter<T>::Cleanup()
 		m_pFile = NULL;
 	}
 
-	if (m_bFileOpened)
-	{
-		WriteLine();
-		CloseFile();
-	}
+	delete[] m_pBuffer;
+	m_pBuffer = NULL;
+	m_BufferLength = 0;
 }
 
 /*! \brief Opens and creates a file given its filename
@@ -50,6 +59,12 @@ template <typename T> bool CsvWriter<T>::CreateFile(const TCHAR *pFilename_in, U
 
 		if (m_bFileOpened)
 		{
+			// the buffer is kept for the lifetime of the writer
+			if (m_pBuffer == NULL)
+				m_pBuffer = new BYTE[CSV_WRITER_BUFFER_SIZE];
+
+			m_BufferLength = 0;
+
 			SetDialectFromFormat(Format_in);
 			m_Filename = pFilename_in;
 			pExcept->Delete();
@@ -73,6 +88,7 @@ template <typename T> bool CsvWriter<T>::CloseFile(void)
 
 		if (m_bFileOpened)
 		{
+			Flush();
 			m_pFile->Flush();
 			m_pFile->Close();
 			m_bFileOpened = false;
@@ -82,6 +98,15 @@ template <typename T> bool CsvWriter<T>::CloseFile(void)
 	return !m_bFileOpened;
 }
 
+/*! \brief Writes the buffered lines to the file */
+template <typename T> void CsvWriter<T>::Flush(void)
+{
+	if (m_pFile != NULL && m_BufferLength > 0)
+		m_pFile->Write(m_pBuffer, m_BufferLength);
+
+	m_BufferLength = 0;
+}
+
 /*! \brief Writes the header of the CSV file
 	\return true if the file is opened; false otherwise
 */
@@ -90,10 +115,8 @@ template <typename T> bool CsvWriter<T>::WriteHeader(void)
 	if (m_bFileOpened == false || m_pFile == NULL)
 		return false;
 
-	if (m_Dialect.m_Header[0] != NULL && m_Dialect.m_Header[1] != NULL)
-		m_pFile->Write(m_Dialect.m_Header, 2);
-	else if (m_Dialect.m_Header[0] != NULL)
-		m_pFile->Write(m_Dialect.m_Header, 1);
+	memcpy(m_pBuffer, m_Dialect.m_Header, m_Dialect.m_HeaderLength);
+	m_BufferLength = m_Dialect.m_HeaderLength;
 
 	return true;
 }
@@ -110,6 +133,112 @@ template <typename T> bool CsvWriter<T>::EscapeString(CString &String_in_out)
 	return (String_in_out.Replace(Delimiter, Replace) != 0);
 }
 
+/*! \brief Encodes a character at the end of the buffer
+	\param[in] Char_in : the character to be encoded
+*/
+template <typename T> void CsvWriter<T>::AppendChar(TCHAR Char_in)
+{
+	TCHAR Text[2] = { Char_in, 0x0 };
+
+	AppendText(Text);
+}
+
+/*! \brief Encodes a text at the end of the buffer
+	\param[in] pText_in : the text to be encoded
+	\param[in] bEscape_in : a flag specifying if the delimiters should be doubled
+*/
+template <typename T> void CsvWriter<T>::AppendText(const TCHAR *pText_in, bool bEscape_in)
+{
+	if (pText_in == NULL)
+		return;
+
+#ifdef _UNICODE
+	if (m_Dialect.m_Encoding == CSV_ENCODING_UTF8)
+	{
+		AppendUtf8(pText_in, bEscape_in);
+		return;
+	}
+#endif
+
+	for (const TCHAR *pChar = pText_in; *pChar != 0; ++pChar)
+	{
+		// the buffer is flushed instead of growing: nothing is allocated while writing
+		if (m_BufferLength + CSV_WRITER_MAX_CHAR_BYTES > CSV_WRITER_BUFFER_SIZE)
+			Flush();
+
+		BYTE *pOut = m_pBuffer + m_BufferLength;
+		int Repeat = (bEscape_in && *pChar == m_Dialect.m_Delimiter) ? 2 : 1;
+
+		for (int Index = 0; Index < Repeat; ++Index)
+		{
+			memcpy(pOut, pChar, sizeof(TCHAR));
+			pOut += sizeof(TCHAR);
+		}
+
+		m_BufferLength = (UINT)(pOut - m_pBuffer);
+	}
+}
+
+#ifdef _UNICODE
+/*! \brief Encodes a text in UTF-8 at the end of the buffer, a run of characters at a time
+	\param[in] pText_in : the text to be encoded
+	\param[in] bEscape_in : a flag specifying if the delimiters should be doubled
+*/
+template <typename T> void CsvWriter<T>::AppendUtf8(const TCHAR *pText_in, bool bEscape_in)
+{
+	const TCHAR *pChar = pText_in;
+
+	while (*pChar != 0)
+	{
+		// the run ends at the next delimiter to double, or at the end of the text
+		const TCHAR *pEnd = bEscape_in ? _tcschr(pChar, m_Dialect.m_Delimiter) : NULL;
+
+		if (pEnd == NULL)
+			pEnd = pChar + _tcslen(pChar);
+
+		while (pChar < pEnd)
+		{
+			// the buffer is flushed instead of growing: nothing is allocated while writing
+			if (m_BufferLength + 2 * CSV_WRITER_MAX_CHAR_BYTES > CSV_WRITER_BUFFER_SIZE)
+				Flush();
+
+			size_t Count = (CSV_WRITER_BUFFER_SIZE - m_BufferLength) / CORE_UTF8_MAX_LENGTH(1);
+
+			if (Count < (size_t)(pEnd - pChar))
+			{
+				// a surrogate pair is never split between two runs
+				if (pChar[Count - 1] >= 0xD800 && pChar[Count - 1] <= 0xDBFF)
+					--Count;
+			}
+			else
+				Count = (size_t)(pEnd - pChar);
+
+			m_BufferLength += (UINT)CoreUtf16ToUtf8(pChar, Count, (char*)m_pBuffer + m_BufferLength);
+			pChar += Count;
+		}
+
+		if (*pChar == 0)
+			break;
+
+		if (m_BufferLength + 2 * CSV_WRITER_MAX_CHAR_BYTES > CSV_WRITER_BUFFER_SIZE)
+			Flush();
+
+		// the delimiter, doubled
+		m_BufferLength += (UINT)CoreUtf16ToUtf8(pChar, 1, (char*)m_pBuffer + m_BufferLength);
+		m_BufferLength += (UINT)CoreUtf16ToUtf8(pChar, 1, (char*)m_pBuffer + m_BufferLength);
+		++pChar;
+	}
+}
+#endif
+
+/*! \brief Ends the current line and counts it */
+template <typename T> void CsvWriter<T>::EndLine(void)
+{
+	AppendText(m_Dialect.m_LineBreak);
+	m_ColumnIndex = 0;
+	m_LineCount++;
+}
+
 /*! \brief Adds a column to the file
 	\param[in] pValue_in : the value of the column
 	\param[in] bEscaped_in : a flag specifying if the value is already escaped
@@ -123,26 +252,16 @@ template <typename T> CsvWriter<T>& CsvWriter<T>::AddColumn(const TCHAR *pValue_
 	{
 		ASSERT(m_ColumnCount > 0);
 
-		bool bLineBreak = (++m_ColumnIndex >= m_ColumnCount);
-		CString strEscapedValue = pValue_in;
+		// the value is escaped while it is encoded
+		AppendChar(m_Dialect.m_Delimiter);
+		AppendText(pValue_in, bEscaped_in == false);
+		AppendChar(m_Dialect.m_Delimiter);
 
-		if (bEscaped_in == false)
-			EscapeString(strEscapedValue);
-
-		if (bLineBreak)
-		{
-			// add the column and the line break
-			m_CurrentLine.AppendFormat(_T("%c%s%c%s"), m_Dialect.m_Delimiter, strEscapedValue,
-				m_Dialect.m_Delimiter, m_Dialect.m_LineBreak);
-// write the current line
-			WriteLine();
-		}
+		// add the line break after the last column
+		if (++m_ColumnIndex >= m_ColumnCount)
+			EndLine();
 		else
-		{
-			// add the column
-			m_CurrentLine.AppendFormat(_T("%c%s%c%c"), m_Dialect.m_Delimiter, strEscapedValue,
-				m_Dialect.m_Delimiter, m_Dialect.m_Separator);
-		}
+			AppendChar(m_Dialect.m_Separator);
 	}
 
 	return *this;
@@ -155,54 +274,52 @@ template <typename T> CsvWriter<T>& CsvWriter<T>::AddColumn(const TCHAR *pValue_
 */
 template <typename T> CsvWriter<T>& CsvWriter<T>::AddColumnFormat(const TCHAR *pFormat_in, ...)
 {
-	int MessageLength;
+	TCHAR Column[CSV_WRITER_FORMAT_SIZE];
 	va_list ArgList;
-	TCHAR *pColumn;
+	int Length;
 
-	// retrieve the arguments list
+	// format the string on the stack
 	va_start(ArgList, pFormat_in);
-	// compute the length of the formatted string
-	MessageLength = _vsctprintf(pFormat_in, ArgList) + 1;
-	// allocate the memory
-	pColumn = (TCHAR*)malloc(MessageLength * sizeof(TCHAR));
-	// format the string
-	_vstprintf_s(pColumn, MessageLength, pFormat_in, ArgList);
+	Length = _vsntprintf_s(Column, CSV_WRITER_FORMAT_SIZE, _TRUNCATE, pFormat_in, ArgList);
 	va_end(ArgList);
-	// add the column
-	AddColumn(pColumn);
-	// cleanup
-	free(pColumn);
+
+	if (Length >= 0)
+	{
+		AddColumn(Column);
+	}
+	else
+	{
+		// the column didn't fit
+		CString LongColumn;
+
+		va_start(ArgList, pFormat_in);
+		LongColumn.FormatV(pFormat_in, ArgList);
+		va_end(ArgList);
+
+		AddColumn(LongColumn);
+	}
 
 	return *this;
 }
 
-/*! \brief Writes the current line in the file
+/*! \brief Ends the current line, it reaches the file with the next flush
 	\param[in] bAutocomplete_in : flag specifying if the missing columns
-			   should be created before writing the line
+			   should be created before ending the line
 	\return a reference to the writer to chain methods
 */
 template <typename T> CsvWriter<T>& CsvWriter<T>::WriteLine(bool bAutocomplete_in)
 {
 	ASSERT(m_bFileOpened);
 
-	if (m_bFileOpened && m_pFile != NULL && m_CurrentLine.IsEmpty() == false)
+	if (m_bFileOpened && m_pFile != NULL && m_ColumnIndex > 0)
 	{
 		ASSERT(m_ColumnCount > 0);
 
-		if (bAutocomplete_in)
-		{
-			int EmptyColumns = m_ColumnCount - m_ColumnIndex;
-
-			// complete the line if it's lacking columns
-			if (EmptyColumns > 0)
-				AddBlank(EmptyColumns);
-		}
-		// write the current line
-		m_pFile->Write(m_CurrentLine.GetBuffer(0), m_CurrentLine.GetLength() * sizeof(TCHAR));
-		// empty the current line
-		m_CurrentLine.Empty();
-		m_ColumnIndex = 0;
-		m_LineCount++;
+		// complete the line if it's lacking columns, the last one ends it
+		if (bAutocomplete_in && m_ColumnIndex < m_ColumnCount)
+			AddBlank(m_ColumnCount - m_ColumnIndex);
+		else
+			EndLine();
 	}
 
 	return *this;
@@ -217,33 +334,20 @@ template <typename T> CsvWriter<T>& CsvWriter<T>::AddBlank(UINT ColumnCount_in)
 	ASSERT(m_bFileOpened);
 
 	// check if the file is opened
-	if (m_bFileOpened && ColumnCount_in > 0)
+	if (m_bFileOpened)
 	{
 		ASSERT(m_ColumnCount > 0);
 
-		// avoid looping for 1 column
-		if (ColumnCount_in == 1)
-		{
-			m_CurrentLine += m_Dialect.m_Separator;
-			m_ColumnIndex++;
-		}
-		else
+		for (UINT Index = 0; Index < ColumnCount_in; ++Index)
 		{
-			// 
-			for (UINT Index = 0; Index < ColumnCount_in; ++Index)
+			if (++m_ColumnIndex < m_ColumnCount)
 			{
-				if (++m_ColumnIndex < m_ColumnCount)
-				{
-					m_CurrentLine += m_Dialect.m_Separator;
-				}
-				else
-				{
-					// the number of columns in the file has been reached
-					m_CurrentLine += m_Dialect.m_LineBreak;
-					// write the current line
-					m_ColumnIndex = 0;
-					WriteLine(false);
-				}
+				AppendChar(m_Dialect.m_Separator);
+			}
+			else
+			{
+				// the number of columns in the file has been reached
+				EndLine();
 			}
 		}
 	}
@@ -262,6 +366,7 @@ template <typename T> void CsvWriter<T>::SetDialectFromFormat(DWORD Format_in)
 	m_Dialect.m_LineBreak[0] = '\r';
 	m_Dialect.m_LineBreak[1] = '\n';
 	m_Dialect.m_LineBreak[2] = '\0';
+	m_Dialect.m_Encoding = CSV_ENCODING_UTF16LE;
 
 	// modify the default dialect depending on the format
 	switch (Format_in)
@@ -269,14 +374,23 @@ template <typename T> void CsvWriter<T>::SetDialectFromFormat(DWORD Format_in)
 		case CSV_FORMAT_EXCEL_5_97:
 			// Add the UNICODE low bit version header only for "recent" Excel
 			// because the old version does not support the standard UNICODE header !
-			m_Dialect.m_Header[0] = NULL;
-			m_Dialect.m_Header[1] = NULL;
+			m_Dialect.m_HeaderLength = 0;
 			break;
 		case CSV_FORMAT_EXCEL_2000_XP:
 			m_Dialect.m_Header[0] = 0xFF;
 			m_Dialect.m_Header[1] = 0xFE;
+			m_Dialect.m_HeaderLength = 2;
+			break;
+		case CSV_FORMAT_UTF8:
+			// the BOM lets Excel detect the encoding, the other readers expect commas
+			m_Dialect.m_Separator = ',';
+			m_Dialect.m_Encoding = CSV_ENCODING_UTF8;
+			m_Dialect.m_Header[0] = 0xEF;
+			m_Dialect.m_Header[1] = 0xBB;
+			m_Dialect.m_Header[2] = 0xBF;
+			m_Dialect.m_HeaderLength = 3;
 			break;
 	}
 }
 
-template CsvWriter<CFile>;
\ No newline at end of file
+template CsvWriter<CFile>;
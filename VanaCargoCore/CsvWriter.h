@@ -3,22 +3,37 @@
 
 class IFile;
 
+//! size of the buffer the lines are written through
+#define CSV_WRITER_BUFFER_SIZE (64 * 1024)
+//! size of the stack buffer used by AddColumnFormat, longer columns are formatted on the heap
+#define CSV_WRITER_FORMAT_SIZE 256
+
+/*! \brief encoding of the CSV file */
+enum CsvEncoding
+{
+	CSV_ENCODING_UTF16LE = 0,	//!< UTF-16 little endian (the native TCHAR)
+	CSV_ENCODING_UTF8			//!< UTF-8
+};
+
 /*! \brief CSV file format */
 typedef struct _CsvDialect
 {
-	BYTE	m_Header[2];	//!< file header (for BOM support)
+	BYTE	m_Header[3];	//!< file header (for BOM support)
+	UINT	m_HeaderLength;	//!< number of bytes of the header
 	TCHAR	m_Delimiter;	//!< CSV delimiter
 	TCHAR	m_Separator;	//!< CSV separator
 	TCHAR   m_LineBreak[3]; //!< CSV line break
+	CsvEncoding m_Encoding;	//!< encoding of the text
 
 	/*! \brief CsvDialect constructor */
-	_CsvDialect() : m_Delimiter('"'), m_Separator(',')
+	_CsvDialect() : m_HeaderLength(2), m_Delimiter('"'), m_Separator(','), m_Encoding(CSV_ENCODING_UTF16LE)
 	{
 		m_LineBreak[0] = '\r';
 		m_LineBreak[1] = '\n';
 		m_LineBreak[2] = '\0';
 		m_Header[0] = 0xFF;
 		m_Header[1] = 0xFE;
+		m_Header[2] = 0x00;
 	}
 
 } CsvDialect;
@@ -33,6 +48,7 @@ public:
 		CSV_FORMAT_UNSUPPORTED = 0,
 		CSV_FORMAT_EXCEL_2000_XP,
 		CSV_FORMAT_EXCEL_5_97,
+		CSV_FORMAT_UTF8,
 		CSV_FORMAT_COUNT
 	};
 
@@ -56,6 +72,8 @@ public:
 		\return true if the file is closed; false otherwise
 	*/
 	bool CloseFile(void);
+	/*! \brief Writes the buffered lines to the file */
+	void Flush(void);
 	/*! \brief Escapes the specified string for use as a CSV column value
 		\param[in,out] String_in_out : the string to be escaped
 		\return true if the string was modified; false otherwise
@@ -92,9 +110,9 @@ public:
 		\return a reference to the writer to chain methods
 	*/
 	CsvWriter& AddBlank(UINT ColumnCount_in = 1);
-	/*! \brief Writes the current line in the file
+	/*! \brief Ends the current line, it reaches the file with the next flush
 		\param[in] bAutocomplete_in : flag specifying if the missing columns
-				   should be created before writing the line
+				   should be created before ending the line
 		\return a reference to the writer to chain methods
 	*/
 	CsvWriter& WriteLine(bool bAutocomplete_in = true);
@@ -117,14 +135,16 @@ public:
 protected:
 	/*! a flag specifying if the CSV file is opened */
 	bool		m_bFileOpened;
-	/*! a string holding the content of the current line */
-	CString		m_CurrentLine;
 	/*! a string holding the path of the CSV file */
 	CString		m_Filename;
 	/*! a dialect object containing the parameters of the CSV file format */
 	CsvDialect	m_Dialect;
 	/*! a file object used to write the data to a file */
 	typename T *m_pFile;
+	/*! the encoded lines not written yet, allocated once when the file is created */
+	BYTE	   *m_pBuffer;
+	/*! the number of bytes used in the buffer */
+	UINT		m_BufferLength;
 	/*! the number of columns in the CSV file */
 	UINT		m_ColumnCount;
 	/*! the index of the current column in the current line */
@@ -132,6 +152,24 @@ protected:
 	/*! the number of lines written in the file */
 	UINT		m_LineCount;
 
+	/*! \brief Encodes a text at the end of the buffer
+		\param[in] pText_in : the text to be encoded
+		\param[in] bEscape_in : a flag specifying if the delimiters should be doubled
+	*/
+	void AppendText(const TCHAR *pText_in, bool bEscape_in = false);
+#ifdef _UNICODE
+	/*! \brief Encodes a text in UTF-8 at the end of the buffer, a run of characters at a time
+		\param[in] pText_in : the text to be encoded
+		\param[in] bEscape_in : a flag specifying if the delimiters should be doubled
+	*/
+	void AppendUtf8(const TCHAR *pText_in, bool bEscape_in);
+#endif
+	/*! \brief Encodes a character at the end of the buffer
+		\param[in] Char_in : the character to be encoded
+	*/
+	void AppendChar(TCHAR Char_in);
+	/*! \brief Ends the current line and counts it */
+	void EndLine(void);
 	/*! \brief Writes the header of the CSV file
 		\return true if the file is opened; false otherwise
 	*/
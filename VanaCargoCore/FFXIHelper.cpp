@@ -268,6 +268,162 @@ bool FFXiHelper::ReadItem(BYTE *pItemData, InventoryItem *pItem, int Language, b
 	return false;
 }
 
+// decodes the name of every item in the DAT files of a language, returns the number of items
+int FFXiHelper::ReadItemCatalog(int Language, CArray<DWORD, DWORD> &ItemIDs, CStringArray &ItemNames)
+{
+	InventoryItem *pItem = new InventoryItem();
+	BYTE *pItemData = (BYTE*)malloc(DATA_SIZE_ITEM + 1);
+	CString DATFile;
+	CFile ItemFile;
+
+	ItemIDs.RemoveAll();
+	ItemNames.RemoveAll();
+
+	for (int Type = ITEM_TYPE_GENERAL_ITEMS_1; Type < ITEM_TYPE_COUNT; ++Type)
+	{
+		GetFileFromType(Type, DATFile, Language);
+
+		if (DATFile.IsEmpty() || ItemFile.Open(DATFile, CFile::modeRead | CFile::shareDenyNone) == FALSE)
+			continue;
+
+		// the file is a sequence of encrypted item records
+		while (ItemFile.Read(pItemData, DATA_SIZE_ITEM) == DATA_SIZE_ITEM)
+		{
+			FFXiHelper::RotateBits(pItemData, pItemData, DATA_SIZE_ITEM, RSHIFT_DECRYPT_ITEM);
+			ClearItemData(pItem);
+
+			if (ReadItem(pItemData, pItem, Language) && pItem->ItemHdr.ItemID > 0 &&
+				pItem->ItemName.IsEmpty() == false && pItem->ItemName != _T("."))
+			{
+				ItemIDs.Add(pItem->ItemHdr.ItemID);
+				ItemNames.Add(pItem->ItemName);
+			}
+		}
+
+		ItemFile.Close();
+	}
+
+	free(pItemData);
+	delete pItem;
+
+	return (int)ItemIDs.GetCount();
+}
+
+// a DAT file kept open with the stamp it had when it was opened
+class CKeptDatFile : public CFile
+{
+public:
+	// CFile::Open can't share the delete access: a game update must be able to delete or rename the file
+	BOOL OpenShared(const CString &DATFile)
+	{
+		HANDLE hFile = ::CreateFile(DATFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+									NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (hFile == INVALID_HANDLE_VALUE)
+			return FALSE;
+
+		m_hFile = hFile;
+		m_bCloseOnDelete = TRUE;
+		SetFilePath(DATFile);
+
+		return GetStamp(DATFile, m_WriteTime, m_Size) ? TRUE : FALSE;
+	}
+
+	// false once the file at the path was written, replaced or deleted
+	bool IsCurrent() const
+	{
+		FILETIME WriteTime;
+		ULONGLONG Size;
+
+		return GetStamp(GetFilePath(), WriteTime, Size)
+			&& CompareFileTime(&WriteTime, &m_WriteTime) == 0 && Size == m_Size;
+	}
+
+private:
+	static bool GetStamp(const CString &DATFile, FILETIME &WriteTime, ULONGLONG &Size)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA Data;
+
+		if (GetFileAttributesEx(DATFile, GetFileExInfoStandard, &Data) == FALSE)
+			return false;
+
+		WriteTime = Data.ftLastWriteTime;
+		Size = ((ULONGLONG)Data.nFileSizeHigh << 32) | Data.nFileSizeLow;
+
+		return true;
+	}
+
+	FILETIME m_WriteTime;
+	ULONGLONG m_Size;
+};
+
+// opens File on the DAT file, or returns the copy kept open when KeepDatFilesOpen was called
+CFile* FFXiHelper::OpenDatFile(const CString &DATFile, CFile &File)
+{
+	if (m_KeepDatFiles == false)
+		return File.Open(DATFile, CFile::modeRead | CFile::shareDenyNone) ? &File : NULL;
+
+	void *pFile = NULL;
+
+	if (m_DatFiles.Lookup(DATFile, pFile))
+		return (CFile*)pFile;
+
+	CKeptDatFile *pDatFile = new CKeptDatFile();
+
+	if (pDatFile->OpenShared(DATFile) == FALSE)
+	{
+		delete pDatFile;
+
+		return NULL;
+	}
+
+	m_DatFiles.SetAt(DATFile, pDatFile);
+
+	return pDatFile;
+}
+
+void FFXiHelper::CloseDatFiles()
+{
+	POSITION Pos = m_DatFiles.GetStartPosition();
+	CString DATFile;
+	void *pFile;
+
+	while (Pos != NULL)
+	{
+		m_DatFiles.GetNextAssoc(Pos, DATFile, pFile);
+		delete (CKeptDatFile*)pFile;
+	}
+
+	m_DatFiles.RemoveAll();
+}
+
+int FFXiHelper::CloseChangedDatFiles()
+{
+	POSITION Pos = m_DatFiles.GetStartPosition();
+	CStringArray Changed;
+	CString DATFile;
+	void *pFile;
+
+	while (Pos != NULL)
+	{
+		m_DatFiles.GetNextAssoc(Pos, DATFile, pFile);
+
+		if (((CKeptDatFile*)pFile)->IsCurrent() == false)
+			Changed.Add(DATFile);
+	}
+
+	for (INT_PTR i = 0; i < Changed.GetCount(); ++i)
+	{
+		if (m_DatFiles.Lookup(Changed[i], pFile))
+		{
+			m_DatFiles.RemoveKey(Changed[i]);
+			delete (CKeptDatFile*)pFile;
+		}
+	}
+
+	return (int)Changed.GetCount();
+}
+
 bool FFXiHelper::ParseInventoryFile(const TCHAR* pFile, const ItemLocationInfo &LocationInfo,
 	ItemArray *pMap, int Language, bool Update)
 {
@@ -308,6 +464,9 @@ bool FFXiHelper::ParseInventoryFile(const TCHAR* pFile, const ItemLocationInfo &
 
 				for (pPos = (WORD*)pFileData + 4; pPos < pLimit; pPos += 4)
 				{
+					if (m_pCanceled != NULL && *m_pCanceled != 0)
+						break;
+
 					InventoryItem *pItem = NULL;
 
 					MapID = ItemID = *pPos;
@@ -321,7 +480,9 @@ bool FFXiHelper::ParseInventoryFile(const TCHAR* pFile, const ItemLocationInfo &
 						{
 							DataOffset = ItemID * DATA_SIZE_ITEM;
 
-							if (DATFile.IsEmpty() == false && InvFile.Open(DATFile, CFile::modeRead | CFile::shareDenyNone))
+							CFile *pDatFile = DATFile.IsEmpty() ? NULL : OpenDatFile(DATFile, InvFile);
+
+							if (pDatFile != NULL)
 							{
 								if (pItem == NULL)
 								{
@@ -337,10 +498,12 @@ bool FFXiHelper::ParseInventoryFile(const TCHAR* pFile, const ItemLocationInfo &
 								pItem->LocationInfo = LocationInfo;
 								pItem->LocationInfo.ListIndex = ItemIndex++;
 
-								DataRead = (UINT)InvFile.Seek(DataOffset, CFile::begin);
+								DataRead = (UINT)pDatFile->Seek(DataOffset, CFile::begin);
 								// Yes we're technically redefining a variable. We have to here.
-								DataRead = InvFile.Read(pItemData, DATA_SIZE_ITEM);
-								InvFile.Close();
+								DataRead = pDatFile->Read(pItemData, DATA_SIZE_ITEM);
+
+								if (pDatFile == &InvFile)
+									InvFile.Close();
 
 								FFXiHelper::RotateBits(pItemData, pItemData, DATA_SIZE_ITEM, RSHIFT_DECRYPT_ITEM);
 
@@ -1391,6 +1554,42 @@ void FFXiHelper::GetWeaponChargesInfo(FFXiWeaponInfo WeaponInfo, CString &Remark
 	}
 }
 
+// decodes an item straight from its DAT file, without an inventory file
+bool FFXiHelper::ReadItemFromID(DWORD ItemID, InventoryItem *pItem, int Language)
+{
+	if (pItem == NULL || ItemID == 0 || ItemID > 0x6FFF)
+		return false;
+
+	BYTE ItemData[DATA_SIZE_ITEM + 1];
+	DWORD FileItemID = ItemID;
+	CString DATFile;
+	CFile File;
+	UINT DataRead = 0;
+
+	// the ID becomes the index of the item in its DAT file
+	GetFileFromItemID(FileItemID, DATFile, Language);
+
+	CFile *pDatFile = DATFile.IsEmpty() ? NULL : OpenDatFile(DATFile, File);
+
+	if (pDatFile == NULL)
+		return false;
+
+	SecureZeroMemory(ItemData, sizeof(ItemData));
+	pDatFile->Seek((LONGLONG)FileItemID * DATA_SIZE_ITEM, CFile::begin);
+	DataRead = pDatFile->Read(ItemData, DATA_SIZE_ITEM);
+
+	if (pDatFile == &File)
+		File.Close();
+
+	if (DataRead != DATA_SIZE_ITEM)
+		return false;
+
+	ClearItemData(pItem);
+	FFXiHelper::RotateBits(ItemData, ItemData, DATA_SIZE_ITEM, RSHIFT_DECRYPT_ITEM);
+
+	return ReadItem(ItemData, pItem, Language);
+}
+
 UINT FFXiHelper::GetItemFromID(DWORD ItemID, ItemArray *pMap, InventoryItem **pItem)
 {
 	if (pMap != NULL && pMap->Lookup(ItemID, *pItem))
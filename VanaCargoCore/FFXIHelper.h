@@ -563,9 +563,11 @@ public:
 	FFXiHelper(int Region = FFXI_REGION_US)
 	{
 		m_Region = Region;
+		m_KeepDatFiles = false;
+		m_pCanceled = NULL;
 	}
 
-	~FFXiHelper() {}
+	~FFXiHelper() { CloseDatFiles(); }
 
 	int DetectGameRegion(int &Regions);
 
@@ -581,6 +583,26 @@ public:
 		m_InstallFolder = pInstallPath;
 	}
 
+	// keeps the DAT files read by ParseInventoryFile open until CloseDatFiles, for a helper parsing many bags
+	void KeepDatFilesOpen(bool Keep)
+	{
+		m_KeepDatFiles = Keep;
+
+		if (Keep == false)
+			CloseDatFiles();
+	}
+
+	void CloseDatFiles();
+	// closes the DAT files kept open that were written or replaced since, returns their number
+	int CloseChangedDatFiles();
+	int GetOpenDatFileCount() const { return (int)m_DatFiles.GetCount(); }
+
+	// ParseInventoryFile stops reading items once *pCanceled is set, the items read so far stay in the map
+	void SetCancelFlag(const volatile LONG *pCanceled)
+	{
+		m_pCanceled = pCanceled;
+	}
+
 	bool ReadInventoryFile(const TCHAR *pPlayerID, int InvType, ItemArray &ItemMap);
 	int GetItemHdr(const BYTE *pItemData, FFXiItemHeader &ItemHdr);
 	int GetArmorInfo(const BYTE *pItemData, FFXiArmorInfo &ArmorInfo);
@@ -609,6 +631,8 @@ public:
 	UINT GetItemFromID(DWORD ItemID, ItemArray *pMap, InventoryItem **pItem);
 	void ClearItemData(InventoryItem *pItem);
 	bool ReadItem(BYTE *pItemData, InventoryItem *pItem, int Language = FFXI_LANG_US, bool NoConversion = false);
+	bool ReadItemFromID(DWORD ItemID, InventoryItem *pItem, int Language = FFXI_LANG_US);
+	int ReadItemCatalog(int Language, CArray<DWORD, DWORD> &ItemIDs, CStringArray &ItemNames);
 
 	static void GetBYTE(BYTE **pData, BYTE &Result, bool MovePtr = true);
 	static void GetWORD(BYTE **pData, WORD &Result, bool MovePtr = true);
@@ -634,8 +658,14 @@ public:
 	const static FFXiStringAssoc SlotStringTable[];
 
 protected:
+	CFile* OpenDatFile(const CString &DATFile, CFile &File);
+
 	CString m_InstallFolder;
 	int m_Region;
+	bool m_KeepDatFiles;
+	const volatile LONG *m_pCanceled;
+	// DAT file path -> CFile*
+	CMapStringToPtr m_DatFiles;
 };
 
 #endif//__FFXI_HELPER_CLASS__
@@ -72,11 +72,78 @@ void FFXiItemList::OnColumnSort(NMHDR* pNMHDR, LRESULT* pResult)
 	else
 		m_SortAsc = true;
 
-	SortItems(ColumnSortFunc, pLV->iItem);
+	// the list only knows the rows by index: the selected item is selected again once sorted
+	int Selected = GetNextItem(-1, LVNI_SELECTED);
+	InventoryItem* pSelected = GetRowItem(Selected);
+
+	m_Rows.Sort(pLV->iItem);
+
+	if (pSelected != NULL)
+	{
+		Selected = m_Rows.Find(pSelected);
+
+		SetItemState(-1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+		SetItemState(Selected, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
+		EnsureVisible(Selected, FALSE);
+	}
+
+	Invalidate(FALSE);
+
+	*pResult = 0;
+}
+
+void FFXiItemList::OnGetDispInfo(NMHDR* pNMHDR, LRESULT* pResult)
+{
+	NMLVDISPINFO* pDispInfo = (NMLVDISPINFO*)pNMHDR;
+	LVITEM& Item = pDispInfo->item;
+	const CoreRowProvider& Provider = m_Rows;
+
+	if (Item.iItem >= 0 && Item.iItem < Provider.GetRowCount())
+	{
+		if ((Item.mask & LVIF_TEXT) && Item.pszText != NULL && Item.cchTextMax > 0)
+			Provider.GetCellText(Item.iItem, Item.iSubItem, Item.pszText, (size_t)Item.cchTextMax);
+
+		// only the name shows the icon
+		if (Item.mask & LVIF_IMAGE)
+			Item.iImage = (Item.iSubItem == INVENTORY_LIST_COL_NAME) ? Provider.GetRowIcon(Item.iItem) : -1;
+	}
 
 	*pResult = 0;
 }
 
+// typing the first letters of a name selects the next item starting with them
+void FFXiItemList::OnFindItem(NMHDR* pNMHDR, LRESULT* pResult)
+{
+	NMLVFINDITEM* pFindInfo = (NMLVFINDITEM*)pNMHDR;
+	const LVFINDINFO& Find = pFindInfo->lvfi;
+	int RowCount = m_Rows.GetRowCount();
+
+	*pResult = -1;
+
+	if ((Find.flags & LVFI_STRING) == 0 || Find.psz == NULL || RowCount == 0)
+		return;
+
+	size_t Length = _tcslen(Find.psz);
+	int Start = (pFindInfo->iStart >= 0 && pFindInfo->iStart < RowCount) ? pFindInfo->iStart : 0;
+
+	for (int Offset = 0; Offset < RowCount; ++Offset)
+	{
+		int Row = (Start + Offset) % RowCount;
+		InventoryItem* pItem = m_Rows.GetItem(Row);
+
+		if (Offset > 0 && Row == 0 && (Find.flags & LVFI_WRAP) == 0)
+			break;
+
+		if ((Find.flags & LVFI_PARTIAL) != 0
+			? _tcsnicmp(pItem->ItemName, Find.psz, Length) == 0
+			: pItem->ItemName.CompareNoCase(Find.psz) == 0)
+		{
+			*pResult = Row;
+			return;
+		}
+	}
+}
+
 int CALLBACK FFXiItemList::ColumnSortFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 {
 	int nRetVal;
@@ -197,7 +264,7 @@ LPTSTR FFXiItemList::GetToolTipText(int nRow, int nCol)
 
 	if (nRow >= 0 && nRow < ItemCount)
 	{
-		InventoryItem* pItem = (InventoryItem*)GetItemData(nRow);
+		InventoryItem* pItem = GetRowItem(nRow);
 
 		if (pItem != NULL)
 		{
@@ -234,34 +301,6 @@ bool FFXiItemList::ShowToolTip(const CPoint& pt) const
 	return (nRow >= 0 && nCol >= 0);
 }
 
-void FFXiItemList::GetItemAt(int Index, int SubItem, int& Icon, CString& Text)
-{
-	LVITEM Item;
-
-	Item.mask = LVIF_TEXT | LVIF_IMAGE;
-	Item.iItem = Index;
-	Item.iSubItem = SubItem;
-	Item.pszText = Text.GetBuffer();
-
-	GetItem(&Item);
-
-	Icon = Item.iImage;
-	Text.ReleaseBuffer();
-}
-
-void FFXiItemList::SetItemAt(int Index, int SubItem, int Icon, CString& Text)
-{
-	LVITEM Item;
-
-	Item.mask = LVIF_TEXT | LVIF_IMAGE;
-	Item.iItem = Index;
-	Item.iImage = Icon;
-	Item.iSubItem = SubItem;
-	Item.pszText = Text.GetBuffer();
-
-	SetItem(&Item);
-}
-
 void FFXiItemList::PreSubclassWindow()
 {
 #if (_WIN32_WINNT >= 0x501)
@@ -274,102 +313,141 @@ void FFXiItemList::PreSubclassWindow()
 
 	GetToolTips()->SetMaxTipWidth(512);
 
+	// the style can't be changed once the control exists, it is set in the resource
+	ASSERT((GetStyle() & LVS_OWNERDATA) == LVS_OWNERDATA);
+
 	CListCtrl::PreSubclassWindow();
 }
 
-bool FFXiItemList::AddItem(InventoryItem* pItem, int& ItemIndex)
+bool FFXiItemList::AddItem(InventoryItem* pItem)
 {
 	if (pItem != NULL)
 	{
-		ItemIndex = InsertItem(ItemIndex, pItem->ItemName, pItem->LocationInfo.ImageIndex);
-		SetItemData(ItemIndex, (LPARAM)pItem);
+		m_Rows.Add(pItem, m_CompactList);
+		return true;
+	}
 
-		if (!pItem->Attr.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_ATTR, -1, pItem->Attr);
+	return false;
+}
 
-		if (!pItem->LocationInfo.Location.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_LOCATION, -1, pItem->LocationInfo.Location);
+void FFXiItemList::ClearItems()
+{
+	m_Rows.Clear();
+	SetItemCountEx(0);
+}
 
-		if (!pItem->ItemDescription.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_DESCRIPTION, -1, pItem->ItemDescription);
+void FFXiItemList::UpdateItemCount()
+{
+	SetItemCountEx(m_Rows.GetRowCount(), LVSICF_NOSCROLL);
+	Invalidate(FALSE);
+}
+
+InventoryItem* FFXiItemList::GetRowItem(int Row) const
+{
+	if (Row >= 0 && Row < m_Rows.GetRowCount())
+		return m_Rows.GetItem(Row);
 
-		if (!pItem->Slot.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_SLOT, -1, pItem->Slot);
+	return NULL;
+}
 
-		if (!pItem->Races.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_RACES, -1, pItem->Races);
+void FFXiItemList::OnPaint()
+{
+	if (m_BlockRedraw == false)
+	{
+		CListCtrl::OnPaint();
+	}
+}
 
-		if (!pItem->Level.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_LEVEL, -1, pItem->Level);
+void InventoryRows::Clear()
+{
+	m_Items.clear();
+	m_Rows.Clear();
+}
 
-		if (!pItem->Jobs.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_JOBS, -1, pItem->Jobs);
+void InventoryRows::Add(InventoryItem* pItem, bool Compact)
+{
+	m_Rows.Add((int)m_Items.size(), pItem->RefCount, Compact);
+	m_Items.push_back(pItem);
+}
 
-		if (!pItem->Remarks.IsEmpty())
-			SetItemAt(ItemIndex, INVENTORY_LIST_COL_REMARKS, -1, pItem->Remarks);
+InventoryItem* InventoryRows::GetItem(int Row) const
+{
+	return m_Items[(size_t)m_Rows.GetRow(Row).Record];
+}
 
-		ItemIndex++;
-		return true;
+int InventoryRows::Find(const InventoryItem* pItem) const
+{
+	for (size_t Record = 0; Record < m_Items.size(); ++Record)
+	{
+		if (m_Items[Record] == pItem)
+			return m_Rows.Find((int)Record);
 	}
 
-	return false;
+	return -1;
 }
 
-void FFXiItemList::UpdateItemData(InventoryItem* pItem, int ItemIndex, int SubIndex)
+void InventoryRows::Sort(int Column)
 {
-	if (pItem != NULL)
+	const std::vector<InventoryItem*>& Items = m_Items;
+
+	m_Rows.Sort([&Items, Column](int Left, int Right)
 	{
-		SetItemData(ItemIndex, (LPARAM)pItem);
+		return FFXiItemList::ColumnSortFunc((LPARAM)Items[(size_t)Left], (LPARAM)Items[(size_t)Right], Column);
+	});
+}
 
-		if (ItemIndex >= 0 && ItemIndex < GetItemCount() &&
-			SubIndex >= 0 && SubIndex < INVENTORY_LIST_COL_COUNT)
-		{
-			switch (SubIndex)
-			{
-			default:
-			case 0:
-				SetItemText(ItemIndex, SubIndex, pItem->ItemName);
-				break;
-			case INVENTORY_LIST_COL_ATTR:
-				SetItemText(ItemIndex, SubIndex, pItem->Attr);
-				break;
-			case INVENTORY_LIST_COL_DESCRIPTION:
-				SetItemText(ItemIndex, SubIndex, pItem->ItemDescription);
-				break;
-			case INVENTORY_LIST_COL_SLOT:
-				SetItemText(ItemIndex, SubIndex, pItem->Slot);
-				break;
-			case INVENTORY_LIST_COL_RACES:
-				SetItemText(ItemIndex, SubIndex, pItem->Races);
-				break;
-			case INVENTORY_LIST_COL_LEVEL:
-				SetItemText(ItemIndex, SubIndex, pItem->Level);
-				break;
-			case INVENTORY_LIST_COL_JOBS:
-				SetItemText(ItemIndex, SubIndex, pItem->Jobs);
-				break;
-			case INVENTORY_LIST_COL_REMARKS:
-				SetItemText(ItemIndex, SubIndex, pItem->Remarks);
-				break;
-			}
-		}
-	}
+int InventoryRows::GetRowCount() const
+{
+	return m_Rows.GetCount();
 }
 
-void FFXiItemList::UpdateItemText(const TCHAR* pText, int ItemIndex, int SubIndex)
+void InventoryRows::GetCellText(int Row, int Column, wchar_t* pBuffer, size_t Size) const
 {
-	if (pText != NULL &&
-		ItemIndex >= 0 && ItemIndex < GetItemCount() &&
-		SubIndex >= 0 && SubIndex < INVENTORY_LIST_COL_COUNT)
+	const CoreRow& Entry = m_Rows.GetRow(Row);
+	const InventoryItem* pItem = m_Items[(size_t)Entry.Record];
+	const CString* pText = NULL;
+
+	switch (Column)
 	{
-		SetItemText(ItemIndex, SubIndex, pText);
+	case INVENTORY_LIST_COL_NAME:
+		if (Entry.Count > 1)
+		{
+			CoreFormatCellCount(pItem->ItemName, Entry.Count, pBuffer, Size);
+			return;
+		}
+
+		pText = &pItem->ItemName;
+		break;
+	case INVENTORY_LIST_COL_LOCATION:
+		pText = &pItem->LocationInfo.Location;
+		break;
+	case INVENTORY_LIST_COL_ATTR:
+		pText = &pItem->Attr;
+		break;
+	case INVENTORY_LIST_COL_DESCRIPTION:
+		pText = &pItem->ItemDescription;
+		break;
+	case INVENTORY_LIST_COL_SLOT:
+		pText = &pItem->Slot;
+		break;
+	case INVENTORY_LIST_COL_RACES:
+		pText = &pItem->Races;
+		break;
+	case INVENTORY_LIST_COL_LEVEL:
+		pText = &pItem->Level;
+		break;
+	case INVENTORY_LIST_COL_JOBS:
+		pText = &pItem->Jobs;
+		break;
+	case INVENTORY_LIST_COL_REMARKS:
+		pText = &pItem->Remarks;
+		break;
 	}
+
+	CoreCopyCellText((pText != NULL) ? (LPCTSTR)*pText : NULL, pBuffer, Size);
 }
 
-void FFXiItemList::OnPaint()
+int InventoryRows::GetRowIcon(int Row) const
 {
-	if (m_BlockRedraw == false)
-	{
-		CListCtrl::OnPaint();
-	}
+	return m_Items[(size_t)m_Rows.GetRow(Row).Record]->LocationInfo.ImageIndex;
 }
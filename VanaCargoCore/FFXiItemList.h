@@ -1,6 +1,8 @@
 #ifndef __TOOLTIP_LIST_CLASS__
 #define __TOOLTIP_LIST_CLASS__
 
+#include "CoreRows.h"
+
 enum InventoryListColumns
 {
 	INVENTORY_LIST_COL_NAME = 0,
@@ -15,6 +17,26 @@ enum InventoryListColumns
 	INVENTORY_LIST_COL_COUNT
 };
 
+// rows of the inventory list, the items belong to the dialog
+class InventoryRows : public CoreRowProvider
+{
+public:
+	void Clear();
+	void Add(InventoryItem *pItem, bool Compact);
+	InventoryItem* GetItem(int Row) const;
+	int Find(const InventoryItem *pItem) const;
+	void Sort(int Column);
+
+	virtual int GetRowCount() const;
+	virtual void GetCellText(int Row, int Column, wchar_t *pBuffer, size_t Size) const;
+	virtual int GetRowIcon(int Row) const;
+
+protected:
+	std::vector<InventoryItem*> m_Items;
+	CoreRowIndex m_Rows;
+};
+
+// LVS_OWNERDATA list: the rows are kept by InventoryRows and only the visible cells are asked for
 class FFXiItemList : public CListCtrl
 {
 	// Construction
@@ -31,11 +53,14 @@ public:
 	}
 
 	LPTSTR GetToolTipText(int nRow, int nCol);
-	bool AddItem(InventoryItem *pItem, int &ItemIndex);
+	// the item is listed once with its count in compact mode, once per unit otherwise
+	bool AddItem(InventoryItem *pItem);
+	void ClearItems();
+	// shows the items added since ClearItems
+	void UpdateItemCount();
+	InventoryItem* GetRowItem(int Row) const;
 	BOOL OnToolTipText(UINT, NMHDR* pNMHDR, LRESULT* pResult);
 	void CellHitTest(const CPoint& pt, int& nRow, int& nCol) const;
-	void UpdateItemText(const TCHAR* pText, int ItemIndex, int SubIndex = 0);
-	void UpdateItemData(InventoryItem *pItem, int ItemIndex, int SubIndex = 0);
 	static void BuildBgWikiUrl(const CString &itemName, CString &urlOut);
 
 	void BlockRedraw(bool BlockRedraw = true)
@@ -53,16 +78,16 @@ public:
 protected:
 	bool m_CompactList;
 	bool m_BlockRedraw;
+	InventoryRows m_Rows;
 
 	static bool m_SortAsc;
 	static int m_SortedColumn;
 
-	void GetItemAt(int Index, int SubItem, int &Icon, CString &Text);
-	void SetItemAt(int Index, int SubItem, int Icon, CString &Text);
-
 	afx_msg void OnPaint();
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
 	afx_msg void OnColumnSort(NMHDR* pNMHDR, LRESULT* pResult);
+	afx_msg void OnGetDispInfo(NMHDR* pNMHDR, LRESULT* pResult);
+	afx_msg void OnFindItem(NMHDR* pNMHDR, LRESULT* pResult);
 	virtual void PreSubclassWindow();
 
 	DECLARE_MESSAGE_MAP()
@@ -0,0 +1,398 @@
+#include "SearchCompletion.h"
+
+#include <algorithm>
+#include <wchar.h>
+#include <wctype.h>
+
+static inline SearchTextChar FoldChar(wchar_t Char)
+{
+	return (SearchTextChar)towlower((wint_t)Char);
+}
+
+static inline unsigned int GetBigram(SearchTextChar First, SearchTextChar Second)
+{
+	return ((unsigned int)First << 16) | Second;
+}
+
+// largest level of the sparse table whose ranges fit in Count ranks
+static size_t GetLevel(size_t Count)
+{
+	size_t Level = 0;
+
+	while (((size_t)2 << Level) <= Count)
+		++Level;
+
+	return Level;
+}
+
+static size_t FoldText(const wchar_t *pText, std::vector<SearchTextChar> &Folded)
+{
+	size_t Length = (pText != NULL) ? wcslen(pText) : 0;
+
+	Folded.resize(Length);
+
+	for (size_t i = 0; i < Length; ++i)
+		Folded[i] = FoldChar(pText[i]);
+
+	return Length;
+}
+
+// orders the ranks of a completion list on their keys, the first added first on a tie
+class CompletionKeyLess
+{
+public:
+	CompletionKeyLess(const std::vector<SearchTextChar> &Text, const std::vector<size_t> &Offsets)
+		: m_Text(Text), m_Offsets(Offsets) {}
+
+	bool operator()(unsigned int Left, unsigned int Right) const
+	{
+		const SearchTextChar *pText = m_Text.empty() ? NULL : &m_Text[0];
+
+		if (std::lexicographical_compare(pText + m_Offsets[Left], pText + m_Offsets[Left + 1],
+										 pText + m_Offsets[Right], pText + m_Offsets[Right + 1]))
+			return true;
+
+		if (std::lexicographical_compare(pText + m_Offsets[Right], pText + m_Offsets[Right + 1],
+										 pText + m_Offsets[Left], pText + m_Offsets[Left + 1]))
+			return false;
+
+		return Left < Right;
+	}
+
+protected:
+	const std::vector<SearchTextChar> &m_Text;
+	const std::vector<size_t> &m_Offsets;
+};
+
+// orders the ranks of a completion list on the scores of their candidates, the highest first
+class CompletionScoreGreater
+{
+public:
+	CompletionScoreGreater(const std::vector<unsigned int> &Scores, const std::vector<unsigned int> &Entries)
+		: m_Scores(Scores), m_Entries(Entries) {}
+
+	bool operator()(unsigned int Left, unsigned int Right) const
+	{
+		return m_Scores[m_Entries[Left]] > m_Scores[m_Entries[Right]];
+	}
+
+protected:
+	const std::vector<unsigned int> &m_Scores;
+	const std::vector<unsigned int> &m_Entries;
+};
+
+// ranks of a prefix range not returned yet, ordered on the best of them
+typedef struct _CompletionRange
+{
+	size_t First;
+	size_t Last;
+	size_t Best;
+	unsigned int Position;
+} CompletionRange;
+
+static bool CompareRange(const CompletionRange &Left, const CompletionRange &Right)
+{
+	// std::push_heap keeps the greatest first, the best position is the smallest
+	return Left.Position > Right.Position;
+}
+
+void SearchCompletion::Clear()
+{
+	m_Text.clear();
+	m_Offsets.clear();
+	m_Entries.clear();
+	m_Scores.clear();
+	m_Positions.clear();
+	m_Ranks.clear();
+	m_MinPositions.clear();
+	m_Postings.clear();
+	m_Built = true;
+}
+
+/*! \brief Appends a candidate, Build must be called before searching again
+	\param[in] pText : text of the candidate, case-folded here
+	\param[in] Length : number of characters of the text
+	\param[in] Score : rank of the candidate, the highest scores are returned first
+	\return the index of the candidate, returned by the searches
+*/
+size_t SearchCompletion::Add(const wchar_t *pText, size_t Length, unsigned int Score)
+{
+	size_t Entry = m_Entries.size();
+	size_t Start = m_Text.size();
+
+	if (m_Offsets.empty())
+		m_Offsets.push_back(0);
+
+	if (pText == NULL)
+		Length = 0;
+
+	m_Text.resize(Start + Length);
+
+	for (size_t i = 0; i < Length; ++i)
+		m_Text[Start + i] = FoldChar(pText[i]);
+
+	m_Offsets.push_back(m_Text.size());
+	m_Entries.push_back((unsigned int)Entry);
+	m_Scores.push_back(Score);
+	m_Built = false;
+
+	return Entry;
+}
+
+//! \brief Sorts the keys, numbers them by score and indexes their bigrams
+void SearchCompletion::Build()
+{
+	if (m_Built)
+		return;
+
+	size_t Count = m_Entries.size();
+	std::vector<unsigned int> Ranks(Count);
+	std::vector<SearchTextChar> Text;
+	std::vector<size_t> Offsets;
+	std::vector<unsigned int> Entries(Count);
+	std::vector<unsigned int> Bigrams;
+
+	for (size_t i = 0; i < Count; ++i)
+		Ranks[i] = (unsigned int)i;
+
+	std::sort(Ranks.begin(), Ranks.end(), CompletionKeyLess(m_Text, m_Offsets));
+
+	// the keys are copied in rank order so that a range of ranks is a range of text
+	Text.reserve(m_Text.size());
+	Offsets.reserve(Count + 1);
+	Offsets.push_back(0);
+
+	for (size_t Rank = 0; Rank < Count; ++Rank)
+	{
+		size_t Start = m_Offsets[Ranks[Rank]];
+		size_t End = m_Offsets[Ranks[Rank] + 1];
+
+		Text.insert(Text.end(), m_Text.begin() + Start, m_Text.begin() + End);
+		Offsets.push_back(Text.size());
+		Entries[Rank] = m_Entries[Ranks[Rank]];
+	}
+
+	m_Text.swap(Text);
+	m_Offsets.swap(Offsets);
+	m_Entries.swap(Entries);
+
+	// best scores first, the order of the keys on a tie
+	m_Ranks.resize(Count);
+	m_Positions.resize(Count);
+
+	for (size_t i = 0; i < Count; ++i)
+		m_Ranks[i] = (unsigned int)i;
+
+	std::stable_sort(m_Ranks.begin(), m_Ranks.end(), CompletionScoreGreater(m_Scores, m_Entries));
+
+	for (size_t Position = 0; Position < Count; ++Position)
+		m_Positions[m_Ranks[Position]] = (unsigned int)Position;
+
+	m_MinPositions.assign(1, m_Positions);
+
+	for (size_t Level = 1, Width = 2; Width <= Count; ++Level, Width <<= 1)
+	{
+		const std::vector<unsigned int> &Previous = m_MinPositions[Level - 1];
+		std::vector<unsigned int> Current(Count - Width + 1);
+
+		for (size_t Rank = 0; Rank < Current.size(); ++Rank)
+			Current[Rank] = std::min(Previous[Rank], Previous[Rank + Width / 2]);
+
+		m_MinPositions.push_back(Current);
+	}
+
+	// indexed in score order, the postings are in that order as well
+	m_Postings.clear();
+
+	for (size_t Position = 0; Position < Count; ++Position)
+	{
+		size_t Rank = m_Ranks[Position];
+
+		Bigrams.clear();
+
+		for (size_t i = m_Offsets[Rank] + 1; i < m_Offsets[Rank + 1]; ++i)
+			Bigrams.push_back(GetBigram(m_Text[i - 1], m_Text[i]));
+
+		std::sort(Bigrams.begin(), Bigrams.end());
+		Bigrams.erase(std::unique(Bigrams.begin(), Bigrams.end()), Bigrams.end());
+
+		for (size_t i = 0; i < Bigrams.size(); ++i)
+			m_Postings[Bigrams[i]].push_back((unsigned int)Position);
+	}
+
+	m_Built = true;
+}
+
+//! \brief Rank with the best score among the ranks [First, Last), which can't be empty
+size_t SearchCompletion::GetBestRank(size_t First, size_t Last) const
+{
+	size_t Level = GetLevel(Last - First);
+	const std::vector<unsigned int> &MinPositions = m_MinPositions[Level];
+
+	return m_Ranks[std::min(MinPositions[First], MinPositions[Last - ((size_t)1 << Level)])];
+}
+
+//! \brief Compares the start of a key with a folded term: 0 if the key starts with the term
+int SearchCompletion::CompareKey(size_t Rank, const SearchTextChar *pTerm, size_t Length) const
+{
+	const SearchTextChar *pKey = m_Text.empty() ? NULL : &m_Text[0] + m_Offsets[Rank];
+	size_t KeyLength = m_Offsets[Rank + 1] - m_Offsets[Rank];
+
+	for (size_t i = 0; i < Length; ++i)
+	{
+		if (i >= KeyLength)
+			return -1;
+
+		if (pKey[i] != pTerm[i])
+			return (pKey[i] < pTerm[i]) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/*! \brief Finds the candidates starting with a text
+	\param[in] pPrefix : text typed, every candidate matches an empty one
+	\param[in] MaxResults : number of candidates to return at most
+	\param[out] Entries : indexes of the candidates, best score first and the order of their keys on a tie
+	\return the number of candidates found
+*/
+size_t SearchCompletion::FindPrefix(const wchar_t *pPrefix, size_t MaxResults, std::vector<size_t> &Entries) const
+{
+	std::vector<SearchTextChar> Prefix;
+	size_t Length = FoldText(pPrefix, Prefix);
+	size_t First = 0, Last = m_Entries.size();
+
+	Entries.clear();
+
+	if (m_Built == false || Last == 0)
+		return 0;
+
+	// first key that doesn't come before the prefix
+	while (First < Last)
+	{
+		size_t Middle = First + (Last - First) / 2;
+
+		if (CompareKey(Middle, Length ? &Prefix[0] : NULL, Length) < 0)
+			First = Middle + 1;
+		else
+			Last = Middle;
+	}
+
+	// first key after the ones starting with the prefix
+	Last = m_Entries.size();
+
+	for (size_t Low = First; Low < Last;)
+	{
+		size_t Middle = Low + (Last - Low) / 2;
+
+		if (CompareKey(Middle, Length ? &Prefix[0] : NULL, Length) == 0)
+			Low = Middle + 1;
+		else
+			Last = Middle;
+	}
+
+	// the best rank of a range is returned and the rest of the range split around it
+	std::vector<CompletionRange> Ranges;
+	CompletionRange Range;
+
+	if (First < Last)
+	{
+		Range.First = First;
+		Range.Last = Last;
+		Range.Best = GetBestRank(First, Last);
+		Range.Position = m_Positions[Range.Best];
+		Ranges.push_back(Range);
+	}
+
+	while (Ranges.empty() == false && Entries.size() < MaxResults)
+	{
+		CompletionRange Current = Ranges.front();
+
+		std::pop_heap(Ranges.begin(), Ranges.end(), CompareRange);
+		Ranges.pop_back();
+		Entries.push_back(m_Entries[Current.Best]);
+
+		if (Current.First < Current.Best)
+		{
+			Range.First = Current.First;
+			Range.Last = Current.Best;
+			Range.Best = GetBestRank(Range.First, Range.Last);
+			Range.Position = m_Positions[Range.Best];
+			Ranges.push_back(Range);
+			std::push_heap(Ranges.begin(), Ranges.end(), CompareRange);
+		}
+
+		if (Current.Best + 1 < Current.Last)
+		{
+			Range.First = Current.Best + 1;
+			Range.Last = Current.Last;
+			Range.Best = GetBestRank(Range.First, Range.Last);
+			Range.Position = m_Positions[Range.Best];
+			Ranges.push_back(Range);
+			std::push_heap(Ranges.begin(), Ranges.end(), CompareRange);
+		}
+	}
+
+	return Entries.size();
+}
+
+/*! \brief Finds the candidates containing a text
+	\param[in] pTerm : text typed, every candidate matches an empty one
+	\param[in] MaxResults : number of candidates to return at most
+	\param[out] Entries : indexes of the candidates, best score first and the order of their keys on a tie
+	\return the number of candidates found
+*/
+size_t SearchCompletion::FindContains(const wchar_t *pTerm, size_t MaxResults, std::vector<size_t> &Entries) const
+{
+	std::vector<SearchTextChar> Term;
+	size_t Length = FoldText(pTerm, Term);
+
+	Entries.clear();
+
+	if (m_Built == false || m_Entries.empty())
+		return 0;
+
+	if (Length == 0)
+		return FindPrefix(pTerm, MaxResults, Entries);
+
+	const SearchTextChar *pText = m_Text.empty() ? NULL : &m_Text[0];
+
+	if (Length == 1)
+	{
+		// a single character is in most keys, the best ones are enough
+		for (size_t Position = 0; Position < m_Entries.size() && Entries.size() < MaxResults; ++Position)
+		{
+			size_t Rank = m_Ranks[Position];
+
+			if (std::find(pText + m_Offsets[Rank], pText + m_Offsets[Rank + 1], Term[0]) != pText + m_Offsets[Rank + 1])
+				Entries.push_back(m_Entries[Rank]);
+		}
+
+		return Entries.size();
+	}
+
+	// every key containing the term contains all of its bigrams, the rarest one has the fewest candidates
+	const std::vector<unsigned int> *pRarest = NULL;
+
+	for (size_t i = 1; i < Length; ++i)
+	{
+		std::unordered_map<unsigned int, std::vector<unsigned int>>::const_iterator It =
+			m_Postings.find(GetBigram(Term[i - 1], Term[i]));
+
+		if (It == m_Postings.end())
+			return 0;
+
+		if (pRarest == NULL || It->second.size() < pRarest->size())
+			pRarest = &It->second;
+	}
+
+	for (size_t i = 0; i < pRarest->size() && Entries.size() < MaxResults; ++i)
+	{
+		size_t Rank = m_Ranks[(*pRarest)[i]];
+
+		if (SearchTextScan(pText, m_Offsets[Rank], m_Offsets[Rank + 1], &Term[0], Length) != m_Offsets[Rank + 1])
+			Entries.push_back(m_Entries[Rank]);
+	}
+
+	return Entries.size();
+}
@@ -0,0 +1,59 @@
+#ifndef __SEARCH_COMPLETION_CLASS__
+#define __SEARCH_COMPLETION_CLASS__
+
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+#include "SearchText.h"
+
+/*! \brief Candidates of an autocomplete list with case-folded keys kept in sorted order
+
+	The keys are folded once when the candidates are added and sorted by Build, a
+	prefix is then a contiguous range of ranks found by binary search. Substrings are
+	found through the bigram postings: only the candidates containing the rarest
+	bigram of the text are verified until enough of them matched.
+
+	Each candidate has a static score, both searches return the best scores first
+	and the order of the keys on a tie. Build numbers the candidates in that order
+	so that ranking costs nothing while searching: the postings are kept in score
+	order and the best candidates of a prefix range come from a sparse table of
+	range minimums, without visiting the rest of the range.
+*/
+class SearchCompletion
+{
+public:
+	SearchCompletion() : m_Built(true) {}
+
+	void Clear();
+	size_t Add(const wchar_t *pText, size_t Length, unsigned int Score = 0);
+	void Build();
+
+	size_t GetCount() const { return m_Entries.size(); }
+	bool IsBuilt() const { return m_Built; }
+
+	size_t FindPrefix(const wchar_t *pPrefix, size_t MaxResults, std::vector<size_t> &Entries) const;
+	size_t FindContains(const wchar_t *pTerm, size_t MaxResults, std::vector<size_t> &Entries) const;
+
+protected:
+	int CompareKey(size_t Rank, const SearchTextChar *pTerm, size_t Length) const;
+	size_t GetBestRank(size_t First, size_t Last) const;
+
+	std::vector<SearchTextChar> m_Text;
+	// key of rank r spans [m_Offsets[r], m_Offsets[r + 1]), in insertion order until Build
+	std::vector<size_t> m_Offsets;
+	// candidate (insertion index) of each rank
+	std::vector<unsigned int> m_Entries;
+	// score of each candidate, in insertion order
+	std::vector<unsigned int> m_Scores;
+	// position of each rank once sorted by score, and the rank at each position
+	std::vector<unsigned int> m_Positions;
+	std::vector<unsigned int> m_Ranks;
+	// m_MinPositions[j][r] is the best position among the ranks [r, r + 2^j)
+	std::vector<std::vector<unsigned int>> m_MinPositions;
+	// ascending positions of the keys containing each bigram
+	std::unordered_map<unsigned int, std::vector<unsigned int>> m_Postings;
+	bool m_Built;
+};
+
+#endif//__SEARCH_COMPLETION_CLASS__
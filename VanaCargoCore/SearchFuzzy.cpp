@@ -0,0 +1,337 @@
+#include "SearchFuzzy.h"
+
+#include <algorithm>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+static inline SearchTextChar FoldChar(wchar_t Char)
+{
+	return (SearchTextChar)towlower((wint_t)Char);
+}
+
+static inline SearchTextChar FoldChar(SearchTextChar Char)
+{
+	// the arena is folded already
+	return Char;
+}
+
+static inline unsigned int GetBigram(SearchTextChar First, SearchTextChar Second)
+{
+	return ((unsigned int)First << 16) | Second;
+}
+
+static bool CompareMatch(const FuzzyMatch &Left, const FuzzyMatch &Right)
+{
+	if (Left.Distance != Right.Distance)
+		return Left.Distance < Right.Distance;
+
+	if (Left.Field != Right.Field)
+		return Left.Field < Right.Field;
+
+	if (Left.Occurrences != Right.Occurrences)
+		return Left.Occurrences > Right.Occurrences;
+
+	return Left.Entry < Right.Entry;
+}
+
+FuzzyPattern::FuzzyPattern()
+{
+	memset(m_LowMasks, 0, sizeof(m_LowMasks));
+	m_LastBit = 0;
+	m_MaxDistance = 0;
+}
+
+//! \brief Number of typos tolerated for a term: none up to 3 characters, 1 up to 7, 2 above
+int FuzzyPattern::GetDefaultDistance(size_t Length)
+{
+	if (Length <= 3)
+		return 0;
+
+	return (Length <= 7) ? 1 : 2;
+}
+
+/*! \brief Prepares the term for matching
+	\param[in] pTerm : term to search, case-folded here
+	\param[in] MaxDistance : number of edits allowed, negative for the default of the term length
+	\return false if the term is empty or longer than FUZZY_MAX_TERM_LENGTH
+*/
+bool FuzzyPattern::Compile(const wchar_t *pTerm, int MaxDistance)
+{
+	size_t Length = (pTerm != NULL) ? wcslen(pTerm) : 0;
+
+	m_Term.clear();
+	m_HighChars.clear();
+	m_HighMasks.clear();
+	memset(m_LowMasks, 0, sizeof(m_LowMasks));
+	m_LastBit = 0;
+
+	if (Length == 0 || Length > FUZZY_MAX_TERM_LENGTH)
+		return false;
+
+	if (MaxDistance < 0)
+		MaxDistance = GetDefaultDistance(Length);
+
+	// with as many edits as characters everything would match
+	m_MaxDistance = (MaxDistance < (int)Length) ? MaxDistance : (int)Length - 1;
+	m_Term.resize(Length);
+	m_LastBit = 1ULL << (Length - 1);
+
+	for (size_t i = 0; i < Length; ++i)
+	{
+		SearchTextChar Char = FoldChar(pTerm[i]);
+		unsigned long long Bit = 1ULL << i;
+
+		m_Term[i] = Char;
+
+		if (Char < 256)
+			m_LowMasks[Char] |= Bit;
+		else
+		{
+			std::vector<SearchTextChar>::iterator It = std::find(m_HighChars.begin(), m_HighChars.end(), Char);
+
+			if (It == m_HighChars.end())
+			{
+				m_HighChars.push_back(Char);
+				m_HighMasks.push_back(Bit);
+			}
+			else
+				m_HighMasks[It - m_HighChars.begin()] |= Bit;
+		}
+	}
+
+	return true;
+}
+
+unsigned long long FuzzyPattern::GetMask(SearchTextChar Char) const
+{
+	if (Char < 256)
+		return m_LowMasks[Char];
+
+	for (size_t i = 0; i < m_HighChars.size(); ++i)
+	{
+		if (m_HighChars[i] == Char)
+			return m_HighMasks[i];
+	}
+
+	return 0;
+}
+
+// one column of the edit distance matrix, the match may start anywhere in the text
+void FuzzyPattern::Step(SearchTextChar Char, unsigned long long &Pv, unsigned long long &Mv, int &Distance) const
+{
+	unsigned long long Eq = GetMask(Char);
+	unsigned long long Xv = Eq | Mv;
+	unsigned long long Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+	unsigned long long Ph = Mv | ~(Xh | Pv);
+	unsigned long long Mh = Pv & Xh;
+
+	if (Ph & m_LastBit)
+		++Distance;
+	else if (Mh & m_LastBit)
+		--Distance;
+
+	Ph <<= 1;
+	Mh <<= 1;
+	Pv = Mh | ~(Xv | Ph);
+	Mv = Ph & Xv;
+}
+
+template <class T> bool FuzzyPattern::MatchText(const T *pText, size_t Length, FuzzyScore &Score) const
+{
+	unsigned long long Pv = ~0ULL, Mv = 0;
+	int Distance = (int)m_Term.size();
+	int Best = Distance;
+	bool Inside = false;
+
+	Score.Distance = (unsigned short)Distance;
+	Score.Occurrences = 0;
+
+	if (pText == NULL || m_Term.empty())
+		return false;
+
+	for (size_t i = 0; i < Length; ++i)
+	{
+		Step(FoldChar(pText[i]), Pv, Mv, Distance);
+
+		if (Distance < Best)
+			Best = Distance;
+
+		// consecutive end positions within the distance belong to the same occurrence
+		if (Distance <= m_MaxDistance)
+		{
+			if (Inside == false && Score.Occurrences < 0xFFFF)
+				++Score.Occurrences;
+
+			Inside = true;
+		}
+		else
+			Inside = false;
+	}
+
+	Score.Distance = (unsigned short)Best;
+
+	return Best <= m_MaxDistance;
+}
+
+bool FuzzyPattern::Match(const wchar_t *pText, size_t Length, FuzzyScore &Score) const
+{
+	return MatchText(pText, Length, Score);
+}
+
+bool FuzzyPattern::Match(const SearchTextChar *pText, size_t Length, FuzzyScore &Score) const
+{
+	return MatchText(pText, Length, Score);
+}
+
+void FuzzyIndex::Clear()
+{
+	m_Text.clear();
+	m_Offsets.clear();
+	m_Postings.clear();
+}
+
+/*! \brief Appends an entry to the index
+	\param[in] ppFields : FUZZY_FIELD_COUNT texts, NULL for a missing field
+	\param[in] pLengths : length of each text
+	\return the index of the entry
+*/
+size_t FuzzyIndex::AddEntry(const wchar_t * const *ppFields, const size_t *pLengths)
+{
+	std::vector<unsigned int> Bigrams;
+	unsigned int Entry = (unsigned int)GetCount();
+
+	if (m_Offsets.empty())
+		m_Offsets.push_back(0);
+
+	for (int Field = 0; Field < FUZZY_FIELD_COUNT; ++Field)
+	{
+		const wchar_t *pText = ppFields[Field];
+		size_t Length = (pText != NULL) ? pLengths[Field] : 0;
+		size_t Start = m_Text.size();
+
+		m_Text.resize(Start + Length);
+
+		for (size_t i = 0; i < Length; ++i)
+		{
+			m_Text[Start + i] = FoldChar(pText[i]);
+
+			if (i > 0)
+				Bigrams.push_back(GetBigram(m_Text[Start + i - 1], m_Text[Start + i]));
+		}
+
+		m_Offsets.push_back(m_Text.size());
+	}
+
+	std::sort(Bigrams.begin(), Bigrams.end());
+	Bigrams.erase(std::unique(Bigrams.begin(), Bigrams.end()), Bigrams.end());
+
+	for (size_t i = 0; i < Bigrams.size(); ++i)
+		m_Postings[Bigrams[i]].push_back(Entry);
+
+	return Entry;
+}
+
+void FuzzyIndex::Verify(const FuzzyPattern &Pattern, unsigned int Entry, std::vector<FuzzyMatch> &Matches) const
+{
+	const size_t *pOffsets = &m_Offsets[Entry * FUZZY_FIELD_COUNT];
+	FuzzyMatch Match;
+	FuzzyScore Score;
+	bool Found = false;
+
+	Match.Entry = Entry;
+	Match.Distance = 0xFFFF;
+	Match.Field = 0;
+	Match.Occurrences = 0;
+
+	for (int Field = 0; Field < FUZZY_FIELD_COUNT; ++Field)
+	{
+		size_t Length = pOffsets[Field + 1] - pOffsets[Field];
+
+		if (Length == 0 || Pattern.Match(&m_Text[pOffsets[Field]], Length, Score) == false)
+			continue;
+
+		// the best field wins, earlier fields on a tie
+		if (Score.Distance < Match.Distance)
+		{
+			Match.Distance = Score.Distance;
+			Match.Field = (unsigned short)Field;
+		}
+
+		Match.Occurrences = (unsigned short)std::min(0xFFFF, Match.Occurrences + Score.Occurrences);
+		Found = true;
+	}
+
+	if (Found)
+		Matches.push_back(Match);
+}
+
+/*! \brief Finds the entries containing the term with at most MaxDistance typos
+	\param[in] pTerm : term to search
+	\param[in] MaxDistance : number of edits allowed, negative for the default of the term length
+	\param[out] Matches : matching entries by distance, field then number of occurrences
+	\param[in] MaxMatches : maximum number of matches to return, 0 for all of them
+	\return the number of matches
+*/
+size_t FuzzyIndex::Search(const wchar_t *pTerm, int MaxDistance, std::vector<FuzzyMatch> &Matches, size_t MaxMatches) const
+{
+	FuzzyPattern Pattern;
+	size_t Count = GetCount();
+
+	Matches.clear();
+
+	if (Count == 0 || Pattern.Compile(pTerm, MaxDistance) == false)
+		return 0;
+
+	const SearchTextChar *pFolded = Pattern.GetTerm();
+	std::vector<unsigned int> Bigrams;
+
+	for (size_t i = 1; i < Pattern.GetLength(); ++i)
+		Bigrams.push_back(GetBigram(pFolded[i - 1], pFolded[i]));
+
+	std::sort(Bigrams.begin(), Bigrams.end());
+	Bigrams.erase(std::unique(Bigrams.begin(), Bigrams.end()), Bigrams.end());
+
+	// every edit destroys at most 2 bigrams of the term
+	int Threshold = (int)Bigrams.size() - 2 * Pattern.GetMaxDistance();
+
+	if (Threshold <= 0)
+	{
+		for (size_t Entry = 0; Entry < Count; ++Entry)
+			Verify(Pattern, (unsigned int)Entry, Matches);
+	}
+	else
+	{
+		std::vector<unsigned char> Shared(Count, 0);
+		std::vector<unsigned int> Candidates;
+
+		for (size_t i = 0; i < Bigrams.size(); ++i)
+		{
+			std::unordered_map<unsigned int, std::vector<unsigned int>>::const_iterator It = m_Postings.find(Bigrams[i]);
+
+			if (It == m_Postings.end())
+				continue;
+
+			const std::vector<unsigned int> &Entries = It->second;
+
+			for (size_t j = 0; j < Entries.size(); ++j)
+			{
+				if (++Shared[Entries[j]] == Threshold)
+					Candidates.push_back(Entries[j]);
+			}
+		}
+
+		for (size_t i = 0; i < Candidates.size(); ++i)
+			Verify(Pattern, Candidates[i], Matches);
+	}
+
+	if (MaxMatches != 0 && Matches.size() > MaxMatches)
+	{
+		std::partial_sort(Matches.begin(), Matches.begin() + MaxMatches, Matches.end(), CompareMatch);
+		Matches.resize(MaxMatches);
+	}
+	else
+		std::sort(Matches.begin(), Matches.end(), CompareMatch);
+
+	return Matches.size();
+}
@@ -0,0 +1,95 @@
+#ifndef __SEARCH_FUZZY_CLASS__
+#define __SEARCH_FUZZY_CLASS__
+
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+#include "SearchText.h"
+
+// the bit-parallel verification keeps one bit per character of the term
+#define FUZZY_MAX_TERM_LENGTH 64
+
+// fields of an index entry, in ranking order
+enum FUZZY_FIELD
+{
+	FUZZY_FIELD_NAME = 0,
+	FUZZY_FIELD_LOG_NAME,
+	FUZZY_FIELD_DESCRIPTION,
+	FUZZY_FIELD_COUNT
+};
+
+typedef struct _FuzzyScore
+{
+	// smallest number of edits between the term and a part of the text
+	unsigned short Distance;
+	// number of places where the term matches within the allowed distance
+	unsigned short Occurrences;
+} FuzzyScore;
+
+typedef struct _FuzzyMatch
+{
+	unsigned int Entry;
+	unsigned short Distance;
+	unsigned short Field;
+	unsigned short Occurrences;
+} FuzzyMatch;
+
+/*! \brief Term compiled for approximate substring matching (Myers' bit-parallel algorithm)
+*/
+class FuzzyPattern
+{
+public:
+	FuzzyPattern();
+
+	bool Compile(const wchar_t *pTerm, int MaxDistance);
+	bool Match(const wchar_t *pText, size_t Length, FuzzyScore &Score) const;
+	bool Match(const SearchTextChar *pText, size_t Length, FuzzyScore &Score) const;
+
+	size_t GetLength() const { return m_Term.size(); }
+	int GetMaxDistance() const { return m_MaxDistance; }
+	const SearchTextChar* GetTerm() const { return m_Term.empty() ? NULL : &m_Term[0]; }
+
+	static int GetDefaultDistance(size_t Length);
+
+protected:
+	unsigned long long GetMask(SearchTextChar Char) const;
+	void Step(SearchTextChar Char, unsigned long long &Pv, unsigned long long &Mv, int &Distance) const;
+	template <class T> bool MatchText(const T *pText, size_t Length, FuzzyScore &Score) const;
+
+	std::vector<SearchTextChar> m_Term;
+	// match masks of the characters of the term, a table for the first 256 code units
+	unsigned long long m_LowMasks[256];
+	std::vector<SearchTextChar> m_HighChars;
+	std::vector<unsigned long long> m_HighMasks;
+	unsigned long long m_LastBit;
+	int m_MaxDistance;
+};
+
+/*! \brief Bigram index over the texts of a catalog with bounded edit distance verification
+
+	Entries are appended once and never removed, an entry has up to FUZZY_FIELD_COUNT
+	fields. A part of a text within k edits of a term of length m shares at least
+	(m - 1) - 2k bigrams with it, only the entries reaching that count are verified.
+*/
+class FuzzyIndex
+{
+public:
+	void Clear();
+	size_t AddEntry(const wchar_t * const *ppFields, const size_t *pLengths);
+
+	size_t GetCount() const { return m_Offsets.empty() ? 0 : (m_Offsets.size() - 1) / FUZZY_FIELD_COUNT; }
+
+	size_t Search(const wchar_t *pTerm, int MaxDistance, std::vector<FuzzyMatch> &Matches, size_t MaxMatches) const;
+
+protected:
+	void Verify(const FuzzyPattern &Pattern, unsigned int Entry, std::vector<FuzzyMatch> &Matches) const;
+
+	std::vector<SearchTextChar> m_Text;
+	// field f of entry e spans [m_Offsets[e * FUZZY_FIELD_COUNT + f], m_Offsets[e * FUZZY_FIELD_COUNT + f + 1])
+	std::vector<size_t> m_Offsets;
+	// ascending entries containing each bigram
+	std::unordered_map<unsigned int, std::vector<unsigned int>> m_Postings;
+};
+
+#endif//__SEARCH_FUZZY_CLASS__
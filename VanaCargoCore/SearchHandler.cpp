@@ -3,39 +3,6 @@
 #include "FFXIHelper.h"
 #include "SearchHandler.h"
 
-int SearchHandler::ProcessSearchTerm(InventoryItem *pItem)
-{
-	if (m_pSearchData != NULL && pItem != NULL &&
-		m_pSearchData->pParams->pSearchTerm &&
-		_tcslen(m_pSearchData->pParams->pSearchTerm) > 0)
-	{
-		CString lcString;
-
-		// search in the item name
-		lcString = pItem->ItemName;
-		lcString = lcString.MakeLower();
-
-		if (lcString.Find(m_pSearchData->pParams->pSearchTerm) != -1)
-			return 1;
-		// search in the item full name
-		lcString = pItem->LogName;
-		lcString = lcString.MakeLower();
-
-		if (lcString.Find(m_pSearchData->pParams->pSearchTerm) != -1)
-			return 1;
-		// search in the item full name
-		lcString = pItem->ItemDescription;
-		lcString = lcString.MakeLower();
-
-		if (lcString.Find(m_pSearchData->pParams->pSearchTerm) != -1)
-			return 1;
-
-		return 0;
-	}
-
-	return -1;
-}
-
 int SearchHandler::ProcessLevelRange(InventoryItem *pItem)
 {
 	if (m_pSearchData != NULL && pItem != NULL)
@@ -212,58 +179,166 @@ int SearchHandler::ProcessRareEx(InventoryItem *pItem)
 	return -1;
 }
 
-void SearchHandler::ProcessAll(InventoryItem *pItem)
+void SearchHandler::GetSearchCriteria(const SearchParams *pParams, SearchCriteria &Criteria)
 {
-	if (m_pSearchData != NULL)
+	SecureZeroMemory(&Criteria, sizeof(Criteria));
+
+	if (pParams != NULL)
 	{
-		bool Result = false;
-		const int Size = 10;
-		int Res[Size];
-
-		SecureZeroMemory(&Res, Size);
-
-		Res[0] = ProcessSearchTerm(pItem);
-		Res[1] = ProcessLevelRange(pItem);
-		Res[2] = ProcessDelayRange(pItem);
-		Res[3] = ProcessDmgRange(pItem);
-		Res[4] = ProcessDefRange(pItem);
-		Res[5] = ProcessJobs(pItem);
-		Res[6] = ProcessSlot(pItem);
-		Res[7] = ProcessSkill(pItem);
-		Res[8] = ProcessRaces(pItem);
-		Res[9] = ProcessRareEx(pItem);
-
-		for (int i = 0; i < Size; i++)
-		{
-			if (Res[i] == 1)
-				Result = true;
-			else if (Res[i] == 0)
-				return;
-		}
+		Criteria.JobsBitMask = pParams->JobsBitMask;
+		Criteria.SlotBitMask = pParams->SlotBitMask;
+		Criteria.RacesBitMask = pParams->RacesBitMask;
+		Criteria.Skill = pParams->Skill;
+		Criteria.MinLevel = pParams->MinLevel;
+		Criteria.MaxLevel = pParams->MaxLevel;
+		Criteria.MinDelay = pParams->MinDelay;
+		Criteria.MaxDelay = pParams->MaxDelay;
+		Criteria.MinDmg = pParams->MinDmg;
+		Criteria.MaxDmg = pParams->MaxDmg;
+		Criteria.MinDef = pParams->MinDef;
+		Criteria.MaxDef = pParams->MaxDef;
+		Criteria.Rare = pParams->Rare;
+		Criteria.Exclusive = pParams->Exclusive;
+	}
+}
 
-		if (Result)
-			m_pSearchData->Items.SetAt(pItem->ItemHdr.ItemID, pItem);
+void SearchHandler::GetSearchFields(const InventoryItem *pItem, SearchFields &Fields)
+{
+	SecureZeroMemory(&Fields, sizeof(Fields));
+
+	if (pItem == NULL)
+		return;
+
+	Fields.Flags = pItem->ItemHdr.Flags;
+	// the delay filter has always read the weapon record regardless of the item type
+	Fields.Delay = pItem->WeaponInfo.Delay;
+
+	if (pItem->ItemHdr.Type == ITEM_OBJECT_TYPE_ARMOR)
+	{
+		Fields.Class = SEARCH_CLASS_ARMOR;
+		Fields.Jobs = pItem->ArmorInfo.Jobs;
+		Fields.Slot = pItem->ArmorInfo.Slot;
+		Fields.Races = pItem->ArmorInfo.Races;
+		Fields.Level = pItem->ArmorInfo.Level;
+		Fields.ItemLevel = pItem->ArmorInfo.iLevel;
+		Fields.Defense = pItem->ArmorInfo.Defense;
+	}
+	else if (pItem->ItemHdr.Type == ITEM_OBJECT_TYPE_WEAPON)
+	{
+		Fields.Class = SEARCH_CLASS_WEAPON;
+		Fields.Jobs = pItem->WeaponInfo.Jobs;
+		Fields.Slot = pItem->WeaponInfo.Slot;
+		Fields.Races = pItem->WeaponInfo.Races;
+		Fields.Level = pItem->WeaponInfo.Level;
+		Fields.ItemLevel = pItem->WeaponInfo.iLevel;
+		Fields.Skill = pItem->WeaponInfo.Skill;
+		Fields.Damage = pItem->WeaponInfo.Damage;
 	}
+	else
+		Fields.Class = SEARCH_CLASS_OTHER;
 }
 
-bool SearchHandler::VerifyRange(int &Min, int &Max)
+/*! \brief Switches the term matching to a few typos, used when the exact term found nothing
+	\return false if the term is too short or too long to tolerate typos
+*/
+bool SearchHandler::EnableFuzzy()
 {
-	if (Min == 0 && Max == 0)
+	const TCHAR *pTerm = (m_pSearchData != NULL && m_pSearchData->pParams != NULL) ? m_pSearchData->pParams->pSearchTerm : NULL;
+
+	if (m_FuzzyPattern.Compile(pTerm, -1) == false || m_FuzzyPattern.GetMaxDistance() == 0)
 		return false;
 
-	if (Max == 0)
-		Max = Min;
-	else if (Min == 0)
-		Min = Max;
-	else if (Min > Max)
+	m_Fuzzy = true;
+
+	return true;
+}
+
+void SearchHandler::CompileParams()
+{
+	SearchCriteria Criteria;
+
+	GetSearchCriteria((m_pSearchData != NULL) ? m_pSearchData->pParams : NULL, Criteria);
+	m_Program.Compile(Criteria);
+}
+
+void SearchHandler::ProcessAll(InventoryItem *pItem)
+{
+	ProcessBatch(&pItem, 1);
+}
+
+void SearchHandler::ProcessBatch(InventoryItem **ppItems, int Count)
+{
+	if (m_pSearchData == NULL || m_pSearchData->pParams == NULL ||
+		ppItems == NULL || Count <= 0 || m_Program.NeverMatches())
+		return;
+
+	SearchFields Fields;
+
+	m_BatchColumns.Clear();
+	m_BatchColumns.Reserve(Count);
+
+	for (int i = 0; i < Count; i++)
+	{
+		GetSearchFields(ppItems[i], Fields);
+		m_BatchColumns.Add(Fields);
+	}
+
+	// the numeric filters narrow the batch down before any string is compared
+	if (m_Program.Filter(m_BatchColumns, m_Selection) == 0)
+		return;
+
+	const TCHAR *pTerm = m_pSearchData->pParams->pSearchTerm;
+
+	if (m_Fuzzy)
+	{
+		FuzzyScore Score;
+
+		for (size_t i = m_Selection.FindNext(0); i < (size_t)Count; i = m_Selection.FindNext(i + 1))
+		{
+			InventoryItem *pItem = ppItems[i];
+
+			if (pItem == NULL ||
+				(m_FuzzyPattern.Match(pItem->ItemName.GetString(), pItem->ItemName.GetLength(), Score) == false &&
+				 m_FuzzyPattern.Match(pItem->LogName.GetString(), pItem->LogName.GetLength(), Score) == false &&
+				 m_FuzzyPattern.Match(pItem->ItemDescription.GetString(), pItem->ItemDescription.GetLength(), Score) == false))
+				m_Selection.Reset(i);
+		}
+	}
+	else if (pTerm != NULL && pTerm[0] != '\0')
+	{
+		m_BatchText.Clear();
+
+		// name, log name and description, folded into one buffer instead of a lowered copy per field
+		for (int i = 0; i < Count; i++)
+		{
+			InventoryItem *pItem = ppItems[i];
+
+			m_BatchText.AddItem();
+
+			if (pItem != NULL && m_Selection.Test(i))
+			{
+				m_BatchText.AddField(pItem->ItemName.GetString(), pItem->ItemName.GetLength(), SEARCH_TEXT_FIELD_NAME);
+				m_BatchText.AddField(pItem->LogName.GetString(), pItem->LogName.GetLength(), SEARCH_TEXT_FIELD_LOG_NAME);
+				m_BatchText.AddField(pItem->ItemDescription.GetString(), pItem->ItemDescription.GetLength(), SEARCH_TEXT_FIELD_DESCRIPTION);
+			}
+		}
+
+		if (m_BatchText.Refine(pTerm, m_Selection) == 0)
+			return;
+	}
+
+	for (size_t i = m_Selection.FindNext(0); i < (size_t)Count; i = m_Selection.FindNext(i + 1))
 	{
-		int Temp = Max;
+		InventoryItem *pItem = ppItems[i];
 
-		Max = Min;
-		Min = Temp;
+		if (pItem != NULL)
+			m_pSearchData->Items.SetAt(pItem->ItemHdr.ItemID, pItem);
 	}
+}
 
-	return true;
+bool SearchHandler::VerifyRange(int &Min, int &Max)
+{
+	return SearchProgram::NormalizeRange(Min, Max);
 }
 
 bool SearchHandler::CheckRange(int Min, int Max, int Value)
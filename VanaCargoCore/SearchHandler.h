@@ -1,6 +1,11 @@
 #ifndef __SEARCH_HANDLER_CLASS__
 #define __SEARCH_HANDLER_CLASS__
 
+#include "SearchProgram.h"
+#include "SearchKernel.h"
+#include "SearchText.h"
+#include "SearchFuzzy.h"
+
 typedef struct _SearchParams
 {
 	TCHAR *pSearchTerm;
@@ -40,13 +45,14 @@ public:
 	SearchHandler(SearchData *pData)
 	{
 		m_pSearchData = pData;
+		m_Fuzzy = false;
+		CompileParams();
 	}
 	virtual ~SearchHandler()
 	{
 		m_pSearchData = NULL;
 	}
 
-	int ProcessSearchTerm(InventoryItem *pItem);
 	int ProcessLevelRange(InventoryItem *pItem);
 	int ProcessDelayRange(InventoryItem *pItem);
 	int ProcessDmgRange(InventoryItem *pItem);
@@ -58,11 +64,24 @@ public:
 	int ProcessRareEx(InventoryItem *pItem);
 
 	void ProcessAll(InventoryItem *pItem);
+	void ProcessBatch(InventoryItem **ppItems, int Count);
+	bool EnableFuzzy();
+
+	static void GetSearchFields(const InventoryItem *pItem, SearchFields &Fields);
+	static void GetSearchCriteria(const SearchParams *pParams, SearchCriteria &Criteria);
 
 	bool VerifyRange(int &Min, int &Max);
 	bool CheckRange(int Min, int Max, int Value);
 protected:
+	void CompileParams();
+
 	SearchData *m_pSearchData;
+	SearchProgram m_Program;
+	SearchColumns m_BatchColumns;
+	SearchBitset m_Selection;
+	SearchTextArena m_BatchText;
+	FuzzyPattern m_FuzzyPattern;
+	bool m_Fuzzy;
 };
 
 #endif//__SEARCH_HANDLER_CLASS__
\ No newline at end of file
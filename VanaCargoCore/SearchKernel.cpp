@@ -0,0 +1,339 @@
+#include "SearchKernel.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#define SEARCH_KERNEL_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define SEARCH_KERNEL_AVX2
+	#else
+		#define SEARCH_KERNEL_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+static unsigned int CountBits(unsigned int Value)
+{
+	Value = Value - ((Value >> 1) & 0x55555555);
+	Value = (Value & 0x33333333) + ((Value >> 2) & 0x33333333);
+
+	return (((Value + (Value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+static unsigned int LowestBit(unsigned int Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+
+	_BitScanForward(&Index, Value);
+
+	return (unsigned int)Index;
+#else
+	return (unsigned int)__builtin_ctz(Value);
+#endif
+}
+
+void SearchBitset::Resize(size_t Count, bool Value)
+{
+	m_Count = Count;
+	m_Words.assign((Count + SEARCH_BITSET_WORD_BITS - 1) / SEARCH_BITSET_WORD_BITS, Value ? 0xFFFFFFFF : 0);
+
+	// keep the bits past the end cleared so that counting never needs a mask
+	if (Value && (Count % SEARCH_BITSET_WORD_BITS) != 0)
+		m_Words.back() = (1U << (Count % SEARCH_BITSET_WORD_BITS)) - 1;
+}
+
+void SearchBitset::And(const SearchBitset &Other)
+{
+	size_t WordCount = (m_Words.size() < Other.m_Words.size()) ? m_Words.size() : Other.m_Words.size();
+
+	for (size_t i = 0; i < WordCount; ++i)
+		m_Words[i] &= Other.m_Words[i];
+
+	for (size_t i = WordCount; i < m_Words.size(); ++i)
+		m_Words[i] = 0;
+}
+
+void SearchBitset::AndNot(const SearchBitset &Other)
+{
+	size_t WordCount = (m_Words.size() < Other.m_Words.size()) ? m_Words.size() : Other.m_Words.size();
+
+	for (size_t i = 0; i < WordCount; ++i)
+		m_Words[i] &= ~Other.m_Words[i];
+}
+
+void SearchBitset::Or(const SearchBitset &Other)
+{
+	size_t WordCount = (m_Words.size() < Other.m_Words.size()) ? m_Words.size() : Other.m_Words.size();
+
+	for (size_t i = 0; i < WordCount; ++i)
+		m_Words[i] |= Other.m_Words[i];
+}
+
+bool SearchBitset::IsEmpty() const
+{
+	for (size_t i = 0; i < m_Words.size(); ++i)
+	{
+		if (m_Words[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+size_t SearchBitset::CountSet() const
+{
+	size_t Result = 0;
+
+	for (size_t i = 0; i < m_Words.size(); ++i)
+		Result += CountBits(m_Words[i]);
+
+	return Result;
+}
+
+/*! \brief Finds the first set bit at or after Index
+	\return the index of the bit or GetCount() if there is none
+*/
+size_t SearchBitset::FindNext(size_t Index) const
+{
+	size_t WordIndex = Index / SEARCH_BITSET_WORD_BITS;
+
+	if (Index >= m_Count)
+		return m_Count;
+
+	unsigned int Word = m_Words[WordIndex] & (0xFFFFFFFF << (Index % SEARCH_BITSET_WORD_BITS));
+
+	while (Word == 0)
+	{
+		if (++WordIndex >= m_Words.size())
+			return m_Count;
+
+		Word = m_Words[WordIndex];
+	}
+
+	return WordIndex * SEARCH_BITSET_WORD_BITS + LowestBit(Word);
+}
+
+void SearchColumns::Clear()
+{
+	Class.clear();
+	Jobs.clear();
+	Slot.clear();
+	Races.clear();
+	Flags.clear();
+	Skill.clear();
+	Level.clear();
+	ItemLevel.clear();
+	Damage.clear();
+	Delay.clear();
+	Defense.clear();
+}
+
+void SearchColumns::Reserve(size_t Count)
+{
+	Class.reserve(Count);
+	Jobs.reserve(Count);
+	Slot.reserve(Count);
+	Races.reserve(Count);
+	Flags.reserve(Count);
+	Skill.reserve(Count);
+	Level.reserve(Count);
+	ItemLevel.reserve(Count);
+	Damage.reserve(Count);
+	Delay.reserve(Count);
+	Defense.reserve(Count);
+}
+
+void SearchColumns::Add(const SearchFields &Fields)
+{
+	Class.push_back(Fields.Class);
+	Jobs.push_back(Fields.Jobs);
+	Slot.push_back(Fields.Slot);
+	Races.push_back(Fields.Races);
+	Flags.push_back(Fields.Flags);
+	Skill.push_back(Fields.Skill);
+	Level.push_back(Fields.Level);
+	ItemLevel.push_back(Fields.ItemLevel);
+	Damage.push_back(Fields.Damage);
+	Delay.push_back(Fields.Delay);
+	Defense.push_back(Fields.Defense);
+}
+
+// Start is always a multiple of SEARCH_BITSET_WORD_BITS, each word is built in a register
+static void MaskCompareScalar(const unsigned int *pValues, size_t Start, size_t Count,
+							  unsigned int AndMask, unsigned int Expected, bool Equal,
+							  unsigned int *pWords)
+{
+	for (size_t Block = Start; Block < Count; Block += SEARCH_BITSET_WORD_BITS)
+	{
+		size_t End = (Count - Block < SEARCH_BITSET_WORD_BITS) ? Count - Block : SEARCH_BITSET_WORD_BITS;
+		unsigned int Word = 0;
+
+		for (size_t i = 0; i < End; ++i)
+			Word |= (unsigned int)(((pValues[Block + i] & AndMask) == Expected) == Equal) << i;
+
+		pWords[Block / SEARCH_BITSET_WORD_BITS] = Word;
+	}
+}
+
+static void RangeScalar(const unsigned int *pValues, size_t Start, size_t Count,
+						unsigned int Min, unsigned int Max, unsigned int *pWords)
+{
+	for (size_t Block = Start; Block < Count; Block += SEARCH_BITSET_WORD_BITS)
+	{
+		size_t End = (Count - Block < SEARCH_BITSET_WORD_BITS) ? Count - Block : SEARCH_BITSET_WORD_BITS;
+		unsigned int Word = 0;
+
+		for (size_t i = 0; i < End; ++i)
+			Word |= (unsigned int)(pValues[Block + i] - Min <= Max - Min) << i;
+
+		pWords[Block / SEARCH_BITSET_WORD_BITS] = Word;
+	}
+}
+
+#ifdef SEARCH_KERNEL_X86
+// 32 values per iteration: four compares of 8 lanes, each movemask yields 8 bits of the word
+SEARCH_KERNEL_AVX2 static size_t MaskCompareAVX2(const unsigned int *pValues, size_t Count,
+												 unsigned int AndMask, unsigned int Expected, bool Equal,
+												 unsigned int *pWords)
+{
+	const __m256i Mask = _mm256_set1_epi32((int)AndMask);
+	const __m256i Value = _mm256_set1_epi32((int)Expected);
+	const unsigned int Invert = Equal ? 0 : 0xFFFFFFFF;
+	size_t Blocks = Count / SEARCH_BITSET_WORD_BITS;
+
+	for (size_t Block = 0; Block < Blocks; ++Block)
+	{
+		const __m256i *pSrc = (const __m256i*)(pValues + Block * SEARCH_BITSET_WORD_BITS);
+		unsigned int Word = 0;
+
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			__m256i Data = _mm256_and_si256(_mm256_loadu_si256(pSrc + Lane), Mask);
+			__m256i Cmp = _mm256_cmpeq_epi32(Data, Value);
+
+			Word |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(Cmp)) << (Lane * 8);
+		}
+
+		pWords[Block] = Word ^ Invert;
+	}
+
+	return Blocks * SEARCH_BITSET_WORD_BITS;
+}
+
+SEARCH_KERNEL_AVX2 static size_t RangeAVX2(const unsigned int *pValues, size_t Count,
+										   unsigned int Min, unsigned int Max,
+										   unsigned int *pWords)
+{
+	// unsigned compare through the sign flip: a <= b <=> (a ^ 0x80000000) <= (b ^ 0x80000000) signed
+	const __m256i Sign = _mm256_set1_epi32((int)0x80000000);
+	const __m256i Lower = _mm256_set1_epi32((int)(Min ^ 0x80000000));
+	const __m256i Upper = _mm256_set1_epi32((int)(Max ^ 0x80000000));
+	size_t Blocks = Count / SEARCH_BITSET_WORD_BITS;
+
+	for (size_t Block = 0; Block < Blocks; ++Block)
+	{
+		const __m256i *pSrc = (const __m256i*)(pValues + Block * SEARCH_BITSET_WORD_BITS);
+		unsigned int Word = 0;
+
+		for (int Lane = 0; Lane < 4; ++Lane)
+		{
+			__m256i Data = _mm256_xor_si256(_mm256_loadu_si256(pSrc + Lane), Sign);
+			__m256i Outside = _mm256_or_si256(_mm256_cmpgt_epi32(Lower, Data), _mm256_cmpgt_epi32(Data, Upper));
+
+			Word |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(Outside)) << (Lane * 8);
+		}
+
+		pWords[Block] = ~Word;
+	}
+
+	return Blocks * SEARCH_BITSET_WORD_BITS;
+}
+
+static bool DetectAVX2()
+{
+#ifdef _MSC_VER
+	int Info[4];
+
+	__cpuid(Info, 0);
+
+	if (Info[0] < 7)
+		return false;
+
+	__cpuid(Info, 1);
+
+	// AVX and OSXSAVE, then the OS must have enabled the YMM state
+	if ((Info[2] & (1 << 27)) == 0 || (Info[2] & (1 << 28)) == 0)
+		return false;
+
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(Info, 7, 0);
+
+	return (Info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+static bool g_UseAVX2 = DetectAVX2();
+#else
+static bool g_UseAVX2 = false;
+#endif
+
+bool SearchKernelHasAVX2()
+{
+	return g_UseAVX2;
+}
+
+/*! \brief Turns the AVX2 path on or off, used to compare against the scalar kernel
+	\param[in] Enable : true to use AVX2 when the CPU supports it
+*/
+void SearchKernelEnableAVX2(bool Enable)
+{
+#ifdef SEARCH_KERNEL_X86
+	g_UseAVX2 = Enable && DetectAVX2();
+#else
+	g_UseAVX2 = false;
+#endif
+}
+
+void SearchKernelMaskCompare(const unsigned int *pValues, size_t Count,
+							 unsigned int AndMask, unsigned int Expected, bool Equal,
+							 SearchBitset &Result)
+{
+	size_t Done = 0;
+
+	Result.Resize(Count, false);
+
+	if (Count == 0)
+		return;
+
+#ifdef SEARCH_KERNEL_X86
+	if (g_UseAVX2)
+		Done = MaskCompareAVX2(pValues, Count, AndMask, Expected, Equal, Result.GetWords());
+#endif
+
+	MaskCompareScalar(pValues, Done, Count, AndMask, Expected, Equal, Result.GetWords());
+}
+
+void SearchKernelRange(const unsigned int *pValues, size_t Count,
+					   unsigned int Min, unsigned int Max,
+					   SearchBitset &Result)
+{
+	size_t Done = 0;
+
+	Result.Resize(Count, false);
+
+	if (Count == 0 || Min > Max)
+		return;
+
+#ifdef SEARCH_KERNEL_X86
+	if (g_UseAVX2)
+		Done = RangeAVX2(pValues, Count, Min, Max, Result.GetWords());
+#endif
+
+	RangeScalar(pValues, Done, Count, Min, Max, Result.GetWords());
+}
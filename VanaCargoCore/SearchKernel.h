@@ -0,0 +1,77 @@
+#ifndef __SEARCH_KERNEL_CLASS__
+#define __SEARCH_KERNEL_CLASS__
+
+#include <stddef.h>
+#include <vector>
+
+#include "SearchProgram.h"
+
+#define SEARCH_BITSET_WORD_BITS 32
+
+/*! \brief One bit per item, combined with AND/OR to intersect or merge predicates
+*/
+class SearchBitset
+{
+public:
+	SearchBitset() : m_Count(0) {}
+
+	void Resize(size_t Count, bool Value);
+	void Clear() { Resize(m_Count, false); }
+
+	size_t GetCount() const { return m_Count; }
+	size_t GetWordCount() const { return m_Words.size(); }
+	unsigned int* GetWords() { return m_Words.empty() ? NULL : &m_Words[0]; }
+	const unsigned int* GetWords() const { return m_Words.empty() ? NULL : &m_Words[0]; }
+
+	bool Test(size_t Index) const { return (m_Words[Index / SEARCH_BITSET_WORD_BITS] >> (Index % SEARCH_BITSET_WORD_BITS)) & 1; }
+	void Set(size_t Index) { m_Words[Index / SEARCH_BITSET_WORD_BITS] |= 1U << (Index % SEARCH_BITSET_WORD_BITS); }
+	void Reset(size_t Index) { m_Words[Index / SEARCH_BITSET_WORD_BITS] &= ~(1U << (Index % SEARCH_BITSET_WORD_BITS)); }
+
+	void And(const SearchBitset &Other);
+	void AndNot(const SearchBitset &Other);
+	void Or(const SearchBitset &Other);
+	bool IsEmpty() const;
+	size_t CountSet() const;
+	size_t FindNext(size_t Index) const;
+
+protected:
+	std::vector<unsigned int> m_Words;
+	size_t m_Count;
+};
+
+/*! \brief Search fields stored column by column so that a predicate streams over one array
+*/
+class SearchColumns
+{
+public:
+	void Clear();
+	void Reserve(size_t Count);
+	void Add(const SearchFields &Fields);
+	size_t GetCount() const { return Class.size(); }
+
+	std::vector<unsigned int> Class;
+	std::vector<unsigned int> Jobs;
+	std::vector<unsigned int> Slot;
+	std::vector<unsigned int> Races;
+	std::vector<unsigned int> Flags;
+	std::vector<unsigned int> Skill;
+	std::vector<unsigned int> Level;
+	std::vector<unsigned int> ItemLevel;
+	std::vector<unsigned int> Damage;
+	std::vector<unsigned int> Delay;
+	std::vector<unsigned int> Defense;
+};
+
+// bit i of the result is set when ((pValues[i] & AndMask) == Expected) == Equal
+void SearchKernelMaskCompare(const unsigned int *pValues, size_t Count,
+							 unsigned int AndMask, unsigned int Expected, bool Equal,
+							 SearchBitset &Result);
+// bit i of the result is set when Min <= pValues[i] <= Max
+void SearchKernelRange(const unsigned int *pValues, size_t Count,
+					   unsigned int Min, unsigned int Max,
+					   SearchBitset &Result);
+
+bool SearchKernelHasAVX2();
+void SearchKernelEnableAVX2(bool Enable);
+
+#endif//__SEARCH_KERNEL_CLASS__
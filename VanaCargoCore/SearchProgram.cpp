@@ -0,0 +1,209 @@
+#include "SearchProgram.h"
+#include "SearchKernel.h"
+
+#include <algorithm>
+
+// relative cost of each predicate: equality and bitmask tests first, ranges last
+static const int SearchOpCost[SEARCH_OP_COUNT] =
+{
+	1,	// SEARCH_OP_SKILL
+	2,	// SEARCH_OP_SLOT
+	2,	// SEARCH_OP_JOBS
+	3,	// SEARCH_OP_RACES
+	3,	// SEARCH_OP_RARE_EX
+	4,	// SEARCH_OP_LEVEL
+	4,	// SEARCH_OP_DMG
+	4,	// SEARCH_OP_DELAY
+	4,	// SEARCH_OP_DEF
+};
+
+static bool CompareOpCost(const SearchOp &Left, const SearchOp &Right)
+{
+	return Left.Cost < Right.Cost;
+}
+
+SearchProgram::SearchProgram()
+{
+	m_ClassMask = SEARCH_CLASS_ALL;
+	m_NeverMatches = false;
+}
+
+bool SearchProgram::NormalizeRange(int &Min, int &Max)
+{
+	if (Min == 0 && Max == 0)
+		return false;
+
+	if (Max == 0)
+		Max = Min;
+	else if (Min == 0)
+		Min = Max;
+	else if (Min > Max)
+	{
+		int Temp = Max;
+
+		Max = Min;
+		Min = Temp;
+	}
+
+	return true;
+}
+
+void SearchProgram::AddRange(int OpCode, int Min, int Max, unsigned int Classes)
+{
+	if (NormalizeRange(Min, Max) == false)
+		return;
+
+	m_ClassMask &= Classes;
+
+	// the fields are 16-bit, a range outside of them can never match
+	if (Max < 0 || Min > SEARCH_FIELD_MAX_VALUE)
+	{
+		m_NeverMatches = true;
+		return;
+	}
+
+	SearchOp Op;
+
+	Op.OpCode = OpCode;
+	Op.Cost = SearchOpCost[OpCode] - ((Min == Max) ? 1 : 0);
+	Op.Mask = 0;
+	Op.Min = Min;
+	Op.Max = Max;
+	m_Ops.push_back(Op);
+}
+
+void SearchProgram::AddMask(int OpCode, unsigned int Mask, unsigned int Classes)
+{
+	if (Mask == 0)
+		return;
+
+	SearchOp Op;
+
+	m_ClassMask &= Classes;
+	Op.OpCode = OpCode;
+	Op.Cost = SearchOpCost[OpCode];
+	Op.Mask = Mask;
+	Op.Min = 0;
+	Op.Max = 0;
+	m_Ops.push_back(Op);
+}
+
+void SearchProgram::Compile(const SearchCriteria &Criteria)
+{
+	unsigned int RareExMask = 0;
+
+	m_Ops.clear();
+	m_ClassMask = SEARCH_CLASS_ALL;
+	m_NeverMatches = false;
+
+	AddMask(SEARCH_OP_SKILL, Criteria.Skill, SEARCH_CLASS_WEAPON);
+	AddMask(SEARCH_OP_JOBS, Criteria.JobsBitMask, SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR);
+	AddMask(SEARCH_OP_RACES, Criteria.RacesBitMask, SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR);
+
+	if (Criteria.SlotBitMask != 0)
+	{
+		unsigned int Classes = SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+
+		// the main hand is never an armor slot and the sub slot alone never a weapon
+		if (Criteria.SlotBitMask == SEARCH_SLOT_FLAG_MAIN)
+			Classes &= ~SEARCH_CLASS_ARMOR;
+		else if (Criteria.SlotBitMask == SEARCH_SLOT_FLAG_SUB)
+			Classes &= ~SEARCH_CLASS_WEAPON;
+
+		AddMask(SEARCH_OP_SLOT, Criteria.SlotBitMask, Classes);
+	}
+
+	if (Criteria.Rare && Criteria.Exclusive)
+		RareExMask = SEARCH_ITEM_FLAG_RARE | SEARCH_ITEM_FLAG_EXCLUSIVE;
+	else if (Criteria.Rare)
+		RareExMask = SEARCH_ITEM_FLAG_RARE;
+	else if (Criteria.Exclusive)
+		RareExMask = SEARCH_ITEM_FLAG_EXCLUSIVE;
+
+	AddMask(SEARCH_OP_RARE_EX, RareExMask, SEARCH_CLASS_ALL);
+
+	AddRange(SEARCH_OP_LEVEL, Criteria.MinLevel, Criteria.MaxLevel, SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR);
+	AddRange(SEARCH_OP_DMG, Criteria.MinDmg, Criteria.MaxDmg, SEARCH_CLASS_WEAPON);
+	AddRange(SEARCH_OP_DELAY, Criteria.MinDelay, Criteria.MaxDelay, SEARCH_CLASS_ALL);
+	AddRange(SEARCH_OP_DEF, Criteria.MinDef, Criteria.MaxDef, SEARCH_CLASS_ARMOR);
+
+	if (m_ClassMask == 0)
+		m_NeverMatches = true;
+
+	if (m_NeverMatches)
+		m_Ops.clear();
+	else
+		std::stable_sort(m_Ops.begin(), m_Ops.end(), CompareOpCost);
+}
+
+static const std::vector<unsigned int>& GetRangeColumn(int OpCode, const SearchColumns &Columns)
+{
+	switch (OpCode)
+	{
+		case SEARCH_OP_DMG:
+			return Columns.Damage;
+		case SEARCH_OP_DELAY:
+			return Columns.Delay;
+		case SEARCH_OP_DEF:
+			return Columns.Defense;
+		default:
+			return Columns.Level;
+	}
+}
+
+/*! \brief Runs the program over columns, each predicate producing a bitset that is ANDed into the selection
+	\param[in] Columns : extracted fields stored column by column
+	\param[out] Selection : one bit per row, set for the matching rows
+	\return the number of matching rows
+*/
+size_t SearchProgram::Filter(const SearchColumns &Columns, SearchBitset &Selection) const
+{
+	size_t Count = Columns.GetCount();
+	SearchBitset Predicate;
+
+	if (m_NeverMatches || Count == 0)
+	{
+		Selection.Resize(Count, false);
+		return 0;
+	}
+
+	if (m_ClassMask == SEARCH_CLASS_ALL)
+		Selection.Resize(Count, true);
+	else
+		SearchKernelMaskCompare(&Columns.Class[0], Count, m_ClassMask, 0, false, Selection);
+
+	for (size_t OpIndex = 0; OpIndex < m_Ops.size(); ++OpIndex)
+	{
+		const SearchOp &Op = m_Ops[OpIndex];
+
+		switch (Op.OpCode)
+		{
+			case SEARCH_OP_SKILL:
+				SearchKernelMaskCompare(&Columns.Skill[0], Count, 0xFFFFFFFF, Op.Mask, true, Predicate);
+				break;
+			case SEARCH_OP_SLOT:
+				SearchKernelMaskCompare(&Columns.Slot[0], Count, ~Op.Mask, 0, true, Predicate);
+				break;
+			case SEARCH_OP_JOBS:
+				SearchKernelMaskCompare(&Columns.Jobs[0], Count, Op.Mask, 0, false, Predicate);
+				break;
+			case SEARCH_OP_RACES:
+				SearchKernelMaskCompare(&Columns.Races[0], Count, ~Op.Mask, 0, true, Predicate);
+				break;
+			case SEARCH_OP_RARE_EX:
+				SearchKernelMaskCompare(&Columns.Flags[0], Count, Op.Mask, Op.Mask, true, Predicate);
+				break;
+			default:
+				SearchKernelRange(&GetRangeColumn(Op.OpCode, Columns)[0], Count,
+								  (unsigned int)((Op.Min < 0) ? 0 : Op.Min), (unsigned int)Op.Max, Predicate);
+				break;
+		}
+
+		Selection.And(Predicate);
+
+		if (Selection.IsEmpty())
+			return 0;
+	}
+
+	return Selection.CountSet();
+}
@@ -0,0 +1,114 @@
+#ifndef __SEARCH_PROGRAM_CLASS__
+#define __SEARCH_PROGRAM_CLASS__
+
+#include <stddef.h>
+#include <vector>
+
+// item classes used by the type check that runs before any other filter
+#define SEARCH_CLASS_OTHER  0x01
+#define SEARCH_CLASS_WEAPON 0x02
+#define SEARCH_CLASS_ARMOR  0x04
+#define SEARCH_CLASS_ALL    (SEARCH_CLASS_OTHER | SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR)
+
+// same values as FFXI_SLOT_FLAG_MAIN and FFXI_SLOT_FLAG_SUB
+#define SEARCH_SLOT_FLAG_MAIN 0x0001
+#define SEARCH_SLOT_FLAG_SUB  0x0002
+// same values as ITEM_FLAG_RARE and ITEM_FLAG_EXCLUSIVE
+#define SEARCH_ITEM_FLAG_RARE      0x8000
+#define SEARCH_ITEM_FLAG_EXCLUSIVE 0x6040
+
+#define SEARCH_FIELD_MAX_VALUE 0xFFFF
+
+class SearchColumns;
+class SearchBitset;
+
+// numeric attributes of an item, extracted once so that the filters
+// never touch the DAT record union or the item strings
+typedef struct _SearchFields
+{
+	unsigned int Jobs;
+	unsigned short Class;
+	unsigned short Flags;
+	unsigned short Slot;
+	unsigned short Races;
+	unsigned short Skill;
+	unsigned short Level;
+	unsigned short ItemLevel;
+	unsigned short Damage;
+	unsigned short Delay;
+	unsigned short Defense;
+} SearchFields;
+
+// filter values as entered in the search dialog, 0 means "not set"
+typedef struct _SearchCriteria
+{
+	unsigned int JobsBitMask;
+	unsigned int SlotBitMask;
+	unsigned int RacesBitMask;
+	unsigned int Skill;
+	int MinLevel;
+	int MaxLevel;
+	int MinDelay;
+	int MaxDelay;
+	int MinDmg;
+	int MaxDmg;
+	int MinDef;
+	int MaxDef;
+	bool Rare;
+	bool Exclusive;
+} SearchCriteria;
+
+enum SEARCH_OP_CODE
+{
+	SEARCH_OP_SKILL = 0,
+	SEARCH_OP_SLOT,
+	SEARCH_OP_JOBS,
+	SEARCH_OP_RACES,
+	SEARCH_OP_RARE_EX,
+	SEARCH_OP_LEVEL,
+	SEARCH_OP_DMG,
+	SEARCH_OP_DELAY,
+	SEARCH_OP_DEF,
+	SEARCH_OP_COUNT
+};
+
+typedef struct _SearchOp
+{
+	int OpCode;
+	int Cost;
+	unsigned int Mask;
+	int Min;
+	int Max;
+} SearchOp;
+
+/*! \brief Search parameters compiled into a short list of predicates
+
+	Inactive filters are dropped, filters that can never match collapse the
+	program to "match nothing" and the remaining predicates are ordered by cost.
+	Text matching is left to the caller and should only run on the selection.
+*/
+class SearchProgram
+{
+public:
+	SearchProgram();
+
+	void Compile(const SearchCriteria &Criteria);
+
+	size_t Filter(const SearchColumns &Columns, SearchBitset &Selection) const;
+
+	bool IsEmpty() const { return !m_NeverMatches && m_ClassMask == SEARCH_CLASS_ALL && m_Ops.empty(); }
+	bool NeverMatches() const { return m_NeverMatches; }
+	size_t GetOpCount() const { return m_Ops.size(); }
+
+	static bool NormalizeRange(int &Min, int &Max);
+
+protected:
+	void AddRange(int OpCode, int Min, int Max, unsigned int Classes);
+	void AddMask(int OpCode, unsigned int Mask, unsigned int Classes);
+
+	std::vector<SearchOp> m_Ops;
+	unsigned int m_ClassMask;
+	bool m_NeverMatches;
+};
+
+#endif//__SEARCH_PROGRAM_CLASS__
@@ -0,0 +1,1167 @@
+#include "SearchQuery.h"
+#include "SearchProgram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <wctype.h>
+
+// rows sampled per inventory to estimate the selectivity of a text predicate
+#define SEARCH_QUERY_SAMPLE_ROWS 64
+// cost of a predicate per row tested, relative to a column predicate
+#define SEARCH_QUERY_COLUMN_COST 1.0
+#define SEARCH_QUERY_TEXT_COST   16.0
+
+typedef struct _SearchQueryName
+{
+	const wchar_t *pName;
+	unsigned int Mask;
+} SearchQueryName;
+
+// same values as FFXI_JOB_FLAG
+static const SearchQueryName g_JobNames[] =
+{
+	{ L"war", 0x00000002 }, { L"mnk", 0x00000004 }, { L"whm", 0x00000008 }, { L"blm", 0x00000010 },
+	{ L"rdm", 0x00000020 }, { L"thf", 0x00000040 }, { L"pld", 0x00000080 }, { L"drk", 0x00000100 },
+	{ L"bst", 0x00000200 }, { L"brd", 0x00000400 }, { L"rng", 0x00000800 }, { L"sam", 0x00001000 },
+	{ L"nin", 0x00002000 }, { L"drg", 0x00004000 }, { L"smn", 0x00008000 }, { L"blu", 0x00010000 },
+	{ L"cor", 0x00020000 }, { L"pup", 0x00040000 }, { L"dnc", 0x00080000 }, { L"sch", 0x00100000 },
+	{ L"run", 0x00200000 }, { L"geo", 0x00400000 }, { L"all", 0x007FFFFE }
+};
+
+// same values as FFXI_SLOT_FLAG, ear and ring stand for both sides
+static const SearchQueryName g_SlotNames[] =
+{
+	{ L"main", 0x0001 }, { L"sub", 0x0002 }, { L"range", 0x0004 }, { L"ranged", 0x0004 },
+	{ L"ammo", 0x0008 }, { L"head", 0x0010 }, { L"body", 0x0020 }, { L"hands", 0x0040 },
+	{ L"legs", 0x0080 }, { L"feet", 0x0100 }, { L"neck", 0x0200 }, { L"waist", 0x0400 },
+	{ L"ear", 0x1800 }, { L"ring", 0x6000 }, { L"back", 0x8000 }
+};
+
+// same values as FFXI_RACE_FLAG
+static const SearchQueryName g_RaceNames[] =
+{
+	{ L"hume", 0x006 }, { L"elvaan", 0x018 }, { L"tarutaru", 0x060 }, { L"taru", 0x060 },
+	{ L"mithra", 0x080 }, { L"galka", 0x100 }, { L"male", 0x12A }, { L"female", 0x0D4 }
+};
+
+static std::wstring ToLower(const std::wstring &Text)
+{
+	std::wstring Lower(Text);
+
+	for (size_t i = 0; i < Lower.size(); ++i)
+		Lower[i] = (wchar_t)towlower((wint_t)Lower[i]);
+
+	return Lower;
+}
+
+static double GetElapsed(const std::chrono::steady_clock::time_point &Start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+static bool IsWordChar(wchar_t Char)
+{
+	return (Char != 0 && !iswspace((wint_t)Char) && wcschr(L"()\":=<>", Char) == NULL);
+}
+
+static bool ParseNumber(const std::wstring &Text, unsigned int &Value)
+{
+	if (Text.empty() || Text.size() > 9)
+		return false;
+
+	Value = 0;
+
+	for (size_t i = 0; i < Text.size(); ++i)
+	{
+		if (Text[i] < L'0' || Text[i] > L'9')
+			return false;
+
+		Value = Value * 10 + (Text[i] - L'0');
+	}
+
+	if (Value > SEARCH_FIELD_MAX_VALUE)
+		Value = SEARCH_FIELD_MAX_VALUE;
+
+	return true;
+}
+
+/*! \brief Combines the masks of a list of names separated by ',', '/' or '+'
+	\param[in] Value : list of names, case-insensitive
+	\param[out] Mask : union of the masks of the names
+	\param[out] Unknown : first name missing from the table
+	\return false if a name is missing from the table
+*/
+static bool ParseNames(const std::wstring &Value, const SearchQueryName *pNames, size_t Count,
+					   unsigned int &Mask, std::wstring &Unknown)
+{
+	std::wstring Lower = ToLower(Value);
+	size_t Start = 0;
+
+	Mask = 0;
+
+	while (Start <= Lower.size())
+	{
+		size_t End = Lower.find_first_of(L",/+", Start);
+
+		if (End == std::wstring::npos)
+			End = Lower.size();
+
+		std::wstring Name = Lower.substr(Start, End - Start);
+		size_t i = 0;
+
+		for (; i < Count; ++i)
+		{
+			if (Name == pNames[i].pName)
+			{
+				Mask |= pNames[i].Mask;
+				break;
+			}
+		}
+
+		if (i == Count)
+		{
+			Unknown = Name;
+			return false;
+		}
+
+		Start = End + 1;
+	}
+
+	return true;
+}
+
+void SearchColumnStats::Build(const SearchColumns &Columns)
+{
+	const std::vector<unsigned int> *pColumns[SEARCH_QUERY_COLUMN_COUNT] =
+	{
+		&Columns.Jobs, &Columns.Slot, &Columns.Races, &Columns.Flags, &Columns.Level,
+		&Columns.ItemLevel, &Columns.Damage, &Columns.Delay, &Columns.Defense
+	};
+
+	m_Count = Columns.GetCount();
+
+	for (int Column = 0; Column < SEARCH_QUERY_COLUMN_COUNT; ++Column)
+	{
+		const std::vector<unsigned int> &Values = *pColumns[Column];
+
+		m_Sorted[Column].clear();
+		m_BitCounts[Column].clear();
+
+		if (Column <= SEARCH_QUERY_COLUMN_FLAGS)
+		{
+			m_BitCounts[Column].resize(32, 0);
+
+			for (size_t i = 0; i < Values.size(); ++i)
+			{
+				for (unsigned int Bits = Values[i]; Bits != 0; Bits &= Bits - 1)
+				{
+					unsigned int Bit = 0;
+
+					while (((Bits >> Bit) & 1) == 0)
+						++Bit;
+
+					++m_BitCounts[Column][Bit];
+				}
+			}
+		}
+		else
+		{
+			m_Sorted[Column] = Values;
+			std::sort(m_Sorted[Column].begin(), m_Sorted[Column].end());
+		}
+	}
+
+	m_ClassCounts[0] = m_ClassCounts[1] = m_ClassCounts[2] = 0;
+
+	for (size_t i = 0; i < Columns.Class.size(); ++i)
+	{
+		if (Columns.Class[i] & SEARCH_CLASS_OTHER)
+			++m_ClassCounts[0];
+		if (Columns.Class[i] & SEARCH_CLASS_WEAPON)
+			++m_ClassCounts[1];
+		if (Columns.Class[i] & SEARCH_CLASS_ARMOR)
+			++m_ClassCounts[2];
+	}
+}
+
+//! \brief Exact number of rows with Min <= value <= Max
+size_t SearchColumnStats::CountRange(int Column, unsigned int Min, unsigned int Max) const
+{
+	const std::vector<unsigned int> &Sorted = m_Sorted[Column];
+
+	if (Min > Max)
+		return 0;
+
+	return (size_t)(std::upper_bound(Sorted.begin(), Sorted.end(), Max) -
+					std::lower_bound(Sorted.begin(), Sorted.end(), Min));
+}
+
+/*! \brief Estimated number of rows matching a mask
+	\param[in] All : true if every bit of the mask must be set, false for any of them
+	\return the count of the rarest bit when All is true, the sum of the counts otherwise
+*/
+size_t SearchColumnStats::CountBits(int Column, unsigned int Mask, bool All) const
+{
+	const std::vector<size_t> &Counts = m_BitCounts[Column];
+	size_t Count = All ? m_Count : 0;
+
+	if (Counts.empty())
+		return Count;
+
+	for (unsigned int Bit = 0; Bit < 32; ++Bit)
+	{
+		if (((Mask >> Bit) & 1) == 0)
+			continue;
+
+		if (All)
+			Count = std::min(Count, Counts[Bit]);
+		else
+			Count += Counts[Bit];
+	}
+
+	return std::min(Count, m_Count);
+}
+
+size_t SearchColumnStats::CountClasses(unsigned int ClassMask) const
+{
+	size_t Count = 0;
+
+	if (ClassMask & SEARCH_CLASS_OTHER)
+		Count += m_ClassCounts[0];
+	if (ClassMask & SEARCH_CLASS_WEAPON)
+		Count += m_ClassCounts[1];
+	if (ClassMask & SEARCH_CLASS_ARMOR)
+		Count += m_ClassCounts[2];
+
+	return std::min(Count, m_Count);
+}
+
+SearchQuery::SearchQuery()
+{
+	m_Current = 0;
+	m_Root = 0;
+	m_Explain = false;
+	m_Rows = 0;
+	m_Inventories = 0;
+	m_PlanTime = 0.0;
+	m_ExecuteTime = 0.0;
+}
+
+bool SearchQuery::Tokenize(const wchar_t *pExpression, std::wstring &Error)
+{
+	size_t Pos = 0;
+	int Previous = TOKEN_END;
+
+	m_Tokens.clear();
+
+	while (true)
+	{
+		while (pExpression[Pos] != 0 && iswspace((wint_t)pExpression[Pos]))
+			++Pos;
+
+		Token Current;
+		wchar_t Char = pExpression[Pos];
+
+		Current.Pos = Pos;
+		Current.Type = TOKEN_WORD;
+
+		if (Char == 0)
+		{
+			Current.Type = TOKEN_END;
+			m_Tokens.push_back(Current);
+
+			return true;
+		}
+
+		if (Char == L'(' || Char == L')')
+		{
+			Current.Type = (Char == L'(') ? TOKEN_OPEN : TOKEN_CLOSE;
+			Current.Text = Char;
+			++Pos;
+		}
+		else if (Char == L'"')
+		{
+			const wchar_t *pEnd = wcschr(pExpression + Pos + 1, L'"');
+
+			if (pEnd == NULL)
+			{
+				wchar_t Message[64];
+
+				swprintf(Message, 64, L"missing closing quote at position %u", (unsigned int)Pos + 1);
+				Error = Message;
+
+				return false;
+			}
+
+			Current.Type = TOKEN_STRING;
+			Current.Text.assign(pExpression + Pos + 1, pEnd);
+			Pos = (pEnd - pExpression) + 1;
+		}
+		else if (Char == L':' || Char == L'=' || Char == L'<' || Char == L'>')
+		{
+			Current.Type = TOKEN_OPERATOR;
+			Current.Text = Char;
+			++Pos;
+
+			if ((Char == L'<' || Char == L'>') && pExpression[Pos] == L'=')
+				Current.Text += pExpression[Pos++];
+		}
+		else if (Char == L'-' && Previous != TOKEN_OPERATOR &&
+				 (IsWordChar(pExpression[Pos + 1]) || pExpression[Pos + 1] == L'(' || pExpression[Pos + 1] == L'"'))
+		{
+			// negation, a dash inside a word or a value is kept in it
+			Current.Type = TOKEN_MINUS;
+			Current.Text = Char;
+			++Pos;
+		}
+		else
+		{
+			size_t Start = Pos;
+
+			while (IsWordChar(pExpression[Pos]))
+				++Pos;
+
+			Current.Text.assign(pExpression + Start, pExpression + Pos);
+		}
+
+		Previous = Current.Type;
+		m_Tokens.push_back(Current);
+	}
+}
+
+// keywords are upper case so that "and", "or" and "not" can still be searched as words
+bool SearchQuery::IsKeyword(const wchar_t *pKeyword) const
+{
+	return (m_Tokens[m_Current].Type == TOKEN_WORD && m_Tokens[m_Current].Text == pKeyword);
+}
+
+size_t SearchQuery::AddNode(int Type)
+{
+	SearchQueryNode Node;
+
+	Node.Type = Type;
+	Node.Column = 0;
+	Node.Mask = 0;
+	Node.Min = 0;
+	Node.Max = SEARCH_FIELD_MAX_VALUE;
+	Node.ClassMask = SEARCH_CLASS_ALL;
+	Node.FieldMask = SEARCH_TEXT_ALL_FIELDS;
+	Node.Selectivity = 1.0;
+	Node.Cost = 0.0;
+	Node.RowsIn = 0;
+	Node.RowsOut = 0;
+	Node.Elapsed = 0.0;
+
+	switch (Type)
+	{
+		case SEARCH_QUERY_NODE_AND: Node.Label = L"AND"; break;
+		case SEARCH_QUERY_NODE_OR: Node.Label = L"OR"; break;
+		case SEARCH_QUERY_NODE_NOT: Node.Label = L"NOT"; break;
+	}
+
+	m_Nodes.push_back(Node);
+
+	return m_Nodes.size() - 1;
+}
+
+size_t SearchQuery::AddNot(size_t Child)
+{
+	size_t Node = AddNode(SEARCH_QUERY_NODE_NOT);
+
+	m_Nodes[Node].Children.push_back(Child);
+
+	return Node;
+}
+
+/*! \brief Parses a query expression
+	\param[in] pExpression : query as typed by the user
+	\param[out] Error : description of the first syntax error
+	\return false if the expression is invalid
+*/
+bool SearchQuery::Parse(const wchar_t *pExpression, std::wstring &Error)
+{
+	m_Nodes.clear();
+	m_Characters.clear();
+	m_Explain = false;
+	m_Current = 0;
+	m_Root = 0;
+	Error.clear();
+
+	if (pExpression == NULL || Tokenize(pExpression, Error) == false)
+		return false;
+
+	if (m_Tokens[0].Type == TOKEN_WORD && ToLower(m_Tokens[0].Text) == L"explain")
+	{
+		m_Explain = true;
+		++m_Current;
+	}
+
+	if (m_Tokens[m_Current].Type == TOKEN_END)
+	{
+		Error = L"the query is empty";
+		return false;
+	}
+
+	if (ParseOr(m_Root, Error) == false)
+		return false;
+
+	if (m_Tokens[m_Current].Type != TOKEN_END)
+	{
+		wchar_t Message[64];
+
+		swprintf(Message, 64, L"unexpected '%ls' at position %u",
+				 m_Tokens[m_Current].Text.c_str(), (unsigned int)m_Tokens[m_Current].Pos + 1);
+		Error = Message;
+
+		return false;
+	}
+
+	// the character patterns select the inventories to search, they must apply to the whole query
+	if (m_Nodes[m_Root].Type == SEARCH_QUERY_NODE_CHARACTER)
+	{
+		m_Characters.push_back(m_Nodes[m_Root].Text);
+		m_Root = AddNode(SEARCH_QUERY_NODE_AND);
+	}
+	else if (m_Nodes[m_Root].Type == SEARCH_QUERY_NODE_AND)
+	{
+		std::vector<size_t> &Children = m_Nodes[m_Root].Children;
+
+		for (size_t i = 0; i < Children.size();)
+		{
+			if (m_Nodes[Children[i]].Type == SEARCH_QUERY_NODE_CHARACTER)
+			{
+				m_Characters.push_back(m_Nodes[Children[i]].Text);
+				Children.erase(Children.begin() + i);
+			}
+			else
+				++i;
+		}
+	}
+
+	std::vector<size_t> Pending(1, m_Root);
+
+	while (!Pending.empty())
+	{
+		const SearchQueryNode &Node = m_Nodes[Pending.back()];
+
+		Pending.pop_back();
+
+		if (Node.Type == SEARCH_QUERY_NODE_CHARACTER)
+		{
+			Error = L"char: can only be combined with the rest of the query by AND";
+			return false;
+		}
+
+		Pending.insert(Pending.end(), Node.Children.begin(), Node.Children.end());
+	}
+
+	return true;
+}
+
+bool SearchQuery::ParseOr(size_t &Node, std::wstring &Error)
+{
+	size_t Left;
+
+	if (ParseAnd(Left, Error) == false)
+		return false;
+
+	if (IsKeyword(L"OR") == false)
+	{
+		Node = Left;
+		return true;
+	}
+
+	Node = AddNode(SEARCH_QUERY_NODE_OR);
+	m_Nodes[Node].Children.push_back(Left);
+
+	while (IsKeyword(L"OR"))
+	{
+		size_t Right;
+
+		++m_Current;
+
+		if (ParseAnd(Right, Error) == false)
+			return false;
+
+		m_Nodes[Node].Children.push_back(Right);
+	}
+
+	return true;
+}
+
+bool SearchQuery::ParseAnd(size_t &Node, std::wstring &Error)
+{
+	std::vector<size_t> Children;
+
+	while (true)
+	{
+		int Type = m_Tokens[m_Current].Type;
+
+		if (Type == TOKEN_END || Type == TOKEN_CLOSE || IsKeyword(L"OR"))
+			break;
+
+		if (IsKeyword(L"AND"))
+		{
+			++m_Current;
+			continue;
+		}
+
+		size_t Child;
+
+		if (ParseUnary(Child, Error) == false)
+			return false;
+
+		Children.push_back(Child);
+	}
+
+	if (Children.empty())
+	{
+		wchar_t Message[64];
+
+		swprintf(Message, 64, L"missing term at position %u", (unsigned int)m_Tokens[m_Current].Pos + 1);
+		Error = Message;
+
+		return false;
+	}
+
+	if (Children.size() == 1)
+		Node = Children[0];
+	else
+	{
+		Node = AddNode(SEARCH_QUERY_NODE_AND);
+		m_Nodes[Node].Children.swap(Children);
+	}
+
+	return true;
+}
+
+bool SearchQuery::ParseUnary(size_t &Node, std::wstring &Error)
+{
+	if (m_Tokens[m_Current].Type == TOKEN_MINUS || IsKeyword(L"NOT"))
+	{
+		size_t Child;
+
+		++m_Current;
+
+		if (ParseUnary(Child, Error) == false)
+			return false;
+
+		Node = AddNot(Child);
+
+		return true;
+	}
+
+	return ParsePrimary(Node, Error);
+}
+
+bool SearchQuery::ParsePrimary(size_t &Node, std::wstring &Error)
+{
+	const Token Current = m_Tokens[m_Current];
+	wchar_t Message[128];
+
+	switch (Current.Type)
+	{
+		case TOKEN_OPEN:
+			++m_Current;
+
+			if (ParseOr(Node, Error) == false)
+				return false;
+
+			if (m_Tokens[m_Current].Type != TOKEN_CLOSE)
+			{
+				swprintf(Message, 128, L"missing ')' for the '(' at position %u", (unsigned int)Current.Pos + 1);
+				Error = Message;
+
+				return false;
+			}
+
+			++m_Current;
+
+			return true;
+		case TOKEN_STRING:
+			++m_Current;
+
+			return ParsePredicate(L"text", L":", Current.Text, Node, Error);
+		case TOKEN_WORD:
+		{
+			++m_Current;
+
+			if (m_Tokens[m_Current].Type == TOKEN_OPERATOR)
+			{
+				const Token &Operator = m_Tokens[m_Current++];
+				const Token &Value = m_Tokens[m_Current];
+
+				if (Value.Type != TOKEN_WORD && Value.Type != TOKEN_STRING)
+				{
+					swprintf(Message, 128, L"missing value after '%ls%ls'", Current.Text.c_str(), Operator.Text.c_str());
+					Error = Message;
+
+					return false;
+				}
+
+				++m_Current;
+
+				return ParsePredicate(ToLower(Current.Text), Operator.Text, Value.Text, Node, Error);
+			}
+
+			std::wstring Lower = ToLower(Current.Text);
+
+			// bare flags
+			if (Lower == L"rare" || Lower == L"ex")
+			{
+				if (ParsePredicate(Lower, L":", L"yes", Node, Error) == false)
+					return false;
+
+				m_Nodes[Node].Label = Lower;
+
+				return true;
+			}
+
+			return ParsePredicate(L"text", L":", Current.Text, Node, Error);
+		}
+		default:
+			if (Current.Type == TOKEN_END)
+				swprintf(Message, 128, L"unexpected end of the query");
+			else
+				swprintf(Message, 128, L"unexpected '%ls' at position %u", Current.Text.c_str(), (unsigned int)Current.Pos + 1);
+
+			Error = Message;
+
+			return false;
+	}
+}
+
+/*! \brief Builds the node of a field predicate
+	\param[in] Field : lower-case field name
+	\param[in] Operator : one of : = < <= > >=
+	\param[in] Value : value as typed, unquoted
+	\param[out] Node : index of the new node
+*/
+bool SearchQuery::ParsePredicate(const std::wstring &Field, const std::wstring &Operator,
+								 const std::wstring &Value, size_t &Node, std::wstring &Error)
+{
+	bool Equals = (Operator == L":" || Operator == L"=");
+	int Type = -1;
+	int Column = 0;
+	unsigned int FieldMask = 0;
+	unsigned int ClassMask = SEARCH_CLASS_ALL;
+	const SearchQueryName *pNames = NULL;
+	size_t NameCount = 0;
+
+	if (Field == L"text")
+		FieldMask = SEARCH_TEXT_ALL_FIELDS;
+	else if (Field == L"name")
+		FieldMask = (1U << SEARCH_TEXT_FIELD_NAME) | (1U << SEARCH_TEXT_FIELD_LOG_NAME);
+	else if (Field == L"desc" || Field == L"description")
+		FieldMask = 1U << SEARCH_TEXT_FIELD_DESCRIPTION;
+	else if (Field == L"attr")
+		FieldMask = 1U << SEARCH_TEXT_FIELD_ATTR;
+	else if (Field == L"job" || Field == L"jobs")
+	{
+		Column = SEARCH_QUERY_COLUMN_JOBS;
+		pNames = g_JobNames;
+		NameCount = sizeof(g_JobNames) / sizeof(g_JobNames[0]);
+	}
+	else if (Field == L"slot")
+	{
+		Column = SEARCH_QUERY_COLUMN_SLOT;
+		pNames = g_SlotNames;
+		NameCount = sizeof(g_SlotNames) / sizeof(g_SlotNames[0]);
+	}
+	else if (Field == L"race" || Field == L"races")
+	{
+		Column = SEARCH_QUERY_COLUMN_RACES;
+		pNames = g_RaceNames;
+		NameCount = sizeof(g_RaceNames) / sizeof(g_RaceNames[0]);
+	}
+	else if (Field == L"rare" || Field == L"ex")
+	{
+		Type = SEARCH_QUERY_NODE_MASK_ALL;
+		Column = SEARCH_QUERY_COLUMN_FLAGS;
+	}
+	else if (Field == L"lvl" || Field == L"level")
+	{
+		Type = SEARCH_QUERY_NODE_RANGE;
+		Column = SEARCH_QUERY_COLUMN_LEVEL;
+		ClassMask = SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+	}
+	else if (Field == L"ilvl")
+	{
+		Type = SEARCH_QUERY_NODE_RANGE;
+		Column = SEARCH_QUERY_COLUMN_ITEM_LEVEL;
+		ClassMask = SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+	}
+	else if (Field == L"dmg" || Field == L"damage")
+	{
+		Type = SEARCH_QUERY_NODE_RANGE;
+		Column = SEARCH_QUERY_COLUMN_DAMAGE;
+		ClassMask = SEARCH_CLASS_WEAPON;
+	}
+	else if (Field == L"delay")
+	{
+		Type = SEARCH_QUERY_NODE_RANGE;
+		Column = SEARCH_QUERY_COLUMN_DELAY;
+		ClassMask = SEARCH_CLASS_WEAPON;
+	}
+	else if (Field == L"def" || Field == L"defense")
+	{
+		Type = SEARCH_QUERY_NODE_RANGE;
+		Column = SEARCH_QUERY_COLUMN_DEFENSE;
+		ClassMask = SEARCH_CLASS_ARMOR;
+	}
+	else if (Field == L"char" || Field == L"character")
+		Type = SEARCH_QUERY_NODE_CHARACTER;
+	else
+	{
+		Error = L"unknown field '" + Field + L"'";
+		return false;
+	}
+
+	if (Type != SEARCH_QUERY_NODE_RANGE && Equals == false)
+	{
+		Error = L"'" + Field + L"' only supports ':'";
+		return false;
+	}
+
+	if (FieldMask != 0)
+		Type = SEARCH_QUERY_NODE_TEXT;
+	else if (pNames != NULL)
+		Type = SEARCH_QUERY_NODE_MASK_ANY;
+
+	Node = AddNode(Type);
+
+	SearchQueryNode &Current = m_Nodes[Node];
+
+	Current.Column = Column;
+	Current.ClassMask = ClassMask;
+	Current.Label = (Field == L"text") ? (L"\"" + Value + L"\"") : (Field + Operator + Value);
+
+	switch (Type)
+	{
+		case SEARCH_QUERY_NODE_TEXT:
+			Current.Text = Value;
+			Current.FieldMask = FieldMask;
+			break;
+		case SEARCH_QUERY_NODE_CHARACTER:
+			Current.Text = ToLower(Value);
+			break;
+		case SEARCH_QUERY_NODE_MASK_ANY:
+		{
+			std::wstring Unknown;
+
+			if (ParseNames(Value, pNames, NameCount, Current.Mask, Unknown) == false)
+			{
+				Error = L"unknown " + Field + L" '" + Unknown + L"'";
+				return false;
+			}
+
+			// the restrictions only mean something for equipment
+			Current.ClassMask = SEARCH_CLASS_WEAPON | SEARCH_CLASS_ARMOR;
+			break;
+		}
+		case SEARCH_QUERY_NODE_MASK_ALL:
+		{
+			std::wstring Lower = ToLower(Value);
+
+			Current.Mask = (Field == L"rare") ? SEARCH_ITEM_FLAG_RARE : SEARCH_ITEM_FLAG_EXCLUSIVE;
+
+			if (Lower == L"no" || Lower == L"false" || Lower == L"0")
+			{
+				// the label stays on the NOT so that EXPLAIN shows the predicate as typed
+				Node = AddNot(Node);
+				m_Nodes[Node].Label = m_Nodes[Node - 1].Label;
+				m_Nodes[Node - 1].Label = Field;
+			}
+			else if (Lower != L"yes" && Lower != L"true" && Lower != L"1")
+			{
+				Error = L"'" + Field + L"' expects yes or no";
+				return false;
+			}
+			break;
+		}
+		case SEARCH_QUERY_NODE_RANGE:
+		{
+			unsigned int Number = 0;
+			bool Valid = true;
+
+			if (Equals)
+			{
+				size_t Dash = Value.find(L'-');
+
+				if (Dash == std::wstring::npos)
+				{
+					Valid = ParseNumber(Value, Current.Min);
+					Current.Max = Current.Min;
+				}
+				else
+				{
+					// either end of a range may be left open
+					std::wstring Min = Value.substr(0, Dash), Max = Value.substr(Dash + 1);
+
+					Valid = (Min.empty() || ParseNumber(Min, Current.Min)) &&
+							(Max.empty() || ParseNumber(Max, Current.Max)) &&
+							(Min.empty() == false || Max.empty() == false);
+				}
+			}
+			else if ((Valid = ParseNumber(Value, Number)) != false)
+			{
+				if (Operator == L">")
+					Current.Min = Number + 1;
+				else if (Operator == L">=")
+					Current.Min = Number;
+				else if (Operator == L"<=")
+					Current.Max = Number;
+				else if (Number == 0)
+				{
+					// < 0 never matches
+					Current.Min = 1;
+					Current.Max = 0;
+				}
+				else
+					Current.Max = Number - 1;
+			}
+
+			if (Valid == false)
+			{
+				Error = L"'" + Field + L"' expects a number or a range such as 10-20";
+				return false;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+//! \brief Case-insensitive match of a pattern where * stands for any text and ? for any character
+bool SearchQuery::MatchPattern(const wchar_t *pPattern, const wchar_t *pText)
+{
+	const wchar_t *pStar = NULL;
+	const wchar_t *pRetry = NULL;
+
+	while (*pText != 0)
+	{
+		if (*pPattern == L'*')
+		{
+			pStar = ++pPattern;
+			pRetry = pText;
+		}
+		else if (*pPattern == L'?' || towlower((wint_t)*pPattern) == towlower((wint_t)*pText))
+		{
+			++pPattern;
+			++pText;
+		}
+		else if (pStar != NULL)
+		{
+			// let the last star absorb one more character
+			pPattern = pStar;
+			pText = ++pRetry;
+		}
+		else
+			return false;
+	}
+
+	while (*pPattern == L'*')
+		++pPattern;
+
+	return (*pPattern == 0);
+}
+
+//! \brief Tells if the inventory of a character is searched, by name or by ID
+bool SearchQuery::MatchCharacter(const std::wstring &Name, const std::wstring &Id) const
+{
+	if (m_Characters.empty())
+		return true;
+
+	for (size_t i = 0; i < m_Characters.size(); ++i)
+	{
+		if (MatchPattern(m_Characters[i].c_str(), Name.c_str()) || MatchPattern(m_Characters[i].c_str(), Id.c_str()))
+			return true;
+	}
+
+	return false;
+}
+
+/*! \brief Estimates the selectivity of every predicate and orders the children of each node
+	\param[in] Data : inventories the query is about to run on
+*/
+void SearchQuery::Plan(const std::vector<SearchQueryData> &Data)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	m_Rows = 0;
+	m_Inventories = Data.size();
+	m_ExecuteTime = 0.0;
+
+	for (size_t i = 0; i < Data.size(); ++i)
+		m_Rows += Data[i].pStats->GetCount();
+
+	for (size_t i = 0; i < m_Nodes.size(); ++i)
+	{
+		m_Nodes[i].RowsIn = 0;
+		m_Nodes[i].RowsOut = 0;
+		m_Nodes[i].Elapsed = 0.0;
+	}
+
+	if (m_Nodes.empty() == false)
+		Estimate(m_Root, Data);
+
+	m_PlanTime = GetElapsed(Start);
+}
+
+void SearchQuery::Estimate(size_t Node, const std::vector<SearchQueryData> &Data)
+{
+	SearchQueryNode &Current = m_Nodes[Node];
+	std::vector<std::pair<double, size_t>> Order;
+	double Rows = (double)m_Rows;
+	double Selectivity = 1.0;
+	double Cost = 0.0;
+
+	switch (Current.Type)
+	{
+		case SEARCH_QUERY_NODE_AND:
+		case SEARCH_QUERY_NODE_OR:
+		{
+			bool And = (Current.Type == SEARCH_QUERY_NODE_AND);
+
+			for (size_t i = 0; i < Current.Children.size(); ++i)
+			{
+				size_t Child = Current.Children[i];
+
+				Estimate(Child, Data);
+
+				const SearchQueryNode &Estimated = m_Nodes[Child];
+
+				// AND: most rows removed per unit of cost first, OR: most rows covered first
+				if (And)
+					Order.push_back(std::make_pair((Estimated.Selectivity - 1.0) / std::max(Estimated.Cost, 1e-9), Child));
+				else
+					Order.push_back(std::make_pair(-Estimated.Selectivity / std::max(Estimated.Cost, 1e-9), Child));
+			}
+
+			std::sort(Order.begin(), Order.end());
+
+			// each child only sees the rows left by the previous ones
+			double Remaining = 1.0;
+
+			for (size_t i = 0; i < Order.size(); ++i)
+			{
+				const SearchQueryNode &Child = m_Nodes[Order[i].second];
+
+				m_Nodes[Node].Children[i] = Order[i].second;
+				Cost += Remaining * Child.Cost;
+				Remaining *= And ? Child.Selectivity : (1.0 - Child.Selectivity);
+			}
+
+			Selectivity = And ? Remaining : 1.0 - Remaining;
+			break;
+		}
+		case SEARCH_QUERY_NODE_NOT:
+			Estimate(Current.Children[0], Data);
+			Selectivity = 1.0 - m_Nodes[Current.Children[0]].Selectivity;
+			Cost = m_Nodes[Current.Children[0]].Cost;
+			break;
+		case SEARCH_QUERY_NODE_TEXT:
+		{
+			size_t Sampled = 0, Kept = 0;
+			SearchBitset Sample;
+
+			// a few rows spread over each inventory
+			for (size_t i = 0; i < Data.size(); ++i)
+			{
+				size_t Count = Data[i].pText->GetCount();
+				size_t Step = std::max(Count / SEARCH_QUERY_SAMPLE_ROWS, (size_t)1);
+
+				Sample.Resize(Count, false);
+
+				for (size_t Row = 0; Row < Count; Row += Step)
+				{
+					Sample.Set(Row);
+					++Sampled;
+				}
+
+				Kept += Data[i].pText->Refine(Current.Text.c_str(), Sample, Current.FieldMask);
+			}
+
+			// nothing found in the sample still leaves a chance to match
+			if (Sampled != 0)
+				Selectivity = (Kept != 0) ? (double)Kept / Sampled : 0.5 / Sampled;
+
+			Cost = SEARCH_QUERY_TEXT_COST;
+			break;
+		}
+		case SEARCH_QUERY_NODE_MASK_ANY:
+		case SEARCH_QUERY_NODE_MASK_ALL:
+		case SEARCH_QUERY_NODE_RANGE:
+		{
+			size_t Matching = 0, Classes = 0;
+
+			for (size_t i = 0; i < Data.size(); ++i)
+			{
+				const SearchColumnStats &Stats = *Data[i].pStats;
+
+				if (Current.Type == SEARCH_QUERY_NODE_RANGE)
+					Matching += Stats.CountRange(Current.Column, Current.Min, Current.Max);
+				else
+					Matching += Stats.CountBits(Current.Column, Current.Mask, Current.Type == SEARCH_QUERY_NODE_MASK_ALL);
+
+				Classes += Stats.CountClasses(Current.ClassMask);
+			}
+
+			if (Rows > 0.0)
+				Selectivity = std::min(Matching, Classes) / Rows;
+
+			Cost = SEARCH_QUERY_COLUMN_COST;
+			break;
+		}
+	}
+
+	m_Nodes[Node].Selectivity = Selectivity;
+	m_Nodes[Node].Cost = Cost;
+}
+
+static const std::vector<unsigned int>& GetColumn(const SearchColumns &Columns, int Column)
+{
+	switch (Column)
+	{
+		case SEARCH_QUERY_COLUMN_JOBS: return Columns.Jobs;
+		case SEARCH_QUERY_COLUMN_SLOT: return Columns.Slot;
+		case SEARCH_QUERY_COLUMN_RACES: return Columns.Races;
+		case SEARCH_QUERY_COLUMN_FLAGS: return Columns.Flags;
+		case SEARCH_QUERY_COLUMN_LEVEL: return Columns.Level;
+		case SEARCH_QUERY_COLUMN_ITEM_LEVEL: return Columns.ItemLevel;
+		case SEARCH_QUERY_COLUMN_DAMAGE: return Columns.Damage;
+		case SEARCH_QUERY_COLUMN_DELAY: return Columns.Delay;
+		default: return Columns.Defense;
+	}
+}
+
+/*! \brief Runs the planned query on one inventory
+	\param[in] Data : indexes of the inventory, the same as one of those given to Plan
+	\param[out] Selection : one bit per row, set for the matching rows
+	\return the number of matching rows
+*/
+size_t SearchQuery::Execute(const SearchQueryData &Data, SearchBitset &Selection)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	Selection.Resize(Data.pColumns->GetCount(), true);
+
+	if (m_Nodes.empty() == false && Selection.GetCount() != 0)
+		Run(m_Root, Data, Selection);
+
+	m_ExecuteTime += GetElapsed(Start);
+
+	return Selection.CountSet();
+}
+
+// clears the selected rows that don't match the node
+void SearchQuery::Run(size_t Node, const SearchQueryData &Data, SearchBitset &Selection)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	const SearchQueryNode &Current = m_Nodes[Node];
+	size_t RowsIn = Selection.CountSet();
+
+	switch (Current.Type)
+	{
+		case SEARCH_QUERY_NODE_AND:
+			for (size_t i = 0; i < Current.Children.size() && Selection.IsEmpty() == false; ++i)
+				Run(Current.Children[i], Data, Selection);
+			break;
+		case SEARCH_QUERY_NODE_OR:
+		{
+			// each alternative only tests the rows that none of the previous ones matched
+			SearchBitset Remaining = Selection, Matched;
+
+			Selection.Clear();
+
+			for (size_t i = 0; i < Current.Children.size() && Remaining.IsEmpty() == false; ++i)
+			{
+				Matched = Remaining;
+				Run(Current.Children[i], Data, Matched);
+				Selection.Or(Matched);
+				Remaining.AndNot(Matched);
+			}
+			break;
+		}
+		case SEARCH_QUERY_NODE_NOT:
+		{
+			SearchBitset Matched = Selection;
+
+			Run(Current.Children[0], Data, Matched);
+			Selection.AndNot(Matched);
+			break;
+		}
+		case SEARCH_QUERY_NODE_TEXT:
+			Data.pText->Refine(Current.Text.c_str(), Selection, Current.FieldMask);
+			break;
+		default:
+		{
+			const SearchColumns &Columns = *Data.pColumns;
+			const std::vector<unsigned int> &Values = GetColumn(Columns, Current.Column);
+			size_t Count = Columns.GetCount();
+			SearchBitset Result;
+
+			if (Current.Type == SEARCH_QUERY_NODE_RANGE)
+				SearchKernelRange(&Values[0], Count, Current.Min, Current.Max, Result);
+			else if (Current.Type == SEARCH_QUERY_NODE_MASK_ANY)
+				SearchKernelMaskCompare(&Values[0], Count, Current.Mask, 0, false, Result);
+			else
+				SearchKernelMaskCompare(&Values[0], Count, Current.Mask, Current.Mask, true, Result);
+
+			if (Current.ClassMask != SEARCH_CLASS_ALL)
+			{
+				SearchBitset Classes;
+
+				SearchKernelMaskCompare(&Columns.Class[0], Count, Current.ClassMask, 0, false, Classes);
+				Result.And(Classes);
+			}
+
+			Selection.And(Result);
+			break;
+		}
+	}
+
+	m_Nodes[Node].RowsIn += RowsIn;
+	m_Nodes[Node].RowsOut += Selection.CountSet();
+	m_Nodes[Node].Elapsed += GetElapsed(Start);
+}
+
+void SearchQuery::ExplainNode(size_t Node, int Depth, std::wstring &Output) const
+{
+	const SearchQueryNode &Current = m_Nodes[Node];
+	wchar_t Line[256];
+
+	swprintf(Line, 256, L"%*ls%-*ls est %6.2f%%  rows %7u -> %-7u %8.3f ms\n",
+			 Depth * 2, L"", std::max(32 - Depth * 2, 1), Current.Label.c_str(),
+			 Current.Selectivity * 100.0, (unsigned int)Current.RowsIn, (unsigned int)Current.RowsOut, Current.Elapsed);
+	Output += Line;
+
+	for (size_t i = 0; i < Current.Children.size(); ++i)
+		ExplainNode(Current.Children[i], Depth + 1, Output);
+}
+
+/*! \brief Describes the plan with the estimated selectivity, the rows and the time of each predicate
+	\param[out] Output : one line per predicate in execution order, the times include the children
+*/
+void SearchQuery::Explain(std::wstring &Output) const
+{
+	wchar_t Line[256];
+
+	swprintf(Line, 256, L"%u rows in %u inventories\n", (unsigned int)m_Rows, (unsigned int)m_Inventories);
+	Output = Line;
+
+	if (m_Nodes.empty() == false)
+	{
+		if (m_Nodes[m_Root].Children.empty() && m_Nodes[m_Root].Type == SEARCH_QUERY_NODE_AND)
+			Output += L"every row matches\n";
+		else
+			ExplainNode(m_Root, 0, Output);
+	}
+
+	swprintf(Line, 256, L"planning %.3f ms, execution %.3f ms\n", m_PlanTime, m_ExecuteTime);
+	Output += Line;
+}
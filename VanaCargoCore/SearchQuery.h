@@ -0,0 +1,176 @@
+#ifndef __SEARCH_QUERY_CLASS__
+#define __SEARCH_QUERY_CLASS__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "SearchKernel.h"
+#include "SearchText.h"
+
+enum SEARCH_QUERY_NODE_TYPE
+{
+	SEARCH_QUERY_NODE_AND = 0,
+	SEARCH_QUERY_NODE_OR,
+	SEARCH_QUERY_NODE_NOT,
+	// the term is found in one of the fields of FieldMask
+	SEARCH_QUERY_NODE_TEXT,
+	// (column & Mask) != 0
+	SEARCH_QUERY_NODE_MASK_ANY,
+	// (column & Mask) == Mask
+	SEARCH_QUERY_NODE_MASK_ALL,
+	// Min <= column <= Max
+	SEARCH_QUERY_NODE_RANGE,
+	// character name pattern, removed from the tree once parsed
+	SEARCH_QUERY_NODE_CHARACTER
+};
+
+enum SEARCH_QUERY_COLUMN
+{
+	SEARCH_QUERY_COLUMN_JOBS = 0,
+	SEARCH_QUERY_COLUMN_SLOT,
+	SEARCH_QUERY_COLUMN_RACES,
+	SEARCH_QUERY_COLUMN_FLAGS,
+	SEARCH_QUERY_COLUMN_LEVEL,
+	SEARCH_QUERY_COLUMN_ITEM_LEVEL,
+	SEARCH_QUERY_COLUMN_DAMAGE,
+	SEARCH_QUERY_COLUMN_DELAY,
+	SEARCH_QUERY_COLUMN_DEFENSE,
+	SEARCH_QUERY_COLUMN_COUNT
+};
+
+/*! \brief Value distribution of the search columns of an inventory
+
+	The numeric columns are kept sorted so that the number of rows in a range is
+	exact, the mask columns only keep the number of rows having each bit set.
+*/
+class SearchColumnStats
+{
+public:
+	SearchColumnStats() : m_Count(0) {}
+
+	void Build(const SearchColumns &Columns);
+	size_t GetCount() const { return m_Count; }
+
+	size_t CountRange(int Column, unsigned int Min, unsigned int Max) const;
+	size_t CountBits(int Column, unsigned int Mask, bool All) const;
+	size_t CountClasses(unsigned int ClassMask) const;
+
+protected:
+	size_t m_Count;
+	std::vector<unsigned int> m_Sorted[SEARCH_QUERY_COLUMN_COUNT];
+	std::vector<size_t> m_BitCounts[SEARCH_QUERY_COLUMN_COUNT];
+	size_t m_ClassCounts[3];
+};
+
+// the indexes of one inventory a query runs on
+typedef struct _SearchQueryData
+{
+	const SearchColumns *pColumns;
+	const SearchTextArena *pText;
+	const SearchColumnStats *pStats;
+} SearchQueryData;
+
+typedef struct _SearchQueryNode
+{
+	int Type;
+	// column predicates
+	int Column;
+	unsigned int Mask;
+	unsigned int Min;
+	unsigned int Max;
+	// item classes the predicate applies to, the other items never match it
+	unsigned int ClassMask;
+	// text predicates and character patterns
+	std::wstring Text;
+	unsigned int FieldMask;
+	// name of the predicate as written in the query, for EXPLAIN
+	std::wstring Label;
+	std::vector<size_t> Children;
+	// estimated fraction of the rows kept and cost per row, set by the planner
+	double Selectivity;
+	double Cost;
+	// measured while running
+	size_t RowsIn;
+	size_t RowsOut;
+	double Elapsed;
+} SearchQueryNode;
+
+/*! \brief Query expression parsed into a predicate tree and planned against the search indexes
+
+	Syntax: terms are implicitly AND-ed, OR and parentheses group them, NOT or a
+	leading '-' negates a term. A term is free text, a quoted string or a field
+	predicate such as name:"kote", job:SAM,NIN, lvl:99, ilvl>=119, dmg:20-30,
+	slot:hands, rare, ex:no or char:Mule*. A leading EXPLAIN keyword asks for the
+	plan and the timings of each predicate.
+
+	The children of every AND are run most selective and cheapest first, each
+	predicate only tests the rows the previous ones kept.
+*/
+class SearchQuery
+{
+public:
+	SearchQuery();
+
+	bool Parse(const wchar_t *pExpression, std::wstring &Error);
+
+	bool IsExplain() const { return m_Explain; }
+	bool HasCharacterFilter() const { return !m_Characters.empty(); }
+	bool MatchCharacter(const std::wstring &Name, const std::wstring &Id) const;
+
+	void Plan(const std::vector<SearchQueryData> &Data);
+	size_t Execute(const SearchQueryData &Data, SearchBitset &Selection);
+	void Explain(std::wstring &Output) const;
+
+	static bool MatchPattern(const wchar_t *pPattern, const wchar_t *pText);
+
+protected:
+	enum TOKEN_TYPE
+	{
+		TOKEN_END = 0,
+		TOKEN_WORD,
+		TOKEN_STRING,
+		TOKEN_OPEN,
+		TOKEN_CLOSE,
+		TOKEN_OPERATOR,
+		TOKEN_MINUS
+	};
+
+	typedef struct _Token
+	{
+		int Type;
+		std::wstring Text;
+		size_t Pos;
+	} Token;
+
+	bool Tokenize(const wchar_t *pExpression, std::wstring &Error);
+	bool ParseOr(size_t &Node, std::wstring &Error);
+	bool ParseAnd(size_t &Node, std::wstring &Error);
+	bool ParseUnary(size_t &Node, std::wstring &Error);
+	bool ParsePrimary(size_t &Node, std::wstring &Error);
+	bool ParsePredicate(const std::wstring &Field, const std::wstring &Operator,
+						const std::wstring &Value, size_t &Node, std::wstring &Error);
+	bool IsKeyword(const wchar_t *pKeyword) const;
+	size_t AddNode(int Type);
+	size_t AddNot(size_t Child);
+
+	void Estimate(size_t Node, const std::vector<SearchQueryData> &Data);
+	void Run(size_t Node, const SearchQueryData &Data, SearchBitset &Selection);
+	void ExplainNode(size_t Node, int Depth, std::wstring &Output) const;
+
+	std::vector<Token> m_Tokens;
+	size_t m_Current;
+
+	std::vector<SearchQueryNode> m_Nodes;
+	size_t m_Root;
+	// lower-case character name patterns, any of them selects a character
+	std::vector<std::wstring> m_Characters;
+	bool m_Explain;
+
+	size_t m_Rows;
+	size_t m_Inventories;
+	double m_PlanTime;
+	double m_ExecuteTime;
+};
+
+#endif//__SEARCH_QUERY_CLASS__
@@ -0,0 +1,314 @@
+#include "SearchText.h"
+
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#define SEARCH_TEXT_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#define SEARCH_TEXT_AVX2
+	#else
+		#define SEARCH_TEXT_AVX2 __attribute__((target("avx2")))
+	#endif
+	// SSE2 is part of x64 and of the default instruction set of the x86 compiler
+	#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+		#define SEARCH_TEXT_SSE2
+	#endif
+#endif
+
+// control characters are reserved for the field separators
+#define SEARCH_TEXT_SEPARATOR_END 0x20
+
+static inline SearchTextChar FoldChar(wchar_t Char)
+{
+	if (Char < SEARCH_TEXT_SEPARATOR_END)
+		return ' ';
+
+	return (SearchTextChar)towlower((wint_t)Char);
+}
+
+static inline unsigned int FirstBit(unsigned int Value)
+{
+#ifdef _MSC_VER
+	unsigned long Index;
+
+	_BitScanForward(&Index, Value);
+
+	return (unsigned int)Index;
+#else
+	return (unsigned int)__builtin_ctz(Value);
+#endif
+}
+
+// the first and last characters already matched, compare what lies between them
+static inline bool VerifyMatch(const SearchTextChar *pText, const SearchTextChar *pTerm, size_t Length)
+{
+	return (Length <= 2 || memcmp(pText + 1, pTerm + 1, (Length - 2) * sizeof(SearchTextChar)) == 0);
+}
+
+#ifdef SEARCH_TEXT_X86
+/*! \brief First/last character prefilter over 16 candidate positions per iteration
+	\param[in,out] Pos : first position to test, receives the first position left untested
+	\param[in] Last : last position a match can start at
+	\return the position of the match or (size_t)-1
+*/
+SEARCH_TEXT_AVX2 static size_t ScanAVX2(const SearchTextChar *pText, size_t &Pos, size_t Last,
+										const SearchTextChar *pTerm, size_t Length)
+{
+	const __m256i First = _mm256_set1_epi16((short)pTerm[0]);
+	const __m256i End = _mm256_set1_epi16((short)pTerm[Length - 1]);
+
+	for (; Pos + 16 <= Last + 1; Pos += 16)
+	{
+		__m256i BlockFirst = _mm256_loadu_si256((const __m256i*)(pText + Pos));
+		__m256i BlockLast = _mm256_loadu_si256((const __m256i*)(pText + Pos + Length - 1));
+		__m256i Cmp = _mm256_and_si256(_mm256_cmpeq_epi16(BlockFirst, First), _mm256_cmpeq_epi16(BlockLast, End));
+		// two mask bits per character, keep one
+		unsigned int Mask = (unsigned int)_mm256_movemask_epi8(Cmp) & 0x55555555;
+
+		while (Mask != 0)
+		{
+			size_t Candidate = Pos + FirstBit(Mask) / 2;
+
+			if (VerifyMatch(pText + Candidate, pTerm, Length))
+				return Candidate;
+
+			Mask &= Mask - 1;
+		}
+	}
+
+	return (size_t)-1;
+}
+#endif
+
+#ifdef SEARCH_TEXT_SSE2
+// same as ScanAVX2 with 8 candidate positions per iteration
+static size_t ScanSSE2(const SearchTextChar *pText, size_t &Pos, size_t Last,
+					   const SearchTextChar *pTerm, size_t Length)
+{
+	const __m128i First = _mm_set1_epi16((short)pTerm[0]);
+	const __m128i End = _mm_set1_epi16((short)pTerm[Length - 1]);
+
+	for (; Pos + 8 <= Last + 1; Pos += 8)
+	{
+		__m128i BlockFirst = _mm_loadu_si128((const __m128i*)(pText + Pos));
+		__m128i BlockLast = _mm_loadu_si128((const __m128i*)(pText + Pos + Length - 1));
+		__m128i Cmp = _mm_and_si128(_mm_cmpeq_epi16(BlockFirst, First), _mm_cmpeq_epi16(BlockLast, End));
+		unsigned int Mask = (unsigned int)_mm_movemask_epi8(Cmp) & 0x5555;
+
+		while (Mask != 0)
+		{
+			size_t Candidate = Pos + FirstBit(Mask) / 2;
+
+			if (VerifyMatch(pText + Candidate, pTerm, Length))
+				return Candidate;
+
+			Mask &= Mask - 1;
+		}
+	}
+
+	return (size_t)-1;
+}
+#endif
+
+/*! \brief Searches a folded term in a range of the arena
+	\param[in] pText : folded text
+	\param[in] Begin : first position of the range
+	\param[in] End : end of the range, a match never extends past it
+	\param[in] pTerm : folded term
+	\param[in] Length : length of the term
+	\return the position of the first match or End
+*/
+size_t SearchTextScan(const SearchTextChar *pText, size_t Begin, size_t End,
+					  const SearchTextChar *pTerm, size_t Length)
+{
+	if (pText == NULL || pTerm == NULL || Length == 0 || End < Begin || End - Begin < Length)
+		return End;
+
+	size_t Last = End - Length;
+	size_t Pos = Begin;
+	size_t Match = (size_t)-1;
+
+#ifdef SEARCH_TEXT_X86
+	if (SearchKernelHasAVX2())
+		Match = ScanAVX2(pText, Pos, Last, pTerm, Length);
+#endif
+#ifdef SEARCH_TEXT_SSE2
+	if (Match == (size_t)-1)
+		Match = ScanSSE2(pText, Pos, Last, pTerm, Length);
+#endif
+
+	if (Match != (size_t)-1)
+		return Match;
+
+	for (; Pos <= Last; ++Pos)
+	{
+		if (pText[Pos] == pTerm[0] && pText[Pos + Length - 1] == pTerm[Length - 1] &&
+			VerifyMatch(pText + Pos, pTerm, Length))
+			return Pos;
+	}
+
+	return End;
+}
+
+void SearchTextArena::Clear()
+{
+	m_Text.clear();
+	m_Offsets.clear();
+}
+
+void SearchTextArena::Reserve(size_t ItemCount, size_t CharCount)
+{
+	m_Text.reserve(CharCount);
+	m_Offsets.reserve(ItemCount + 1);
+}
+
+//! \brief Starts a new item, the following fields are added to it
+void SearchTextArena::AddItem()
+{
+	if (m_Offsets.empty())
+		m_Offsets.push_back(0);
+
+	m_Offsets.push_back(m_Text.size());
+}
+
+void SearchTextArena::AddField(const wchar_t *pText, size_t Length, int Field)
+{
+	if (pText == NULL || Length == 0)
+		return;
+
+	if (m_Offsets.empty())
+		AddItem();
+
+	size_t Start = m_Text.size();
+
+	m_Text.resize(Start + Length + 1);
+	m_Text[Start] = (SearchTextChar)(1 + Field % (SEARCH_TEXT_SEPARATOR_END - 1));
+
+	for (size_t i = 0; i < Length; ++i)
+		m_Text[Start + 1 + i] = FoldChar(pText[i]);
+
+	m_Offsets.back() = m_Text.size();
+}
+
+void SearchTextArena::AddField(const wchar_t *pText, int Field)
+{
+	if (pText != NULL)
+		AddField(pText, wcslen(pText), Field);
+}
+
+// field of a match, from the separator that precedes it
+int SearchTextArena::GetField(size_t Pos) const
+{
+	while (Pos > 0 && m_Text[Pos] >= SEARCH_TEXT_SEPARATOR_END)
+		--Pos;
+
+	return (int)m_Text[Pos] - 1;
+}
+
+size_t SearchTextArena::FoldTerm(const wchar_t *pTerm, std::vector<SearchTextChar> &Folded)
+{
+	size_t Length = (pTerm != NULL) ? wcslen(pTerm) : 0;
+
+	Folded.resize(Length);
+
+	for (size_t i = 0; i < Length; ++i)
+		Folded[i] = FoldChar(pTerm[i]);
+
+	return Length;
+}
+
+bool SearchTextArena::Contains(size_t Item, const wchar_t *pTerm) const
+{
+	std::vector<SearchTextChar> Term;
+	size_t Length = FoldTerm(pTerm, Term);
+
+	if (Length == 0 || Item >= GetCount())
+		return false;
+
+	size_t End = m_Offsets[Item + 1];
+
+	return (SearchTextScan(m_Text.empty() ? NULL : &m_Text[0], m_Offsets[Item], End, &Term[0], Length) != End);
+}
+
+/*! \brief Clears the selected items that don't contain the term
+	\param[in] pTerm : term to search, folded the same way as the text
+	\param[in,out] Selection : one bit per item, only the set bits are searched
+	\param[in] FieldMask : bit i set to search in the field i (SEARCH_TEXT_FIELD)
+	\return the number of items left in the selection
+*/
+size_t SearchTextArena::Refine(const wchar_t *pTerm, SearchBitset &Selection, unsigned int FieldMask) const
+{
+	std::vector<SearchTextChar> Term;
+	size_t Length = FoldTerm(pTerm, Term);
+	size_t Count = (Selection.GetCount() < GetCount()) ? Selection.GetCount() : GetCount();
+	size_t Kept = 0;
+
+	if (Length == 0)
+		return Selection.CountSet();
+
+	// items past the end of the arena have no text
+	for (size_t i = Selection.FindNext(Count); i < Selection.GetCount(); i = Selection.FindNext(i + 1))
+		Selection.Reset(i);
+
+	if (m_Text.empty())
+	{
+		Selection.Clear();
+		return 0;
+	}
+
+	size_t First = Selection.FindNext(0);
+
+	while (First < Count)
+	{
+		size_t Last = First;
+
+		while (Last + 1 < Count && Selection.Test(Last + 1))
+			++Last;
+
+		// consecutive items are contiguous in the arena, the whole run is scanned at once
+		size_t End = m_Offsets[Last + 1];
+		size_t Item = First;
+		size_t Pos = m_Offsets[Item];
+
+		while (Item <= Last)
+		{
+			Pos = SearchTextScan(&m_Text[0], Pos, End, &Term[0], Length);
+
+			// the items before the one holding the match don't contain the term
+			while (Item <= Last && m_Offsets[Item + 1] <= Pos)
+				Selection.Reset(Item++);
+
+			if (Item > Last)
+				break;
+
+			if (FieldMask != SEARCH_TEXT_ALL_FIELDS && ((FieldMask >> GetField(Pos)) & 1) == 0)
+			{
+				// not in one of the fields searched, look further in the same item
+				++Pos;
+				continue;
+			}
+
+			// a match can't cross the separator that starts the next item, skip to it
+			++Kept;
+			Pos = m_Offsets[++Item];
+		}
+
+		First = Selection.FindNext(Last + 1);
+	}
+
+	return Kept;
+}
+
+/*! \brief Searches the term in every item of the arena
+	\param[out] Result : one bit per item, set for the items containing the term
+	\return the number of matching items
+*/
+size_t SearchTextArena::Find(const wchar_t *pTerm, SearchBitset &Result, unsigned int FieldMask) const
+{
+	Result.Resize(GetCount(), true);
+
+	return Refine(pTerm, Result, FieldMask);
+}
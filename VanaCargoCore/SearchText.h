@@ -0,0 +1,66 @@
+#ifndef __SEARCH_TEXT_CLASS__
+#define __SEARCH_TEXT_CLASS__
+
+#include <stddef.h>
+#include <vector>
+
+#include "SearchKernel.h"
+
+// a UTF-16 code unit of the arena (wchar_t is 32-bit outside of Windows)
+typedef unsigned short SearchTextChar;
+
+// fields a text search can be restricted to, stored in the separator that starts each field
+enum SEARCH_TEXT_FIELD
+{
+	SEARCH_TEXT_FIELD_NAME = 0,
+	SEARCH_TEXT_FIELD_LOG_NAME,
+	SEARCH_TEXT_FIELD_DESCRIPTION,
+	SEARCH_TEXT_FIELD_ATTR,
+	SEARCH_TEXT_FIELD_SLOT,
+	SEARCH_TEXT_FIELD_RACES,
+	SEARCH_TEXT_FIELD_LEVEL,
+	SEARCH_TEXT_FIELD_JOBS,
+	SEARCH_TEXT_FIELD_REMARKS,
+	SEARCH_TEXT_FIELD_ID,
+	SEARCH_TEXT_FIELD_COUNT
+};
+
+#define SEARCH_TEXT_ALL_FIELDS 0xFFFFFFFF
+
+/*! \brief Case-folded text of every item stored back to back in one buffer
+
+	Each field is preceded by a control character holding its field so that a
+	match never spans two fields, items are located through their offsets. The text
+	is folded once when it is added so that searching never copies or lowers a string.
+*/
+class SearchTextArena
+{
+public:
+	void Clear();
+	void Reserve(size_t ItemCount, size_t CharCount);
+
+	void AddItem();
+	void AddField(const wchar_t *pText, size_t Length, int Field);
+	void AddField(const wchar_t *pText, int Field);
+
+	size_t GetCount() const { return m_Offsets.empty() ? 0 : m_Offsets.size() - 1; }
+	size_t GetLength() const { return m_Text.size(); }
+
+	bool Contains(size_t Item, const wchar_t *pTerm) const;
+	size_t Refine(const wchar_t *pTerm, SearchBitset &Selection, unsigned int FieldMask = SEARCH_TEXT_ALL_FIELDS) const;
+	size_t Find(const wchar_t *pTerm, SearchBitset &Result, unsigned int FieldMask = SEARCH_TEXT_ALL_FIELDS) const;
+
+protected:
+	static size_t FoldTerm(const wchar_t *pTerm, std::vector<SearchTextChar> &Folded);
+	int GetField(size_t Pos) const;
+
+	std::vector<SearchTextChar> m_Text;
+	// m_Offsets[i] is the first character of item i, the last entry is the end of the text
+	std::vector<size_t> m_Offsets;
+};
+
+// returns the position of the first occurrence of the folded term in [Begin, End) or End
+size_t SearchTextScan(const SearchTextChar *pText, size_t Begin, size_t End,
+					  const SearchTextChar *pTerm, size_t Length);
+
+#endif//__SEARCH_TEXT_CLASS__